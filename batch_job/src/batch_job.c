@@ -15,6 +15,7 @@ See the file COPYING for details.
 
 #include <sys/stat.h>
 
+#include <errno.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -44,7 +45,7 @@ static struct batch_queue_module batch_queue_unknown = {
 
 	NULL, NULL, NULL, NULL,
 
-	{NULL, NULL, NULL},
+	{NULL, NULL, NULL, NULL},
 
 	{NULL, NULL, NULL, NULL, NULL, NULL, NULL},
 };
@@ -254,6 +255,32 @@ batch_job_id_t batch_job_wait_timeout(struct batch_queue * q, struct batch_job_i
 	return q->module->job.wait(q, info, stoptime);
 }
 
+int batch_job_wait_many(struct batch_queue *q, struct batch_job_result *results, int max, time_t stoptime)
+{
+	if(max < 1) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if(q->module->job.wait_many) {
+		return q->module->job.wait_many(q, results, max, stoptime);
+	}
+
+	/* Otherwise, wait for the first job, and poll for the others without blocking. */
+	int n = 0;
+	while(n < max) {
+		batch_job_id_t jobid = q->module->job.wait(q, &results[n].info, n > 0 ? time(0) : stoptime);
+		if(jobid <= 0) {
+			return n > 0 ? n : jobid;
+		}
+
+		results[n].jobid = jobid;
+		n++;
+	}
+
+	return n;
+}
+
 int batch_job_remove(struct batch_queue *q, batch_job_id_t jobid)
 {
 	return q->module->job.remove(q, jobid);
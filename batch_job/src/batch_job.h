@@ -64,6 +64,12 @@ struct batch_job_info {
 	int disk_allocation_exhausted; /**< Non-zero if the job filled its loop device allocation to capacity, zero otherwise */
 };
 
+/** Describes one job returned by @ref batch_job_wait_many. */
+struct batch_job_result {
+	batch_job_id_t jobid;        /**< The id of the completed job. */
+	struct batch_job_info info;  /**< The details of the completed job. */
+};
+
 /** Create a new batch_job_info struct.
 @return A new empty batch_job_info struct.
 */
@@ -118,6 +124,20 @@ If less than zero, the operation timed out or was interrupted by a system event,
 */
 batch_job_id_t batch_job_wait_timeout(struct batch_queue *q, struct batch_job_info *info, time_t stoptime);
 
+/** Wait for one or more batch jobs to complete, with a timeout.
+Blocks until a batch job completes or the current time exceeds stoptime, and then
+returns without further waiting every other job already complete, up to max jobs.
+@param q The queue to wait on.
+@param results Pointer to an array of @ref batch_job_result structures that will be filled in with the completed jobs.
+@param max The length of the results array.
+@param stoptime An absolute time at which to stop waiting. If zero, wait forever. If less than or equal to the current time,
+then this function will check for complete jobs but will not block.
+@return If greater than zero, indicates the number of completed jobs in results.
+If equal to zero, there were no more jobs to wait for.
+If less than zero, the operation timed out or was interrupted by a system event, but may be tried again.
+*/
+int batch_job_wait_many(struct batch_queue *q, struct batch_job_result *results, int max, time_t stoptime);
+
 /** Remove a batch job.
 This call will start the removal process.
 You must still call @ref batch_job_wait to wait for the removal to complete.
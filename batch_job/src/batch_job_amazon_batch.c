@@ -586,6 +586,7 @@ const struct batch_queue_module batch_queue_amazon_batch = {
 		batch_job_amazon_batch_submit,
 		batch_job_amazon_batch_wait,
 		batch_job_amazon_batch_remove,
+		NULL,
 	},
 
 	{
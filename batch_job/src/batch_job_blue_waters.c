@@ -324,6 +324,7 @@ const struct batch_queue_module batch_queue_blue_waters = {
 		batch_job_cluster_submit,
 		batch_job_cluster_wait,
 		batch_job_cluster_remove,
+		NULL,
 	},
 
 	{
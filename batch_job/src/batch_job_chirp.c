@@ -392,6 +392,7 @@ const struct batch_queue_module batch_queue_chirp = {
 		batch_job_chirp_submit,
 		batch_job_chirp_wait,
 		batch_job_chirp_remove,
+		NULL,
 	},
 
 	{
@@ -263,16 +263,23 @@ static batch_job_id_t batch_job_cluster_submit (struct batch_queue * q, const ch
 	return -1;
 }
 
-static batch_job_id_t batch_job_cluster_wait (struct batch_queue * q, struct batch_job_info * info_out, time_t stoptime)
+/*
+Scan the status files of all jobs, and return every job complete, up to max,
+waiting until stoptime for at least one of them.
+*/
+
+static int batch_job_cluster_wait_many (struct batch_queue * q, struct batch_job_result * results, int max, time_t stoptime)
 {
 	struct batch_job_info *info;
 	batch_job_id_t jobid;
 	int t, c;
 
 	while(1) {
+		int n = 0;
+
 		UINT64_T ujobid;
 		itable_firstkey(q->job_table);
-		while(itable_nextkey(q->job_table, &ujobid, (void **) &info)) {
+		while(n < max && itable_nextkey(q->job_table, &ujobid, (void **) &info)) {
 			jobid = ujobid;
 			char *statusfile = string_format("%s.status.%" PRIbjid, cluster_name, jobid);
 			FILE *file = fopen(statusfile, "r");
@@ -294,11 +301,9 @@ static batch_job_id_t batch_job_cluster_wait (struct batch_queue * q, struct bat
 
 				if(info->finished != 0) {
 					unlink(statusfile);
-					info = itable_remove(q->job_table, jobid);
-					*info_out = *info;
-					free(info);
-					free(statusfile);
-					return jobid;
+					results[n].jobid = jobid;
+					results[n].info = *info;
+					n++;
 				}
 			} else {
 				debug(D_BATCH, "could not open status file \"%s\"", statusfile);
@@ -307,6 +312,15 @@ static batch_job_id_t batch_job_cluster_wait (struct batch_queue * q, struct bat
 			free(statusfile);
 		}
 
+		if(n > 0) {
+			/* remove the jobs from the table only once the scan is over. */
+			int i;
+			for(i = 0; i < n; i++) {
+				free(itable_remove(q->job_table, results[i].jobid));
+			}
+			return n;
+		}
+
 		if(itable_size(q->job_table) <= 0)
 			return 0;
 
@@ -322,6 +336,19 @@ static batch_job_id_t batch_job_cluster_wait (struct batch_queue * q, struct bat
 	return -1;
 }
 
+static batch_job_id_t batch_job_cluster_wait (struct batch_queue * q, struct batch_job_info * info_out, time_t stoptime)
+{
+	struct batch_job_result result;
+
+	int n = batch_job_cluster_wait_many(q, &result, 1, stoptime);
+	if(n > 0) {
+		*info_out = result.info;
+		return result.jobid;
+	}
+
+	return n;
+}
+
 static int batch_job_cluster_remove (struct batch_queue *q, batch_job_id_t jobid)
 {
 	struct batch_job_info *info;
@@ -449,6 +476,7 @@ const struct batch_queue_module batch_queue_cluster = {
 		batch_job_cluster_submit,
 		batch_job_cluster_wait,
 		batch_job_cluster_remove,
+		batch_job_cluster_wait_many,
 	},
 
 	{
@@ -475,6 +503,7 @@ const struct batch_queue_module batch_queue_moab = {
 		batch_job_cluster_submit,
 		batch_job_cluster_wait,
 		batch_job_cluster_remove,
+		batch_job_cluster_wait_many,
 	},
 
 	{
@@ -501,6 +530,7 @@ const struct batch_queue_module batch_queue_sge = {
 		batch_job_cluster_submit,
 		batch_job_cluster_wait,
 		batch_job_cluster_remove,
+		batch_job_cluster_wait_many,
 	},
 
 	{
@@ -527,6 +557,7 @@ const struct batch_queue_module batch_queue_pbs = {
 		batch_job_cluster_submit,
 		batch_job_cluster_wait,
 		batch_job_cluster_remove,
+		batch_job_cluster_wait_many,
 	},
 
 	{
@@ -553,6 +584,7 @@ const struct batch_queue_module batch_queue_torque = {
 		batch_job_cluster_submit,
 		batch_job_cluster_wait,
 		batch_job_cluster_remove,
+		batch_job_cluster_wait_many,
 	},
 
 	{
@@ -579,6 +611,7 @@ const struct batch_queue_module batch_queue_slurm = {
 		batch_job_cluster_submit,
 		batch_job_cluster_wait,
 		batch_job_cluster_remove,
+		batch_job_cluster_wait_many,
 	},
 
 	{
@@ -367,6 +367,7 @@ const struct batch_queue_module batch_queue_condor = {
 		batch_job_condor_submit,
 		batch_job_condor_wait,
 		batch_job_condor_remove,
+		NULL,
 	},
 
 	{
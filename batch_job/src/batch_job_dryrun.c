@@ -230,6 +230,7 @@ const struct batch_queue_module batch_queue_dryrun = {
 		batch_job_dryrun_submit,
 		batch_job_dryrun_wait,
 		batch_job_dryrun_remove,
+		NULL,
 	},
 
 	{
@@ -34,6 +34,7 @@ struct batch_queue_module {
 		batch_job_id_t (*submit) (struct batch_queue *Q, const char *command, const char *inputs, const char *outputs, struct jx *env_list, const struct rmsummary *resources);
 		batch_job_id_t (*wait) (struct batch_queue *Q, struct batch_job_info *info, time_t stoptime);
 		int (*remove) (struct batch_queue *Q, batch_job_id_t id);
+		int (*wait_many) (struct batch_queue *Q, struct batch_job_result *results, int max, time_t stoptime); /* optional, see batch_job_wait_many */
 	} job;
 
 	struct {
@@ -708,6 +708,7 @@ const struct batch_queue_module batch_queue_k8s = {
 		batch_job_k8s_submit,
 		batch_job_k8s_wait,
 		batch_job_k8s_remove,
+		NULL,
 	},
 
 	{
@@ -457,6 +457,7 @@ const struct batch_queue_module batch_queue_lambda = {
 	 batch_job_lambda_submit,
 	 batch_job_lambda_wait,
 	 batch_job_lambda_remove,
+	 NULL,
 	 },
 
 	{
@@ -108,6 +108,28 @@ static batch_job_id_t batch_job_local_wait (struct batch_queue * q, struct batch
 	}
 }
 
+/*
+Wait for the first job until stoptime, and then collect without blocking
+every other process that already exited.
+*/
+
+static int batch_job_local_wait_many (struct batch_queue *q, struct batch_job_result *results, int max, time_t stoptime)
+{
+	int n = 0;
+
+	while(n < max) {
+		batch_job_id_t jobid = batch_job_local_wait(q, &results[n].info, n > 0 ? time(0) : stoptime);
+		if(jobid <= 0) {
+			return n > 0 ? n : jobid;
+		}
+
+		results[n].jobid = jobid;
+		n++;
+	}
+
+	return n;
+}
+
 static int batch_job_local_remove (struct batch_queue *q, batch_job_id_t jobid)
 {
 	if(kill(jobid, SIGTERM) == 0) {
@@ -158,6 +180,7 @@ const struct batch_queue_module batch_queue_local = {
 		batch_job_local_submit,
 		batch_job_local_wait,
 		batch_job_local_remove,
+		batch_job_local_wait_many,
 	},
 
 	{
@@ -709,7 +709,8 @@ const struct batch_queue_module batch_queue_mpi = {
 	{
 	 batch_job_mpi_submit,
 	 batch_job_mpi_wait,
-	 batch_job_mpi_remove,},
+	 batch_job_mpi_remove,
+	 NULL,},
 
 	{
 	 batch_fs_mpi_chdir,
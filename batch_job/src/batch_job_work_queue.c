@@ -176,6 +176,31 @@ static batch_job_id_t batch_job_wq_wait (struct batch_queue * q, struct batch_jo
 	}
 }
 
+/*
+Wait for the first task until stoptime, and then collect the tasks whose
+results are already waiting in the queue.
+*/
+
+static int batch_job_wq_wait_many (struct batch_queue *q, struct batch_job_result *results, int max, time_t stoptime)
+{
+	int n = 0;
+
+	while(n < max) {
+		batch_job_id_t jobid = batch_job_wq_wait(q, &results[n].info, n > 0 ? time(0) : stoptime);
+		if(jobid <= 0) {
+			return n > 0 ? n : jobid;
+		}
+
+		results[n].jobid = jobid;
+		n++;
+
+		if(!work_queue_results_ready(q->data))
+			break;
+	}
+
+	return n;
+}
+
 static int batch_job_wq_remove (struct batch_queue *q, batch_job_id_t jobid)
 {
 	return 0;
@@ -278,6 +303,7 @@ const struct batch_queue_module batch_queue_wq = {
 		batch_job_wq_submit,
 		batch_job_wq_wait,
 		batch_job_wq_remove,
+		batch_job_wq_wait_many,
 	},
 
 	{
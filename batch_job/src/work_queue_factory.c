@@ -953,10 +953,14 @@ static void mainloop( struct batch_queue *queue )
 		time_t stoptime = time(0)+5;
 
 		while(1) {
-			struct batch_job_info info;
-			batch_job_id_t jobid;
-			jobid = batch_job_wait_timeout(queue,&info,stoptime);
-			if(jobid>0) {
+			struct batch_job_result results[64];
+			int i, count;
+			count = batch_job_wait_many(queue,results,64,stoptime);
+			if(count<=0) {
+				break;
+			}
+			for(i=0;i<count;i++) {
+				batch_job_id_t jobid = results[i].jobid;
 				if(itable_lookup(job_table,jobid)) {
 					itable_remove(job_table,jobid);
 					debug(D_WQ,"worker job %"PRId64" exited",jobid);
@@ -964,8 +968,6 @@ static void mainloop( struct batch_queue *queue )
 				} else {
 					// it may have been a job from a previous run.
 				}
-			} else {
-				break;
 			}
 		}
 
@@ -37,6 +37,37 @@ static int read_only_mode = 0;
 static char default_acl[PATH_MAX];
 static int acl_inherit_default_mode = 0;
 
+/*
+Parsed ACL files and tickets are cached by each server process, so that
+a permission check costs one stat of the file, rather than an open,
+read, close, and parse of it.  A cached copy is used only while the
+file's inode, size, mtime, and ctime are unchanged, and the file was
+last modified in an earlier second than it was loaded.  (A second write
+within the same second could leave the mtime unchanged.)  Writes made
+by this process also discard the cached copy directly.
+*/
+
+#define CHIRP_ACL_CACHE_MAX 4096
+
+struct acl_cache_entry {
+	struct chirp_stat info;
+	time_t loaded;
+	int nentries;
+	struct acl_cache_subject {
+		char *subject;
+		int flags;
+	} *entries;
+};
+
+struct ticket_cache_entry {
+	struct chirp_stat info;
+	time_t loaded;
+	struct chirp_ticket ct;
+};
+
+static struct hash_table *acl_cache = 0;
+static struct hash_table *ticket_cache = 0;
+
 void chirp_acl_force_readonly()
 {
 	read_only_mode = 1;
@@ -52,7 +83,126 @@ void chirp_acl_inherit_default( int onoff )
 	acl_inherit_default_mode = onoff;
 }
 
-static int ticket_read(char *ticket_filename, struct chirp_ticket *ct)
+static int cache_entry_valid(const struct chirp_stat *info, time_t loaded, const struct chirp_stat *current)
+{
+	return info->cst_ino == current->cst_ino
+		&& info->cst_size == current->cst_size
+		&& info->cst_mtime == current->cst_mtime
+		&& info->cst_ctime == current->cst_ctime
+		&& info->cst_mtime < loaded;
+}
+
+static void acl_cache_entry_delete(struct acl_cache_entry *e)
+{
+	int i;
+	if(!e)
+		return;
+	for(i = 0; i < e->nentries; i++)
+		free(e->entries[i].subject);
+	free(e->entries);
+	free(e);
+}
+
+static void acl_cache_invalidate(const char *dirname)
+{
+	if(acl_cache)
+		acl_cache_entry_delete(hash_table_remove(acl_cache, dirname));
+}
+
+static void acl_cache_clear(void)
+{
+	char *key;
+	struct acl_cache_entry *e;
+
+	hash_table_firstkey(acl_cache);
+	while(hash_table_nextkey(acl_cache, &key, (void **) &e)) {
+		hash_table_remove(acl_cache, key);
+		acl_cache_entry_delete(e);
+	}
+}
+
+/*
+Return the parsed ACL file belonging to this directory, from the cache
+if possible.  Returns null if the directory has no ACL file of its own,
+in which case the caller falls back to chirp_acl_open, which applies
+inheritance and the default ACL.
+*/
+
+static struct acl_cache_entry *acl_cache_lookup(const char *dirname)
+{
+	char aclpath[CHIRP_PATH_MAX];
+	char subject[CHIRP_LINE_MAX];
+	struct chirp_stat info;
+	struct acl_cache_entry *e;
+	CHIRP_FILE *aclfile;
+	int flags;
+
+	if(!acl_cache)
+		acl_cache = hash_table_create(0, 0);
+
+	string_nformat(aclpath, sizeof(aclpath), "%s/%s", dirname, CHIRP_ACL_BASE_NAME);
+	if(cfs->stat(aclpath, &info) == -1) {
+		acl_cache_invalidate(dirname);
+		return 0;
+	}
+
+	e = hash_table_lookup(acl_cache, dirname);
+	if(e && cache_entry_valid(&e->info, e->loaded, &info))
+		return e;
+
+	acl_cache_invalidate(dirname);
+
+	aclfile = cfs_fopen(aclpath, "r");
+	if(!aclfile)
+		return 0;
+
+	e = xxcalloc(1, sizeof(*e));
+	e->info = info;
+	e->loaded = time(0);
+	while(chirp_acl_read(aclfile, subject, &flags)) {
+		e->entries = xxrealloc(e->entries, sizeof(*e->entries) * (e->nentries + 1));
+		e->entries[e->nentries].subject = xxstrdup(subject);
+		e->entries[e->nentries].flags = flags;
+		e->nentries++;
+	}
+	chirp_acl_close(aclfile);
+
+	if(hash_table_size(acl_cache) >= CHIRP_ACL_CACHE_MAX)
+		acl_cache_clear();
+	hash_table_insert(acl_cache, dirname, e);
+
+	return e;
+}
+
+static void ticket_copy(struct chirp_ticket *dst, const struct chirp_ticket *src)
+{
+	size_t i;
+
+	*dst = *src;
+	dst->subject = xxstrdup(src->subject);
+	dst->ticket = xxstrdup(src->ticket);
+	dst->rights = xxmalloc(sizeof(*dst->rights) * (src->nrights + 1));
+	for(i = 0; i < src->nrights; i++) {
+		dst->rights[i].directory = xxstrdup(src->rights[i].directory);
+		dst->rights[i].acl = xxstrdup(src->rights[i].acl);
+	}
+}
+
+static void ticket_cache_invalidate(const char *ticket_filename)
+{
+	struct ticket_cache_entry *e;
+
+	if(!ticket_cache)
+		return;
+
+	e = hash_table_remove(ticket_cache, ticket_filename);
+	if(e) {
+		chirp_ticket_free(&e->ct);
+		free(e);
+	}
+}
+
+static int ticket_load(char *ticket_filename, struct chirp_ticket *ct)
 {
 	int rc;
 	buffer_t B[1];
@@ -76,12 +226,62 @@ out:
 	return rc == 0 ? 1 : 0;
 }
 
+static int ticket_read(char *ticket_filename, struct chirp_ticket *ct)
+{
+	struct chirp_stat info;
+	struct ticket_cache_entry *e;
+
+	if(!ticket_cache)
+		ticket_cache = hash_table_create(0, 0);
+
+	if(cfs->stat(ticket_filename, &info) == -1) {
+		ticket_cache_invalidate(ticket_filename);
+		return 0;
+	}
+
+	e = hash_table_lookup(ticket_cache, ticket_filename);
+	if(!e || !cache_entry_valid(&e->info, e->loaded, &info)) {
+		ticket_cache_invalidate(ticket_filename);
+
+		e = xxcalloc(1, sizeof(*e));
+		e->info = info;
+		e->loaded = time(0);
+		if(!ticket_load(ticket_filename, &e->ct)) {
+			free(e);
+			return 0;
+		}
+
+		if(hash_table_size(ticket_cache) >= CHIRP_ACL_CACHE_MAX) {
+			char *key;
+			struct ticket_cache_entry *old;
+			hash_table_firstkey(ticket_cache);
+			while(hash_table_nextkey(ticket_cache, &key, (void **) &old)) {
+				hash_table_remove(ticket_cache, key);
+				chirp_ticket_free(&old->ct);
+				free(old);
+			}
+		}
+		hash_table_insert(ticket_cache, ticket_filename, e);
+	}
+
+	/* A cached ticket may have expired since it was loaded. */
+	if(e->ct.expiration <= time(0)) {
+		ticket_cache_invalidate(ticket_filename);
+		return 0;
+	}
+
+	ticket_copy(ct, &e->ct);
+	return 1;
+}
+
 static int ticket_write(const char *ticket_filename, struct chirp_ticket *ct)
 {
 	int result;
 	char *str;
 	char tmp[CHIRP_PATH_MAX];
 
+	ticket_cache_invalidate(ticket_filename);
+
 	string_nformat(tmp, sizeof(tmp), "%s.%d", ticket_filename, (int)getpid());
 	CHIRP_FILE *tf = cfs_fopen(tmp, "w");
 	if(!tf)
@@ -147,8 +347,19 @@ static int do_chirp_acl_get(const char *dirname, const char *subject, int *total
 		}
 		*totalflags &= mask;
 	} else {
-		aclfile = chirp_acl_open(dirname);
-		if(aclfile) {
+		struct acl_cache_entry *e = acl_cache_lookup(dirname);
+		if(e) {
+			int i;
+			for(i = 0; i < e->nentries; i++) {
+				if(string_match(e->entries[i].subject, subject)) {
+					*totalflags |= e->entries[i].flags;
+				} else if(!strncmp(e->entries[i].subject, "group:", 6)) {
+					if(chirp_group_lookup(e->entries[i].subject, subject)) {
+						*totalflags |= e->entries[i].flags;
+					}
+				}
+			}
+		} else if((aclfile = chirp_acl_open(dirname))) {
 			while(chirp_acl_read(aclfile, aclsubject, &aclflags)) {
 				if(string_match(aclsubject, subject)) {
 					*totalflags |= aclflags;
@@ -363,6 +574,7 @@ int chirp_acl_ticket_delete(const char *subject, const char *ticket_subject)
 	}
 
 	if(strcmp(esubject, ct.subject) == 0 || strcmp(chirp_super_user, subject) == 0) {
+		ticket_cache_invalidate(ticket_filename);
 		status = cfs->unlink(ticket_filename);
 	} else {
 		errno = EACCES;
@@ -475,6 +687,7 @@ int chirp_acl_gctickets(void)
 				continue;
 			}
 			debug(D_CHIRP, "ticket %s expired (or corrupt), garbage collecting", digest);
+			ticket_cache_invalidate(d->name);
 			cfs->unlink(d->name);
 		}
 	}
@@ -615,6 +828,8 @@ int chirp_acl_set(const char *dirname, const char *subject, int flags, int reset
 	string_nformat(aclname,    sizeof(aclname),    "%s/%s",    dirname, CHIRP_ACL_BASE_NAME);
 	string_nformat(newaclname, sizeof(newaclname), "%s/%s.%d", dirname, CHIRP_ACL_BASE_NAME, (int) getpid());
 
+	acl_cache_invalidate(dirname);
+
 	if(reset_acl) {
 		aclfile = cfs_fopen_local("/dev/null", "r");
 	} else {
@@ -103,6 +103,17 @@ int do_stat(const char *file, struct stat *buf)
 	}
 }
 
+int do_connect(void)
+{
+	if(do_chirp) {
+		char subject[CHIRP_LINE_MAX];
+		chirp_reli_disconnect(host);
+		return chirp_reli_whoami(host, subject, sizeof(subject), STOPTIME);
+	} else {
+		return 0;
+	}
+}
+
 int do_bandwidth(const char *file, int bytes, int blocksize, int do_write)
 {
 	int offset = 0;
@@ -238,6 +249,11 @@ int main(int argc, char *argv[])
 	RUN_LOOP("stat", do_stat(fname, &buf));
 	RUN_LOOP("open", rc = do_open(fname, O_RDONLY | do_sync, 0777); do_close());
 
+	/* Each connection includes authentication and one small operation. */
+	RUN_LOOP("connect", do_connect());
+	if(average > 0)
+		printf("connect	%9.1f connections/sec\n", 1000000.0 / average);
+
 	if(bwloops == 0)
 		return 0;
 
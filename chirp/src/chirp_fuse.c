@@ -583,6 +583,7 @@ static void show_help(const char *cmd)
 	fprintf(stdout, " %-30s Run in foreground for debugging.\n", "-f,--foreground");
 	fprintf(stdout, " %-30s Comma-delimited list of tickets to use for authentication.\n", "-i,--tickets=<files>");
 	fprintf(stdout, " %-30s Mount options passed to FUSE.\n", "-m,--mount-options=<options>");
+	fprintf(stdout, " %-30s Read ahead up to this many blocks. (default is %d)\n", "-r,--readahead=<blocks>", (int) chirp_reli_readahead_get());
 	fprintf(stdout, " %-30s Send debugging to this file. (can also be :stderr, :stdout, :syslog, or :journal)\n", "-o,--debug-file=<file>");
 	fprintf(stdout, " %-30s Timeout for network operations. (default is %ds)\n", "-t,--timeout=<timeout>", chirp_fuse_timeout);
 	fprintf(stdout, " %-30s Show program version.\n", "-v,--version");
@@ -610,13 +611,14 @@ int main(int argc, char *argv[])
 		{"tickets", required_argument, 0, 'i'},
 		{"mount-options", required_argument, 0, 'm'},
 		{"debug-file", required_argument, 0, 'o'},
+		{"readahead", required_argument, 0, 'r'},
 		{"timeout", required_argument, 0, 't'},
 		{"version", no_argument, 0, 'v'},
 		{"help", no_argument, 0, 'h'},
 		{0, 0, 0, 0}
 	};
 
-	while((c = getopt_long(argc, argv, "a:b:d:Dfhi:m:o:t:v", long_options, NULL)) > -1) {
+	while((c = getopt_long(argc, argv, "a:b:d:Dfhi:m:o:r:t:v", long_options, NULL)) > -1) {
 		switch (c) {
 		case 'd':
 			debug_flags_set(optarg);
@@ -637,6 +639,9 @@ int main(int argc, char *argv[])
 		case 'o':
 			debug_config_file(optarg);
 			break;
+		case 'r':
+			chirp_reli_readahead_set(atoi(optarg));
+			break;
 		case 'a':
 			if (!auth_register_byname(optarg))
 				fatal("could not register authentication method `%s': %s", optarg, strerror(errno));
@@ -267,50 +267,72 @@ int chirp_matrix_set_row(struct chirp_matrix *a, int j, const void *data, time_t
 	return chirp_reli_pwrite_unbuffered(a->rfiles[index], data, a->element_size * a->width, offset, stoptime);
 }
 
-int chirp_matrix_set_range(struct chirp_matrix *a, int x, int y, int width, int height, const void *data, time_t stoptime)
+/*
+A range touches a strided region of each file that it spans, so it is
+transferred as one strided read or write per file, split into pieces of
+at most CHIRP_MATRIX_BULKIO_SIZE bytes to stay under the server's buffer
+limit.  Up to CHIRP_MATRIX_BULKIO_MAX pieces are sent through
+chirp_reli_bulkio at once.  This issues all the requests before waiting
+for any reply, so each host pays one round trip per batch rather than
+one per row, and all hosts work at the same time.
+*/
+
+#define CHIRP_MATRIX_BULKIO_SIZE (1024*1024)
+#define CHIRP_MATRIX_BULKIO_MAX 64
+
+static int chirp_matrix_range_io(struct chirp_matrix *a, chirp_bulkio_t type, int x, int y, int width, int height, char *data, time_t stoptime)
 {
+	struct chirp_bulkio bulkio[CHIRP_MATRIX_BULKIO_MAX];
+	INT64_T row_length = width * a->element_size;
+	int rows_per_io = MAX(1, CHIRP_MATRIX_BULKIO_SIZE / row_length);
+	int count = 0;
+	int i, j = 0;
+
 	if(x < 0 || y < 0 || width < 1 || height < 1 || (x + width) > a->width || (y + height) > a->height) {
 		errno = EINVAL;
 		return -1;
 	}
 
-	int j = 0;
-	const char *cdata = data;
-
-	for(j = 0; j < height; j++) {
+	while(j < height) {
 		int index = (y + j) / a->n_row_per_file;
-		INT64_T file_offset = (x + ((y + j) % a->n_row_per_file) * a->width) * a->element_size;
-		INT64_T buffer_offset = (j * width) * a->element_size;
-		INT64_T length = width * a->element_size;
-		INT64_T result = chirp_reli_pwrite_unbuffered(a->rfiles[index], &cdata[buffer_offset], length, file_offset, stoptime);
-		if(result != length)
-			return -1;
+		int row = (y + j) % a->n_row_per_file;
+		int nrows = MIN(MIN(rows_per_io, height - j), a->n_row_per_file - row);
+
+		struct chirp_bulkio *b = &bulkio[count++];
+		b->type = type;
+		b->file = a->rfiles[index];
+		b->buffer = &data[j * row_length];
+		b->length = nrows * row_length;
+		b->stride_length = row_length;
+		b->stride_skip = a->width * a->element_size;
+		b->offset = (x + row * a->width) * a->element_size;
+
+		j += nrows;
+
+		if(count == CHIRP_MATRIX_BULKIO_MAX || j == height) {
+			if(chirp_reli_bulkio(bulkio, count, stoptime) < 0)
+				return -1;
+			for(i = 0; i < count; i++) {
+				if(bulkio[i].result != bulkio[i].length) {
+					errno = bulkio[i].result < 0 ? bulkio[i].errnum : EIO;
+					return -1;
+				}
+			}
+			count = 0;
+		}
 	}
 
-	return j * width * a->element_size;
+	return height * row_length;
 }
 
-int chirp_matrix_get_range(struct chirp_matrix *a, int x, int y, int width, int height, void *data, time_t stoptime)
+int chirp_matrix_set_range(struct chirp_matrix *a, int x, int y, int width, int height, const void *data, time_t stoptime)
 {
-	if(x < 0 || y < 0 || width < 1 || height < 1 || (x + width) > a->width || (y + height) > a->height) {
-		errno = EINVAL;
-		return -1;
-	}
-
-	int j = 0;
-	char *cdata = data;
-
-	for(j = 0; j < height; j++) {
-		int index = (y + j) / a->n_row_per_file;
-		INT64_T file_offset = (x + ((y + j) % a->n_row_per_file) * a->width) * a->element_size;
-		INT64_T buffer_offset = (j * width) * a->element_size;
-		INT64_T length = width * a->element_size;
-		INT64_T result = chirp_reli_pread_unbuffered(a->rfiles[index], &cdata[buffer_offset], length, file_offset, stoptime);
-		if(result != length)
-			return -1;
-	}
+	return chirp_matrix_range_io(a, CHIRP_BULKIO_SWRITE, x, y, width, height, (char *) data, stoptime);
+}
 
-	return j * width * a->element_size;
+int chirp_matrix_get_range(struct chirp_matrix *a, int x, int y, int width, int height, void *data, time_t stoptime)
+{
+	return chirp_matrix_range_io(a, CHIRP_BULKIO_SREAD, x, y, width, height, data, stoptime);
 }
 
 int chirp_matrix_get_col(struct chirp_matrix *a, int i, void *data, time_t stoptime)
@@ -43,7 +43,9 @@ int main(int argc, char *argv[])
 	int randlimit = atoi(argv[6]);
 	time_t stoptime = time(0) + 3600;
 
-	double *data = malloc(width * 8);
+	int tile_width = MIN(width, 100);
+	int tile_height = MIN(height, 100);
+	double *data = malloc(MAX(width, tile_width * tile_height) * 8);
 
 	struct chirp_matrix *matrix;
 
@@ -132,6 +134,25 @@ int main(int argc, char *argv[])
 	stop = timestamp_get();
 	printf("cellwrite %8.0lf cells/sec\n", 1000000.0 * randlimit / (stop - start));
 
+	/*--------------------------------------------------------------------*/
+
+	start = timestamp_get();
+	for(i = 0; i < randlimit; i++) {
+		chirp_matrix_get_range(matrix, rand() % (width - tile_width + 1), rand() % (height - tile_height + 1), tile_width, tile_height, data, stoptime);
+	}
+	stop = timestamp_get();
+	printf("tileread  %8.0lf cells/sec\n", 1000000.0 * randlimit * tile_width * tile_height / (stop - start));
+
+	/*--------------------------------------------------------------------*/
+
+	start = timestamp_get();
+	for(i = 0; i < randlimit; i++) {
+		chirp_matrix_set_range(matrix, rand() % (width - tile_width + 1), rand() % (height - tile_height + 1), tile_width, tile_height, data, stoptime);
+	}
+	chirp_matrix_fsync(matrix, stoptime);
+	stop = timestamp_get();
+	printf("tilewrite %8.0lf cells/sec\n", 1000000.0 * randlimit * tile_width * tile_height / (stop - start));
+
 	/*-------------------------------------------------------------------*/
 
 
@@ -36,13 +36,17 @@ struct chirp_file {
 	INT64_T serial;
 	INT64_T stale;
 	char *buffer;
+	INT64_T buffer_size;
 	INT64_T buffer_valid;
 	INT64_T buffer_offset;
 	INT64_T buffer_dirty;
+	INT64_T window;
+	INT64_T next_offset;
 };
 
 struct hash_table *table = 0;
 static int chirp_reli_blocksize = 65536;
+static int chirp_reli_readahead = 16;
 static int chirp_reli_default_nreps = 0;
 
 INT64_T chirp_reli_blocksize_get()
@@ -55,6 +59,16 @@ void    chirp_reli_blocksize_set( INT64_T bs )
 	chirp_reli_blocksize = bs;
 }
 
+INT64_T chirp_reli_readahead_get()
+{
+	return chirp_reli_readahead;
+}
+
+void    chirp_reli_readahead_set( INT64_T blocks )
+{
+	chirp_reli_readahead = MAX(blocks,1);
+}
+
 static struct chirp_client * connect_to_host( const char *host, time_t stoptime )
 {
 	struct chirp_client *c;
@@ -166,9 +180,12 @@ struct chirp_file * chirp_reli_open( const char *host, const char *path, INT64_T
 				file->serial = chirp_client_serial(client);
 				file->stale = 0;
 				file->buffer = malloc(chirp_reli_blocksize);
+				file->buffer_size = file->buffer ? chirp_reli_blocksize : 0;
 				file->buffer_offset = 0;
 				file->buffer_valid = 0;
 				file->buffer_dirty = 0;
+				file->window = 0;
+				file->next_offset = 0;
 				return file;
 			} else {
 				if(errno!=ECONNRESET) return 0;
@@ -248,6 +265,115 @@ INT64_T chirp_reli_close( struct chirp_file *file, time_t stoptime )
 	}
 
 
+/*
+Each file handle keeps a window of blocks that grows while the file is
+accessed sequentially and drops back to a single block on a seek.  The
+buffer is refilled with a whole window of pread requests, all of which
+are sent before the first reply is read, so a sequential reader waits
+for one round trip per window rather than one per block.  Likewise,
+sequential writes are gathered into a window-sized buffer that is
+flushed as a pipelined series of pwrites.  Nothing is left outstanding
+between calls, because the connection to each host is shared by every
+open file.
+*/
+
+static INT64_T update_window( struct chirp_file *file, INT64_T offset )
+{
+	if(offset==file->next_offset) {
+		file->window = MIN(MAX(file->window*2,1),chirp_reli_readahead);
+	} else {
+		file->window = 1;
+	}
+	return file->window;
+}
+
+static int reserve_buffer( struct chirp_file *file, INT64_T size )
+{
+	char *buffer;
+
+	if(size<=file->buffer_size) return 1;
+
+	buffer = realloc(file->buffer,size);
+	if(!buffer) return 0;
+
+	file->buffer = buffer;
+	file->buffer_size = size;
+	return 1;
+}
+
+static INT64_T pread_pipelined( struct chirp_client *client, INT64_T fd, char *data, INT64_T length, INT64_T offset, time_t stoptime )
+{
+	INT64_T bs = chirp_reli_blocksize;
+	INT64_T total = 0;
+	INT64_T result, i;
+	int done = 0;
+	int error = 0;
+
+	for(i=0;i<length;i+=bs) {
+		result = chirp_client_pread_begin(client,fd,&data[i],MIN(bs,length-i),offset+i,stoptime);
+		if(result<0) return -1;
+	}
+
+	for(i=0;i<length;i+=bs) {
+		result = chirp_client_pread_finish(client,fd,&data[i],MIN(bs,length-i),offset+i,stoptime);
+		if(result<0) {
+			if(errno==ECONNRESET) return -1;
+			if(!done) error = errno;
+			done = 1;
+		} else if(!done) {
+			total += result;
+			if(result<MIN(bs,length-i)) done = 1;
+		}
+	}
+
+	if(total==0 && error) {
+		errno = error;
+		return -1;
+	}
+
+	return total;
+}
+
+static INT64_T pwrite_pipelined( struct chirp_client *client, INT64_T fd, const char *data, INT64_T length, INT64_T offset, time_t stoptime )
+{
+	INT64_T bs = chirp_reli_blocksize;
+	INT64_T total = 0;
+	INT64_T result, i;
+	int error = 0;
+
+	for(i=0;i<length;i+=bs) {
+		result = chirp_client_pwrite_begin(client,fd,&data[i],MIN(bs,length-i),offset+i,stoptime);
+		if(result<0) return -1;
+	}
+
+	for(i=0;i<length;i+=bs) {
+		result = chirp_client_pwrite_finish(client,fd,&data[i],MIN(bs,length-i),offset+i,stoptime);
+		if(result<0) {
+			if(errno==ECONNRESET) return -1;
+			if(!error) error = errno;
+		} else {
+			total += result;
+		}
+	}
+
+	if(error) {
+		errno = error;
+		return -1;
+	}
+
+	return total;
+}
+
+static INT64_T chirp_reli_pread_pipelined( struct chirp_file *file, void *data, INT64_T length, INT64_T offset, time_t stoptime )
+{
+	RETRY_FILE( result = pread_pipelined(client,file->fd,data,length,offset,stoptime); )
+}
+
+static INT64_T chirp_reli_pwrite_pipelined( struct chirp_file *file, const void *data, INT64_T length, INT64_T offset, time_t stoptime )
+{
+	RETRY_FILE( result = pwrite_pipelined(client,file->fd,data,length,offset,stoptime); )
+}
+
 INT64_T chirp_reli_pread_unbuffered( struct chirp_file *file, void *data, INT64_T length, INT64_T offset, time_t stoptime )
 {
 	RETRY_FILE( result = chirp_client_pread(client,file->fd,data,length,offset,stoptime); )
@@ -255,19 +381,25 @@ INT64_T chirp_reli_pread_unbuffered( struct chirp_file *file, void *data, INT64_
 
 static INT64_T chirp_reli_pread_buffered( struct chirp_file *file, void *data, INT64_T length, INT64_T offset, time_t stoptime )
 {
+	INT64_T result;
+	INT64_T size;
+
 	if(file->buffer_valid) {
 		if(offset >= file->buffer_offset && offset < (file->buffer_offset+file->buffer_valid) ) {
 			INT64_T blength;
 			blength = MIN(length,file->buffer_offset+file->buffer_valid-offset);
 			memcpy(data,&file->buffer[offset-file->buffer_offset],blength);
+			file->next_offset = offset+blength;
 			return blength;
 		}
 	}
 
 	chirp_reli_flush(file,stoptime);
 
-	if(length<=chirp_reli_blocksize) {
-		INT64_T result = chirp_reli_pread_unbuffered(file,file->buffer,chirp_reli_blocksize,offset,stoptime);
+	size = update_window(file,offset)*chirp_reli_blocksize;
+
+	if(length<=size && reserve_buffer(file,size)) {
+		result = chirp_reli_pread_pipelined(file,file->buffer,size,offset,stoptime);
 		if(result<0) {
 			file->buffer_offset = 0;
 			file->buffer_valid = 0;
@@ -279,11 +411,13 @@ static INT64_T chirp_reli_pread_buffered( struct chirp_file *file, void *data, I
 			file->buffer_dirty = 0;
 			result = MIN(result,length);
 			memcpy(data,file->buffer,result);
-			return result;
 		}
 	} else {
-		return chirp_reli_pread_unbuffered(file,data,length,offset,stoptime);
+		result = chirp_reli_pread_unbuffered(file,data,length,offset,stoptime);
 	}
+
+	if(result>0) file->next_offset = offset+result;
+	return result;
 }
 
 INT64_T chirp_reli_pread( struct chirp_file *file, void *data, INT64_T length, INT64_T offset, time_t stoptime )
@@ -316,21 +450,18 @@ INT64_T chirp_reli_pwrite_unbuffered( struct chirp_file *file, const void *data,
 
 static INT64_T chirp_reli_pwrite_buffered( struct chirp_file *file, const void *data, INT64_T length, INT64_T offset, time_t stoptime )
 {
-	if(length>=chirp_reli_blocksize) {
-		if(chirp_reli_flush(file,stoptime)<0) {
-			return -1;
-		} else {
-			return chirp_reli_pwrite_unbuffered(file,data,length,offset,stoptime);
-		}
-	}
+	INT64_T result;
+	INT64_T size;
 
 	if(file->buffer_valid>0) {
-		if( (file->buffer_offset + file->buffer_valid) == offset ) {
-			INT64_T blength = MIN(chirp_reli_blocksize-file->buffer_valid,length);
+		size = MIN(file->window*chirp_reli_blocksize,file->buffer_size);
+		if( (file->buffer_offset + file->buffer_valid) == offset && file->buffer_valid < size ) {
+			INT64_T blength = MIN(size-file->buffer_valid,length);
 			memcpy(&file->buffer[file->buffer_valid],data,blength);
 			file->buffer_valid += blength;
 			file->buffer_dirty = 1;
-			if(file->buffer_valid==chirp_reli_blocksize) {
+			file->next_offset = offset+blength;
+			if(file->buffer_valid==size) {
 				if(chirp_reli_flush(file,stoptime)<0) {
 					return -1;
 				}
@@ -347,9 +478,18 @@ static INT64_T chirp_reli_pwrite_buffered( struct chirp_file *file, const void *
 
 	/* if we got here, then the buffer is empty */
 
+	size = update_window(file,offset)*chirp_reli_blocksize;
+
+	if(length>=size || !reserve_buffer(file,size)) {
+		result = chirp_reli_pwrite_unbuffered(file,data,length,offset,stoptime);
+		if(result>0) file->next_offset = offset+result;
+		return result;
+	}
+
 	file->buffer_offset = offset;
 	file->buffer_valid = length;
 	file->buffer_dirty = 1;
+	file->next_offset = offset+length;
 	memcpy(file->buffer,data,length);
 	return length;
 }
@@ -424,7 +564,7 @@ INT64_T chirp_reli_flush( struct chirp_file *file, time_t stoptime )
 	INT64_T result;
 
 	if(file->buffer_valid && file->buffer_dirty) {
-		result = chirp_reli_pwrite_unbuffered(file,file->buffer,file->buffer_valid,file->buffer_offset,stoptime);
+		result = chirp_reli_pwrite_pipelined(file,file->buffer,file->buffer_valid,file->buffer_offset,stoptime);
 	} else {
 		result = 0;
 	}
@@ -779,6 +779,24 @@ aggregated together.  This function sets the current buffer size.
 
 void chirp_reli_blocksize_set(INT64_T bs);
 
+/** Return the maximum readahead window.
+When a file is read or written sequentially, this module grows its buffer
+up to this many blocks, and moves each buffer with a pipelined series of
+block-sized requests, so that one round trip covers the whole window.
+@return The maximum number of blocks buffered per open file.
+*/
+
+INT64_T chirp_reli_readahead_get();
+
+/** Set the maximum readahead window.
+When a file is read or written sequentially, this module grows its buffer
+up to this many blocks, and moves each buffer with a pipelined series of
+block-sized requests.  A value of one disables readahead and write-behind.
+@param blocks The maximum number of blocks buffered per open file.
+*/
+
+void chirp_reli_readahead_set(INT64_T blocks);
+
 /** Prepare to fork in a parallel program.
 The Chirp library is not thread-safe, but it can be used in a program
 that exploits parallelism by calling fork().  Before calling fork, this
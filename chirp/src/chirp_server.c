@@ -30,6 +30,7 @@
 #include "getopt_aux.h"
 #include "host_disk_info.h"
 #include "host_memory_info.h"
+#include "itable.h"
 #include "json.h"
 #include "jx.h"
 #include "jx_print.h"
@@ -93,6 +94,8 @@ static int         config_pipe[2] = {-1, -1};
 static char        hostname[DOMAIN_NAME_MAX];
 static int         idle_timeout = 60; /* one minute */
 static UINT64_T    minimum_space_free = 0;
+static int         prefork_connections = 100;
+static int         prefork_processes = 0; /* zero forks once per connection */
 static UINT64_T    root_quota = 0;
 static gid_t       safe_gid = 0;
 static uid_t       safe_uid = 0;
@@ -101,6 +104,9 @@ static int         sim_latency = 0;
 static int         stall_timeout = 3600; /* one hour */
 static time_t      starttime;
 
+static struct auth_state *backend_auth = 0;
+static struct auth_state *server_auth = 0;
+
 /* space_available() is a simple mechanism to ensure that a runaway client does
  * not use up every last drop of disk space on a machine.  This function
  * returns false if consuming the given amount of space will leave less than a
@@ -543,9 +549,15 @@ static void chirp_handler(struct link *l, const char *addr, const char *subject)
 	char *esubject;
 	buffer_t B[1]; /* output buffer */
 	void *buffer = xxmalloc(MAX_BUFFER_SIZE+1); /* general purpose temporary buffer w/ room for NUL */
+	struct itable *open_files; /* files left open are closed on disconnect */
+	UINT64_T ofd;
 
-	if(!chirp_acl_whoami(subject, &esubject))
+	if(!chirp_acl_whoami(subject, &esubject)) {
+		free(buffer);
 		return;
+	}
+
+	open_files = itable_create(0);
 
 	link_tune(l, LINK_TUNE_INTERACTIVE);
 
@@ -1042,9 +1054,12 @@ static void chirp_handler(struct link *l, const char *addr, const char *subject)
 				cfs->fstat(result, &info);
 				chirp_stat_encode(B, &info);
 				buffer_putliteral(B, "\n");
+				itable_insert(open_files, result, (void*)1);
 			}
 		} else if(sscanf(line, "close %" SCNd64, &fd) == 1) {
 			result = cfs->close(fd);
+			if(fd >= 0)
+				itable_remove(open_files, fd);
 		} else if(sscanf(line, "fchmod %" SCNd64 " %" SCNd64, &fd, &mode) == 2) {
 			result = cfs->fchmod(fd, mode);
 		} else if(sscanf(line, "fchown %" SCNd64 " %" SCNd64 " %" SCNd64, &fd, &uid, &gid) == 3) {
@@ -1683,22 +1698,23 @@ done:
 			debug(D_CHIRP, "= %" PRId64, result);
 	}
 die:
+	/* A pre-forked process serves other clients next, so nothing may outlive this one. */
+	itable_firstkey(open_files);
+	while(itable_nextkey(open_files, &ofd, NULL)) {
+		cfs->close(ofd);
+	}
+	itable_delete(open_files);
+
 	buffer_free(B);
 	free(esubject);
 	free(buffer);
 }
 
-static void chirp_receive(struct link *link, char url[CHIRP_PATH_MAX])
+/* Prepare a child process for receiving clients, by loading the backend and
+ * setting aside the authentication state for the server and the backend.
+ */
+static void chirp_receive_setup(const char *url)
 {
-	char *atype, *asubject;
-	char typesubject[AUTH_TYPE_MAX + AUTH_SUBJECT_MAX];
-	char addr[LINK_ADDRESS_MAX];
-	int port;
-
-	link_address_remote(link, addr, &port);
-
-	change_process_title("chirp_server [%s:%d] [backend starting]", addr, port, typesubject);
-
 	/* Authentication problems:
 	 *
 	 * Confuga and the thirdput RPC both use the auth module when acting as
@@ -1720,7 +1736,7 @@ static void chirp_receive(struct link *link, char url[CHIRP_PATH_MAX])
 	 * system. Fortunately, these are metadata files in Confuga so it does not
 	 * require talking to a storage node.
 	 */
-	struct auth_state *server_state = auth_clone();
+	server_auth = auth_clone();
 
 	/* Chirp's backend file system must be loaded here. HDFS loads in the JVM
 	 * which does not play nicely with fork. So, we only manipulate the backend
@@ -1734,15 +1750,34 @@ static void chirp_receive(struct link *link, char url[CHIRP_PATH_MAX])
 	 */
 	backend_setup(url);
 
-	change_process_title("chirp_server [%s:%d] [authenticating]", addr, port, typesubject);
-
-	struct auth_state *backend_state = auth_clone();
-	auth_replace(server_state);
+	backend_auth = auth_clone();
 
 	auth_ticket_server_callback(chirp_acl_ticket_callback);
+}
+
+/* Make a saved authentication state current, keeping a copy for the next client. */
+static struct auth_state *auth_restore(struct auth_state *saved)
+{
+	auth_replace(saved);
+	free(saved);
+	return auth_clone();
+}
+
+static void chirp_receive(struct link *link)
+{
+	char *atype, *asubject;
+	char typesubject[AUTH_TYPE_MAX + AUTH_SUBJECT_MAX];
+	char addr[LINK_ADDRESS_MAX];
+	int port;
+
+	link_address_remote(link, addr, &port);
+
+	change_process_title("chirp_server [%s:%d] [authenticating]", addr, port);
+
+	server_auth = auth_restore(server_auth);
 
 	if(auth_accept(link, &atype, &asubject, time(0) + idle_timeout)) {
-		auth_replace(backend_state);
+		backend_auth = auth_restore(backend_auth);
 
 		sprintf(typesubject, "%s:%s", atype, asubject);
 		free(atype);
@@ -1772,11 +1807,42 @@ static void chirp_receive(struct link *link, char url[CHIRP_PATH_MAX])
 
 		debug(D_LOGIN, "disconnected");
 	} else {
-		auth_free(backend_state);
 		debug(D_LOGIN, "authentication failed from %s:%d", addr, port);
 	}
 
 	link_close(link);
+}
+
+/* A pre-forked process loads the backend once, and then serves clients one
+ * at a time, so that neither fork nor backend_setup is paid per connection.
+ * Once privileges are downgraded after authentication, the process can no
+ * longer authenticate as root, so it serves just one client in that case.
+ */
+static void chirp_prefork(struct link *master, const char *url)
+{
+	pid_t parent = getppid();
+	int served = 0;
+
+	change_process_title("chirp_server [backend starting]");
+
+	chirp_receive_setup(url);
+
+	while(served < prefork_connections) {
+		if(getppid() != parent)
+			break;
+
+		change_process_title("chirp_server [waiting]");
+
+		struct link *l = link_accept(master, time(0) + 5);
+		if(!l)
+			continue;
+
+		chirp_receive(l);
+		served++;
+
+		if(safe_username)
+			break;
+	}
 
 	cfs->destroy();
 }
@@ -1870,6 +1936,8 @@ static void show_help(const char *cmd)
 	fprintf(stdout, " %-30s Set the maximum number of clients to accept at once. (default unlimited)\n", "-M,--max-clients=<count>");
 	fprintf(stdout, " %-30s Use this name when reporting to the catalog.\n", "-n,--catalog-name=<name>");
 	fprintf(stdout, " %-30s Rotate debug file once it reaches this size.\n", "-O,--debug-rotate-max=<bytes>");
+	fprintf(stdout, " %-30s Pre-fork this many processes to serve connections. (default: fork per connection)\n", "   --prefork=<count>");
+	fprintf(stdout, " %-30s Connections served by each pre-forked process. (default: %d)\n", "   --prefork-connections=<count>", prefork_connections);
 	fprintf(stdout, " %-30s Superuser for all directories. (default: none)\n", "-P,--superuser=<user>");
 	fprintf(stdout, " %-30s Listen on this port. (default: %d; arbitrary: 0)\n", "-p,--port=<port>", chirp_port);
 	fprintf(stdout, " %-30s Project this Chirp server belongs to.\n", "   --project-name=<name>");
@@ -1898,6 +1966,8 @@ int main(int argc, char *argv[])
 		LONGOPT_JOB_TIME_LIMIT                   = INT_MAX-2,
 		LONGOPT_INHERIT_DEFAULT_ACL              = INT_MAX-3,
 		LONGOPT_PROJECT_NAME                     = INT_MAX-4,
+		LONGOPT_PREFORK                          = INT_MAX-5,
+		LONGOPT_PREFORK_CONNECTIONS              = INT_MAX-6,
 	};
 
 	static const struct option long_options[] = {
@@ -1929,6 +1999,8 @@ int main(int argc, char *argv[])
 		{"pid-file", required_argument, 0, 'B'},
 		{"port", required_argument, 0, 'p'},
 		{"port-file", required_argument, 0, 'Z'},
+		{"prefork", required_argument, 0, LONGOPT_PREFORK},
+		{"prefork-connections", required_argument, 0, LONGOPT_PREFORK_CONNECTIONS},
 		{"project-name", required_argument, 0, LONGOPT_PROJECT_NAME},
 		{"read-only", no_argument, 0, 'R'},
 		{"root", required_argument, 0, 'r'},
@@ -1955,6 +2027,7 @@ int main(int argc, char *argv[])
 	int max_child_procs = 100;
 	const char *listen_on_interface = 0;
 	int total_child_procs = 0;
+	struct itable *prefork_procs = itable_create(0);
 	int did_explicit_auth = 0;
 	char port_file[PATH_MAX] = "";
 
@@ -2104,6 +2177,12 @@ int main(int argc, char *argv[])
 		case LONGOPT_PROJECT_NAME:
 			strncpy(chirp_project_name, optarg, sizeof(chirp_project_name)-1);
 			break;
+		case LONGOPT_PREFORK:
+			prefork_processes = atoi(optarg);
+			break;
+		case LONGOPT_PREFORK_CONNECTIONS:
+			prefork_connections = MAX(1, atoi(optarg));
+			break;
 		case 'h':
 		default:
 			show_help(argv[0]);
@@ -2269,7 +2348,26 @@ int main(int argc, char *argv[])
 			else if(WIFSIGNALED(status))
 				debug(D_PROCESS, "pid %d failed due to signal %d (%s) (%d total child procs)", pid, WTERMSIG(status), string_signal(WTERMSIG(status)), total_child_procs);
 			else assert(0);
-			total_child_procs--;
+			if(!itable_remove(prefork_procs, pid))
+				total_child_procs--;
+		}
+
+		/* Replace any pre-forked processes that have exited. */
+
+		while(itable_size(prefork_procs) < prefork_processes) {
+			pid = fork();
+			if(pid == 0) {
+				close(config_pipe[0]);
+				config_pipe[0] = -1;
+				chirp_prefork(link, chirp_url);
+				_exit(0);
+			} else if(pid > 0) {
+				itable_insert(prefork_procs, pid, (void*)1);
+				debug(D_PROCESS, "created pre-forked pid %d", pid);
+			} else {
+				debug(D_PROCESS, "couldn't fork: %s", strerror(errno));
+				break;
+			}
 		}
 
 		if(time(0) >= advertise_alarm) {
@@ -2285,11 +2383,12 @@ int main(int argc, char *argv[])
 
 		/* Wait for action on one of two ports: the master TCP port, or the internal pipe. */
 		/* If the limit of child procs has been reached, don't watch the TCP port. */
+		/* Pre-forked processes accept connections themselves. */
 
 		fd_set rfds;
 		FD_ZERO(&rfds);
 		FD_SET(config_pipe[0], &rfds);
-		if(max_child_procs == 0 || total_child_procs < max_child_procs) {
+		if(prefork_processes == 0 && (max_child_procs == 0 || total_child_procs < max_child_procs)) {
 			FD_SET(link_fd(link), &rfds);
 		}
 		int maxfd = MAX(link_fd(link), config_pipe[0]) + 1;
@@ -2315,7 +2414,10 @@ int main(int argc, char *argv[])
 				link_close(link);
 				close(config_pipe[0]);
 				config_pipe[0] = -1;
-				chirp_receive(l, chirp_url);
+				change_process_title("chirp_server [%s:%d] [backend starting]", addr, port);
+				chirp_receive_setup(chirp_url);
+				chirp_receive(l);
+				cfs->destroy();
 				_exit(0);
 			} else if(pid > 0) {
 				total_child_procs++;
@@ -28,8 +28,10 @@ See the file COPYING for details.
 #include <errno.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <stdarg.h>
 #include <ctype.h>
+#include <unistd.h>
 
 struct deltadb {
 	struct hash_table *table;
@@ -102,6 +104,25 @@ static int compat_checkpoint_read( struct deltadb *db, const char *filename )
 	return 1;
 }
 
+/* Move each key and value of a checkpoint object over to the hash table. */
+
+static void checkpoint_load( struct deltadb *db, struct jx *jcheckpoint )
+{
+	/* Skip objects that don't match the filter. */
+
+	struct jx_pair *p;
+	for(p=jcheckpoint->u.pairs;p;p=p->next) {
+		if(p->key->type!=JX_STRING) continue;
+		if(!deltadb_boolean_expr(db->filter_expr,p->value)) continue;
+		hash_table_insert(db->table,p->key->u.string_value,p->value);
+		p->value = 0;
+	}
+
+	/* Delete the leftover object with empty pairs. */
+
+	jx_delete(jcheckpoint);
+}
+
 /* Get a complete checkpoint file and reconstitute the state of the table. */
 
 static int checkpoint_read( struct deltadb *db, const char *filename )
@@ -119,21 +140,60 @@ static int checkpoint_read( struct deltadb *db, const char *filename )
 		return compat_checkpoint_read(db,filename);
 	}
 
-	/* For each key and value, move the value over to the hash table. */
+	checkpoint_load(db,jcheckpoint);
 
-	/* Skip objects that don't match the filter. */
+	return 1;
+}
 
-	struct jx_pair *p;
-	for(p=jcheckpoint->u.pairs;p;p=p->next) {
-		if(p->key->type!=JX_STRING) continue;
-		if(!deltadb_boolean_expr(db->filter_expr,p->value)) continue;
-		hash_table_insert(db->table,p->key->u.string_value,p->value);
-		p->value = 0;
+/*
+Use the index of intra-day checkpoints (see jx_database.h) to find the
+latest one taken before starttime, and load it.  It must be strictly
+before, so that the time record for starttime is still replayed.
+On success, returns true and sets log_offset to the place in the
+day's log to continue from.
+*/
+
+static int checkpoint_read_intraday( struct deltadb *db, int year, int day, time_t starttime, long *log_offset )
+{
+	char line[256];
+	long long t;
+	long loffset, coffset;
+	long checkpoint_offset = -1;
+
+	char *filename = string_format("%s/%d/%d.idx",db->logdir,year,day);
+	FILE *file = fopen(filename,"r");
+	free(filename);
+	if(!file) return 0;
+
+	while(fgets(line,sizeof(line),file)) {
+		if(sscanf(line,"%lld %ld %ld",&t,&loffset,&coffset)!=3) continue;
+		if(t>=starttime) break;
+		*log_offset = loffset;
+		checkpoint_offset = coffset;
 	}
 
-	/* Delete the leftover object with empty pairs. */
+	fclose(file);
 
-	jx_delete(jcheckpoint);
+	if(checkpoint_offset<0) return 0;
+
+	filename = string_format("%s/%d/%d.ckpts",db->logdir,year,day);
+	file = fopen(filename,"r");
+	free(filename);
+	if(!file) return 0;
+
+	struct jx *jcheckpoint = 0;
+	if(fseek(file,checkpoint_offset,SEEK_SET)==0) {
+		jcheckpoint = jx_parse_stream(file);
+	}
+
+	fclose(file);
+
+	if(!jcheckpoint || jcheckpoint->type!=JX_OBJECT) {
+		jx_delete(jcheckpoint);
+		return 0;
+	}
+
+	checkpoint_load(db,jcheckpoint);
 
 	return 1;
 }
@@ -292,16 +352,13 @@ on to the head of the current list.
 static void jx_merge_into( struct jx *current, struct jx *update )
 {
 	while(1) {
-		struct jx_pair *p = update->u.pairs;
+		struct jx_pair *p = jx_object_shift(update);
 		if(!p) break;
 
-		update->u.pairs = p->next;
-
 		struct jx *oldvalue = jx_remove(current,p->key);
 		if(oldvalue) jx_delete(oldvalue);
 
-		p->next = current->u.pairs;
-		current->u.pairs = p;
+		jx_insert_pair(current,p);
 	}
 }
 
@@ -374,7 +431,14 @@ int deltadb_time_event( struct deltadb *db, time_t starttime, time_t stoptime, t
 
 	if(current < (db->display_next)) return 1;
 
-	db->display_next += db->display_every;
+	/*
+	Advance to the first display time after the current time, so that
+	a gap in the log results in one output rather than a burst of them,
+	and the display times depend only on the previous time record.
+	*/
+	if(db->display_every>0) {
+		db->display_next += ((current-db->display_next)/db->display_every+1)*db->display_every;
+	}
 
 	if(display_mode==MODE_STREAM) {
 		db->deferred_time = current;
@@ -407,28 +471,47 @@ static int days_in_year( int y )
 	}
 }
 
-/*
-Play the log from starttime to stoptime by opening the appropriate
-checkpoint file and working ahead in the various log files.
-*/
+static void next_day( int *year, int *day )
+{
+	(*day)++;
+	if(*day>=days_in_year(*year)) {
+		(*year)++;
+		*day = 0;
+	}
+}
 
-static int log_play_time( struct deltadb *db, time_t starttime, time_t stoptime )
+static void previous_day( int *year, int *day )
 {
-	int file_errors = 0;
+	(*day)--;
+	if(*day<0) {
+		(*year)--;
+		*day = days_in_year(*year)-1;
+	}
+}
 
-	struct tm *starttm = localtime(&starttime);
+static int day_after( int year, int day, int stopyear, int stopday )
+{
+	return year>stopyear || (year==stopyear && day>stopday);
+}
 
-	int year = starttm->tm_year + 1900;
-	int day = starttm->tm_yday;
+/*
+Play the logs of the days from year/day through stopyear/stopday,
+beginning at the closest checkpoint before starttime, and stopping
+at stoptime.
+*/
 
-	struct tm *stoptm = localtime(&stoptime);
+static int log_play_days( struct deltadb *db, int year, int day, int stopyear, int stopday, time_t starttime, time_t stoptime )
+{
+	int file_errors = 0;
 
-	int stopyear = stoptm->tm_year + 1900;
-	int stopday = stoptm->tm_yday;
+	long offset = 0;
 
-	char *filename = string_format("%s/%d/%d.ckpt",db->logdir,year,day);
-	checkpoint_read(db,filename);
-	free(filename);
+	if(!checkpoint_read_intraday(db,year,day,starttime,&offset)) {
+		offset = 0;
+		char *filename = string_format("%s/%d/%d.ckpt",db->logdir,year,day);
+		checkpoint_read(db,filename);
+		free(filename);
+	}
 
 	while(1) {
 		char *filename = string_format("%s/%d/%d.log",db->logdir,year,day);
@@ -442,6 +525,13 @@ static int log_play_time( struct deltadb *db, time_t starttime, time_t stoptime
 
 		} else {
 			free(filename);
+
+			// Only the first log is entered part way through, at the checkpoint.
+			if(offset>0) {
+				fseek(file,offset,SEEK_SET);
+				offset = 0;
+			}
+
 			int keepgoing = deltadb_process_stream(db,file,starttime,stoptime);
 			starttime = 0;
 
@@ -451,19 +541,247 @@ static int log_play_time( struct deltadb *db, time_t starttime, time_t stoptime
 			if(!keepgoing) break;
 		}
 
-		day++;
-		if(day>=days_in_year(year)) {
-			year++;
-			day = 0;
-		}
+		next_day(&year,&day);
 
 		// If we have passed the file, stop.
-		if(year>=stopyear && day>stopday) break;
+		if(day_after(year,day,stopyear,stopday)) break;
 	}
 
 	return 1;
 }
 
+/*
+Play the log from starttime to stoptime by opening the closest
+checkpoint before starttime and working ahead in the various log files.
+*/
+
+static int log_play_time( struct deltadb *db, time_t starttime, time_t stoptime )
+{
+	struct tm *starttm = localtime(&starttime);
+
+	int year = starttm->tm_year + 1900;
+	int day = starttm->tm_yday;
+
+	struct tm *stoptm = localtime(&stoptime);
+
+	int stopyear = stoptm->tm_year + 1900;
+	int stopday = stoptm->tm_yday;
+
+	return log_play_days(db,year,day,stopyear,stopday,starttime,stoptime);
+}
+
+/*
+Return the last time record in a log file, reading backwards
+from the end in blocks until one is found, or zero if none.
+Blocks overlap slightly, so that a record split between two
+blocks is seen whole in one of them.
+*/
+
+#define LOG_TAIL_BLOCK 65536
+#define LOG_TAIL_OVERLAP 64
+
+static time_t log_last_time( const char *filename )
+{
+	static char block[LOG_TAIL_BLOCK+1];
+	long long t = 0;
+
+	FILE *file = fopen(filename,"r");
+	if(!file) return 0;
+
+	fseek(file,0,SEEK_END);
+	long end = ftell(file);
+
+	while(end>0) {
+		long start = end>LOG_TAIL_BLOCK ? end-LOG_TAIL_BLOCK : 0;
+
+		fseek(file,start,SEEK_SET);
+		size_t length = fread(block,1,end-start,file);
+		block[length] = 0;
+
+		if(start==0) sscanf(block,"T %lld",&t);
+
+		char *line = block;
+		while((line = strstr(line,"\nT "))) {
+			line++;
+			sscanf(line,"T %lld",&t);
+		}
+
+		if(t || start==0) break;
+
+		end = start + LOG_TAIL_OVERLAP;
+	}
+
+	fclose(file);
+	return t;
+}
+
+/*
+A segment of the query is a run of days that begins with a day that
+has a checkpoint (or the first day of the query) and so can be played
+without the days before it.
+*/
+
+struct segment {
+	int year, day;
+	int stopyear, stopday;
+	pid_t pid;
+	FILE *output;
+	int done;
+};
+
+/*
+Play one segment in a child process, writing its output to a temporary
+file.  Outputs are computed from the table at single instants, so each
+segment can be played independently once its display times are aligned
+with those of a sequential run: the next display is the first one after
+the last time record of the previous day.
+*/
+
+static int segment_start( struct deltadb *db, struct segment *seg, int first, time_t starttime, time_t stoptime )
+{
+	seg->output = tmpfile();
+	if(!seg->output) return 0;
+
+	fflush(stdout);
+
+	seg->pid = fork();
+	if(seg->pid<0) {
+		fclose(seg->output);
+		seg->output = 0;
+		return 0;
+	} else if(seg->pid>0) {
+		return 1;
+	}
+
+	dup2(fileno(seg->output),STDOUT_FILENO);
+
+	if(!first) {
+		int year = seg->year;
+		int day = seg->day;
+		previous_day(&year,&day);
+
+		char *filename = string_format("%s/%d/%d.log",db->logdir,year,day);
+		time_t last = log_last_time(filename);
+		free(filename);
+
+		if(last>=starttime && db->display_every>0) {
+			db->display_next = starttime + ((last-starttime)/db->display_every+1)*db->display_every;
+		}
+	}
+
+	log_play_days(db,seg->year,seg->day,seg->stopyear,seg->stopday,starttime,stoptime);
+
+	fflush(stdout);
+	_exit(0);
+}
+
+/* Copy the output of a completed segment to stdout. */
+
+static void segment_finish( struct segment *seg )
+{
+	char buffer[65536];
+	size_t length;
+
+	rewind(seg->output);
+	while((length = fread(buffer,1,sizeof(buffer),seg->output))>0) {
+		fwrite(buffer,1,length,stdout);
+	}
+	fflush(stdout);
+
+	fclose(seg->output);
+	seg->output = 0;
+}
+
+/*
+Play the log from starttime to stoptime by dividing it into segments
+at each daily checkpoint, and playing up to jobs segments at once,
+each in its own process.  The output of each segment is written out
+in order as soon as it and all the segments before it are complete.
+*/
+
+static int log_play_time_parallel( struct deltadb *db, time_t starttime, time_t stoptime, int jobs )
+{
+	struct tm *starttm = localtime(&starttime);
+
+	int year = starttm->tm_year + 1900;
+	int day = starttm->tm_yday;
+
+	struct tm *stoptm = localtime(&stoptime);
+
+	int stopyear = stoptm->tm_year + 1900;
+	int stopday = stoptm->tm_yday;
+
+	struct segment *segments = 0;
+	int nsegments = 0;
+
+	for(;!day_after(year,day,stopyear,stopday);next_day(&year,&day)) {
+		char *filename = string_format("%s/%d/%d.ckpt",db->logdir,year,day);
+		int has_checkpoint = access(filename,R_OK)==0;
+		free(filename);
+
+		if(nsegments==0 || has_checkpoint) {
+			segments = realloc(segments,sizeof(*segments)*(nsegments+1));
+			memset(&segments[nsegments],0,sizeof(*segments));
+			segments[nsegments].year = year;
+			segments[nsegments].day = day;
+			nsegments++;
+		}
+
+		segments[nsegments-1].stopyear = year;
+		segments[nsegments-1].stopday = day;
+	}
+
+	debug(D_DEBUG,"playing %d segments with %d jobs",nsegments,jobs);
+
+	int started = 0;
+	int finished = 0;
+	int running = 0;
+	int result = 1;
+
+	while(finished<nsegments) {
+
+		/* Start as many segments as allowed. */
+		while(started<nsegments && running<jobs && result) {
+			if(!segment_start(db,&segments[started],started==0,starttime,stoptime)) {
+				fprintf(stderr,"deltadb_query: couldn't start process: %s\n",strerror(errno));
+				result = 0;
+				break;
+			}
+			started++;
+			running++;
+		}
+
+		if(running==0) break;
+
+		/* Wait for any one to complete. */
+		int status;
+		pid_t pid = wait(&status);
+		if(pid<0) break;
+
+		for(int i=finished;i<started;i++) {
+			if(segments[i].pid==pid) {
+				segments[i].done = 1;
+				running--;
+				if(!WIFEXITED(status) || WEXITSTATUS(status)!=0) result = 0;
+				break;
+			}
+		}
+
+		/* Write out the completed segments in order. */
+		while(finished<started && segments[finished].done) {
+			segment_finish(&segments[finished]);
+			finished++;
+		}
+	}
+
+	for(int i=finished;i<nsegments;i++) {
+		if(segments[i].output) fclose(segments[i].output);
+	}
+	free(segments);
+
+	return result;
+}
+
 int suffix_to_multiplier( char suffix )
 {
 	switch(tolower(suffix)) {
@@ -498,9 +816,9 @@ time_t parse_time( const char *str, time_t current )
 	if(n==6) {
 		if (t.tm_hour>23)
 			t.tm_hour = 0;
-		if (t.tm_min>23)
+		if (t.tm_min>59)
 			t.tm_min = 0;
-		if (t.tm_sec>23)
+		if (t.tm_sec>59)
 			t.tm_sec = 0;
 
 		t.tm_year -= 1900;
@@ -532,6 +850,7 @@ static struct option long_options[] =
 	{"at", required_argument, 0, 'A'},
 	{"every", required_argument, 0, 'e'},
 	{"epoch", no_argument, 0, 't'},
+	{"jobs", required_argument, 0, 'j'},
 	{"version", no_argument, 0, 'v'},
 	{"help", no_argument, 0, 'h'},
 	{0,0,0,0}
@@ -550,6 +869,7 @@ void show_help()
 	printf("  --to <time>         End query at this absolute time.\n");
 	printf("  --every <interval>  Compute output at this time interval.\n");
 	printf("  --epoch             Display time column in Unix epoch format.\n");
+	printf("  --jobs <n>          Play up to this many days at once. (outputs only)\n");
 	printf("  --version           Show software version.\n");
 	printf("  --help              Show this help text.\n");
 }
@@ -566,6 +886,7 @@ int main( int argc, char *argv[] )
 	time_t stop_time = 0;
 	int display_every = 0;
 	int epoch_mode = 0;
+	int jobs = 1;
 
 	char reduce_name[1024];
 	char reduce_attr[1024];
@@ -574,7 +895,7 @@ int main( int argc, char *argv[] )
 
 	int c;
 
-	while((c=getopt_long(argc,argv,"D:L:o:w:f:F:T:e:tvh",long_options,0))!=-1) {
+	while((c=getopt_long(argc,argv,"D:L:o:w:f:F:T:e:j:tvh",long_options,0))!=-1) {
 		switch(c) {
 		case 'D':
 			dbdir = optarg;
@@ -640,6 +961,13 @@ int main( int argc, char *argv[] )
 		case 't':
 			epoch_mode = 1;
 			break;
+		case 'j':
+			jobs = atoi(optarg);
+			if(jobs<1) {
+				fprintf(stderr,"deltadb_query: --jobs must be at least one\n");
+				return 1;
+			}
+			break;
 		case 'v':
 			cctools_version_print(stdout,"deltadb_query");
 			break;
@@ -696,6 +1024,9 @@ int main( int argc, char *argv[] )
 		}
 		deltadb_process_stream(db,file,start_time,stop_time);
 		fclose(file);
+	} else if(jobs>1 && display_mode!=MODE_STREAM) {
+		/* A stream of events cannot be split, as each day would begin without its create events. */
+		if(!log_play_time_parallel(db,start_time,stop_time,jobs)) return 1;
 	} else {
 		log_play_time(db,start_time,stop_time);
 	}
@@ -40,20 +40,22 @@ SECTION(OPTIONS)
 OPTIONS_BEGIN
 OPTION_ITEM(`-b, --background')Run as a daemon.
 OPTION_TRIPLET(-B, pid-file,file)Write process identifier (PID) to file.
+OPTION_TRIPLET(-C, checkpoint-interval, time) Write a checkpoint of the history at this interval during the day, so that historical queries can start near the time of interest. Each checkpoint is a full copy of the table, so hourly checkpoints store 24 more copies a day than daily ones. (default is 1h, 0 writes only daily checkpoints)
 OPTION_TRIPLET(-d, debug, flag)Enable debugging for this subsystem
 OPTION_ITEM(`-h, --help')Show this help screen
 OPTION_TRIPLET(-H, history, directory) Store catalog history in this directory.  Enables fast data recovery after a failure or restart, and enables historical queries via deltadb_query.
 OPTION_TRIPLET(-I, interface, addr)Listen only on this network interface.
 OPTION_TRIPLET(-l, lifetime, secs)Lifetime of data, in seconds (default is 1800)
 OPTION_TRIPLET(-L, update-log,file)Log new updates to this file.
-OPTION_TRIPLET(-m, max-jobs,n)Maximum number of child processes.  (default is 50)
+OPTION_TRIPLET(-m, max-jobs,n)Maximum number of queries answered at once.  (default is 50)
 OPTION_TRIPLET(-M, server-size, size)Maximum size of a server to be believed.  (default is any)
 OPTION_TRIPLET(-n, name, name)Set the preferred hostname of this server.
 OPTION_TRIPLET(-o,debug-file,file)Write debugging output to this file. By default, debugging is sent to stderr (":stderr"). You may specify logs be sent to stdout (":stdout"), to the system syslog (":syslog"), or to the systemd journal (":journal").
 OPTION_TRIPLET(-O, debug-rotate-max, bytes)Rotate debug file once it reaches this size (default 10M, 0 disables).
 OPTION_TRIPLET(-p,, port, port)Port number to listen on (default is 9097)
-OPTION_ITEM(`-S, --single')Single process mode; do not fork on queries.
-OPTION_TRIPLET(-T, timeout, time)Maximum time to allow a query process to run.  (default is 60s)
+OPTION_ITEM(`-S, --single')Single thread mode; answer queries one at a time in the main thread.
+OPTION_TRIPLET(-t, threads, n)Number of threads that parse incoming updates.  (default is 4, 0 parses them in the main thread)
+OPTION_TRIPLET(-T, timeout, time)Maximum time to allow for answering a query.  (default is 60s)
 OPTION_TRIPLET(-u, update-host, host)Send status updates to this host. (default is catalog.cse.nd.edu,backup-catalog.cse.nd.edu)
 OPTION_TRIPLET(-U, update-interval, time)Send status updates at this interval. (default is 5m)
 OPTION_ITEM(`-v, --version')Show version string
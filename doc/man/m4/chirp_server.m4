@@ -40,6 +40,8 @@ OPTION_TRIPLET(-M, max-clients,count)Set the maximum number of clients to accept
 OPTION_TRIPLET(-n, catalog-name,name)Use this name when reporting to the catalog.
 OPTION_TRIPLET(-o,debug-file,file)Write debugging output to this file. By default, debugging is sent to stderr (":stderr"). You may specify logs be sent to stdout (":stdout"), to the system syslog (":syslog"), or to the systemd journal (":journal").
 OPTION_TRIPLET(-O, debug-rotate-max,bytes)Rotate debug file once it reaches this size.
+OPTION_PAIR(--prefork,count)Pre-fork this many processes to serve connections, instead of forking once per connection.
+OPTION_PAIR(--prefork-connections,count)Connections served by each pre-forked process before it is replaced. (default is 100)
 OPTION_TRIPLET(-P,superuser,user)Superuser for all directories. (default is none)
 OPTION_TRIPLET(-p,port,port)Listen on this port (default is 9094, arbitrary is 0)
 OPTION_PAIR(--project-name,name)Project name this Chirp server belongs to.
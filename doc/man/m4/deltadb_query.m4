@@ -27,6 +27,7 @@ OPTION_ITEM(--from time) (required) The starting date and time of the query in a
 OPTION_ITEM(--to time) The ending time of the query, in the same format as the --from option.  If omitted, the current time is assumed.
 OPTION_ITEM(--every interval) The intervals at which output should be produced, like 5s, 5m, 5h, 5d to indicate five seconds, minutes, hours, or days ago, respectively.
 OPTION_ITEM(--epoch) Causes the output to be expressed in integer Unix epoch time, instead of a formatted time.
+OPTION_ITEM(--jobs n) Play up to n days of the history at once in separate processes, which speeds up queries over many days.  Each day with a checkpoint starts a new segment.  Applies to outputs and reductions, not to the raw event stream.
 OPTION_ITEM(--filter expr) (multiple) If given, only records matching this expression will be processed.  Use --filter to apply expressions that do not change over time, such as the name or type of a record.
 OPTION_ITEM(--where expr)  (multiple) If given, only records matching this expression will be displayed.  Use --where to apply expressions that may change over time, such as load average or storage space consumed.
 OPTION_ITEM(--output expr) (multiple) Display this expression on the output.
@@ -0,0 +1,297 @@
+/*
+Copyright (C) 2019- The University of Notre Dame
+This software is distributed under the GNU General Public License.
+See the file COPYING for details.
+*/
+
+/*
+catalog_benchmark loads a running catalog server with a storm of UDP
+updates, while other clients query it over HTTP, and reports how many
+updates per second the server took in, and how long queries took.
+
+Every update describes a new record, so that the number of records that
+reach the table is the number of updates the server received.  Records
+are tagged with a run identifier, so that the benchmark can be repeated
+against the same server.
+*/
+
+#include "catalog_query.h"
+#include "datagram.h"
+#include "debug.h"
+#include "domain_name_cache.h"
+#include "jx.h"
+#include "jx_print.h"
+#include "link.h"
+#include "timestamp.h"
+#include "xxmalloc.h"
+
+#include <pthread.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char *catalog_host = "localhost";
+static int catalog_port = CATALOG_PORT_DEFAULT;
+static const char *query_path = "/query.json";
+static int updates = 50000;
+static int senders = 4;
+static int clients = 2;
+static int rate = 0;
+
+static char run[64];
+static char address[DATAGRAM_ADDRESS_MAX];
+
+/* Set once all senders are done, to stop the query clients. */
+static volatile int sending_done = 0;
+
+struct client_stats {
+	int queries;
+	int failures;
+	timestamp_t total;
+	timestamp_t min;
+	timestamp_t max;
+};
+
+static void *sender_thread(void *arg)
+{
+	int id = (int) (long) arg;
+	struct datagram *d = datagram_create(DATAGRAM_PORT_ANY);
+	timestamp_t start = timestamp_get();
+	int count = updates / senders + (id < updates % senders);
+	int i;
+
+	if(!d)
+		fatal("couldn't create datagram port: %s", strerror(errno));
+
+	for(i = 0; i < count; i++) {
+		struct jx *j = jx_object(0);
+		jx_insert_string(j, "type", "catalog_benchmark");
+		jx_insert_string(j, "run", run);
+		jx_insert(j, jx_string("uuid"), jx_format("%s-%d-%d", run, id, i));
+		jx_insert_integer(j, "port", 9000 + id);
+		jx_insert_string(j, "owner", "benchmark");
+		jx_insert_integer(j, "cores", 8);
+		jx_insert_integer(j, "memory", 16384);
+		jx_insert_integer(j, "disk", 100000);
+		jx_insert_integer(j, "tasks_running", i % 8);
+		jx_insert_integer(j, "tasks_complete", i);
+		jx_insert_string(j, "version", "benchmark");
+
+		char *text = jx_print_string(j);
+		datagram_send(d, text, strlen(text), address, catalog_port);
+		free(text);
+		jx_delete(j);
+
+		/* Pace this sender to its share of the total rate. */
+		if(rate > 0) {
+			timestamp_t due = start + (timestamp_t) i * 1000000 * senders / rate;
+			timestamp_t now = timestamp_get();
+			if(due > now)
+				usleep(due - now);
+		}
+	}
+
+	datagram_delete(d);
+
+	return 0;
+}
+
+static void *client_thread(void *arg)
+{
+	struct client_stats *s = arg;
+	char request[1024];
+	char buffer[65536];
+
+	snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\n\r\n", query_path);
+
+	while(!sending_done) {
+		timestamp_t start = timestamp_get();
+		time_t stoptime = time(0) + 60;
+
+		struct link *l = link_connect(address, catalog_port, stoptime);
+		if(!l) {
+			s->failures++;
+			usleep(100000);
+			continue;
+		}
+
+		link_write(l, request, strlen(request), stoptime);
+		while(link_read(l, buffer, sizeof(buffer), stoptime) > 0) {}
+		link_close(l);
+
+		timestamp_t elapsed = timestamp_get() - start;
+
+		if(s->queries == 0 || elapsed < s->min)
+			s->min = elapsed;
+		if(elapsed > s->max)
+			s->max = elapsed;
+		s->total += elapsed;
+		s->queries++;
+	}
+
+	return 0;
+}
+
+/* Return the number of records of this run in the catalog, or -1 on failure. */
+
+static int count_records()
+{
+	char hostport[1024];
+	struct jx *filter = jx_operator(JX_OP_EQ, jx_symbol("run"), jx_string(run));
+	struct jx *fields = jx_array(0);
+	struct jx *j;
+	int count = 0;
+
+	jx_array_append(fields, jx_string("uuid"));
+
+	snprintf(hostport, sizeof(hostport), "%s:%d", catalog_host, catalog_port);
+
+	struct catalog_query *q = catalog_query_create_projection(hostport, filter, fields, 0, time(0) + 60);
+	if(!q)
+		return -1;
+
+	while((j = catalog_query_read(q, time(0) + 60))) {
+		count++;
+		jx_delete(j);
+	}
+
+	catalog_query_delete(q);
+
+	return count;
+}
+
+static void show_help(const char *cmd)
+{
+	fprintf(stdout, "Use: %s [options]\n", cmd);
+	fprintf(stdout, "Where options are:\n");
+	fprintf(stdout, " %-20s Catalog server to load. (default: %s)\n", "-H <host>", catalog_host);
+	fprintf(stdout, " %-20s Port of the catalog server. (default: %d)\n", "-p <port>", catalog_port);
+	fprintf(stdout, " %-20s Number of updates to send. (default: %d)\n", "-n <updates>", updates);
+	fprintf(stdout, " %-20s Number of threads sending updates. (default: %d)\n", "-s <senders>", senders);
+	fprintf(stdout, " %-20s Updates per second, 0 for unlimited. (default: %d)\n", "-r <rate>", rate);
+	fprintf(stdout, " %-20s Number of threads querying. (default: %d)\n", "-c <clients>", clients);
+	fprintf(stdout, " %-20s Path to query. (default: %s)\n", "-q <path>", query_path);
+	fprintf(stdout, " %-20s Show this help screen.\n", "-h");
+}
+
+int main(int argc, char *argv[])
+{
+	pthread_t *sender_threads, *client_threads;
+	struct client_stats *stats;
+	int c, i;
+
+	debug_config(argv[0]);
+
+	while((c = getopt(argc, argv, "H:p:n:s:r:c:q:h")) != -1) {
+		switch(c) {
+		case 'H':
+			catalog_host = optarg;
+			break;
+		case 'p':
+			catalog_port = atoi(optarg);
+			break;
+		case 'n':
+			updates = atoi(optarg);
+			break;
+		case 's':
+			senders = atoi(optarg);
+			break;
+		case 'r':
+			rate = atoi(optarg);
+			break;
+		case 'c':
+			clients = atoi(optarg);
+			break;
+		case 'q':
+			query_path = optarg;
+			break;
+		case 'h':
+		default:
+			show_help(argv[0]);
+			return c=='h' ? 0 : 1;
+		}
+	}
+
+	if(senders < 1)
+		senders = 1;
+
+	if(!domain_name_cache_lookup(catalog_host, address)) {
+		fprintf(stderr, "couldn't look up %s\n", catalog_host);
+		return 1;
+	}
+
+	snprintf(run, sizeof(run), "%d-%ld", (int) getpid(), (long) time(0));
+
+	sender_threads = xxmalloc(senders * sizeof(*sender_threads));
+	client_threads = xxmalloc((clients + 1) * sizeof(*client_threads));
+	stats = xxcalloc(clients + 1, sizeof(*stats));
+
+	timestamp_t start = timestamp_get();
+
+	for(i = 0; i < clients; i++)
+		pthread_create(&client_threads[i], 0, client_thread, &stats[i]);
+
+	for(i = 0; i < senders; i++)
+		pthread_create(&sender_threads[i], 0, sender_thread, (void *) (long) i);
+
+	for(i = 0; i < senders; i++)
+		pthread_join(sender_threads[i], 0);
+
+	timestamp_t sent = timestamp_get();
+
+	/*
+	Keep counting until the server has taken in everything it is going to.
+	The server answers from a snapshot that may be a second old, which
+	limits how precisely the end of ingestion can be seen.
+	*/
+
+	int received = 0;
+	timestamp_t last_change = sent;
+
+	while(received < updates && timestamp_get() - last_change < 3000000) {
+		usleep(250000);
+		int count = count_records();
+		if(count < 0) {
+			fprintf(stderr, "couldn't query %s:%d\n", catalog_host, catalog_port);
+			return 1;
+		}
+		if(count > received) {
+			received = count;
+			last_change = timestamp_get();
+		}
+	}
+
+	sending_done = 1;
+
+	struct client_stats *total = &stats[clients];
+	for(i = 0; i < clients; i++) {
+		pthread_join(client_threads[i], 0);
+		if(stats[i].queries > 0) {
+			if(total->queries == 0 || stats[i].min < total->min)
+				total->min = stats[i].min;
+			if(stats[i].max > total->max)
+				total->max = stats[i].max;
+		}
+		total->queries += stats[i].queries;
+		total->failures += stats[i].failures;
+		total->total += stats[i].total;
+	}
+
+	timestamp_t ingest = last_change - start;
+
+	printf("updates sent:       %d in %.3lf s\n", updates, (sent - start) / 1000000.0);
+	printf("updates received:   %d (%.1lf%% dropped)\n", received, 100.0 * (updates - received) / updates);
+	printf("updates/sec:        %.0lf\n", received / (ingest / 1000000.0));
+	printf("queries:            %d (%d failed)\n", total->queries, total->failures);
+	if(total->queries > 0) {
+		printf("query latency:      min %.1lf ms, avg %.1lf ms, max %.1lf ms\n",
+			total->min / 1000.0, total->total / 1000.0 / total->queries, total->max / 1000.0);
+	}
+
+	return 0;
+}
+
+/* vim: set noexpandtab tabstop=4: */
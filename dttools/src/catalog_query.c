@@ -13,8 +13,12 @@ See the file COPYING for details.
 #include "jx.h"
 #include "jx_parse.h"
 #include "jx_eval.h"
+#include "jx_print.h"
+#include "b64.h"
+#include "buffer.h"
 #include "xxmalloc.h"
 #include "stringtools.h"
+#include "url_encode.h"
 #include "debug.h"
 #include "datagram.h"
 #include "domain_name_cache.h"
@@ -28,12 +32,16 @@ See the file COPYING for details.
 struct catalog_query {
 	struct jx *data;
 	struct jx *filter_expr;
+	struct jx *fields;
+	time_t since;
+	int applied_by_server;
 	struct jx_item *current;
 };
 
 struct catalog_host {
 	char *host;
 	char *url;
+	char *query_url;
 	int down;
 };
 
@@ -62,6 +70,11 @@ const char *parse_hostlist(const char *hosts, char *host, int *port)
 	return next ? next + 1 : NULL;
 }
 
+/*
+Send a query and return the array of results, or null if the server
+could not be reached or answered with something other than an array.
+*/
+
 struct jx *catalog_query_send_query(const char *url, time_t stoptime) {
 	struct link *link = http_query(url, "GET", stoptime);
 
@@ -75,19 +88,94 @@ struct jx *catalog_query_send_query(const char *url, time_t stoptime) {
 
 	if(!j) {
 		debug(D_DEBUG,"query result failed to parse as JSON");
+		errno = EINVAL;
 		return NULL;
 	}
 
 	if(!jx_istype(j,JX_ARRAY)) {
 		debug(D_DEBUG,"query result is not a JSON array");
 		jx_delete(j);
+		errno = EINVAL;
 		return NULL;
 	}
 
 	return j;
 }
 
-struct list *catalog_query_sort_hostlist(const char *hosts) {
+/*
+Encode the filter, fields, and since time as url options to be applied
+by the server, or return null if there are none.
+*/
+
+static char *catalog_query_options(struct jx *filter_expr, struct jx *fields, time_t since)
+{
+	buffer_t B;
+	char *options = NULL;
+	const char *separator = "?";
+
+	if(!filter_expr && !fields && since <= 0)
+		return NULL;
+
+	buffer_init(&B);
+	buffer_abortonfailure(&B, 1);
+
+	if(filter_expr) {
+		char *str = jx_print_string(filter_expr);
+		buffer_printf(&B, "%sfilter=", separator);
+		b64_encode(str, strlen(str), &B);
+		free(str);
+		separator = "&";
+	}
+
+	if(fields) {
+		struct jx *field;
+		const char *comma = "";
+		buffer_printf(&B, "%sfields=", separator);
+		for(void *i = NULL; (field = jx_iterate_array(fields, &i));) {
+			if(jx_istype(field, JX_STRING)) {
+				buffer_printf(&B, "%s%s", comma, field->u.string_value);
+				comma = ",";
+			}
+		}
+		separator = "&";
+	}
+
+	if(since > 0) {
+		buffer_printf(&B, "%ssince=%lld", separator, (long long) since);
+	}
+
+	buffer_dup(&B, &options);
+	buffer_free(&B);
+	return options;
+}
+
+/*
+Return the url with the query options added, or null if the request
+line that carries it would be too long for the server to read, in which
+case the options are applied by the client.
+*/
+
+static char *catalog_query_url(const char *url, const char *options)
+{
+	char encoded[CATALOG_QUERY_LINE_MAX];
+
+	if(!options)
+		return NULL;
+
+	char *query_url = string_format("%s%s", url, options);
+
+	/* The encoded url is truncated if it does not fit, so leave room to tell. */
+	url_encode(query_url, encoded, sizeof(encoded));
+	if(strlen(encoded) + strlen("GET  HTTP/1.1") >= sizeof(encoded) - 4) {
+		debug(D_DEBUG,"query options are too long, applying them locally");
+		free(query_url);
+		return NULL;
+	}
+
+	return query_url;
+}
+
+struct list *catalog_query_sort_hostlist(const char *hosts, const char *options) {
 	const char *next_host;
 	char *n;
 	struct catalog_host *h;
@@ -112,6 +200,7 @@ struct list *catalog_query_sort_hostlist(const char *hosts) {
 
 		h->host = xxstrdup(host);
 		h->url = string_format("http://%s:%d/query.json", host, port);
+		h->query_url = catalog_query_url(h->url, options);
 		h->down = 0;
 
 		set_first_element(down_hosts);
@@ -131,11 +220,17 @@ struct list *catalog_query_sort_hostlist(const char *hosts) {
 }
 
 struct catalog_query *catalog_query_create(const char *hosts, struct jx *filter_expr, time_t stoptime)
+{
+	return catalog_query_create_projection(hosts, filter_expr, NULL, 0, stoptime);
+}
+
+struct catalog_query *catalog_query_create_projection(const char *hosts, struct jx *filter_expr, struct jx *fields, time_t since, time_t stoptime)
 {
 	struct catalog_query *q = NULL;
 	char *n;
 	struct catalog_host *h;
-	struct list *sorted_hosts = catalog_query_sort_hostlist(hosts);
+	char *options = catalog_query_options(filter_expr, fields, since);
+	struct list *sorted_hosts = catalog_query_sort_hostlist(hosts, options);
 
 	int backoff_interval = 1;
 
@@ -150,13 +245,30 @@ struct catalog_query *catalog_query_create(const char *hosts, struct jx *filter_
 
 			continue;
 		}
-		struct jx *j = catalog_query_send_query(h->url, time(NULL) + 5);
+		struct jx *j = NULL;
+		int applied_by_server = 0;
+
+		if(h->query_url) {
+			j = catalog_query_send_query(h->query_url, time(NULL) + 5);
+			if(j) {
+				applied_by_server = 1;
+			} else {
+				/* Older servers reject options they do not know, or may not read a long query at all. */
+				debug(D_DEBUG,"catalog server at %s did not answer the query with options, filtering locally", h->host);
+				j = catalog_query_send_query(h->url, time(NULL) + 5);
+			}
+		} else {
+			j = catalog_query_send_query(h->url, time(NULL) + 5);
+		}
 
 		if(j) {
 			q = xxmalloc(sizeof(*q));
 			q->data = j;
 			q->current = j->u.items;
 			q->filter_expr = filter_expr;
+			q->fields = fields;
+			q->since = since;
+			q->applied_by_server = applied_by_server;
 
 			if(h->down) {
 				debug(D_DEBUG,"catalog server at %s is back up", h->host);
@@ -182,19 +294,43 @@ struct catalog_query *catalog_query_create(const char *hosts, struct jx *filter_
 	while((h = list_next_item(sorted_hosts))) {
 		free(h->host);
 		free(h->url);
+		free(h->query_url);
 		free(h);
 	}
 	list_delete(sorted_hosts);
+	free(options);
 	return q;
 }
 
+/* Return a new object with only the given fields of j. */
+
+static struct jx *catalog_query_project(struct jx *j, struct jx *fields)
+{
+	struct jx *p = jx_object(0);
+	struct jx *field;
+
+	for(void *i = NULL; (field = jx_iterate_array(fields, &i));) {
+		if(!jx_istype(field, JX_STRING))
+			continue;
+		struct jx *value = jx_lookup(j, field->u.string_value);
+		if(value && !jx_lookup(p, field->u.string_value))
+			jx_insert(p, jx_copy(field), jx_copy(value));
+	}
+
+	return p;
+}
+
 struct jx *catalog_query_read(struct catalog_query *q, time_t stoptime)
 {
 	while(q && q->current) {
 
 		int keepit = 1;
 
-		if(q->filter_expr) {
+		if(q->applied_by_server) {
+			keepit = 1;
+		} else if(q->since > 0 && jx_lookup_integer(q->current->value, "lastheardfrom") < q->since) {
+			keepit = 0;
+		} else if(q->filter_expr) {
 			struct jx * b;
 			b = jx_eval(q->filter_expr,q->current->value);
 			if(jx_istype(b, JX_BOOLEAN) && b->u.boolean_value) {
@@ -208,7 +344,12 @@ struct jx *catalog_query_read(struct catalog_query *q, time_t stoptime)
 		}
 
 		if(keepit) {
-			struct jx *result = jx_copy(q->current->value);
+			struct jx *result;
+			if(q->fields && !q->applied_by_server) {
+				result = catalog_query_project(q->current->value, q->fields);
+			} else {
+				result = jx_copy(q->current->value);
+			}
 			q->current = q->current->next;
 			return result;
 		}
@@ -222,6 +363,7 @@ struct jx *catalog_query_read(struct catalog_query *q, time_t stoptime)
 void catalog_query_delete(struct catalog_query *q)
 {
 	jx_delete(q->filter_expr);
+	jx_delete(q->fields);
 	jx_delete(q->data);
 	free(q);
 }
@@ -17,6 +17,9 @@ Query the global catalog server for server descriptions.
 #define CATALOG_HOST_DEFAULT "catalog.cse.nd.edu,backup-catalog.cse.nd.edu"
 #define CATALOG_PORT_DEFAULT 9097
 
+/** Longest HTTP request line that a catalog server will read.  Queries with longer options are filtered by the client instead. */
+#define CATALOG_QUERY_LINE_MAX 4096
+
 #define CATALOG_HOST (getenv("CATALOG_HOST") ? getenv("CATALOG_HOST") : CATALOG_HOST_DEFAULT )
 #define CATALOG_PORT (getenv("CATALOG_PORT") ? atoi(getenv("CATALOG_PORT")) : CATALOG_PORT_DEFAULT )
 
@@ -33,6 +36,23 @@ If neither is set, the system will contact chirp.cse.nd.edu on port 9097.
 */
 struct catalog_query *catalog_query_create(const char *hosts, struct jx *filter_expr, time_t stoptime);
 
+/** Create a catalog query that returns only part of each matching record.
+Like @ref catalog_query_create, but the filter, the choice of fields, and
+the time limit are sent to the catalog server and applied there, so that
+only the matching records and fields cross the network.  If the server
+does not accept these options, they are applied as the results are read.
+@param hosts A comma delimited list of catalog servers to query, or null for the default server.
+@param filter_expr An optional expression to filter the results in JX syntax.
+ A null pointer indicates no filter.
+@param fields An optional JX array of the names of the fields to return.
+ A null pointer returns all fields.
+@param since If greater than zero, return only records updated at or after this time.
+@param stoptime The absolute time at which to abort.
+@return A catalog query object on success, or null on failure.
+The query object takes ownership of filter_expr and fields.
+*/
+struct catalog_query *catalog_query_create_projection(const char *hosts, struct jx *filter_expr, struct jx *fields, time_t since, time_t stoptime);
+
 /** Read the next object from a query.
 Returns the next @ref jx expressions from the issued query.
 The caller may use @ref jx_lookup_string, @ref jx_lookup_integer and related
@@ -14,6 +14,7 @@ See the file COPYING for details.
 #include "nvpair.h"
 #include "nvpair_jx.h"
 #include "jx_database.h"
+#include "jx_eval.h"
 #include "jx_parse.h"
 #include "jx_print.h"
 #include "jx_table.h"
@@ -26,7 +27,9 @@ See the file COPYING for details.
 #include "macros.h"
 #include "daemon.h"
 #include "getopt_aux.h"
-#include "change_process_title.h"
+#include "b64.h"
+#include "buffer.h"
+#include "url_encode.h"
 #include "zlib.h"
 
 #include <stdlib.h>
@@ -35,15 +38,15 @@ See the file COPYING for details.
 #include <errno.h>
 #include <signal.h>
 #include <unistd.h>
-#include <sys/wait.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <sys/select.h>
+#include <sys/socket.h>
 
 #ifndef LINE_MAX
 #define LINE_MAX 1024
 #endif
 
-#define MAX_TABLE_SIZE 10000
-
 /* Timeout in communicating with the querying client */
 #define HANDLE_QUERY_TIMEOUT 15
 
@@ -53,12 +56,18 @@ See the file COPYING for details.
 /* Maximum size of a JX record arriving via TCP is 1MB. */
 #define TCP_PAYLOAD_MAX 1024*1024
 
+/* Buffer for uncompressed data is 1MB to accommodate expansion. */
+#define UPDATE_DATA_MAX 1024*1024
+
+/* Maximum number of updates waiting to be parsed before the server stops receiving more. */
+#define UPDATE_QUEUE_MAX 10000
+
+/* Size of the kernel buffer requested for incoming datagrams. */
+#define UDP_BUFFER_SIZE 16*1024*1024
+
 /* The table of record, hashed on address:port */
 static struct jx_database *table = 0;
 
-/* An array of jxs used to sort for display */
-static struct jx *array[MAX_TABLE_SIZE];
-
 /* The time for which updated data lives before automatic deletion */
 static int lifetime = 1800;
 
@@ -86,17 +95,23 @@ static char owner[USERNAME_MAX];
 /* Time when the process was started. */
 static time_t starttime;
 
-/* If true, for for every query */
-static int fork_mode = 1;
+/* If true, answer each query in its own thread. */
+static int query_thread_mode = 1;
+
+/* The maximum number of queries that can be answered at once. */
+static int query_threads_max = 50;
 
-/* The maximum number of simultaneous children that can be running. */
-static int child_procs_max = 50;
+/* Number of query threads currently running. */
+static int query_threads_count = 0;
 
-/* Number of query processses currently running. */
-static int child_procs_count = 0;
+/* Maximum time to allow for sending the answer to a query. */
+static int query_timeout = 60;
 
-/* Maximum time to allow a child process to run. */
-static int child_procs_timeout = 60;
+/* Number of threads parsing updates, or zero to parse them in the main thread. */
+static int update_threads = 4;
+
+/* Minimum time between snapshots of the table for answering queries. */
+static time_t snapshot_interval = 1;
 
 /* The maximum size of a server that will actually be believed. */
 static INT64_T max_server_size = 0;
@@ -108,17 +123,62 @@ static char *logfilename = 0;
 /* Location of the history file. Default is in the current dir. */
 static const char * history_dir = "catalog.history";
 
+/* Interval between checkpoints of the history during the day, or -1 for the default. */
+static int history_checkpoint_interval = -1;
+
 /* Settings for the master catalog that we will report *to* */
 static int outgoing_alarm = 0;
 static int outgoing_timeout = 300;
 static struct list *outgoing_host_list;
 
-/* Buffer for uncompressed data is 1MB to accommodate expansion. */
-static char data[1024*1024];
-
 struct datagram *update_dgram = 0;
 struct link *update_port = 0;
 
+/*
+Updates are received by the main thread, decompressed, parsed, and named
+by a pool of update threads, and then handed back to the main thread,
+which is the only one to modify the table.  The main thread is woken up
+by a byte on parsed_pipe when the parsed queue becomes non-empty.
+*/
+
+struct update {
+	char addr[LINK_ADDRESS_MAX];
+	int port;
+	const char *protocol;
+	char *raw_data;
+	int raw_data_length;
+	struct link *link;
+	char *key;
+	struct jx *j;
+};
+
+static struct list *update_queue = 0;
+static struct list *parsed_queue = 0;
+static pthread_mutex_t update_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t update_cond = PTHREAD_COND_INITIALIZER;
+static int parsed_pipe[2];
+
+/*
+Queries are answered from a snapshot: a copy of the table, sorted by name,
+that is never modified once made.  (Looking up a key in a jx object does
+not modify it either.)  Any number of query threads can read it
+while the main thread goes on updating the table.  When a query arrives,
+a new snapshot is swapped in if the table has changed and the current one
+is at least snapshot_interval seconds old.  The last reader of a snapshot
+that has been replaced deletes it.
+*/
+
+struct snapshot {
+	struct jx **records;
+	int count;
+	int refcount;
+	time_t time;
+};
+
+static struct snapshot *current_snapshot = 0;
+static int table_changed = 1;
+static pthread_mutex_t query_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 void shutdown_clean(int sig)
 {
 	exit(0);
@@ -181,6 +241,7 @@ static void remove_expired_records()
 		if( (current-lastheardfrom) > this_lifetime ) {
 				j = jx_database_remove(table,key);
 			if(j) jx_delete(j);
+			table_changed = 1;
 		}
 	}
 
@@ -231,17 +292,27 @@ static void make_hash_key(struct jx *j, char *key)
 			uuid ? uuid : "");
 }
 
-static void handle_update( const char *addr, int port, const char *raw_data, int raw_data_length, const char *protocol )
+/*
+Decode the raw data of an update into u->j and work out its key.
+data is a buffer of UPDATE_DATA_MAX bytes for the uncompressed text.
+This is called by the update threads, and so must not touch the table.
+*/
+
+static void update_decode(struct update *u, const char *raw_data, int raw_data_length, char *data)
 {
 	char key[LINE_MAX];
 	unsigned long data_length;
 	struct jx *j;
+	const char *addr = u->addr;
+	int port = u->port;
+
+		if(raw_data_length<1) return;
 
 		// If the packet starts with Control-Z (0x1A), it is compressed,
 		// so uncompress it to data[].  Otherwise just copy to data[];.
 
 		if(raw_data[0]==0x1A) {
-			data_length = sizeof(data);
+			data_length = UPDATE_DATA_MAX-1;
 			int success = uncompress((Bytef*)data,&data_length,(const Bytef*)&raw_data[1],raw_data_length-1);
 			if(success!=Z_OK) {
 				debug(D_DEBUG,"warning: %s:%d sent invalid compressed data (ignoring it)\n",addr,port);
@@ -321,67 +392,311 @@ static void handle_update( const char *addr, int port, const char *raw_data, int
 
 		make_hash_key(j, key);
 
-		if(logfile) {
-			if(!jx_database_lookup(table,key)) {
-				jx_print_stream(j,logfile);
-				fprintf(logfile,"\n");
-				fflush(logfile);
-			}
+		u->j = j;
+		u->key = xxstrdup(key);
+}
+
+/*
+Read the update, if it is still waiting on a TCP connection, then decode it.
+buffer is TCP_PAYLOAD_MAX bytes and data is UPDATE_DATA_MAX bytes.
+*/
+
+static void update_process(struct update *u, char *buffer, char *data)
+{
+	if(u->link) {
+		time_t stoptime = time(0) + HANDLE_TCP_UPDATE_TIMEOUT;
+
+		int length = link_read(u->link,buffer,TCP_PAYLOAD_MAX-1,stoptime);
+
+		link_close(u->link);
+		u->link = 0;
+
+		if(length>0) {
+			buffer[length] = 0;
+			update_decode(u,buffer,length,data);
+		}
+	} else {
+		update_decode(u,u->raw_data,u->raw_data_length,data);
+	}
+}
+
+/* Add a decoded update to the table.  Only the main thread may do this. */
+
+static void update_apply(struct update *u)
+{
+	if(!u->j)
+		return;
+
+	if(logfile) {
+		if(!jx_database_lookup(table,u->key)) {
+			jx_print_stream(u->j,logfile);
+			fprintf(logfile,"\n");
 		}
+	}
 
-		jx_database_insert(table, key, j);
+	jx_database_insert(table, u->key, u->j);
+	u->j = 0;
 
-		debug(D_DEBUG, "received %s update from %s",protocol,key);
+	table_changed = 1;
+
+	debug(D_DEBUG, "received %s update from %s",u->protocol,u->key);
+}
+
+static struct update *update_create(const char *protocol)
+{
+	struct update *u = xxcalloc(1,sizeof(*u));
+	u->protocol = protocol;
+	return u;
+}
+
+static void update_delete(struct update *u)
+{
+	if(u->link)
+		link_close(u->link);
+	jx_delete(u->j);
+	free(u->raw_data);
+	free(u->key);
+	free(u);
+}
+
+static void *update_thread(void *arg)
+{
+	char *buffer = xxmalloc(TCP_PAYLOAD_MAX);
+	char *data = xxmalloc(UPDATE_DATA_MAX);
+
+	while(1) {
+		pthread_mutex_lock(&update_mutex);
+		while(!list_size(update_queue))
+			pthread_cond_wait(&update_cond,&update_mutex);
+		struct update *u = list_pop_head(update_queue);
+		pthread_mutex_unlock(&update_mutex);
+
+		update_process(u,buffer,data);
+
+		pthread_mutex_lock(&update_mutex);
+		list_push_tail(parsed_queue,u);
+		int wakeup = list_size(parsed_queue)==1;
+		pthread_mutex_unlock(&update_mutex);
+
+		if(wakeup) {
+			char c = 0;
+			write(parsed_pipe[1],&c,1);
+		}
+	}
+
+	return 0;
+}
+
+static void update_threads_start()
+{
+	int i;
+
+	update_queue = list_create();
+	parsed_queue = list_create();
+
+	if(pipe(parsed_pipe)<0)
+		fatal("couldn't create pipe: %s",strerror(errno));
+
+	fcntl(parsed_pipe[0],F_SETFL,O_NONBLOCK);
+	fcntl(parsed_pipe[1],F_SETFL,O_NONBLOCK);
+
+	for(i=0;i<update_threads;i++) {
+		pthread_t thread;
+		if(pthread_create(&thread,0,update_thread,0))
+			fatal("couldn't start update thread: %s",strerror(errno));
+		pthread_detach(thread);
+	}
+}
+
+/*
+Hand updates over to the update threads, or if there are none,
+handle them right away in the main thread.
+*/
+
+static void update_submit(struct update **updates, int count)
+{
+	static char buffer[TCP_PAYLOAD_MAX];
+	static char data[UPDATE_DATA_MAX];
+	int i;
+
+	if(update_threads>0) {
+		pthread_mutex_lock(&update_mutex);
+		for(i=0;i<count;i++)
+			list_push_tail(update_queue,updates[i]);
+		pthread_cond_broadcast(&update_cond);
+		pthread_mutex_unlock(&update_mutex);
+	} else {
+		for(i=0;i<count;i++) {
+			update_process(updates[i],buffer,data);
+			update_apply(updates[i]);
+			update_delete(updates[i]);
+		}
+		if(logfile) fflush(logfile);
+	}
+}
+
+static int update_queue_full()
+{
+	int full = 0;
+
+	if(update_threads>0) {
+		pthread_mutex_lock(&update_mutex);
+		full = list_size(update_queue)>=UPDATE_QUEUE_MAX;
+		pthread_mutex_unlock(&update_mutex);
+	}
+
+	return full;
+}
+
+/* Add all the updates parsed so far to the table. */
+
+static void handle_parsed_updates()
+{
+	char buf[64];
+	struct update *u;
+
+	while(read(parsed_pipe[0],buf,sizeof(buf))>0) {}
+
+	pthread_mutex_lock(&update_mutex);
+	struct list *ready = parsed_queue;
+	parsed_queue = list_create();
+	pthread_mutex_unlock(&update_mutex);
+
+	while((u=list_pop_head(ready))) {
+		update_apply(u);
+		update_delete(u);
+	}
+
+	list_delete(ready);
+
+	if(logfile) fflush(logfile);
 }
 
 /*
 Where possible, we prefer to accept short updates via UDP,
 because these can be accepted quickly in a non-blocking manner.
+Waiting datagrams are received in batches, and receiving stops
+while the update threads have a full queue, leaving the rest
+in the kernel buffer until they catch up.
 */
 
 static void handle_udp_updates(struct datagram *update_port)
 {
-	char data[DATAGRAM_PAYLOAD_MAX];
-	char addr[DATAGRAM_ADDRESS_MAX];
-	int port;
+	static char buffers[DATAGRAM_RECV_BATCH_MAX][DATAGRAM_PAYLOAD_MAX];
+	static char addrs[DATAGRAM_RECV_BATCH_MAX][DATAGRAM_ADDRESS_MAX];
+	char *data[DATAGRAM_RECV_BATCH_MAX];
+	char *addr[DATAGRAM_RECV_BATCH_MAX];
+	int lengths[DATAGRAM_RECV_BATCH_MAX];
+	int ports[DATAGRAM_RECV_BATCH_MAX];
+	struct update *updates[DATAGRAM_RECV_BATCH_MAX];
+	int i, n;
 
-	while(1) {
-		int result = datagram_recv(update_port, data, DATAGRAM_PAYLOAD_MAX, addr, &port, 0);
+	for(i=0;i<DATAGRAM_RECV_BATCH_MAX;i++) {
+		data[i] = buffers[i];
+		addr[i] = addrs[i];
+	}
+
+	while(!update_queue_full()) {
+		int result = datagram_recv_many(update_port, data, lengths, addr, ports, DATAGRAM_RECV_BATCH_MAX, DATAGRAM_PAYLOAD_MAX);
 		if(result <= 0)
 			return;
 
-		data[result] = 0;
-		handle_update(addr,port,data,result,"udp");
+		n = 0;
+		for(i=0;i<result;i++) {
+			if(lengths[i]<=0) continue;
+			struct update *u = update_create("udp");
+			strcpy(u->addr,addr[i]);
+			u->port = ports[i];
+			u->raw_data = xxmalloc(lengths[i]);
+			memcpy(u->raw_data,data[i],lengths[i]);
+			u->raw_data_length = lengths[i];
+			updates[n++] = u;
+		}
+
+		update_submit(updates,n);
 	}
 }
 
 /*
-Where necessary, we accept updates via TCP, but they cause
-the server to block, and so we impose a very short timeout on top.
+Where necessary, we accept updates via TCP.  The update is read
+under a very short timeout by an update thread, so that a slow
+sender does not hold up the server.
 */
 
 void handle_tcp_update( struct link *update_port )
 {
-	char data[TCP_PAYLOAD_MAX];
-
 	time_t stoptime = time(0) + HANDLE_TCP_UPDATE_TIMEOUT;
 
 	struct link *l = link_accept(update_port,stoptime);
 	if(!l) return;
 
-	char addr[LINK_ADDRESS_MAX];
-	int port;
+	struct update *u = update_create("tcp");
+	link_address_remote(l,u->addr,&u->port);
+	u->link = l;
 
-	link_address_remote(l,addr,&port);
+	update_submit(&u,1);
+}
 
-	int length = link_read(l,data,sizeof(data)-1,stoptime);
+static struct snapshot *snapshot_create()
+{
+	struct snapshot *s = xxcalloc(1,sizeof(*s));
+	int size = 1024;
+	char *key;
+	struct jx *j;
+
+	s->records = xxmalloc(size*sizeof(*s->records));
+	s->refcount = 1;
+	s->time = time(0);
+
+	jx_database_firstkey(table);
+	while(jx_database_nextkey(table, &key, &j)) {
+		if(s->count == size) {
+			size *= 2;
+			s->records = xxrealloc(s->records, size*sizeof(*s->records));
+		}
+		/* A large record is indexed as it is copied, here on the main thread. */
+		s->records[s->count++] = jx_copy(j);
+	}
+
+	qsort(s->records, s->count, sizeof(struct jx *), compare_jx);
+
+	return s;
+}
+
+static void snapshot_release(struct snapshot *s)
+{
+	int i;
+
+	pthread_mutex_lock(&query_mutex);
+	int refcount = --s->refcount;
+	pthread_mutex_unlock(&query_mutex);
 
-	if(length>0) {
-		data[length] = 0;
-		handle_update(addr,port,data,length,"tcp");
+	if(refcount>0)
+		return;
+
+	for(i=0;i<s->count;i++)
+		jx_delete(s->records[i]);
+	free(s->records);
+	free(s);
+}
+
+/* Return a reference to a snapshot that is recent enough to answer a query. */
+
+static struct snapshot *snapshot_get()
+{
+	if(!current_snapshot || (table_changed && time(0)-current_snapshot->time >= snapshot_interval)) {
+		struct snapshot *old = current_snapshot;
+		current_snapshot = snapshot_create();
+		table_changed = 0;
+		if(old)
+			snapshot_release(old);
 	}
 
-	link_close(l);
+	pthread_mutex_lock(&query_mutex);
+	current_snapshot->refcount++;
+	pthread_mutex_unlock(&query_mutex);
+
+	return current_snapshot;
 }
 
 static struct jx_table html_headers[] = {
@@ -396,28 +711,127 @@ static struct jx_table html_headers[] = {
 	{0,0,0,0,0}
 };
 
-static void handle_query(struct link *query_link)
+/*
+Parse the options of a query such as /query.json?filter=F&fields=A,B&since=T,
+where F is a JX expression encoded in base64, A,B are the names of the
+fields to return, and T is a time in seconds: only records heard from
+at or after T are returned.  Returns false if any option cannot be
+understood, so that the client can fall back to filtering by itself.
+*/
+
+static int parse_query_options(char *options, struct jx **filter, struct jx **fields, time_t *since)
+{
+	char *option, *saveptr;
+
+	for(option = strtok_r(options, "&", &saveptr); option; option = strtok_r(0, "&", &saveptr)) {
+		char *value = strchr(option, '=');
+		if(!value) {
+			debug(D_DEBUG, "invalid query option: %s", option);
+			return 0;
+		}
+		*value++ = 0;
+
+		url_decode(value, value, strlen(value) + 1);
+
+		if(!strcmp(option, "filter")) {
+			buffer_t B;
+			buffer_init(&B);
+			jx_delete(*filter);
+			*filter = 0;
+			if(b64_decode(value, &B) == 0)
+				*filter = jx_parse_string(buffer_tostring(&B));
+			buffer_free(&B);
+			if(!*filter) {
+				debug(D_DEBUG, "invalid query filter: %s", value);
+				return 0;
+			}
+		} else if(!strcmp(option, "fields")) {
+			char *name;
+			jx_delete(*fields);
+			*fields = jx_array(0);
+			for(name = strsep(&value, ","); name; name = strsep(&value, ",")) {
+				if(name[0])
+					jx_array_append(*fields, jx_string(name));
+			}
+		} else if(!strcmp(option, "since")) {
+			*since = atoll(value);
+		} else {
+			debug(D_DEBUG, "unknown query option: %s", option);
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static int query_matches(struct jx *j, struct jx *filter, time_t since)
+{
+	if(since > 0 && jx_lookup_integer(j, "lastheardfrom") < since)
+		return 0;
+
+	if(filter) {
+		struct jx *result = jx_eval(filter, j);
+		int match = jx_istrue(result);
+		jx_delete(result);
+		return match;
+	}
+
+	return 1;
+}
+
+/* Return a new object with only the given fields of j. */
+
+static struct jx *query_project(struct jx *j, struct jx *fields)
+{
+	struct jx *p = jx_object(0);
+	struct jx *field;
+	void *i = 0;
+
+	while((field = jx_iterate_array(fields, &i))) {
+		struct jx *value = jx_lookup(j, field->u.string_value);
+		if(value && !jx_lookup(p, field->u.string_value))
+			jx_insert(p, jx_copy(field), jx_copy(value));
+	}
+
+	return p;
+}
+
+/*
+Answer a query from a snapshot of the table.  The answer is written to
+memory first and then sent under a timeout, so that a client that is slow
+to read cannot hold a query thread for long.
+*/
+
+static void handle_query(struct link *query_link, struct snapshot *snapshot)
 {
 	FILE *stream;
-	char line[LINE_MAX];
-	char url[LINE_MAX];
-	char path[LINE_MAX];
-	char action[LINE_MAX];
-	char version[LINE_MAX];
-	char hostport[LINE_MAX];
+	char *response = 0;
+	size_t response_length = 0;
+	char date[LINE_MAX];
+	char line[CATALOG_QUERY_LINE_MAX];
+	char url[CATALOG_QUERY_LINE_MAX];
+	char path[CATALOG_QUERY_LINE_MAX];
+	char action[CATALOG_QUERY_LINE_MAX];
+	char version[CATALOG_QUERY_LINE_MAX];
+	char hostport[CATALOG_QUERY_LINE_MAX];
 	char addr[LINK_ADDRESS_MAX];
-	char key[LINE_MAX];
+	char key[CATALOG_QUERY_LINE_MAX];
 	int port;
 	time_t current;
 
-	char *hkey;
 	struct jx *j;
+	struct jx **array = 0;
 	int i, n;
 
+	char *options;
+	struct jx *filter, *fields;
+	time_t since;
+	int project;
+
 	link_address_remote(query_link, addr, &port);
 	debug(D_DEBUG, "www query from %s:%d", addr, port);
 
-	if(link_readline(query_link, line, LINE_MAX, time(0) + HANDLE_QUERY_TIMEOUT)) {
+	if(link_readline(query_link, line, sizeof(line), time(0) + HANDLE_QUERY_TIMEOUT)) {
 		string_chomp(line);
 		if(sscanf(line, "%s %s %s", action, url, version) != 3) {
 			return;
@@ -425,7 +839,7 @@ static void handle_query(struct link *query_link)
 
 		// Consume the rest of the query
 		while(1) {
-			if(!link_readline(query_link, line, LINE_MAX, time(0) + HANDLE_QUERY_TIMEOUT)) {
+			if(!link_readline(query_link, line, sizeof(line), time(0) + HANDLE_QUERY_TIMEOUT)) {
 				return;
 			}
 
@@ -438,18 +852,10 @@ static void handle_query(struct link *query_link)
 	}
 
 	// Output response
-	stream = fdopen(link_fd(query_link), "w");
+	stream = open_memstream(&response, &response_length);
 	if(!stream) {
 		return;
 	}
-	link_nonblocking(query_link, 0);
-
-	current = time(0);
-	fprintf(stream, "HTTP/1.1 200 OK\n");
-	fprintf(stream, "Date: %s", ctime(&current));
-	fprintf(stream, "Server: catalog_server\n");
-	fprintf(stream, "Connection: close\n");
-	fprintf(stream, "Access-Control-Allow-Origin: *\n");
 
 	if(sscanf(url, "http://%[^/]%s", hostport, path) == 2) {
 		// continue on
@@ -457,18 +863,49 @@ static void handle_query(struct link *query_link)
 		strcpy(path, url);
 	}
 
-	/* load the hash table entries into one big array */
+	filter = fields = 0;
+	since = 0;
 
-	n = 0;
-	jx_database_firstkey(table);
-	while(jx_database_nextkey(table, &hkey, &j)) {
-		array[n] = j;
-		n++;
+	current = time(0);
+	ctime_r(&current, date);
+
+	options = strchr(path, '?');
+	if(options) {
+		*options++ = 0;
+		if(!parse_query_options(options, &filter, &fields, &since)) {
+			fprintf(stream, "HTTP/1.1 400 Bad Request\n");
+			fprintf(stream, "Date: %s", date);
+			fprintf(stream, "Server: catalog_server\n");
+			fprintf(stream, "Connection: close\n\n");
+			fclose(stream);
+			link_write(query_link, response, response_length, time(0) + query_timeout);
+			free(response);
+			jx_delete(filter);
+			jx_delete(fields);
+			return;
+		}
 	}
 
-	/* sort the array by name before displaying */
+	fprintf(stream, "HTTP/1.1 200 OK\n");
+	fprintf(stream, "Date: %s", date);
+	fprintf(stream, "Server: catalog_server\n");
+	fprintf(stream, "Connection: close\n");
+	fprintf(stream, "Access-Control-Allow-Origin: *\n");
+
+	/* The html pages need the fields they display, so only project the data formats. */
+	project = fields && !strncmp(path, "/query.", 7) && strcmp(path, "/query.html");
+
+	/* select the matching records, which the snapshot already has sorted by name */
 
-	qsort(array, n, sizeof(struct jx *), compare_jx);
+	n = 0;
+	array = xxmalloc((snapshot->count + 1) * sizeof(*array));
+
+	for(i = 0; i < snapshot->count; i++) {
+		j = snapshot->records[i];
+		if(!query_matches(j, filter, since))
+			continue;
+		array[n++] = project ? query_project(j, fields) : j;
+	}
 
 	if(!strcmp(path, "/query.text")) {
 		fprintf(stream, "Content-type: text/plain\n\n");
@@ -498,9 +935,16 @@ static void handle_query(struct link *query_link)
 			jx_export_xml(array[i], stream);
 		fprintf(stream, "</catalog>\n");
 	} else if(sscanf(path, "/detail/%s", key) == 1) {
-		struct jx *j;
+		char jkey[LINE_MAX];
 		fprintf(stream, "Content-type: text/html\n\n");
-		j = jx_database_lookup(table, key);
+		j = 0;
+		for(i = 0; i < snapshot->count; i++) {
+			make_hash_key(snapshot->records[i], jkey);
+			if(!strcmp(jkey, key)) {
+				j = snapshot->records[i];
+				break;
+			}
+		}
 		if(j) {
 			const char *name = jx_lookup_string(j, "name");
 			if(!name)
@@ -560,6 +1004,68 @@ static void handle_query(struct link *query_link)
 		fprintf(stream, "</center>\n");
 	}
 	fclose(stream);
+
+	link_write(query_link, response, response_length, time(0) + query_timeout);
+	free(response);
+
+	if(project) {
+		for(i = 0; i < n; i++)
+			jx_delete(array[i]);
+	}
+	free(array);
+	jx_delete(filter);
+	jx_delete(fields);
+}
+
+struct query {
+	struct link *link;
+	struct snapshot *snapshot;
+};
+
+static void *query_thread(void *arg)
+{
+	struct query *q = arg;
+
+	handle_query(q->link, q->snapshot);
+
+	link_close(q->link);
+	snapshot_release(q->snapshot);
+	free(q);
+
+	pthread_mutex_lock(&query_mutex);
+	query_threads_count--;
+	pthread_mutex_unlock(&query_mutex);
+
+	return 0;
+}
+
+static void start_query(struct link *link)
+{
+	struct query *q = xxmalloc(sizeof(*q));
+	pthread_attr_t attr;
+	pthread_t thread;
+
+	q->link = link;
+	q->snapshot = snapshot_get();
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+	pthread_mutex_lock(&query_mutex);
+	query_threads_count++;
+	pthread_mutex_unlock(&query_mutex);
+
+	if(pthread_create(&thread, &attr, query_thread, q)) {
+		debug(D_NOTICE, "couldn't start query thread: %s", strerror(errno));
+		pthread_mutex_lock(&query_mutex);
+		query_threads_count--;
+		pthread_mutex_unlock(&query_mutex);
+		snapshot_release(q->snapshot);
+		link_close(link);
+		free(q);
+	}
+
+	pthread_attr_destroy(&attr);
 }
 
 static void show_help(const char *cmd)
@@ -568,14 +1074,17 @@ static void show_help(const char *cmd)
 	fprintf(stdout, "where options are:\n");
 	fprintf(stdout, " %-30s Run as a daemon.\n", "-b,--background");
 	fprintf(stdout, " %-30s Write process identifier (PID) to file.\n", "-B,--pid-file=<file>");
+	fprintf(stdout, " %-30s Checkpoint the history at this interval.\n", "-C,--checkpoint-interval=<time>");
+	fprintf(stdout, " %-30s (default is 1h, 0 for daily checkpoints only)\n", "");
+	fprintf(stdout, " %-30s Each stores the whole table, so shorter intervals use more disk.\n", "");
 	fprintf(stdout, " %-30s Enable debugging for this subsystem\n", "-d,--debug=<subsystem>");
 	fprintf(stdout, " %-30s Show this help screen\n", "-h,--help");
 	fprintf(stdout, " %-30s Record catalog history to this directory.\n", "-H,--history=<directory>");
 	fprintf(stdout, " %-30s Listen only on this network interface.\n", "-I,--interface=<addr>");
 	fprintf(stdout, " %-30s Lifetime of data, in seconds (default is %d)\n", "-l,--lifetime=<secs>", lifetime);
 	fprintf(stdout, " %-30s Log new updates to this file.\n", "-L,--update-log=<file>");
-	fprintf(stdout, " %-30s Maximum number of child processes.\n", "-m,--max-jobs=<n>");
-	fprintf(stdout, " %-30s (default is %d)\n", "", child_procs_max);
+	fprintf(stdout, " %-30s Maximum number of queries answered at once.\n", "-m,--max-jobs=<n>");
+	fprintf(stdout, " %-30s (default is %d)\n", "", query_threads_max);
 	fprintf(stdout, " %-30s Maximum size of a server to be believed.\n", "-M,--server-size=<size>");
 	fprintf(stdout, " %-30s (default is any)\n", "");
 	fprintf(stdout, " %-30s Preferred host name of this server.\n", "-n,--name=<name>");
@@ -584,9 +1093,11 @@ static void show_help(const char *cmd)
 	fprintf(stdout, " %-30s Rotate debug file once it reaches this size.\n", "-O,--debug-rotate-max=<bytes>");
 	fprintf(stdout, " %-30s (default 10M, 0 disables)\n", "");
 	fprintf(stdout, " %-30s Port number to listen on (default is %d)\n", "-p,--port=<port>", port);
-	fprintf(stdout, " %-30s Single process mode; do not work on queries.\n", "-S,--single");
-	fprintf(stdout, " %-30s Maximum time to allow a query process to run.\n", "-T,--timeout=<time>");
-	fprintf(stdout, " %-30s (default is %ds)\n", "", child_procs_timeout);
+	fprintf(stdout, " %-30s Single thread mode; answer queries one at a time.\n", "-S,--single");
+	fprintf(stdout, " %-30s Number of threads parsing updates.\n", "-t,--threads=<n>");
+	fprintf(stdout, " %-30s (default is %d, 0 parses in the main thread)\n", "", update_threads);
+	fprintf(stdout, " %-30s Maximum time to allow for answering a query.\n", "-T,--timeout=<time>");
+	fprintf(stdout, " %-30s (default is %ds)\n", "", query_timeout);
 	fprintf(stdout, " %-30s Send status updates to this host. (default is\n", "-u,--update-host=<host>");
 	fprintf(stdout, " %-30s %s)\n", "", CATALOG_HOST_DEFAULT);
 	fprintf(stdout, " %-30s Send status updates at this interval.\n", "-U,--update-interval=<time>");
@@ -604,18 +1115,15 @@ int main(int argc, char *argv[])
 	int is_daemon = 0;
 	char *pidfile = NULL;
 	char *interface = NULL;
-	char raddr[LINK_ADDRESS_MAX];
-	int rport;
 
 	outgoing_host_list = list_create();
 
-	change_process_title_init(argv);
-
 	debug_config(argv[0]);
 
 	static const struct option long_options[] = {
 		{"background", no_argument, 0, 'b'},
 		{"pid-file", required_argument, 0, 'B'},
+		{"checkpoint-interval", required_argument, 0, 'C'},
 		{"debug", required_argument, 0, 'd'},
 		{"help", no_argument, 0, 'h'},
 		{"history", required_argument, 0, 'H'},
@@ -629,6 +1137,7 @@ int main(int argc, char *argv[])
 		{"debug-rotate-max", required_argument, 0, 'O'},
 		{"port", required_argument, 0, 'p'},
 		{"single", no_argument, 0, 'S'},
+		{"threads", required_argument, 0, 't'},
 		{"timeout", required_argument, 0, 'T'},
 		{"update-host", required_argument, 0, 'u'},
 		{"update-interval", required_argument, 0, 'U'},
@@ -637,7 +1146,7 @@ int main(int argc, char *argv[])
 		{0,0,0,0}};
 
 
-	while((ch = getopt_long(argc, argv, "bB:d:hH:I:l:L:m:M:n:o:O:p:ST:u:U:vZ:", long_options, NULL)) > -1) {
+	while((ch = getopt_long(argc, argv, "bB:C:d:hH:I:l:L:m:M:n:o:O:p:St:T:u:U:vZ:", long_options, NULL)) > -1) {
 		switch (ch) {
 			case 'b':
 				is_daemon = 1;
@@ -646,6 +1155,9 @@ int main(int argc, char *argv[])
 				free(pidfile);
 				pidfile = strdup(optarg);
 				break;
+			case 'C':
+				history_checkpoint_interval = string_time_parse(optarg);
+				break;
 			case 'd':
 				debug_flags_set(optarg);
 				break;
@@ -667,7 +1179,7 @@ int main(int argc, char *argv[])
 				interface = strdup(optarg);
 				break;
 			case 'm':
-				child_procs_max = atoi(optarg);
+				query_threads_max = atoi(optarg);
 				break;
 			case 'M':
 				max_server_size = string_metric_parse(optarg);
@@ -685,10 +1197,13 @@ int main(int argc, char *argv[])
 				port = atoi(optarg);
 				break;
 			case 'S':
-				fork_mode = 0;
+				query_thread_mode = 0;
+				break;
+			case 't':
+				update_threads = atoi(optarg);
 				break;
 			case 'T':
-				child_procs_timeout = string_time_parse(optarg);
+				query_timeout = string_time_parse(optarg);
 				break;
 			case 'u':
 				list_push_head(outgoing_host_list, xxstrdup(optarg));
@@ -724,7 +1239,6 @@ int main(int argc, char *argv[])
 
 	install_handler(SIGPIPE, ignore_signal);
 	install_handler(SIGHUP, ignore_signal);
-	install_handler(SIGCHLD, ignore_signal);
 	install_handler(SIGINT, shutdown_clean);
 	install_handler(SIGTERM, shutdown_clean);
 	install_handler(SIGQUIT, shutdown_clean);
@@ -742,6 +1256,9 @@ int main(int argc, char *argv[])
 	if(!table)
 		fatal("couldn't create directory %s: %s\n",history_dir,strerror(errno));
 
+	if(history_checkpoint_interval>=0)
+		jx_database_set_checkpoint_interval(table,history_checkpoint_interval);
+
 	query_port = link_serve_address(interface, port);
 	if(query_port) {
 		/*
@@ -770,6 +1287,10 @@ int main(int argc, char *argv[])
 			fatal("couldn't listen on UDP port %d", port);
 	}
 
+	/* A large buffer absorbs bursts of updates while the server is busy. */
+	int buffer_size = UDP_BUFFER_SIZE;
+	setsockopt(datagram_fd(update_dgram), SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+
 	update_port = link_serve_address(interface,port+1);
 	if(!update_port) {
 		if(interface)
@@ -780,11 +1301,15 @@ int main(int argc, char *argv[])
 
 	opts_write_port_file(port_file,port);
 
+	if(update_threads>0)
+		update_threads_start();
+
 	while(1) {
 		fd_set rfds;
 		int dfd = datagram_fd(update_dgram);
 		int lfd = link_fd(query_port);
 		int ufd = link_fd(update_port);
+		int pfd = update_threads>0 ? parsed_pipe[0] : -1;
 
 		int result, maxfd;
 		struct timeval timeout;
@@ -796,24 +1321,22 @@ int main(int argc, char *argv[])
 			outgoing_alarm = time(0) + outgoing_timeout;
 		}
 
-		while(1) {
-			int status;
-			pid_t pid = waitpid(-1, &status, WNOHANG);
-			if(pid>0) {
-				child_procs_count--;
-				continue;
-			} else {
-				break;
-			}
-		}
+		pthread_mutex_lock(&query_mutex);
+		int accept_queries = query_threads_count < query_threads_max;
+		pthread_mutex_unlock(&query_mutex);
 
 		FD_ZERO(&rfds);
-		FD_SET(dfd, &rfds);
+		if(!update_queue_full()) {
+			FD_SET(dfd, &rfds);
+		}
 		FD_SET(ufd, &rfds);
-		if(child_procs_count < child_procs_max) {
+		if(accept_queries) {
 			FD_SET(lfd, &rfds);
 		}
-		maxfd = MAX(ufd,MAX(dfd, lfd)) + 1;
+		if(pfd>=0) {
+			FD_SET(pfd, &rfds);
+		}
+		maxfd = MAX(pfd,MAX(ufd,MAX(dfd, lfd))) + 1;
 
 		timeout.tv_sec = 5;
 		timeout.tv_usec = 0;
@@ -822,6 +1345,10 @@ int main(int argc, char *argv[])
 		if(result <= 0)
 			continue;
 
+		if(pfd>=0 && FD_ISSET(pfd, &rfds)) {
+			handle_parsed_updates();
+		}
+
 		if(FD_ISSET(dfd, &rfds)) {
 			handle_udp_updates(update_dgram);
 		}
@@ -833,21 +1360,14 @@ int main(int argc, char *argv[])
 		if(FD_ISSET(lfd, &rfds)) {
 			link = link_accept(query_port, time(0) + 5);
 			if(link) {
-				if(fork_mode) {
-					pid_t pid = fork();
-					if(pid == 0) {
-						link_address_remote(link, raddr, &rport);
-						change_process_title("catalog_server [%s]", raddr);
-						alarm(child_procs_timeout);
-						handle_query(link);
-						_exit(0);
-					} else if (pid>0) {
-						child_procs_count++;
-					}
+				if(query_thread_mode) {
+					start_query(link);
 				} else {
-					handle_query(link);
+					struct snapshot *s = snapshot_get();
+					handle_query(link, s);
+					snapshot_release(s);
+					link_close(link);
 				}
-				link_close(link);
 			}
 		}
 	}
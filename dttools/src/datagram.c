@@ -6,6 +6,7 @@ See the file COPYING for details.
 */
 
 #include "datagram.h"
+#include "macros.h"
 #include "stringtools.h"
 
 #include <sys/types.h>
@@ -89,14 +90,20 @@ static int errno_is_temporary(int e)
 	}
 }
 
+static void sockaddr_to_text(struct sockaddr_storage *iaddr, SOCKLEN_T iaddr_length, char *addr, int *port)
+{
+	char port_string[16];
+
+	getnameinfo((struct sockaddr *)iaddr,iaddr_length,addr,DATAGRAM_ADDRESS_MAX,port_string,sizeof(port_string),NI_NUMERICHOST|NI_NUMERICSERV);
+
+	*port = atoi(port_string);
+}
+
 int datagram_recv(struct datagram *d, char *data, int length, char *addr, int *port, int timeout)
 {
 	int result;
 	struct sockaddr_storage iaddr;
 	SOCKLEN_T iaddr_length;
-	SOCKLEN_T addr_length = DATAGRAM_ADDRESS_MAX;
-	char port_string[16];
-	SOCKLEN_T port_string_length = 16;
 	fd_set fds;
 	struct timeval tm;
 
@@ -125,11 +132,72 @@ int datagram_recv(struct datagram *d, char *data, int length, char *addr, int *p
 	if(result < 0)
 		return result;
 
-	getnameinfo((struct sockaddr *)&iaddr,iaddr_length,addr,addr_length,port_string,port_string_length,NI_NUMERICHOST|NI_NUMERICSERV);
+	sockaddr_to_text(&iaddr, iaddr_length, addr, port);
 
-	*port = atoi(port_string);
+	return result;
+}
+
+/* Receive waiting datagrams one at a time, where recvmmsg is not available. */
+
+static int datagram_recv_each(struct datagram *d, char **data, int *lengths, char **addrs, int *ports, int count, int length)
+{
+	struct sockaddr_storage iaddr;
+	SOCKLEN_T iaddr_length;
+	int n;
+
+	for(n = 0; n < count; n++) {
+		iaddr_length = sizeof(iaddr);
+		int result = recvfrom(d->fd, data[n], length, MSG_DONTWAIT, (struct sockaddr *) &iaddr, &iaddr_length);
+		if(result < 0) {
+			if(n > 0 || errno_is_temporary(errno))
+				break;
+			return -1;
+		}
+		lengths[n] = result;
+		sockaddr_to_text(&iaddr, iaddr_length, addrs[n], &ports[n]);
+	}
+
+	return n;
+}
+
+int datagram_recv_many(struct datagram *d, char **data, int *lengths, char **addrs, int *ports, int count, int length)
+{
+#if defined(CCTOOLS_OPSYS_LINUX) && defined(MSG_WAITFORONE)
+	struct mmsghdr msgs[DATAGRAM_RECV_BATCH_MAX];
+	struct iovec iov[DATAGRAM_RECV_BATCH_MAX];
+	struct sockaddr_storage iaddr[DATAGRAM_RECV_BATCH_MAX];
+	int i, result;
+
+	count = MIN(count, DATAGRAM_RECV_BATCH_MAX);
+
+	memset(msgs, 0, sizeof(msgs[0]) * count);
+	for(i = 0; i < count; i++) {
+		iov[i].iov_base = data[i];
+		iov[i].iov_len = length;
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_name = &iaddr[i];
+		msgs[i].msg_hdr.msg_namelen = sizeof(iaddr[i]);
+	}
+
+	result = recvmmsg(d->fd, msgs, count, MSG_DONTWAIT, 0);
+	if(result < 0) {
+		if(errno == ENOSYS)
+			return datagram_recv_each(d, data, lengths, addrs, ports, count, length);
+		if(errno_is_temporary(errno))
+			return 0;
+		return -1;
+	}
+
+	for(i = 0; i < result; i++) {
+		lengths[i] = msgs[i].msg_len;
+		sockaddr_to_text(&iaddr[i], msgs[i].msg_hdr.msg_namelen, addrs[i], &ports[i]);
+	}
 
 	return result;
+#else
+	return datagram_recv_each(d, data, lengths, addrs, ports, MIN(count, DATAGRAM_RECV_BATCH_MAX), length);
+#endif
 }
 
 int datagram_send(struct datagram *d, const char *data, int length, const char *addr, int port)
@@ -63,6 +63,9 @@ if(length>0) {
 /** Maximum number of bytes in a datagram payload */
 #define DATAGRAM_PAYLOAD_MAX 65536
 
+/** Maximum number of datagrams received by one call to @ref datagram_recv_many. */
+#define DATAGRAM_RECV_BATCH_MAX 64
+
 /** Used to indicate any available port. */
 #define DATAGRAM_PORT_ANY 0
 
@@ -98,6 +101,21 @@ void datagram_delete(struct datagram *d);
 */
 int datagram_recv(struct datagram *d, char *data, int length, char *addr, int *port, int timeout);
 
+/** Receive several waiting datagrams at once.
+Unlike @ref datagram_recv, this does not wait: it returns as soon as no more
+datagrams are waiting, or @a count have been received.  Where the system
+allows it, the whole batch is received with a single system call.
+@param d The datagram object.
+@param data Array of @a count buffers, each of @a length bytes, to store the received messages.
+@param lengths Array of @a count integers, filled in with the length of each message.
+@param addrs Array of @a count strings of at least DATAGRAM_ADDRESS_MAX characters, filled in with the IP address of each sender.
+@param ports Array of @a count integers, filled in with the port number of each sender.
+@param count The number of buffers, of which at most DATAGRAM_RECV_BATCH_MAX are used.
+@param length The length of each buffer, typically DATAGRAM_PAYLOAD_MAX.
+@return The number of datagrams received, which is zero if none were waiting.  On failure, returns less than zero and sets errno appropriately.
+*/
+int datagram_recv_many(struct datagram *d, char **data, int *lengths, char **addrs, int *ports, int count, int length);
+
 /** Send a datagram.
 @param d The datagram object.
 @param data The data to send.
@@ -360,6 +360,11 @@ void debug_flags_restore(int64_t fl)
 	debug_flags = fl;
 }
 
+int debug_flags_active(int64_t fl)
+{
+	return (fl & debug_flags) != 0;
+}
+
 void debug_rename(const char *suffix)
 {
 	debug_file_rename(suffix);
@@ -123,6 +123,7 @@ modify the linker namespace we are using.
 #define debug_flags_print      cctools_debug_flags_print
 #define debug_flags_clear      cctools_debug_flags_clear
 #define debug_flags_restore    cctools_debug_flags_restore
+#define debug_flags_active     cctools_debug_flags_active
 #define debug_set_flag_name    cctools_debug_set_flag_name
 #define debug_rename           cctools_debug_rename
 
@@ -238,6 +239,13 @@ void debug_set_flag_name(int64_t flag, const char *name);
 */
 void debug_flags_restore(int64_t flags);
 
+/** Check whether any of the given debug flags are enabled.
+Useful to skip building a message that would not be shown.
+@param flags Any of the standard debugging flags OR-ed together.
+@return Non-zero if @ref debug would emit a message with these flags.
+*/
+int debug_flags_active(int64_t flags);
+
 /** Rename debug file with given suffix.
 @param suffix Suffix of saved log.
 */
@@ -9,6 +9,7 @@ See the file COPYING for details.
 #include "hash_cache.h"
 #include "debug.h"
 
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
@@ -22,6 +23,12 @@ See the file COPYING for details.
 static struct hash_cache *name_to_addr = 0;
 static struct hash_cache *addr_to_name = 0;
 
+/*
+The caches may be shared by several threads, but the lock is not held
+while resolving a name, so that a slow lookup does not hold up the others.
+*/
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 static int domain_name_cache_init()
 {
 	if(!name_to_addr) {
@@ -52,15 +59,22 @@ int domain_name_cache_lookup(const char *name, char *addr)
 	char *found, *copy;
 	int success;
 
-	if(!domain_name_cache_init())
+	pthread_mutex_lock(&cache_mutex);
+
+	if(!domain_name_cache_init()) {
+		pthread_mutex_unlock(&cache_mutex);
 		return 0;
+	}
 
 	found = hash_cache_lookup(name_to_addr, name);
 	if(found) {
 		strcpy(addr, found);
+		pthread_mutex_unlock(&cache_mutex);
 		return 1;
 	}
 
+	pthread_mutex_unlock(&cache_mutex);
+
 	success = domain_name_lookup(name, addr);
 	if(!success)
 		return 0;
@@ -69,7 +83,9 @@ int domain_name_cache_lookup(const char *name, char *addr)
 	if(!copy)
 		return 1;
 
+	pthread_mutex_lock(&cache_mutex);
 	success = hash_cache_insert(name_to_addr, name, copy, DOMAIN_NAME_CACHE_LIFETIME);
+	pthread_mutex_unlock(&cache_mutex);
 
 	return 1;
 }
@@ -79,15 +95,22 @@ int domain_name_cache_lookup_reverse(const char *addr, char *name)
 	char *found, *copy;
 	int success;
 
-	if(!domain_name_cache_init())
+	pthread_mutex_lock(&cache_mutex);
+
+	if(!domain_name_cache_init()) {
+		pthread_mutex_unlock(&cache_mutex);
 		return 0;
+	}
 
 	found = hash_cache_lookup(addr_to_name, addr);
 	if(found) {
 		strcpy(name, found);
+		pthread_mutex_unlock(&cache_mutex);
 		return 1;
 	}
 
+	pthread_mutex_unlock(&cache_mutex);
+
 	success = domain_name_lookup_reverse(addr, name);
 	if(!success)
 		return 0;
@@ -96,7 +119,9 @@ int domain_name_cache_lookup_reverse(const char *addr, char *name)
 	if(!copy)
 		return 1;
 
+	pthread_mutex_lock(&cache_mutex);
 	success = hash_cache_insert(addr_to_name, addr, copy, DOMAIN_NAME_CACHE_LIFETIME);
+	pthread_mutex_unlock(&cache_mutex);
 
 	return 1;
 }
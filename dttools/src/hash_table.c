@@ -109,43 +109,30 @@ int hash_table_size(struct hash_table *h)
 
 static int hash_table_double_buckets(struct hash_table *h)
 {
-	struct hash_table *hn = hash_table_create(2 * h->bucket_count, h->hash_func);
+	int new_count = 2 * h->bucket_count;
+	struct entry **new_buckets = (struct entry **) calloc(new_count, sizeof(struct entry *));
 
-	if(!hn)
+	if(!new_buckets)
 		return 0;
 
-	/* Move pairs to new hash */
-	char *key;
-	void *value;
-	hash_table_firstkey(h);
-	while(hash_table_nextkey(h, &key, &value))
-		if(!hash_table_insert(hn, key, value))
-		{
-			hash_table_delete(hn);
-			return 0;
-		}
-
-	/* Delete all old pairs */
+	/* Move entries to the new buckets, keeping their keys and hashes,
+	   rather than copying every key into a new table. */
 	struct entry *e, *f;
 	int i;
 	for(i = 0; i < h->bucket_count; i++) {
 		e = h->buckets[i];
 		while(e) {
 			f = e->next;
-			free(e->key);
-			free(e);
+			unsigned index = e->hash % new_count;
+			e->next = new_buckets[index];
+			new_buckets[index] = e;
 			e = f;
 		}
 	}
 
-	/* Make the old point to the new */
 	free(h->buckets);
-	h->buckets      = hn->buckets;
-	h->bucket_count = hn->bucket_count;
-	h->size         = hn->size;
-
-	/* Delete reference to new, so old is safe */
-	free(hn);
+	h->buckets      = new_buckets;
+	h->bucket_count = new_count;
 
 	return 1;
 }
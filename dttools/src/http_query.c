@@ -63,9 +63,19 @@ struct link *http_query(const char *url, const char *action, time_t stoptime)
 }
 
 struct link *http_query_size(const char *url, const char *action, INT64_T * size, time_t stoptime, int cache_reload)
+{
+	return http_query_range(url, action, 0, size, stoptime, cache_reload);
+}
+
+struct link *http_query_size_via_proxy(const char *proxy, const char *url, const char *action, INT64_T * size, time_t stoptime, int cache_reload)
+{
+	return http_query_range_via_proxy(proxy, url, action, 0, size, stoptime, cache_reload);
+}
+
+struct link *http_query_range(const char *url, const char *action, INT64_T offset, INT64_T * size, time_t stoptime, int cache_reload)
 {
 	if(!getenv("HTTP_PROXY")) {
-		return http_query_size_via_proxy(0, url, action, size, stoptime, cache_reload);
+		return http_query_range_via_proxy(0, url, action, offset, size, stoptime, cache_reload);
 	} else {
 		char proxies[HTTP_LINE_MAX];
 		char *proxy;
@@ -75,7 +85,7 @@ struct link *http_query_size(const char *url, const char *action, INT64_T * size
 
 		while(proxy) {
 			struct link *result;
-			result = http_query_size_via_proxy(proxy, url, action, size, stoptime, cache_reload);
+			result = http_query_range_via_proxy(proxy, url, action, offset, size, stoptime, cache_reload);
 			if(result)
 				return result;
 			proxy = strtok(0, ";");
@@ -84,7 +94,7 @@ struct link *http_query_size(const char *url, const char *action, INT64_T * size
 	}
 }
 
-struct link *http_query_size_via_proxy(const char *proxy, const char *urlin, const char *action, INT64_T * size, time_t stoptime, int cache_reload)
+struct link *http_query_range_via_proxy(const char *proxy, const char *urlin, const char *action, INT64_T offset, INT64_T * size, time_t stoptime, int cache_reload)
 {
 	char url[HTTP_LINE_MAX];
 	char newurl[HTTP_LINE_MAX];
@@ -154,6 +164,8 @@ struct link *http_query_size_via_proxy(const char *proxy, const char *urlin, con
 		buffer_printf(&B, "%s %s HTTP/1.1\r\n", action, url);
 		if(cache_reload)
 			buffer_putliteral(&B, "Cache-Control: max-age=0\r\n");
+		if(offset > 0)
+			buffer_printf(&B, "Range: bytes=%" PRId64 "-\r\n", offset);
 		buffer_putliteral(&B, "Connection: close\r\n");
 		buffer_printf(&B, "Host: %s\r\n", actual_host);
 		if(getenv("HTTP_USER_AGENT"))
@@ -185,6 +197,18 @@ struct link *http_query_size_via_proxy(const char *proxy, const char *urlin, con
 
 			switch (response) {
 			case 200:
+				/* The server ignored the range, so skip up to the offset. */
+				if(offset > 0 && strcmp(action, "HEAD")) {
+					if(link_soak(link, offset, stoptime) != offset) {
+						link_close(link);
+						errno = ECONNRESET;
+						return 0;
+					}
+					*size -= offset;
+				}
+				return link;
+				break;
+			case 206:
 				return link;
 				break;
 			case 301:
@@ -198,7 +222,7 @@ struct link *http_query_size_via_proxy(const char *proxy, const char *urlin, con
 						errno = EIO;
 						return 0;
 					} else {
-						return http_query_size_via_proxy(proxy,newurl,action,size,stoptime,cache_reload);
+						return http_query_range_via_proxy(proxy,newurl,action,offset,size,stoptime,cache_reload);
 					}
 				} else {
 					errno = ENOENT;
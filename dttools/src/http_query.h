@@ -16,6 +16,10 @@ struct link *http_query_no_cache(const char *url, const char *action, time_t sto
 struct link *http_query_size(const char *url, const char *action, INT64_T * size, time_t stoptime, int cache_reload);
 struct link *http_query_size_via_proxy(const char *proxy, const char *url, const char *action, INT64_T * size, time_t stoptime, int cache_reload);
 
+/* Like http_query_size, but asks for the object starting at offset. On return, size holds the number of bytes remaining after offset. */
+struct link *http_query_range(const char *url, const char *action, INT64_T offset, INT64_T * size, time_t stoptime, int cache_reload);
+struct link *http_query_range_via_proxy(const char *proxy, const char *url, const char *action, INT64_T offset, INT64_T * size, time_t stoptime, int cache_reload);
+
 INT64_T http_fetch_to_file(const char *url, const char *filename, time_t stoptime);
 
 #endif
@@ -7,6 +7,7 @@ See the file COPYING for details.
 #include "jx.h"
 #include "stringtools.h"
 #include "buffer.h"
+#include "hash_table.h"
 #include "xxmalloc.h"
 
 #include <assert.h>
@@ -15,6 +16,16 @@ See the file COPYING for details.
 #include <stdlib.h>
 #include <string.h>
 
+/*
+An object is indexed once it holds this many pairs.
+Smaller objects are faster to search linearly.
+The index is only built and changed when the object is,
+so that lookups never modify an object, and an object
+that is no longer modified can be searched by many threads.
+*/
+
+#define JX_INDEX_THRESHOLD 16
+
 struct jx_pair * jx_pair( struct jx *key, struct jx *value, struct jx_pair *next )
 {
 	struct jx_pair *pair = calloc(1, sizeof(*pair));
@@ -117,10 +128,13 @@ struct jx * jx_boolean( int boolean_value )
 	return j;
 }
 
+static void jx_index_check( struct jx *j );
+
 struct jx * jx_object( struct jx_pair *pairs )
 {
 	struct jx *j = jx_create(JX_OBJECT);
 	j->u.pairs = pairs;
+	jx_index_check(j);
 	return j;
 }
 
@@ -163,6 +177,78 @@ struct jx * jx_arrayv( struct jx *value, ... )
 	return array;
 }
 
+/*
+Build a hash table mapping each string key to its pair.
+When a key appears more than once, the first pair in the
+list shadows the others, just as in a linear search.
+*/
+
+static void jx_index_build( struct jx *j )
+{
+	struct jx_pair *p;
+
+	j->index = hash_table_create(0,0);
+
+	for(p=j->u.pairs;p;p=p->next) {
+		if(p->key && p->key->type==JX_STRING) {
+			hash_table_insert(j->index,p->key->u.string_value,p);
+		}
+	}
+}
+
+/* Index the object if it has become large enough. */
+
+static void jx_index_check( struct jx *j )
+{
+	struct jx_pair *p;
+	int count = 0;
+
+	if(j->index) return;
+
+	for(p=j->u.pairs;p;p=p->next) {
+		if(++count>=JX_INDEX_THRESHOLD) {
+			jx_index_build(j);
+			return;
+		}
+	}
+}
+
+/* Account for a pair just added to the head of the object. */
+
+static void jx_index_insert( struct jx *j, struct jx_pair *p )
+{
+	if(!j->index) {
+		jx_index_check(j);
+		return;
+	}
+
+	if(!p->key || p->key->type!=JX_STRING) return;
+
+	/* A duplicate key shadows the old pair. */
+	hash_table_remove(j->index,p->key->u.string_value);
+	hash_table_insert(j->index,p->key->u.string_value,p);
+}
+
+/* Account for a pair just removed, which may uncover an older duplicate in rest. */
+
+static void jx_index_remove( struct jx *j, struct jx_pair *p, struct jx_pair *rest )
+{
+	if(!j->index || !p->key || p->key->type!=JX_STRING) return;
+
+	const char *key = p->key->u.string_value;
+
+	if(hash_table_lookup(j->index,key)!=p) return;
+
+	hash_table_remove(j->index,key);
+
+	for(;rest;rest=rest->next) {
+		if(rest->key && rest->key->type==JX_STRING && !strcmp(rest->key->u.string_value,key)) {
+			hash_table_insert(j->index,key,rest);
+			return;
+		}
+	}
+}
+
 struct jx * jx_lookup_guard( struct jx *j, const char *key, int *found )
 {
 	struct jx_pair *p;
@@ -172,6 +258,16 @@ struct jx * jx_lookup_guard( struct jx *j, const char *key, int *found )
 
 	if(!j || j->type!=JX_OBJECT) return 0;
 
+	if(j->index) {
+		p = hash_table_lookup(j->index,key);
+		if(p) {
+			if(found)
+				*found = 1;
+			return p->value;
+		}
+		return 0;
+	}
+
 	for(p=j->u.pairs;p;p=p->next) {
 		if(p && p->key && p->key->type==JX_STRING) {
 			if(!strcmp(p->key->u.string_value,key)) {
@@ -236,15 +332,26 @@ struct jx * jx_remove( struct jx *object, struct jx *key )
 
 	struct jx_pair *p;
 	struct jx_pair *last = 0;
+	struct jx_pair *target = 0;
+
+	/*
+	With an index, a missing key costs nothing, and the pair
+	can be located by comparing pointers instead of keys.
+	*/
+	if(object->index && key && key->type==JX_STRING) {
+		target = hash_table_lookup(object->index,key->u.string_value);
+		if(!target) return 0;
+	}
 
 	for(p=object->u.pairs;p;p=p->next) {
-		if(jx_equals(key,p->key)) {
+		if(target ? p==target : jx_equals(key,p->key)) {
 			struct jx *value = p->value;
 			if(last) {
 				last->next = p->next;
 			} else {
 				object->u.pairs = p->next;
 			}
+			jx_index_remove(object,p,p->next);
 			p->value = 0;
 			p->next = 0;
 			jx_pair_delete(p);
@@ -260,6 +367,27 @@ int jx_insert( struct jx *j, struct jx *key, struct jx *value )
 {
 	if(!j || j->type!=JX_OBJECT) return 0;
 	j->u.pairs = jx_pair(key,value,j->u.pairs);
+	jx_index_insert(j,j->u.pairs);
+	return 1;
+}
+
+struct jx_pair * jx_object_shift( struct jx *object )
+{
+	if(!object || object->type!=JX_OBJECT || !object->u.pairs) return 0;
+
+	struct jx_pair *p = object->u.pairs;
+	object->u.pairs = p->next;
+	jx_index_remove(object,p,p->next);
+	p->next = 0;
+	return p;
+}
+
+int jx_insert_pair( struct jx *j, struct jx_pair *pair )
+{
+	if(!j || j->type!=JX_OBJECT) return 0;
+	pair->next = j->u.pairs;
+	j->u.pairs = pair;
+	jx_index_insert(j,pair);
 	return 1;
 }
 
@@ -409,6 +537,7 @@ void jx_delete( struct jx *j )
 			break;
 		case JX_OBJECT:
 			jx_pair_delete(j->u.pairs);
+			if(j->index) hash_table_delete(j->index);
 			break;
 		case JX_OPERATOR:
 			jx_delete(j->u.oper.left);
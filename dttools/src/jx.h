@@ -38,6 +38,8 @@ Will create the following output:
 
 #include <stdint.h>
 
+struct hash_table;
+
 /** JX atomic type.  */
 typedef enum {
 	JX_NULL = 0, /**< null value */
@@ -124,6 +126,7 @@ struct jx {
 		struct jx_operator oper; /**< value of @ref JX_OPERATOR */
 		struct jx *err;  /**< error value of @ref JX_ERROR */
 	} u;
+	struct hash_table *index; /**< index of string keys in a large @ref JX_OBJECT, kept up to date as pairs are inserted and removed */
 };
 
 /** Create a JX null value. @return A JX expression. */
@@ -227,6 +230,20 @@ struct jx * jx_remove( struct jx *object, struct jx *key );
 /** Insert a key-value pair into an object.  @param object The object.  @param key The key.  @param value The value. @return True on success, false on failure.  Failure can only occur if the object is not a @ref JX_OBJECT. */
 int jx_insert( struct jx *object, struct jx *key, struct jx *value );
 
+/** Insert an existing pair at the head of an object.
+Code that moves pairs between objects must use this
+rather than linking into @ref jx.pairs directly, so that
+the key index of a large object stays consistent.
+@param object The object.  @param pair The pair, which becomes owned by the object.
+@return True on success, false on failure.  Failure can only occur if the object is not a @ref JX_OBJECT. */
+int jx_insert_pair( struct jx *object, struct jx_pair *pair );
+
+/** Remove the first pair of an object.
+Like @ref jx_insert_pair, this keeps the key index consistent.
+@param object The object.
+@return The removed pair, now owned by the caller, or null if the object is empty or not a @ref JX_OBJECT. */
+struct jx_pair * jx_object_shift( struct jx *object );
+
 /** Insert a key-value pair into an object, unless the value is an empty collection, in which case delete the key and value.  @param key The key.  @param value The value. @return 1 on success, -1 on empty value, 0 on failure.  Failure can only occur if the object is not a @ref JX_OBJECT. */
 int jx_insert_unless_empty( struct jx *object, struct jx *key, struct jx *value );
 
@@ -239,7 +256,7 @@ void jx_insert_double( struct jx *object, const char *key, double value );
 /** Insert a string value into an object @param object The object @param key The key represented as a C string  @param value The C string value. */
 void jx_insert_string( struct jx *object, const char *key, const char *value );
 
-/** Search for a arbitrary item in an object.  The key is an ordinary string value.  @param object The object in which to search.  @param key The string key to match.  @return The value of the matching pair, or null if none is found. */
+/** Search for a arbitrary item in an object.  The key is an ordinary string value.  A large object is indexed by key as it is built, so that searches take constant time.  Searching does not modify the object, so an object that is no longer changing may be searched by several threads at once.  @param object The object in which to search.  @param key The string key to match.  @return The value of the matching pair, or null if none is found. */
 struct jx * jx_lookup( struct jx *object, const char *key );
 
 /* Like @ref jx_lookup, but found is set to 1 when the key is found. Useful for when value is false. */
@@ -249,6 +249,7 @@ struct jx * jx_binary_read( FILE *stream )
 	struct jx *arr;
 	struct jx *obj;
 	struct jx_pair **pair;
+	struct jx_pair *head;
 	struct jx_item **item;
 	
 	int result = jx_binary_read_uint8(stream,&type);
@@ -301,8 +302,8 @@ struct jx * jx_binary_read( FILE *stream )
 			return arr;
 			break;
 		case JX_BINARY_OBJECT:
-			obj = jx_object(0);
-			pair = &obj->u.pairs;
+			head = 0;
+			pair = &head;
 			while(1) {
 				*pair = jx_binary_read_pair(stream);
 				if(*pair) {
@@ -311,6 +312,7 @@ struct jx * jx_binary_read( FILE *stream )
 					break;
 				}
 			}
+			obj = jx_object(head);
 			return obj;
 			break;
 		case JX_BINARY_END:
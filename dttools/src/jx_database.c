@@ -22,6 +22,9 @@ See the file COPYING for details.
 #include <sys/types.h>
 #include <stdarg.h>
 
+/* Default interval between intra-day checkpoints. */
+#define CHECKPOINT_INTERVAL_DEFAULT 3600
+
 struct jx_database {
 	struct hash_table *table;
 	const char *logdir;
@@ -29,19 +32,18 @@ struct jx_database {
 	int logday;
 	FILE *logfile;
 	time_t last_log_time;
+	time_t last_checkpoint_time;
+	int checkpoint_interval;
 };
 
-/* Take the current state of the table and write it out verbatim to a checkpoint file. */
+/* Write the current state of the table verbatim to a stream. */
 
-static int checkpoint_write( struct jx_database *db, const char *filename )
+static void checkpoint_write_stream( struct jx_database *db, FILE *file )
 {
 	char *key;
 	struct jx *jobject;
 	int first = 1;
 
-	FILE *file = fopen(filename,"w");
-	if(!file) return 0;
-
 	fprintf(file,"{\n");
 
 	hash_table_firstkey(db->table);
@@ -56,7 +58,57 @@ static int checkpoint_write( struct jx_database *db, const char *filename )
 	}
 
 	fprintf(file,"}\n");
+}
+
+/* Take the current state of the table and write it out verbatim to a checkpoint file. */
+
+static int checkpoint_write( struct jx_database *db, const char *filename )
+{
+	FILE *file = fopen(filename,"w");
+	if(!file) return 0;
+
+	checkpoint_write_stream(db,file);
+
+	fclose(file);
+
+	return 1;
+}
+
+/*
+Append the current state of the table to the intra-day checkpoints of
+the open log, then add an index entry stating that it is the state at
+the given time, and that the log continues from the current offset.
+The index entry is written last, so that an interrupted checkpoint
+is never used.
+*/
+
+static int checkpoint_write_intraday( struct jx_database *db, time_t current )
+{
+	char filename[PATH_MAX];
+
+	fflush(db->logfile);
+	long log_offset = ftell(db->logfile);
+	if(log_offset<0) return 0;
+
+	sprintf(filename,"%s/%d/%d.ckpts",db->logdir,db->logyear,db->logday);
+	FILE *file = fopen(filename,"a");
+	if(!file) return 0;
 
+	fseek(file,0,SEEK_END);
+	long checkpoint_offset = ftell(file);
+
+	checkpoint_write_stream(db,file);
+
+	if(fclose(file)!=0 || checkpoint_offset<0) {
+		debug(D_NOTICE,"could not write checkpoint to %s: %s",filename,strerror(errno));
+		return 0;
+	}
+
+	sprintf(filename,"%s/%d/%d.idx",db->logdir,db->logyear,db->logday);
+	file = fopen(filename,"a");
+	if(!file) return 0;
+
+	fprintf(file,"%lld %ld %ld\n",(long long)current,log_offset,checkpoint_offset);
 	fclose(file);
 
 	return 1;
@@ -92,6 +144,22 @@ static int compat_checkpoint_read( struct jx_database *db, const char *filename
 	return 1;
 }
 
+/* Move each key and value of a checkpoint object over to the hash table. */
+
+static void checkpoint_load( struct jx_database *db, struct jx *jcheckpoint )
+{
+	struct jx_pair *p;
+	for(p=jcheckpoint->u.pairs;p;p=p->next) {
+		if(p->key->type!=JX_STRING) continue;
+		hash_table_insert(db->table,p->key->u.string_value,p->value);
+		p->value = 0;
+	}
+
+	/* Delete the leftover object with empty pairs. */
+
+	jx_delete(jcheckpoint);
+}
+
 /* Get a complete checkpoint file and reconstitute the state of the table. */
 
 static int checkpoint_read( struct jx_database *db, const char *filename )
@@ -110,18 +178,58 @@ static int checkpoint_read( struct jx_database *db, const char *filename )
 		return compat_checkpoint_read(db,filename);
 	}
 
-	/* For each key and value, move the value over to the hash table. */
+	checkpoint_load(db,jcheckpoint);
 
-	struct jx_pair *p;
-	for(p=jcheckpoint->u.pairs;p;p=p->next) {
-		if(p->key->type!=JX_STRING) continue;
-		hash_table_insert(db->table,p->key->u.string_value,p->value);
-		p->value = 0;
+	return 1;
+}
+
+/*
+Find the latest intra-day checkpoint of the given day taken at or before
+the snapshot time, and load it into the (empty) table.  On success, returns
+true and sets log_offset to the place in the log at which to continue.
+*/
+
+static int checkpoint_read_intraday( struct jx_database *db, int year, int day, time_t snapshot, long *log_offset )
+{
+	char filename[PATH_MAX];
+	char line[256];
+	long long t;
+	long loffset, coffset;
+	long checkpoint_offset = -1;
+
+	sprintf(filename,"%s/%d/%d.idx",db->logdir,year,day);
+	FILE *file = fopen(filename,"r");
+	if(!file) return 0;
+
+	while(fgets(line,sizeof(line),file)) {
+		if(sscanf(line,"%lld %ld %ld",&t,&loffset,&coffset)!=3) continue;
+		if(t>snapshot) break;
+		*log_offset = loffset;
+		checkpoint_offset = coffset;
 	}
 
-	/* Delete the leftover object with empty pairs. */
+	fclose(file);
 
-	jx_delete(jcheckpoint);
+	if(checkpoint_offset<0) return 0;
+
+	sprintf(filename,"%s/%d/%d.ckpts",db->logdir,year,day);
+	file = fopen(filename,"r");
+	if(!file) return 0;
+
+	struct jx *jcheckpoint = 0;
+	if(fseek(file,checkpoint_offset,SEEK_SET)==0) {
+		jcheckpoint = jx_parse_stream(file);
+	}
+
+	fclose(file);
+
+	if(!jcheckpoint || jcheckpoint->type!=JX_OBJECT) {
+		debug(D_NOTICE,"could not parse checkpoint at offset %ld of %s",checkpoint_offset,filename);
+		jx_delete(jcheckpoint);
+		return 0;
+	}
+
+	checkpoint_load(db,jcheckpoint);
 
 	return 1;
 }
@@ -155,6 +263,10 @@ static void log_select( struct jx_database *db )
 	sprintf(filename,"%s/%d/%d.log",db->logdir,db->logyear,db->logday);
 	db->logfile = fopen(filename,"a");
 	if(!db->logfile) fatal("could not open log file %s: %s",filename,strerror(errno));
+	fseek(db->logfile,0,SEEK_END);
+
+	// The daily checkpoint (or recovery) stands for the state at this moment.
+	db->last_checkpoint_time = current;
 
 	// If we switched from one log to another, write an intermediate checkpoint.
 	if(write_checkpoint_file) {
@@ -164,12 +276,20 @@ static void log_select( struct jx_database *db )
 
 }
 
-/* If time has advanced since the last event, log a time record. */
+/*
+If time has advanced since the last event, log a time record.
+Before doing so, write an intra-day checkpoint if one is due, so that
+it captures exactly the state as of the last time record.
+*/
 
 static void log_time( struct jx_database *db )
 {
 	time_t current = time(0);
 	if(db->last_log_time!=current) {
+		if(db->checkpoint_interval>0 && db->last_log_time>0 && (current-db->last_checkpoint_time)>=db->checkpoint_interval) {
+			checkpoint_write_intraday(db,db->last_log_time);
+			db->last_checkpoint_time = current;
+		}
 		db->last_log_time = current;
 		fprintf(db->logfile,"T %lld\n",(long long)current);
 	}
@@ -229,7 +349,7 @@ static void log_updates( struct jx_database *db, const char *key, struct jx *a,
 			}
 		} else {
 			// item was removed, log a remove record instead
-			log_message(db,"R %s %s",key,name);
+			log_message(db,"R %s %s\n",key,name);
 		}
 	}
 
@@ -301,7 +421,7 @@ Returns true if file could be open and played, false otherwise.
 
 #define LOG_LINE_MAX 65536
 
-static int log_replay( struct jx_database *db, const char *filename, time_t snapshot)
+static int log_replay( struct jx_database *db, const char *filename, long offset, time_t snapshot)
 {
 	char line[LOG_LINE_MAX];
 	char value[LOG_LINE_MAX];
@@ -315,6 +435,11 @@ static int log_replay( struct jx_database *db, const char *filename, time_t snap
 	FILE *file = fopen(filename,"r");
 	if(!file) return 0;
 
+	if(offset>0 && fseek(file,offset,SEEK_SET)!=0) {
+		fclose(file);
+		return 0;
+	}
+
 	while(fgets(line,sizeof(line),file)) {
 		if(line[0]=='C') {
 			n = sscanf(line,"C %s %[^\n]",key,value);
@@ -405,25 +530,30 @@ static int log_replay( struct jx_database *db, const char *filename, time_t snap
 }
 
 /*
-Recover the state of the table by loading the appropriate checkpoint
-file, then playing the corresponding log until the snapshot time is reached.
+Recover the state of the table by loading the latest checkpoint
+before the snapshot time, then playing the corresponding log from
+that point until the snapshot time is reached.
 Returns true if successful, false if files could not be played.
 */
 
 static int log_recover( struct jx_database *db, time_t snapshot )
 {
 	char filename[PATH_MAX];
+	long offset = 0;
 
 	struct tm *t = gmtime(&snapshot);
 
 	int year = t->tm_year + 1900;
 	int day = t->tm_yday;
 
-	sprintf(filename,"%s/%d/%d.ckpt",db->logdir,year,day);
-	checkpoint_read(db,filename);
+	if(!checkpoint_read_intraday(db,year,day,snapshot,&offset)) {
+		offset = 0;
+		sprintf(filename,"%s/%d/%d.ckpt",db->logdir,year,day);
+		checkpoint_read(db,filename);
+	}
 
 	sprintf(filename,"%s/%d/%d.log",db->logdir,year,day);
-	log_replay(db,filename,snapshot);
+	log_replay(db,filename,offset,snapshot);
 
 	return 1;
 }
@@ -441,6 +571,8 @@ struct jx_database * jx_database_create( const char *logdir )
 	db->logday = 0;
 	db->logfile = 0;
 	db->last_log_time = 0;
+	db->last_checkpoint_time = 0;
+	db->checkpoint_interval = CHECKPOINT_INTERVAL_DEFAULT;
 	db->logdir = 0;
 
 	if(logdir) {
@@ -451,11 +583,19 @@ struct jx_database * jx_database_create( const char *logdir )
 	return db;
 }
 
-void jx_database_insert( struct jx_database *db, const char *key, struct jx *nv )
+void jx_database_set_checkpoint_interval( struct jx_database *db, int interval )
 {
-	struct jx *old = hash_table_remove(db->table,key);
+	db->checkpoint_interval = interval;
+}
 
-	hash_table_insert(db->table,key,nv);
+/*
+Note that the change is logged before the table is modified,
+so that a checkpoint written along the way does not include it.
+*/
+
+void jx_database_insert( struct jx_database *db, const char *key, struct jx *nv )
+{
+	struct jx *old = hash_table_lookup(db->table,key);
 
 	if(db->logdir) {
 		if(old) {
@@ -465,7 +605,12 @@ void jx_database_insert( struct jx_database *db, const char *key, struct jx *nv
 		}
 	}
 
-	if(old) jx_delete(old);
+	if(old) {
+		hash_table_remove(db->table,key);
+		jx_delete(old);
+	}
+
+	hash_table_insert(db->table,key,nv);
 
 	log_flush(db);
 }
@@ -477,14 +622,12 @@ struct jx * jx_database_lookup( struct jx_database *db, const char *key )
 
 struct jx * jx_database_remove( struct jx_database *db, const char *key )
 {
-	const char *nkey = strdup(key);
-
-	struct jx *j = hash_table_remove(db->table,key);
+	struct jx *j = hash_table_lookup(db->table,key);
 	if(db->logdir && j) {
-		log_delete(db,nkey);
+		log_delete(db,key);
 		log_flush(db);
 	}
-	return j;
+	return hash_table_remove(db->table,key);
 }
 
 void jx_database_firstkey( struct jx_database *db )
@@ -13,12 +13,19 @@ See the file COPYING for details.
 #include "macros.h"
 #include "stringtools.h"
 #include "address.h"
+#include "itable.h"
+#include "list.h"
+#include "set.h"
 
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <sys/file.h>
 #include <poll.h>
+#ifdef CCTOOLS_OPSYS_LINUX
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
+#endif
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <sys/types.h>
@@ -60,6 +67,16 @@ struct link {
 	char buffer[1<<16];
 	char raddr[LINK_ADDRESS_MAX];
 	int rport;
+	struct link_poller *poller;
+	int poller_events;
+};
+
+struct link_poller {
+#ifdef CCTOOLS_OPSYS_LINUX
+	int epfd;
+#endif
+	struct itable *links;
+	struct set *buffered;
 };
 
 static int link_send_window = 65536;
@@ -283,6 +300,8 @@ static struct link *link_create()
 	link->raddr[0] = 0;
 	link->rport = 0;
 	link->type = LINK_TYPE_STANDARD;
+	link->poller = 0;
+	link->poller_events = 0;
 
 	return link;
 }
@@ -554,6 +573,8 @@ static ssize_t fill_buffer(struct link *link, time_t stoptime)
 			link->read += chunk;
 			link->buffer_start = link->buffer;
 			link->buffer_length = chunk;
+			if(link->poller)
+				set_insert(link->poller->buffered, link);
 			return chunk;
 		} else if(chunk == 0) {
 			link->buffer_start = link->buffer;
@@ -811,6 +832,8 @@ ssize_t link_putfstring(struct link *link, const char *fmt, time_t stoptime, ...
 void link_close(struct link *link)
 {
 	if(link) {
+		if(link->poller)
+			link_poller_remove(link->poller, link);
 		if(link->fd >= 0)
 			close(link->fd);
 		if(link->rport)
@@ -822,6 +845,8 @@ void link_close(struct link *link)
 void link_detach(struct link *link)
 {
 	if(link) {
+		if(link->poller)
+			link_poller_remove(link->poller, link);
 		free(link);
 	}
 }
@@ -912,10 +937,97 @@ ssize_t link_stream_to_buffer(struct link * link, char **buffer, time_t stoptime
 	return total;
 }
 
+#ifdef CCTOOLS_OPSYS_LINUX
+/*
+Move data from the link to fd without copying it to user space, by
+splicing it through a pipe. Data already in the link buffer is written
+first. Returns the number of bytes moved, or -1 on a write error. If
+splice is not supported by fd, only part of length may be moved, and the
+caller continues with the regular copy.
+*/
+
+static int64_t link_splice_to_fd(struct link *link, int fd, int64_t length, time_t stoptime)
+{
+	int64_t total = 0;
+	int pipefd[2];
+
+	if(link->buffer_length > 0) {
+		size_t chunk = MIN(link->buffer_length, (size_t)length);
+		if(full_write(fd, link->buffer_start, chunk) != (ssize_t)chunk) {
+			return -1;
+		}
+		link->buffer_start += chunk;
+		link->buffer_length -= chunk;
+		total += chunk;
+		length -= chunk;
+	}
+
+	if(length < (int64_t)sizeof(link->buffer) || pipe(pipefd) != 0) {
+		return total;
+	}
+
+	int spliceable = 1;
+
+	while(length > 0 && spliceable) {
+		ssize_t ractual = splice(link->fd, NULL, pipefd[1], NULL, MIN(sizeof(link->buffer), (size_t)length), SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+		if(ractual < 0) {
+			if(errno_is_temporary(errno) && link_sleep(link, stoptime, 1, 0)) {
+				continue;
+			}
+			break;
+		} else if(ractual == 0) {
+			break;
+		}
+
+		link->read += ractual;
+
+		ssize_t pending = ractual;
+		while(pending > 0) {
+			ssize_t wactual = spliceable ? splice(pipefd[0], NULL, fd, NULL, pending, SPLICE_F_MOVE) : -1;
+			if(wactual > 0) {
+				pending -= wactual;
+				continue;
+			}
+
+			/* fd does not take spliced data, so drain the pipe by hand. */
+			spliceable = 0;
+
+			char buffer[1<<16];
+			ssize_t chunk = full_read(pipefd[0], buffer, MIN(sizeof(buffer), (size_t)pending));
+			if(chunk <= 0 || full_write(fd, buffer, chunk) != chunk) {
+				break;
+			}
+			pending -= chunk;
+		}
+
+		if(pending > 0) {
+			total = -1;
+			break;
+		}
+
+		total += ractual;
+		length -= ractual;
+	}
+
+	close(pipefd[0]);
+	close(pipefd[1]);
+
+	return total;
+}
+#endif
+
 int64_t link_stream_to_fd(struct link * link, int fd, int64_t length, time_t stoptime)
 {
 	int64_t total = 0;
 
+#ifdef CCTOOLS_OPSYS_LINUX
+	total = link_splice_to_fd(link, fd, length, stoptime);
+	if(total < 0) {
+		return total;
+	}
+	length -= total;
+#endif
+
 	while(length > 0) {
 		char buffer[1<<16];
 		size_t chunk = MIN(sizeof(buffer), (size_t)length);
@@ -962,10 +1074,57 @@ int64_t link_stream_to_file(struct link * link, FILE * file, int64_t length, tim
 	return total;
 }
 
+#ifdef CCTOOLS_OPSYS_LINUX
+/*
+Send data from fd to the link with sendfile, without copying it to user
+space. Returns the number of bytes sent, or -1 on error. If fd does not
+support sendfile (e.g. a pipe), only part of length may be sent, and the
+caller continues with the regular copy from the current offset of fd.
+*/
+
+static int64_t link_sendfile_from_fd(struct link *link, int fd, int64_t length, time_t stoptime)
+{
+	int64_t total = 0;
+
+	while(length > 0) {
+		ssize_t chunk = sendfile(link->fd, fd, NULL, MIN((int64_t)(1<<30), length));
+		if(chunk < 0) {
+			if(errno_is_temporary(errno)) {
+				if(link_sleep(link, stoptime, 0, 1)) {
+					continue;
+				} else {
+					return -1;
+				}
+			} else if(errno == EINVAL || errno == ENOSYS) {
+				break;
+			} else {
+				return -1;
+			}
+		} else if(chunk == 0) {
+			break;
+		}
+
+		link->written += chunk;
+		total += chunk;
+		length -= chunk;
+	}
+
+	return total;
+}
+#endif
+
 int64_t link_stream_from_fd(struct link * link, int fd, int64_t length, time_t stoptime)
 {
 	int64_t total = 0;
 
+#ifdef CCTOOLS_OPSYS_LINUX
+	total = link_sendfile_from_fd(link, fd, length, stoptime);
+	if(total < 0) {
+		return total;
+	}
+	length -= total;
+#endif
+
 	while(length > 0) {
 		char buffer[1<<16];
 		size_t chunk = MIN(sizeof(buffer), (size_t)length);
@@ -1113,4 +1272,212 @@ int link_poll(struct link_info *links, int nlinks, int msec)
 	return result;
 }
 
+struct link_poller *link_poller_create()
+{
+	struct link_poller *p = malloc(sizeof(*p));
+	if(!p)
+		return 0;
+
+#ifdef CCTOOLS_OPSYS_LINUX
+	p->epfd = epoll_create1(EPOLL_CLOEXEC);
+	if(p->epfd < 0) {
+		free(p);
+		return 0;
+	}
+#endif
+	p->links = itable_create(0);
+	p->buffered = set_create(0);
+
+	return p;
+}
+
+void link_poller_delete(struct link_poller *p)
+{
+	if(!p)
+		return;
+
+	/* links still registered must not point back to the poller. */
+	struct link *link;
+	uint64_t fd;
+	itable_firstkey(p->links);
+	while(itable_nextkey(p->links, &fd, (void **) &link)) {
+		link->poller = 0;
+		link->poller_events = 0;
+	}
+	itable_delete(p->links);
+
+#ifdef CCTOOLS_OPSYS_LINUX
+	close(p->epfd);
+#endif
+
+	set_delete(p->buffered);
+	free(p);
+}
+
+#ifdef CCTOOLS_OPSYS_LINUX
+static int link_to_epoll(int events)
+{
+	int r = 0;
+	if(events & LINK_READ)
+		r |= EPOLLIN;
+	if(events & LINK_WRITE)
+		r |= EPOLLOUT;
+	return r;
+}
+
+static int epoll_to_link(int events)
+{
+	int r = 0;
+	if(events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+		r |= LINK_READ;
+	if(events & EPOLLOUT)
+		r |= LINK_WRITE;
+	return r;
+}
+#endif
+
+int link_poller_add(struct link_poller *p, struct link *link, int events)
+{
+	if(link->poller && link->poller != p) {
+		errno = EBUSY;
+		return 0;
+	}
+
+	if(link->poller == p && link->poller_events == events)
+		return 1;
+
+#ifdef CCTOOLS_OPSYS_LINUX
+	struct epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = link_to_epoll(events);
+	ev.data.ptr = link;
+
+	if(epoll_ctl(p->epfd, link->poller ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, link->fd, &ev) != 0)
+		return 0;
+#endif
+
+	itable_insert(p->links, link->fd, link);
+
+	link->poller = p;
+	link->poller_events = events;
+
+	if(link->buffer_length)
+		set_insert(p->buffered, link);
+
+	return 1;
+}
+
+void link_poller_remove(struct link_poller *p, struct link *link)
+{
+	if(link->poller != p)
+		return;
+
+#ifdef CCTOOLS_OPSYS_LINUX
+	struct epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	epoll_ctl(p->epfd, EPOLL_CTL_DEL, link->fd, &ev);
+#endif
+
+	itable_remove(p->links, link->fd);
+
+	set_remove(p->buffered, link);
+	link->poller = 0;
+	link->poller_events = 0;
+}
+
+/* Add a link to the ready array, merging it with the links found ready because of their buffers. */
+static void link_poller_ready(struct link_info *ready, int nbuffered, int *n, struct link *link, int revents)
+{
+	int i;
+	for(i = 0; i < nbuffered; i++) {
+		if(ready[i].link == link) {
+			ready[i].revents |= revents;
+			return;
+		}
+	}
+
+	ready[*n].link = link;
+	ready[*n].events = link->poller_events;
+	ready[*n].revents = revents;
+	(*n)++;
+}
+
+int link_poller_wait(struct link_poller *p, struct link_info *ready, int nready, int msec)
+{
+	struct link *link;
+	int result;
+	int n = 0;
+	int i;
+
+	/* Links with data already waiting in their buffer are ready, and we should not sit in the wait. */
+	struct list *drained = 0;
+	set_first_element(p->buffered);
+	while((link = set_next_element(p->buffered))) {
+		if(!link->buffer_length) {
+			if(!drained)
+				drained = list_create();
+			list_push_tail(drained, link);
+		} else if(n < nready && (link->poller_events & LINK_READ)) {
+			link_poller_ready(ready, 0, &n, link, LINK_READ);
+		}
+	}
+
+	if(drained) {
+		while((link = list_pop_head(drained))) {
+			set_remove(p->buffered, link);
+		}
+		list_delete(drained);
+	}
+
+	int nbuffered = n;
+	if(nbuffered > 0)
+		msec = 0;
+
+#ifdef CCTOOLS_OPSYS_LINUX
+	if(nready - n < 1)
+		return n;
+
+	struct epoll_event *events = malloc((nready - n) * sizeof(*events));
+	result = epoll_wait(p->epfd, events, nready - n, msec);
+
+	for(i = 0; i < result; i++) {
+		link_poller_ready(ready, nbuffered, &n, events[i].data.ptr, epoll_to_link(events[i].events));
+	}
+
+	free(events);
+#else
+	int nlinks = itable_size(p->links);
+	struct pollfd *fds = malloc(nlinks * sizeof(struct pollfd));
+	struct link **links = malloc(nlinks * sizeof(struct link *));
+	uint64_t fd;
+
+	memset(fds, 0, nlinks * sizeof(struct pollfd));
+
+	i = 0;
+	itable_firstkey(p->links);
+	while(itable_nextkey(p->links, &fd, (void **) &link)) {
+		fds[i].fd = link->fd;
+		fds[i].events = link_to_poll(link->poller_events);
+		links[i] = link;
+		i++;
+	}
+
+	result = poll(fds, nlinks, msec);
+
+	for(i = 0; result > 0 && i < nlinks && n < nready; i++) {
+		int revents = poll_to_link(fds[i].revents);
+		if(revents)
+			link_poller_ready(ready, nbuffered, &n, links[i], revents);
+	}
+
+	free(fds);
+	free(links);
+#endif
+
+	if(result < 0 && n == 0)
+		return -1;
+
+	return n;
+}
+
 /* vim: set noexpandtab tabstop=4: */
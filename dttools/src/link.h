@@ -346,4 +346,43 @@ Wait for a activity on a an array of links.
 
 int link_poll(struct link_info *array, int nlinks, int msec);
 
+struct link_poller;
+
+/** Create a persistent set of links to wait on.
+Unlike @ref link_poll, links are registered once with @ref link_poller_add, and the cost of
+@ref link_poller_wait grows with the number of links that are ready, rather than with the
+number of links registered. On Linux, it is implemented with epoll.
+@return A pointer to a new poller, or null on failure with errno set appropriately.
+*/
+struct link_poller *link_poller_create();
+
+/** Delete a poller. The links registered with it are not closed.
+@param p The poller to delete.
+*/
+void link_poller_delete(struct link_poller *p);
+
+/** Register a link with a poller, or change the events of a link already registered.
+A link may be registered with only one poller at a time, and it is removed from it when closed.
+@param p The poller.
+@param link The link to wait on.
+@param events The events to wait for (@ref LINK_READ or @ref LINK_WRITE).
+@return True on success, false on failure with errno set appropriately.
+*/
+int link_poller_add(struct link_poller *p, struct link *link, int events);
+
+/** Remove a link from a poller.
+@param p The poller.
+@param link The link to remove.
+*/
+void link_poller_remove(struct link_poller *p, struct link *link);
+
+/** Wait for activity on the links registered with a poller.
+@param p The poller.
+@param ready Pointer to an array of @ref link_info structures, which is filled with the links that are ready.
+@param nready The length of the array. Links ready beyond this length are reported in a following call.
+@param msec The number of milliseconds to wait for activity.  Zero indicates do not wait at all, while -1 indicates wait forever.
+@return The number of entries filled in the array, or -1 on failure.
+*/
+int link_poller_wait(struct link_poller *p, struct link_info *ready, int nready, int msec);
+
 #endif
@@ -122,6 +122,20 @@ void list_reset(struct list_cursor *cur) {
 	cur->target = NULL;
 }
 
+/* The push, pop, and peek functions below are called very often, so
+ * they use a cursor on the stack rather than allocating one each time. */
+static void list_cursor_init(struct list_cursor *cur, struct list *list) {
+	assert(list);
+	cur->list = list;
+	cur->target = NULL;
+	list_ref(list);
+}
+
+static void list_cursor_fini(struct list_cursor *cur) {
+	list_reset(cur);
+	list_unref(cur->list);
+}
+
 void list_cursor_destroy(struct list_cursor *cur) {
 	assert(cur);
 	assert(cur->list);
@@ -379,17 +393,19 @@ void list_free(struct list *l) {
 }
 
 int list_push_head(struct list *l, void *item) {
-	struct list_cursor *cur = list_cursor_create(l);
-	list_seek(cur, 0);
-	list_insert(cur, item);
-	list_cursor_destroy(cur);
+	struct list_cursor cur;
+	list_cursor_init(&cur, l);
+	list_seek(&cur, 0);
+	list_insert(&cur, item);
+	list_cursor_fini(&cur);
 	return 1;
 }
 
 int list_push_tail(struct list *l, void *item) {
-	struct list_cursor *cur = list_cursor_create(l);
-	list_insert(cur, item);
-	list_cursor_destroy(cur);
+	struct list_cursor cur;
+	list_cursor_init(&cur, l);
+	list_insert(&cur, item);
+	list_cursor_fini(&cur);
 	return 1;
 }
 
@@ -399,11 +415,12 @@ void *list_pop_head(struct list *l) {
 	if (!l)
 		return NULL;
 
-	struct list_cursor *cur = list_cursor_create(l);
-	list_seek(cur, 0);
-	list_get(cur, &item);
-	list_drop(cur);
-	list_cursor_destroy(cur);
+	struct list_cursor cur;
+	list_cursor_init(&cur, l);
+	list_seek(&cur, 0);
+	list_get(&cur, &item);
+	list_drop(&cur);
+	list_cursor_fini(&cur);
 
 	return item;
 }
@@ -414,11 +431,12 @@ void *list_pop_tail(struct list *l) {
 	if (!l)
 		return NULL;
 
-	struct list_cursor *cur = list_cursor_create(l);
-	list_seek(cur, -1);
-	list_get(cur, &item);
-	list_drop(cur);
-	list_cursor_destroy(cur);
+	struct list_cursor cur;
+	list_cursor_init(&cur, l);
+	list_seek(&cur, -1);
+	list_get(&cur, &item);
+	list_drop(&cur);
+	list_cursor_fini(&cur);
 
 	return item;
 }
@@ -429,10 +447,11 @@ void *list_peek_head(struct list *l) {
 	if (!l)
 		return NULL;
 
-	struct list_cursor *cur = list_cursor_create(l);
-	list_seek(cur, 0);
-	list_get(cur, &item);
-	list_cursor_destroy(cur);
+	struct list_cursor cur;
+	list_cursor_init(&cur, l);
+	list_seek(&cur, 0);
+	list_get(&cur, &item);
+	list_cursor_fini(&cur);
 
 	return item;
 }
@@ -443,10 +462,11 @@ void *list_peek_tail(struct list *l) {
 	if (!l)
 		return NULL;
 
-	struct list_cursor *cur = list_cursor_create(l);
-	list_seek(cur, -1);
-	list_get(cur, &item);
-	list_cursor_destroy(cur);
+	struct list_cursor cur;
+	list_cursor_init(&cur, l);
+	list_seek(&cur, -1);
+	list_get(&cur, &item);
+	list_cursor_fini(&cur);
 
 	return item;
 }
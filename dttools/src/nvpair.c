@@ -48,17 +48,17 @@ void nvpair_delete(struct nvpair *n)
 void nvpair_parse(struct nvpair *n, const char *data)
 {
 	char *text = xxstrdup(data);
-	char *name, *value;
+	char *name, *value, *saveptr;
 
-	name = strtok(text, " ");
+	name = strtok_r(text, " ", &saveptr);
 	while(name) {
-		value = strtok(0, "\n");
+		value = strtok_r(0, "\n", &saveptr);
 		if(value) {
 			nvpair_insert_string(n, name, value);
 		} else {
 			break;
 		}
-		name = strtok(0, " ");
+		name = strtok_r(0, " ", &saveptr);
 	}
 
 	free(text);
@@ -0,0 +1,353 @@
+/*
+Copyright (C) 2019- The University of Notre Dame
+This software is distributed under the GNU General Public License.
+See the file COPYING for details.
+*/
+
+#include "priority_queue.h"
+#include "itable.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define DEFAULT_CAPACITY 127
+
+struct node {
+	void *data;
+	double priority;
+	uint64_t sequence;   /* ties are broken by push order */
+	int index;           /* current position in the heap */
+};
+
+struct priority_queue {
+	int size;
+	int capacity;
+	struct node **heap;
+	struct itable *nodes;   /* data -> node */
+	uint64_t next_sequence;
+
+	/* iteration in priority order: a heap of positions of the main heap. */
+	int *iter;
+	int iter_size;
+	int iter_capacity;
+	uint64_t version;
+	uint64_t iter_version;
+};
+
+/* 1 if a goes before b. */
+static int node_before(struct node *a, struct node *b)
+{
+	if(a->priority != b->priority) {
+		return a->priority > b->priority;
+	}
+
+	return a->sequence < b->sequence;
+}
+
+static void swap_nodes(struct priority_queue *pq, int i, int j)
+{
+	struct node *tmp = pq->heap[i];
+
+	pq->heap[i] = pq->heap[j];
+	pq->heap[j] = tmp;
+
+	pq->heap[i]->index = i;
+	pq->heap[j]->index = j;
+}
+
+static int sift_up(struct priority_queue *pq, int i)
+{
+	while(i > 0) {
+		int parent = (i - 1) / 2;
+		if(!node_before(pq->heap[i], pq->heap[parent])) {
+			break;
+		}
+		swap_nodes(pq, i, parent);
+		i = parent;
+	}
+
+	return i;
+}
+
+static int sift_down(struct priority_queue *pq, int i)
+{
+	while(1) {
+		int left  = 2 * i + 1;
+		int right = 2 * i + 2;
+		int best  = i;
+
+		if(left < pq->size && node_before(pq->heap[left], pq->heap[best])) {
+			best = left;
+		}
+
+		if(right < pq->size && node_before(pq->heap[right], pq->heap[best])) {
+			best = right;
+		}
+
+		if(best == i) {
+			break;
+		}
+
+		swap_nodes(pq, i, best);
+		i = best;
+	}
+
+	return i;
+}
+
+struct priority_queue *priority_queue_create(int capacity)
+{
+	struct priority_queue *pq;
+
+	pq = (struct priority_queue *) malloc(sizeof(struct priority_queue));
+	if(!pq)
+		return 0;
+
+	if(capacity < 1)
+		capacity = DEFAULT_CAPACITY;
+
+	pq->heap = (struct node **) malloc(capacity * sizeof(struct node *));
+	pq->nodes = itable_create(0);
+	if(!pq->heap || !pq->nodes) {
+		free(pq->heap);
+		if(pq->nodes)
+			itable_delete(pq->nodes);
+		free(pq);
+		return 0;
+	}
+
+	pq->size = 0;
+	pq->capacity = capacity;
+	pq->next_sequence = 0;
+
+	pq->iter = 0;
+	pq->iter_size = 0;
+	pq->iter_capacity = 0;
+	pq->version = 0;
+	pq->iter_version = 0;
+
+	return pq;
+}
+
+void priority_queue_delete(struct priority_queue *pq)
+{
+	int i;
+
+	if(!pq)
+		return;
+
+	for(i = 0; i < pq->size; i++) {
+		free(pq->heap[i]);
+	}
+
+	itable_delete(pq->nodes);
+	free(pq->heap);
+	free(pq->iter);
+	free(pq);
+}
+
+int priority_queue_size(struct priority_queue *pq)
+{
+	return pq->size;
+}
+
+int priority_queue_push(struct priority_queue *pq, void *data, double priority)
+{
+	if(!data)
+		return 0;
+
+	if(itable_lookup(pq->nodes, (uintptr_t) data))
+		return 0;
+
+	if(pq->size == pq->capacity) {
+		struct node **heap = realloc(pq->heap, 2 * pq->capacity * sizeof(struct node *));
+		if(!heap)
+			return 0;
+		pq->heap = heap;
+		pq->capacity *= 2;
+	}
+
+	struct node *n = malloc(sizeof(*n));
+	if(!n)
+		return 0;
+
+	n->data = data;
+	n->priority = priority;
+	n->sequence = pq->next_sequence++;
+	n->index = pq->size;
+
+	pq->heap[pq->size] = n;
+	pq->size++;
+
+	itable_insert(pq->nodes, (uintptr_t) data, n);
+	sift_up(pq, n->index);
+
+	pq->version++;
+
+	return 1;
+}
+
+/* Remove the node at position i, and restore the heap property. */
+static void *remove_at(struct priority_queue *pq, int i)
+{
+	struct node *n = pq->heap[i];
+	void *data = n->data;
+
+	pq->size--;
+	if(i != pq->size) {
+		swap_nodes(pq, i, pq->size);
+		if(sift_up(pq, i) == i) {
+			sift_down(pq, i);
+		}
+	}
+
+	itable_remove(pq->nodes, (uintptr_t) data);
+	free(n);
+
+	pq->version++;
+
+	return data;
+}
+
+void *priority_queue_pop(struct priority_queue *pq)
+{
+	if(pq->size < 1)
+		return 0;
+
+	return remove_at(pq, 0);
+}
+
+void *priority_queue_peek_top(struct priority_queue *pq)
+{
+	if(pq->size < 1)
+		return 0;
+
+	return pq->heap[0]->data;
+}
+
+int priority_queue_top_priority(struct priority_queue *pq, double *priority)
+{
+	if(pq->size < 1)
+		return 0;
+
+	*priority = pq->heap[0]->priority;
+
+	return 1;
+}
+
+void *priority_queue_peek_at(struct priority_queue *pq, int index)
+{
+	if(index < 0 || index >= pq->size)
+		return 0;
+
+	return pq->heap[index]->data;
+}
+
+int priority_queue_remove(struct priority_queue *pq, const void *data)
+{
+	struct node *n = itable_lookup(pq->nodes, (uintptr_t) data);
+
+	if(!n)
+		return 0;
+
+	remove_at(pq, n->index);
+
+	return 1;
+}
+
+/* The iteration heap holds positions of the main heap, ordered as their nodes. */
+static int iter_before(struct priority_queue *pq, int a, int b)
+{
+	return node_before(pq->heap[pq->iter[a]], pq->heap[pq->iter[b]]);
+}
+
+static void iter_push(struct priority_queue *pq, int index)
+{
+	if(pq->iter_size == pq->iter_capacity) {
+		int capacity = pq->iter_capacity > 0 ? 2 * pq->iter_capacity : DEFAULT_CAPACITY;
+		int *iter = realloc(pq->iter, capacity * sizeof(int));
+		if(!iter)
+			return;
+		pq->iter = iter;
+		pq->iter_capacity = capacity;
+	}
+
+	int i = pq->iter_size++;
+	pq->iter[i] = index;
+
+	while(i > 0) {
+		int parent = (i - 1) / 2;
+		if(!iter_before(pq, i, parent)) {
+			break;
+		}
+		int tmp = pq->iter[i];
+		pq->iter[i] = pq->iter[parent];
+		pq->iter[parent] = tmp;
+		i = parent;
+	}
+}
+
+static int iter_pop(struct priority_queue *pq)
+{
+	int top = pq->iter[0];
+	int i = 0;
+
+	pq->iter_size--;
+	pq->iter[0] = pq->iter[pq->iter_size];
+
+	while(1) {
+		int left  = 2 * i + 1;
+		int right = 2 * i + 2;
+		int best  = i;
+
+		if(left < pq->iter_size && iter_before(pq, left, best)) {
+			best = left;
+		}
+
+		if(right < pq->iter_size && iter_before(pq, right, best)) {
+			best = right;
+		}
+
+		if(best == i) {
+			break;
+		}
+
+		int tmp = pq->iter[i];
+		pq->iter[i] = pq->iter[best];
+		pq->iter[best] = tmp;
+		i = best;
+	}
+
+	return top;
+}
+
+void priority_queue_first_item(struct priority_queue *pq)
+{
+	pq->iter_size = 0;
+	pq->iter_version = pq->version;
+
+	if(pq->size > 0) {
+		iter_push(pq, 0);
+	}
+}
+
+void *priority_queue_next_item(struct priority_queue *pq)
+{
+	if(pq->iter_version != pq->version || pq->iter_size < 1)
+		return 0;
+
+	/* the next object is the best among the children of those already visited. */
+	int i = iter_pop(pq);
+
+	if(2 * i + 1 < pq->size) {
+		iter_push(pq, 2 * i + 1);
+	}
+
+	if(2 * i + 2 < pq->size) {
+		iter_push(pq, 2 * i + 2);
+	}
+
+	return pq->heap[i]->data;
+}
+
+/* vim: set noexpandtab tabstop=4: */
@@ -0,0 +1,121 @@
+/*
+Copyright (C) 2019- The University of Notre Dame
+This software is distributed under the GNU General Public License.
+See the file COPYING for details.
+*/
+
+#ifndef PRIORITY_QUEUE_H
+#define PRIORITY_QUEUE_H
+
+/** @file priority_queue.h A binary heap of arbitrary objects.
+A priority queue keeps arbitrary objects (void pointers) ordered by a
+numeric priority, with the highest priority at the top.  Objects with
+the same priority are kept in the order in which they were pushed.
+Pushing, popping, and removing any object take O(log n) time.
+An object may be in the queue at most once.
+
+For example, to process jobs from the highest to the lowest priority:
+<pre>
+struct priority_queue *pq = priority_queue_create(0);
+
+priority_queue_push(pq, job_a, 10);
+priority_queue_push(pq, job_b, 20);
+
+while((job = priority_queue_pop(pq))) {
+	run(job);
+}
+
+priority_queue_delete(pq);
+</pre>
+
+To visit the objects in priority order without removing them,
+use @ref priority_queue_first_item and @ref priority_queue_next_item.
+To visit them in no particular order, use @ref priority_queue_peek_at
+with indices from zero to @ref priority_queue_size minus one.
+*/
+
+/** Create a new priority queue.
+@param capacity The number of objects for which to reserve space. If zero, a default value will be used.
+@return A pointer to a new priority queue.
+*/
+
+struct priority_queue *priority_queue_create(int capacity);
+
+/** Delete a priority queue.
+Note that this function will not delete the objects contained within the queue.
+@param pq The priority queue to delete.
+*/
+
+void priority_queue_delete(struct priority_queue *pq);
+
+/** Count the objects in a priority queue.
+@param pq A pointer to a priority queue.
+@return The number of objects in the queue.
+*/
+
+int priority_queue_size(struct priority_queue *pq);
+
+/** Push an object into a priority queue.
+@param pq A pointer to a priority queue.
+@param data The object to push. It may not be null.
+@param priority The priority of the object. Higher priorities are popped first.
+@return One on success, zero if the object is already in the queue.
+*/
+
+int priority_queue_push(struct priority_queue *pq, void *data, double priority);
+
+/** Remove the object with the highest priority.
+@param pq A pointer to a priority queue.
+@return The object with the highest priority, or null if the queue is empty.
+*/
+
+void *priority_queue_pop(struct priority_queue *pq);
+
+/** Look at the object with the highest priority without removing it.
+@param pq A pointer to a priority queue.
+@return The object with the highest priority, or null if the queue is empty.
+*/
+
+void *priority_queue_peek_top(struct priority_queue *pq);
+
+/** Get the priority of the object with the highest priority.
+@param pq A pointer to a priority queue.
+@param priority A pointer where the priority is stored.
+@return One if the queue is not empty, zero otherwise.
+*/
+
+int priority_queue_top_priority(struct priority_queue *pq, double *priority);
+
+/** Look at the object at a position of the underlying heap.
+Positions are in no particular order, and change when the queue is modified.
+@param pq A pointer to a priority queue.
+@param index A position between zero and @ref priority_queue_size minus one.
+@return The object at that position, or null if the index is out of range.
+*/
+
+void *priority_queue_peek_at(struct priority_queue *pq, int index);
+
+/** Remove an object from any position in the queue.
+@param pq A pointer to a priority queue.
+@param data The object to remove.
+@return One if the object was in the queue and was removed, zero otherwise.
+*/
+
+int priority_queue_remove(struct priority_queue *pq, const void *data);
+
+/** Begin iteration in priority order.
+Iteration does not modify the queue, and visiting the first k objects costs O(k log k).
+If the queue is modified, the iteration ends.
+@param pq A pointer to a priority queue.
+*/
+
+void priority_queue_first_item(struct priority_queue *pq);
+
+/** Continue iteration in priority order.
+@param pq A pointer to a priority queue.
+@return The next object, or null if there are no more objects to visit.
+*/
+
+void *priority_queue_next_item(struct priority_queue *pq);
+
+#endif
@@ -0,0 +1,110 @@
+#!/bin/sh
+
+# Many clients querying the catalog server at once, against records
+# large enough for their keys to be indexed, must all see every record.
+# Filters of any length must give the same answer.
+
+. ../../dttools/test/test_runner_common.sh
+
+test_dir=`basename $0 .sh`.dir
+port_file=$test_dir/port
+pid_file=$test_dir/pid
+
+RECORDS=8
+CLIENTS=8
+QUERIES=25
+
+prepare()
+{
+	rm -rf $test_dir
+	mkdir $test_dir
+	return 0
+}
+
+run()
+{
+	../src/catalog_server -Z $port_file -H $test_dir/history -d all -o $test_dir/catalog.log &
+	echo $! > $pid_file
+
+	wait_for_file_creation $port_file 5
+	port=`cat $port_file`
+
+	for r in `seq 1 $RECORDS`
+	do
+		{
+			echo "{ \"type\":\"catalog_test\", \"uuid\":\"record$r\""
+			for f in `seq 0 39`
+			do
+				echo ", \"field$f\":$f"
+			done
+			echo "}"
+		} > $test_dir/record$r.json
+		../src/catalog_update -c localhost:$port -f $test_dir/record$r.json || return 1
+	done
+
+	# The server answers from a snapshot that may be a second old.
+	count=0
+	for i in `seq 1 10`
+	do
+		count=`../src/catalog_query -c localhost:$port --where 'type=="catalog_test"' | grep -c '"uuid"'`
+		[ "$count" -eq $RECORDS ] && break
+		sleep 1
+	done
+
+	if [ "$count" -ne $RECORDS ]
+	then
+		echo "only $count of $RECORDS records reached the catalog"
+		return 1
+	fi
+
+	# A long filter is applied by the server, and one too long for a
+	# request line is applied by the client, with the same results.
+	for length in 1000 4000
+	do
+		pad=`head -c $length /dev/zero | tr '\\0' x`
+		../src/catalog_query -c localhost:$port -d all --where "type==\"catalog_test\" && (field1==1 || name==\"$pad\")" > $test_dir/long.out 2> $test_dir/long.err
+		n=`grep -c '"uuid"' $test_dir/long.out`
+		if [ "$n" -ne $RECORDS ]
+		then
+			echo "query with a filter of $length bytes saw $n records"
+			return 1
+		fi
+		if grep -q "filtering locally" $test_dir/long.err
+		then
+			echo "query with a filter of $length bytes was not answered by the server"
+			return 1
+		fi
+		grep -q "too long" $test_dir/long.err && echo "filter of $length bytes applied by the client"
+	done
+
+	clients=""
+	for c in `seq 1 $CLIENTS`
+	do
+		(
+			for q in `seq 1 $QUERIES`
+			do
+				n=`../src/catalog_query -c localhost:$port --where 'type=="catalog_test" && field0==0 && field39==39' | grep -c '"field20":20'`
+				[ "$n" -eq $RECORDS ] || echo "client $c query $q saw $n records"
+			done
+		) > $test_dir/client$c.out &
+		clients="$clients $!"
+	done
+	wait $clients
+
+	cat $test_dir/client*.out
+	[ -z "`cat $test_dir/client*.out`" ]
+}
+
+clean()
+{
+	if [ -f $pid_file ]
+	then
+		kill `cat $pid_file`
+	fi
+	rm -rf $test_dir
+	return 0
+}
+
+dispatch "$@"
+
+# vim: set noexpandtab tabstop=4:
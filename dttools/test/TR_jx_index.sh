@@ -0,0 +1,150 @@
+#!/bin/sh
+
+. ../../dttools/test/test_runner_common.sh
+
+exe="jx_index.test"
+
+prepare()
+{
+	${CC} -I../src/ -g $CCTOOLS_TEST_CCFLAGS -o "$exe" -x c - -x none ../src/libdttools.a -lm <<EOF
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "jx.h"
+#include "jx_parse.h"
+#include "timestamp.h"
+
+#define N 1000
+#define LOOKUPS 100000
+
+static struct jx * make_object( int n )
+{
+	char key[32];
+	int i;
+
+	struct jx *j = jx_object(0);
+	for(i=0;i<n;i++) {
+		sprintf(key,"key%d",i);
+		jx_insert_integer(j,key,i);
+	}
+	return j;
+}
+
+static unsigned long time_lookups( struct jx *j, int n )
+{
+	char key[32];
+	int i;
+
+	timestamp_t start = timestamp_get();
+	for(i=0;i<LOOKUPS;i++) {
+		sprintf(key,"key%d",i%n);
+		assert(jx_lookup_integer(j,key)==i%n);
+	}
+	return timestamp_get()-start;
+}
+
+int main( int argc, char *argv[] )
+{
+	char key[32];
+	int i;
+
+	struct jx *j = make_object(N);
+
+	// a large object is indexed as it is built, and lookups leave it alone.
+	assert(j->index);
+	struct jx *small = make_object(10);
+	assert(!small->index);
+	assert(!jx_lookup(small,"missing"));
+	assert(!small->index);
+	jx_delete(small);
+
+	// inserts and removes keep the index consistent.
+	for(i=0;i<N;i+=2) {
+		sprintf(key,"key%d",i);
+		struct jx *k = jx_string(key);
+		jx_delete(jx_remove(j,k));
+		assert(!jx_remove(j,k));
+		jx_delete(k);
+	}
+	for(i=0;i<N;i++) {
+		sprintf(key,"key%d",i);
+		int found;
+		struct jx *v = jx_lookup_guard(j,key,&found);
+		assert(found==(i%2));
+		assert(!found || v->u.integer_value==i);
+	}
+	jx_insert_integer(j,"key0",100);
+	assert(jx_lookup_integer(j,"key0")==100);
+
+	// iteration order is unchanged: newest pair first.
+	void *iter = 0;
+	assert(!strcmp(jx_iterate_keys(j,&iter),"key0"));
+	assert(!strcmp(jx_iterate_keys(j,&iter),"key999"));
+	assert(!strcmp(jx_iterate_keys(j,&iter),"key997"));
+
+	// with a duplicate key the newest value wins, and removing it uncovers the older one.
+	jx_insert_integer(j,"key0",200);
+	assert(j->index);
+	assert(jx_lookup_integer(j,"key0")==200);
+	struct jx *k0 = jx_string("key0");
+	jx_delete(jx_remove(j,k0));
+	assert(jx_lookup_integer(j,"key0")==100);
+	jx_delete(jx_remove(j,k0));
+	assert(!jx_lookup(j,"key0"));
+	jx_delete(k0);
+
+	// shifting pairs off keeps the index consistent.
+	struct jx_pair *p = jx_object_shift(j);
+	assert(!strcmp(p->key->u.string_value,"key999"));
+	assert(!jx_lookup(j,"key999"));
+	assert(jx_lookup_integer(j,"key997")==997);
+	jx_pair_delete(p);
+	jx_delete(j);
+
+	// objects parsed or copied in one piece are indexed too.
+	struct jx *parsed = jx_parse_string("{\"a\":1,\"b\":2,\"c\":3,\"d\":4,\"e\":5,\"f\":6,\"g\":7,\"h\":8,\"i\":9,\"j\":10,\"k\":11,\"l\":12,\"m\":13,\"n\":14,\"o\":15,\"p\":16,\"a\":17}");
+	assert(parsed->index);
+	assert(jx_lookup_integer(parsed,"a")==1);
+	assert(jx_lookup_integer(parsed,"p")==16);
+	jx_delete(parsed);
+
+	// copies and merges of large objects behave the same.
+	struct jx *a = make_object(N);
+	struct jx *b = jx_copy(a);
+	assert(jx_lookup_integer(a,"key500")==500);
+	assert(jx_equals(a,b));
+	struct jx *m = jx_merge(a,b,0);
+	assert(jx_lookup_integer(m,"key999")==999);
+	jx_delete(a);
+	jx_delete(b);
+	jx_delete(m);
+
+	// lookups on a large object cost about the same as on a small one.
+	small = make_object(10);
+	struct jx *large = make_object(N);
+	unsigned long tsmall = time_lookups(small,10);
+	unsigned long tlarge = time_lookups(large,N);
+	printf("%d lookups: %d keys %lu us, %d keys %lu us\n",LOOKUPS,10,tsmall,N,tlarge);
+	jx_delete(small);
+	jx_delete(large);
+
+	return 0;
+}
+EOF
+	return $?
+}
+
+run()
+{
+	./"$exe"
+	return $?
+}
+
+clean()
+{
+	rm -f "$exe"
+	return 0
+}
+
+dispatch "$@"
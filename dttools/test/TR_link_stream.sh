@@ -0,0 +1,186 @@
+#!/bin/sh
+
+. ../../dttools/test/test_runner_common.sh
+
+exe="link_stream.test"
+
+prepare()
+{
+	${CC} -I../src/ -g $CCTOOLS_TEST_CCFLAGS -o "$exe" -x c - -x none ../src/libdttools.a -lm <<EOF
+#include "debug.h"
+#include "full_io.h"
+#include "link.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LENGTH (4*1024*1024)
+#define CHUNK (64*1024)
+
+static char source[LENGTH];
+static char copy[LENGTH];
+
+/* Feed the source through a pipe a chunk at a time, so that the reader sees partial transfers. */
+static int slow_pipe(void)
+{
+	int fds[2];
+
+	if(pipe(fds) != 0)
+		fatal("couldn't create pipe: %s", strerror(errno));
+
+	pid_t pid = fork();
+	if(pid < 0) {
+		fatal("couldn't fork: %s", strerror(errno));
+	} else if(pid == 0) {
+		int i;
+		close(fds[0]);
+		for(i = 0; i < LENGTH; i += CHUNK) {
+			if(full_write(fds[1], source + i, CHUNK) != CHUNK)
+				_exit(1);
+			usleep(2000);
+		}
+		_exit(0);
+	}
+
+	close(fds[1]);
+	return fds[0];
+}
+
+/*
+Send the source to port with link_stream_from_fd, from a file (sendfile)
+or from a slow pipe (sendfile refuses it), after a header line that the
+receiver buffers along with the first part of the data.
+*/
+
+static void sender(int port, int from_pipe)
+{
+	time_t stoptime = time(0) + 60;
+
+	struct link *l = link_connect("127.0.0.1", port, stoptime);
+	if(!l)
+		fatal("couldn't connect: %s", strerror(errno));
+
+	int fd = from_pipe ? slow_pipe() : open("link_stream.source", O_RDONLY);
+	if(fd < 0)
+		fatal("couldn't open source: %s", strerror(errno));
+
+	link_putfstring(l, "%d\n", stoptime, LENGTH);
+
+	int64_t sent = link_stream_from_fd(l, fd, LENGTH, stoptime);
+	if(sent != LENGTH)
+		fatal("sent %lld of %d bytes: %s", (long long) sent, LENGTH, strerror(errno));
+
+	close(fd);
+	link_close(l);
+	while(wait(0) > 0) {}
+	_exit(0);
+}
+
+/*
+Receive into a file with link_stream_to_fd, which splices, or falls
+back to a copy when the file is in append mode and refuses splice.
+*/
+
+static void check(struct link *master, int port, int from_pipe, int append, int slow_reader)
+{
+	time_t stoptime = time(0) + 60;
+	char line[1024];
+	int status;
+
+	pid_t pid = fork();
+	if(pid < 0)
+		fatal("couldn't fork: %s", strerror(errno));
+	else if(pid == 0)
+		sender(port, from_pipe);
+
+	struct link *l = link_accept(master, stoptime);
+	if(!l)
+		fatal("couldn't accept: %s", strerror(errno));
+
+	/* Let the sender fill the socket and wait for room. */
+	if(slow_reader)
+		sleep(1);
+
+	if(!link_readline(l, line, sizeof(line), stoptime) || atoi(line) != LENGTH)
+		fatal("bad header: %s", line);
+
+	unlink("link_stream.copy");
+	int fd = open("link_stream.copy", O_WRONLY | O_CREAT | O_TRUNC | (append ? O_APPEND : 0), 0644);
+	if(fd < 0)
+		fatal("couldn't open copy: %s", strerror(errno));
+
+	int64_t received = link_stream_to_fd(l, fd, LENGTH, stoptime);
+	if(received != LENGTH)
+		fatal("received %lld of %d bytes: %s", (long long) received, LENGTH, strerror(errno));
+	close(fd);
+	link_close(l);
+
+	if(waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		fatal("sender failed");
+
+	fd = open("link_stream.copy", O_RDONLY);
+	if(fd < 0 || full_read(fd, copy, LENGTH) != LENGTH)
+		fatal("couldn't read copy: %s", strerror(errno));
+	close(fd);
+
+	if(memcmp(source, copy, LENGTH))
+		fatal("copy differs from source (pipe %d, append %d, slow reader %d)", from_pipe, append, slow_reader);
+
+	printf("copied %d bytes (pipe %d, append %d, slow reader %d)\n", LENGTH, from_pipe, append, slow_reader);
+}
+
+int main(int argc, char *argv[])
+{
+	char addr[LINK_ADDRESS_MAX];
+	int port, i, fd;
+
+	/* Small socket buffers, so that transfers are partial and the non-blocking links hit EAGAIN. */
+	setenv("TCP_WINDOW_SIZE", "16384", 1);
+
+	srand(1);
+	for(i = 0; i < LENGTH; i++)
+		source[i] = rand();
+
+	fd = open("link_stream.source", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(fd < 0 || full_write(fd, source, LENGTH) != LENGTH)
+		fatal("couldn't write source: %s", strerror(errno));
+	close(fd);
+
+	struct link *master = link_serve(0);
+	if(!master || !link_address_local(master, addr, &port))
+		fatal("couldn't serve: %s", strerror(errno));
+
+	check(master, port, 0, 0, 0);
+	check(master, port, 0, 0, 1);
+	check(master, port, 0, 1, 0);
+	check(master, port, 1, 0, 0);
+	check(master, port, 1, 1, 0);
+
+	link_close(master);
+	return 0;
+}
+EOF
+	return $?
+}
+
+run()
+{
+	./"$exe"
+	return $?
+}
+
+clean()
+{
+	rm -f "$exe" link_stream.source link_stream.copy
+	return 0
+}
+
+dispatch "$@"
+
+# vim: set noexpandtab tabstop=4:
@@ -0,0 +1,108 @@
+#!/bin/sh
+
+. ../../dttools/test/test_runner_common.sh
+
+exe="priority_queue.test"
+
+prepare()
+{
+	${CC} -I../src/ -g $CCTOOLS_TEST_CCFLAGS -o "$exe" -x c - -x none ../src/libdttools.a -lm <<EOF
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "priority_queue.h"
+
+#define N 1000
+
+int main (int argc, char *argv[])
+{
+	struct priority_queue *pq = priority_queue_create(0);
+	assert(pq);
+	assert(priority_queue_size(pq) == 0);
+	assert(!priority_queue_pop(pq));
+	assert(!priority_queue_peek_top(pq));
+
+	// objects are 1..N, with priority i % 10, so that there are many ties.
+	intptr_t i;
+	for(i = 1; i <= N; i++) {
+		assert(priority_queue_push(pq, (void *) i, i % 10));
+	}
+	assert(priority_queue_size(pq) == N);
+
+	// an object can only be pushed once.
+	assert(!priority_queue_push(pq, (void *) 1, 100));
+	assert(priority_queue_size(pq) == N);
+
+	double p;
+	assert(priority_queue_top_priority(pq, &p));
+	assert(p == 9);
+	assert((intptr_t) priority_queue_peek_top(pq) == 9);
+
+	// iteration follows priority order, and ties follow push order.
+	intptr_t item, last = 0;
+	int count = 0;
+	priority_queue_first_item(pq);
+	while((item = (intptr_t) priority_queue_next_item(pq))) {
+		if(last) {
+			assert(last % 10 > item % 10 || (last % 10 == item % 10 && last < item));
+		}
+		last = item;
+		count++;
+	}
+	assert(count == N);
+	assert(priority_queue_size(pq) == N);
+
+	// modifying the queue ends the iteration.
+	priority_queue_first_item(pq);
+	assert(priority_queue_next_item(pq));
+	assert(priority_queue_remove(pq, (void *) 19));
+	assert(!priority_queue_next_item(pq));
+
+	// remove all the multiples of 3 from anywhere in the queue.
+	for(i = 3; i <= N; i += 3) {
+		if(i == 19) continue;
+		assert(priority_queue_remove(pq, (void *) i));
+	}
+	assert(!priority_queue_remove(pq, (void *) 3));
+
+	// pop everything else, in order.
+	last = 0;
+	count = 0;
+	while((item = (intptr_t) priority_queue_pop(pq))) {
+		assert(item % 3 != 0 && item != 19);
+		if(last) {
+			assert(last % 10 > item % 10 || (last % 10 == item % 10 && last < item));
+		}
+		last = item;
+		count++;
+	}
+	assert(count == N - N/3 - 1);
+	assert(priority_queue_size(pq) == 0);
+
+	// objects may be pushed again once removed.
+	assert(priority_queue_push(pq, (void *) 1, 1));
+	assert(priority_queue_peek_at(pq, 0) == (void *) 1);
+	assert(!priority_queue_peek_at(pq, 1));
+
+	priority_queue_delete(pq);
+
+	return 0;
+}
+EOF
+	return $?
+}
+
+run()
+{
+	./"$exe"
+	return $?
+}
+
+clean()
+{
+	rm -f "$exe"
+	return 0
+}
+
+dispatch "$@"
@@ -189,6 +189,66 @@ void dag_count_states(struct dag *d)
 	}
 }
 
+void dag_ready_nodes_update(struct dag *d, struct dag_node *n)
+{
+	if(!d->ready_nodes || n->in_ready_list)
+		return;
+
+	if(n->state == DAG_NODE_STATE_WAITING && n->source_files_missing == 0) {
+		list_push_tail(d->ready_nodes, n);
+		n->in_ready_list = 1;
+	}
+}
+
+void dag_ready_nodes_init(struct dag *d)
+{
+	struct dag_node *n;
+	struct dag_file *f;
+
+	dag_ready_nodes_delete(d);
+	d->ready_nodes = list_create();
+
+	for(n = d->nodes; n; n = n->next) {
+		n->in_ready_list = 0;
+		n->source_files_missing = 0;
+
+		list_first_item(n->source_files);
+		while((f = list_next_item(n->source_files))) {
+			if(!dag_file_should_exist(f))
+				n->source_files_missing++;
+		}
+
+		dag_ready_nodes_update(d, n);
+	}
+}
+
+void dag_ready_nodes_delete(struct dag *d)
+{
+	if(d->ready_nodes) {
+		list_delete(d->ready_nodes);
+		d->ready_nodes = NULL;
+	}
+}
+
+/* existed is the value of dag_file_should_exist(f) before its state changed. */
+void dag_ready_nodes_file_update(struct dag *d, struct dag_file *f, int existed)
+{
+	struct dag_node *n;
+
+	if(!d->ready_nodes)
+		return;
+
+	int exists = dag_file_should_exist(f);
+	if(exists == existed)
+		return;
+
+	list_first_item(f->needed_by);
+	while((n = list_next_item(f->needed_by))) {
+		n->source_files_missing += exists ? -1 : 1;
+		dag_ready_nodes_update(d, n);
+	}
+}
+
 /**
  * If the return value is x, a positive integer, that means at least x tasks
  * can be run in parallel during a certain point of the execution of the
@@ -42,6 +42,7 @@ struct dag {
 
 	struct itable *local_job_table;     /* Mapping from unique integers dag_node->jobid to nodes, rules with prefix LOCAL. */
 	struct itable *remote_job_table;    /* Mapping from unique integers dag_node->jobid to nodes. */
+	struct list *ready_nodes;           /* Waiting nodes with all their source files present, see dag_ready_nodes_init. */
 	int completed_files;                /* Keeps a count of the rules in state recieved or beyond. */
 	int deleted_files;                  /* Keeps a count of the files delete in GC. */
 
@@ -61,6 +62,16 @@ void dag_count_states(struct dag *d);
 struct dag_file *dag_file_lookup_or_create(struct dag *d, const char *filename);
 struct dag_file *dag_file_from_name(struct dag *d, const char *filename);
 
+/* The ready list holds the nodes that are waiting, and whose source files
+ * should all exist. Once initialized, it is kept up to date by calling
+ * dag_ready_nodes_update when the state of a node changes, and
+ * dag_ready_nodes_file_update when the state of a file changes.
+ * dag_ready_nodes_delete frees it. */
+void dag_ready_nodes_init(struct dag *d);
+void dag_ready_nodes_update(struct dag *d, struct dag_node *n);
+void dag_ready_nodes_file_update(struct dag *d, struct dag_file *f, int existed);
+void dag_ready_nodes_delete(struct dag *d);
+
 int dag_width( struct dag *d );
 int dag_depth( struct dag *d );
 int dag_width_guaranteed_max( struct dag *d );
@@ -25,6 +25,13 @@ See the file COPYING for details.
 
 extern char **environ; 
 
+/*
+Most rules have a handful of variables, files, and neighbors, and a large
+workflow has hundreds of thousands of rules, so the per-node tables start
+small and grow as needed rather than at the default size.
+*/
+#define DAG_NODE_TABLE_SIZE 7
+
 struct dag_node *dag_node_create(struct dag *d, int linenum)
 {
 	struct dag_node *n = calloc(1, sizeof(*n));
@@ -33,17 +40,17 @@ struct dag_node *dag_node_create(struct dag *d, int linenum)
 	n->linenum = linenum;
 	n->state = DAG_NODE_STATE_WAITING;
 	n->nodeid = d->nodeid_counter++;
-	n->variables = hash_table_create(0, 0);
+	n->variables = hash_table_create(DAG_NODE_TABLE_SIZE, 0);
 
 	n->type = DAG_NODE_TYPE_COMMAND;
 	n->source_files = list_create();
 	n->target_files = list_create();
 
-	n->remote_names = itable_create(0);
-	n->remote_names_inv = hash_table_create(0, 0);
+	n->remote_names = itable_create(DAG_NODE_TABLE_SIZE);
+	n->remote_names_inv = hash_table_create(DAG_NODE_TABLE_SIZE, 0);
 
-	n->descendants = set_create(0);
-	n->ancestors = set_create(0);
+	n->descendants = set_create(DAG_NODE_TABLE_SIZE);
+	n->ancestors = set_create(DAG_NODE_TABLE_SIZE);
 
 	n->ancestor_depth = -1;
 
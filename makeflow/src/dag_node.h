@@ -87,6 +87,8 @@ struct dag_node {
 	batch_job_id_t jobid;               /* The id this node get, either from the local or remote batch system. */
 	dag_node_state_t state;             /* Enum: DAG_NODE_STATE_{WAITING,RUNNING,...} */
 	int failure_count;                  /* How many times has this rule failed? (see -R and -r) */
+	int source_files_missing;           /* Number of source files that should not exist yet. */
+	int in_ready_list;                  /* Flag: is this node in dag->ready_nodes? */
 	time_t previous_completion;
 
 	const char *umbrella_spec;          /* the umbrella spec file for executing this job */
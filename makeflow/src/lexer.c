@@ -9,6 +9,9 @@
 #include <stdarg.h>
 #include <ctype.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "int_sizes.h"
 #include "stringtools.h"
@@ -30,6 +33,7 @@
 
 #define WHITE_SPACE          " \t"
 #define BUFFER_CHUNK_SIZE 1048576	// One megabyte
+#define MAPPING_RELEASE_SIZE (16*BUFFER_CHUNK_SIZE)
 
 #define MAX_SUBSTITUTION_DEPTH 32
 
@@ -37,15 +41,18 @@
 extern int verbose_parsing;
 #endif
 
+/* The lexeme is allocated together with its token, unless it is later
+   replaced with lexer_set_lexeme. Either way, lexer_free_token frees
+   both. */
 struct token *lexer_pack_token(struct lexer *lx, enum token_t type)
 {
-	struct token *t = malloc(sizeof(struct token));
+	struct token *t = malloc(sizeof(struct token) + lx->lexeme_size + 1);
 
 	t->type = type;
 	t->line_number   = lx->line_number;
 	t->column_number = lx->column_number;
 
-	t->lexeme = calloc(lx->lexeme_size + 1, sizeof(char));
+	t->lexeme = (char *) (t + 1);
 	memcpy(t->lexeme, lx->lexeme, lx->lexeme_size);
 	*(t->lexeme + lx->lexeme_size) = '\0';
 
@@ -54,6 +61,14 @@ struct token *lexer_pack_token(struct lexer *lx, enum token_t type)
 	return t;
 }
 
+void lexer_set_lexeme(struct token *t, char *lexeme)
+{
+	if(t->lexeme != (char *) (t + 1))
+		free(t->lexeme);
+
+	t->lexeme = lexeme;
+}
+
 char *lexer_print_token(struct token *t)
 {
 	char str[1024];
@@ -127,7 +142,10 @@ void lexer_roll_back_one(struct lexer *lx)
 	if(c == '\n') {
 
 		lx->line_number--;
-		lx->column_number = (uintptr_t) list_pop_head(lx->column_numbers);
+		if(lx->column_numbers_count > 0) {
+			lx->column_numbers_count--;
+			lx->column_number = lx->column_numbers[lx->column_numbers_count % LEXER_COLUMN_HISTORY];
+		}
 	} else if(c == CHAR_EOF) {
 		lx->eof = 0;
 		lx->column_number--;
@@ -135,6 +153,11 @@ void lexer_roll_back_one(struct lexer *lx)
 		lx->column_number--;
 	}
 
+	if(!lx->chunk_last_loaded) {
+		lx->lexeme_end--;
+		return;
+	}
+
 	if(lx->lexeme_end == lx->buffer)
 		lx->lexeme_end = (lx->buffer + 2 * BUFFER_CHUNK_SIZE);
 
@@ -269,20 +292,85 @@ void lexer_load_chunk(struct lexer *lx)
 
 }
 
+/* Strings, and streams that can be mapped, are kept whole in lx->buffer
+   between a leading '\0' and a trailing CHAR_EOF, so lexer_next_char
+   never has to switch chunks. The second CHAR_EOF is for when
+   lexer_read_file and lexer_read_command_argument step past the first. */
 void lexer_load_string(struct lexer *lx, char *s)
 {
-	int len = strlen(s);
+	size_t len = strlen(s);
 
-	lx->chunk_last_loaded = 1;
+	lx->buffer = malloc(len + 3);
+	if(!lx->buffer)
+		fatal("Could not allocate memory for input buffer.\n");
 
-	strcpy(lx->buffer, s);
-	*(lx->buffer + len) = CHAR_EOF;
+	*lx->buffer = '\0';
+	memcpy(lx->buffer + 1, s, len);
+	*(lx->buffer + len + 1) = CHAR_EOF;
+	*(lx->buffer + len + 2) = CHAR_EOF;
 
-	*(lx->buffer + 2 * BUFFER_CHUNK_SIZE - 1) = '\0';
+	lx->lexeme_end = lx->buffer;
+	lx->chunk_last_loaded = 0;
+}
 
-	if(lx->lexeme_end >= lx->buffer + 2 * BUFFER_CHUNK_SIZE)
-		fatal("End of token is out of bounds.\n");
+/* Map a regular file in place of reading it by chunks. The mapping is
+   private and writable only so that the end-of-file markers can be
+   placed after the data. Returns zero if the stream cannot be mapped. */
+int lexer_map_stream(struct lexer *lx, FILE *stream)
+{
+	struct stat info;
+	int fd = fileno(stream);
+
+	if(fd < 0 || fstat(fd, &info) < 0 || !S_ISREG(info.st_mode))
+		return 0;
+
+	/* The stream must not have been read yet, as the mapping starts at offset zero. */
+	if(ftello(stream) != 0)
+		return 0;
+
+	size_t page = sysconf(_SC_PAGESIZE);
+	size_t size = info.st_size;
+	size_t length = ((page + size + 2 + page - 1) / page) * page;
+
+	/* The first page holds the leading '\0', and the file data is mapped right after it. */
+	char *base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(base == MAP_FAILED)
+		return 0;
+
+	char *data = base + page;
+	if(size > 0 && mmap(data, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+		munmap(base, length);
+		return 0;
+	}
+
+	posix_madvise(data, size, POSIX_MADV_SEQUENTIAL);
 
+	*(data - 1) = '\0';
+	*(data + size) = CHAR_EOF;
+	*(data + size + 1) = CHAR_EOF;
+
+	lx->mapping = base;
+	lx->mapping_size = length;
+	lx->mapping_released = data;
+
+	lx->buffer = data - 1;
+	lx->lexeme_end = lx->buffer;
+	lx->chunk_last_loaded = 0;
+
+	debug(D_MAKEFLOW_LEXER, "mapped %zu bytes of input", size);
+
+	return 1;
+}
+
+/* Pages of the mapping that are well behind the current position are
+   given back, so that reading a very large file does not keep all of it
+   resident. Should they be read again, they are reloaded from the file. */
+void lexer_release_mapping(struct lexer *lx)
+{
+#ifdef MADV_DONTNEED
+	madvise(lx->mapping_released, MAPPING_RELEASE_SIZE, MADV_DONTNEED);
+#endif
+	lx->mapping_released += MAPPING_RELEASE_SIZE;
 }
 
 
@@ -292,8 +380,15 @@ char lexer_next_char(struct lexer *lx)
 		return CHAR_EOF;
 	}
 
+	if(!lx->chunk_last_loaded) {
+		/* All the input is in buffer, there are no chunks to wrap around. */
+		lx->lexeme_end++;
+
+		if(lx->mapping && lx->lexeme_end > lx->mapping_released + MAPPING_RELEASE_SIZE + BUFFER_CHUNK_SIZE)
+			lexer_release_mapping(lx);
+	}
 	/* If at the end of chunk, load the next chunk. */
-	if(((lx->lexeme_end + 1) == (lx->buffer + BUFFER_CHUNK_SIZE - 1)) || ((lx->lexeme_end + 1) == (lx->buffer + 2 * BUFFER_CHUNK_SIZE - 1))) {
+	else if(((lx->lexeme_end + 1) == (lx->buffer + BUFFER_CHUNK_SIZE - 1)) || ((lx->lexeme_end + 1) == (lx->buffer + 2 * BUFFER_CHUNK_SIZE - 1))) {
 		if(lx->lexeme_max == BUFFER_CHUNK_SIZE - 1)
 			lexer_report_error(lx, "Input buffer is full. Runaway token?");	//BUG: This is really a recoverable error, increase the buffer size.
 		/* Wrap around the file chunks */
@@ -311,7 +406,8 @@ char lexer_next_char(struct lexer *lx)
 
 	if(c == '\n') {
 		lx->line_number++;
-		list_push_head(lx->column_numbers, (uint64_t *) lx->column_number);
+		lx->column_numbers[lx->column_numbers_count % LEXER_COLUMN_HISTORY] = lx->column_number;
+		lx->column_numbers_count++;
 		lx->column_number = 1;
 	} else {
 		lx->column_number++;
@@ -390,7 +486,13 @@ void lexer_discard_comments(struct lexer *lx)
    ignored as stops, with \n replaced with spaces. */
 int lexer_read_escaped_until(struct lexer *lx, char *char_set)
 {
-	char *char_set_slash = string_format("\\%s", char_set);
+	char char_set_slash[32];
+
+	if(strlen(char_set) + 2 > sizeof(char_set_slash))
+		fatal("Set of stop characters is too long.\n");
+
+	char_set_slash[0] = '\\';
+	strcpy(char_set_slash + 1, char_set);
 
 	int count = 0;
 
@@ -414,8 +516,6 @@ int lexer_read_escaped_until(struct lexer *lx, char *char_set)
 
 	} while(!lx->eof);
 
-	free(char_set_slash);
-
 	if(lx->eof && !strchr(char_set, CHAR_EOF))
 		lexer_report_error(lx, "Missing %s\n", char_set);
 
@@ -682,12 +782,12 @@ struct token *lexer_concat_expandable(struct lexer *lx, struct list *tokens)
 			substitution = dag_variable_lookup_string(t->lexeme, lx->environment);
 			if(!substitution)
 				fatal("Variable %s has not yet been defined at line % " PRId64 ".\n", t->lexeme, lx->line_number);
-			buffer_printf(&b, "%s", substitution);
+			buffer_putstring(&b, substitution);
 			free(substitution);
 			break;
 		case TOKEN_LITERAL:
 			if(strcmp(t->lexeme, "") != 0)           // Skip empty strings.
-				buffer_printf(&b, "%s", t->lexeme);
+				buffer_putstring(&b, t->lexeme);
 			break;
 		default:
 			lexer_report_error(lx, "Error in expansion, got: %s.\n", lexer_print_token(t));
@@ -699,10 +799,8 @@ struct token *lexer_concat_expandable(struct lexer *lx, struct list *tokens)
 
 	t = lexer_pack_token(lx, TOKEN_LITERAL);
 
-	/* free lexeme allocated, as the buffer did the accumulation */
-	free(t->lexeme);
-
-	t->lexeme = xxstrdup(buffer_tostring(&b));
+	/* replace the lexeme packed, as the buffer did the accumulation */
+	lexer_set_lexeme(t, xxstrdup(buffer_tostring(&b)));
 	buffer_free(&b);
 
 	return t;
@@ -861,8 +959,7 @@ void lexer_concatenate_consecutive_literals(struct list *tokens)
 
 		char *merge = string_format("%s%s", prev->lexeme, t->lexeme);
 		lexer_free_token(t);
-		free(prev->lexeme);
-		prev->lexeme = merge;
+		lexer_set_lexeme(prev, merge);
 
 		list_push_tail(tmp, prev);
 	}
@@ -1279,33 +1376,37 @@ struct lexer *lexer_create(int type, void *data, int line_number, int column_num
 
 	lx->line_number = line_number;
 	lx->column_number = column_number;
-	lx->column_numbers = list_create();
+	lx->column_numbers_count = 0;
 
 	lx->stream = NULL;
 	lx->buffer = NULL;
+	lx->mapping = NULL;
 	lx->eof = 0;
 
 	lx->depth = 0;
 
 	lx->keep_quotes = 1; // Keep " and ', unless expanding file specifications
 
-	lx->lexeme = calloc(BUFFER_CHUNK_SIZE, sizeof(char));
+	/* A lexeme is never longer than a substitution, and lexer_add_to_lexeme grows it otherwise. */
+	lx->lexeme_max = type == STREAM ? BUFFER_CHUNK_SIZE : strlen((char *) data) + 1;
+	lx->lexeme = calloc(lx->lexeme_max, sizeof(char));
 	lx->lexeme_size = 0;
-	lx->lexeme_max = BUFFER_CHUNK_SIZE;
 
 	lx->token_queue = list_create();
 
-	lx->buffer = calloc(2 * BUFFER_CHUNK_SIZE, sizeof(char));
-	if(!lx->buffer)
-		fatal("Could not allocate memory for input buffer.\n");
-
-	lx->lexeme_end = (lx->buffer + 2 * BUFFER_CHUNK_SIZE - 2);
-
 	if(type == STREAM) {
 		lx->stream = (FILE *) data;
 
-		lx->chunk_last_loaded = 2;	// Bootstrap load_chunk to load chunk 1.
-		lexer_load_chunk(lx);
+		if(!lexer_map_stream(lx, lx->stream)) {
+			lx->buffer = calloc(2 * BUFFER_CHUNK_SIZE, sizeof(char));
+			if(!lx->buffer)
+				fatal("Could not allocate memory for input buffer.\n");
+
+			lx->lexeme_end = (lx->buffer + 2 * BUFFER_CHUNK_SIZE - 2);
+
+			lx->chunk_last_loaded = 2;	// Bootstrap load_chunk to load chunk 1.
+			lexer_load_chunk(lx);
+		}
 	} else {
 		lexer_load_string(lx, (char *) data);
 	}
@@ -1341,21 +1442,21 @@ struct lexer *lexer_create_substitution(struct lexer *lx, struct token *t)
 
 void lexer_delete(struct lexer *lx)
 {
-
-	list_delete(lx->column_numbers);
-
 	free(lx->lexeme);
 
 	list_delete(lx->token_queue);
 
-	free(lx->buffer);
+	if(lx->mapping)
+		munmap(lx->mapping, lx->mapping_size);
+	else
+		free(lx->buffer);
 
 	free(lx);
 }
 
 void lexer_free_token(struct token *t)
 {
-	free(t->lexeme);
+	lexer_set_lexeme(t, NULL);
 	free(t);
 }
 
@@ -1380,7 +1481,7 @@ struct token *lexer_next_token(struct lexer *lx)
 
 	if(head)
 	{
-		if(lx->depth == 0) {
+		if(lx->depth == 0 && debug_flags_active(D_MAKEFLOW_LEXER)) {
 			char *str = lexer_print_token(head);
 			debug(D_MAKEFLOW_LEXER, "%s", str);
 			free(str);
@@ -74,6 +74,9 @@
 #include "dag.h"
 #include "category.h"
 
+/* Roll backs never go further than the current line and its escaped newlines. */
+#define LEXER_COLUMN_HISTORY 64
+
 struct lexer
 {
 	struct dag *d;                      /* The dag being built. */
@@ -93,14 +96,19 @@ struct lexer
 	uint64_t lexeme_max;
 	uint64_t lexeme_size;
 
-	int   chunk_last_loaded;
+	int   chunk_last_loaded;        /* 1 or 2 when reading the stream by chunks, 0 when all the input is in buffer. */
 	char *buffer;
 
+	char  *mapping;                 /* When the stream is a regular file, it is mmap'd here instead of read by chunks. */
+	size_t mapping_size;
+	char  *mapping_released;        /* Pages of the mapping before this point have already been given back. */
+
 	int eof;
 
 	long int   line_number;
 	long int   column_number;
-	struct list *column_numbers;
+	long int   column_numbers[LEXER_COLUMN_HISTORY];   /* Columns at the last newlines read, to roll back over them. */
+	unsigned   column_numbers_count;
 
 	struct list *token_queue;
 
@@ -54,6 +54,7 @@ See the file COPYING for details.
 #include "makeflow_hook.h"
 
 #include <fcntl.h>
+#include <pthread.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <libgen.h>
@@ -647,8 +648,6 @@ static enum job_submit_status makeflow_node_submit(struct dag *d, struct dag_nod
 
 static int makeflow_node_ready(struct dag *d, struct dag_node *n, const struct rmsummary *resources)
 {
-	struct dag_file *f;
-
 	if(n->state != DAG_NODE_STATE_WAITING)
 		return 0;
 
@@ -665,14 +664,9 @@ static int makeflow_node_ready(struct dag *d, struct dag_node *n, const struct r
 			return 0;
 	}
 
-	list_first_item(n->source_files);
-	while((f = list_next_item(n->source_files))) {
-		if(dag_file_should_exist(f)) {
-			continue;
-		} else {
-			return 0;
-		}
-	}
+	/* Kept up to date as files are created and deleted. */
+	if(n->source_files_missing > 0)
+		return 0;
 
 	/* If all makeflow checks pass for this node we will 
 	return the result of the hooks, which will be 1 if all pass
@@ -711,6 +705,9 @@ int makeflow_nodes_remote_waiting_count(const struct dag *d) {
 
 /*
 Find all jobs ready to be run, then submit them.
+Only the nodes in the ready list are considered, which are the waiting
+nodes with all their source files present. Nodes that cannot run yet
+because of the limits on jobs and resources are kept in the list.
 */
 
 static void makeflow_dispatch_ready_jobs(struct dag *d)
@@ -727,28 +724,83 @@ static void makeflow_dispatch_ready_jobs(struct dag *d)
 	 */
 	int submission_timeout = 0;
 
-	for(n = d->nodes; n; n = n->next) {
+	/* Nodes that become ready while dispatching are considered in the next call. */
+	int count = list_size(d->ready_nodes);
+
+	while(count-- > 0) {
 		if(dag_remote_jobs_running(d) >= remote_jobs_max && dag_local_jobs_running(d) >= local_jobs_max) {
 			break;
 		}
 
+		n = list_pop_head(d->ready_nodes);
+		n->in_ready_list = 0;
+
+		if(n->state != DAG_NODE_STATE_WAITING || n->source_files_missing > 0) {
+			continue;
+		}
+
 		const struct rmsummary *resources = dag_node_dynamic_label(n);
 
-		if(makeflow_node_ready(d, n, resources)) {
-			if(is_local_job(n) || !submission_timeout) {
-				enum job_submit_status status = makeflow_node_submit(d, n, resources);
+		if(makeflow_node_ready(d, n, resources) && (is_local_job(n) || !submission_timeout)) {
+			enum job_submit_status status = makeflow_node_submit(d, n, resources);
 
-				if(status == JOB_SUBMISSION_ABORTED) {
-					break;
-				} else if(status == JOB_SUBMISSION_TIMEOUT) {
-					debug(D_MAKEFLOW_RUN, "batch submissions are timing-out. Only submitting local jobs for the rest of this cycle.");
-					submission_timeout = 1;
-				}
+			/* A node that was not submitted goes back to the list, to be tried again. */
+			dag_ready_nodes_update(d, n);
+
+			if(status == JOB_SUBMISSION_ABORTED) {
+				break;
+			} else if(status == JOB_SUBMISSION_TIMEOUT) {
+				debug(D_MAKEFLOW_RUN, "batch submissions are timing-out. Only submitting local jobs for the rest of this cycle.");
+				submission_timeout = 1;
 			}
+		} else {
+			dag_ready_nodes_update(d, n);
 		}
 	}
 }
 
+/*
+Wait for a job of the queue to complete until stoptime, and collect with
+it all the other jobs already complete, so that the nodes that become
+ready are dispatched together. Returns the number of jobs completed.
+*/
+
+#define MAKEFLOW_WAIT_MANY_MAX 1024
+
+static int makeflow_wait_jobs(struct dag *d, struct batch_queue *queue, struct itable *job_table, time_t stoptime)
+{
+	static struct batch_job_result results[MAKEFLOW_WAIT_MANY_MAX];
+	struct dag_node *n;
+	int completed = 0;
+	int count, i;
+
+	do {
+		count = batch_job_wait_many(queue, results, MAKEFLOW_WAIT_MANY_MAX, completed ? time(0) : stoptime);
+
+		for(i = 0; i < count; i++) {
+			batch_job_id_t jobid = results[i].jobid;
+
+			if(job_table == d->remote_job_table)
+				printf("job %"PRIbjid" completed\n",jobid);
+			debug(D_MAKEFLOW_RUN, "Job %" PRIbjid " has returned.\n", jobid);
+
+			n = itable_remove(job_table, jobid);
+			if(n){
+				// Stop gap until batch_job_wait returns task struct
+				batch_task_set_info(n->task, &results[i].info);
+				makeflow_node_complete(d, n, queue, n->task);
+			}
+		}
+
+		if(count > 0)
+			completed += count;
+
+		/* A full array may have left other jobs complete. */
+	} while(count == MAKEFLOW_WAIT_MANY_MAX && !makeflow_abort_flag);
+
+	return completed;
+}
+
 /*
 Check the the indicated file was created and log, error, or retry as appropriate.
 */
@@ -916,6 +968,75 @@ static void makeflow_node_complete(struct dag *d, struct dag_node *n, struct bat
 	}
 }
 
+/*
+Checking the files of a large workflow one stat at a time is
+dominated by latency, especially on a shared filesystem, so the
+stats are issued by a pool of threads and the results are then
+examined in order by the main thread.  Batch systems that reach
+files through their own connection (chirp) or log every access
+(dryrun) are not safe to call from several threads, and are
+checked serially.
+*/
+
+#define MAKEFLOW_FILE_CHECK_THREADS 16
+
+struct makeflow_file_check {
+	struct dag_file *file;
+	struct stat info;
+	int result;
+};
+
+struct makeflow_file_check_set {
+	struct makeflow_file_check *checks;
+	int count;
+	int next;
+	pthread_mutex_t mutex;
+};
+
+static void *makeflow_check_files_thread( void *arg )
+{
+	struct makeflow_file_check_set *set = arg;
+
+	while(1) {
+		pthread_mutex_lock(&set->mutex);
+		int i = set->next++;
+		pthread_mutex_unlock(&set->mutex);
+
+		if(i >= set->count) break;
+
+		struct makeflow_file_check *c = &set->checks[i];
+		c->result = batch_fs_stat(remote_queue, c->file->filename, &c->info);
+	}
+
+	return 0;
+}
+
+static void makeflow_check_files_stat( struct makeflow_file_check_set *set )
+{
+	pthread_t threads[MAKEFLOW_FILE_CHECK_THREADS];
+	int nthreads = 0;
+	int i;
+
+	batch_queue_type_t type = batch_queue_get_type(remote_queue);
+	if(type != BATCH_QUEUE_TYPE_CHIRP && type != BATCH_QUEUE_TYPE_DRYRUN) {
+		nthreads = MIN(MAKEFLOW_FILE_CHECK_THREADS, set->count / 64);
+	}
+
+	for(i = 0; i < nthreads; i++) {
+		if(pthread_create(&threads[i], NULL, makeflow_check_files_thread, set)) {
+			break;
+		}
+	}
+	nthreads = i;
+
+	/* The main thread takes part, and finishes the work alone if no thread could be started. */
+	makeflow_check_files_thread(set);
+
+	for(i = 0; i < nthreads; i++) {
+		pthread_join(threads[i], NULL);
+	}
+}
+
 /*
 Check the dag for all files that should exist,
 whether provided by the user, or created by 
@@ -924,14 +1045,19 @@ a prior run that was logged.
 
 static int makeflow_check_files(struct dag *d)
 {
-	struct stat buf;
+	struct makeflow_file_check_set set;
 	struct dag_file *f;
 	char *name;
 	int errors = 0;
 	int warnings = 0;
+	int i;
 
 	printf("checking files for unexpected changes...  (use --skip-file-check to skip this step)\n");
 
+	memset(&set, 0, sizeof(set));
+	set.checks = xxmalloc(sizeof(*set.checks) * (hash_table_size(d->files) + 1));
+	pthread_mutex_init(&set.mutex, NULL);
+
 	hash_table_firstkey(d->files);
 	while(hash_table_nextkey(d->files, &name, (void **) &f)) {
 
@@ -941,8 +1067,19 @@ static int makeflow_check_files(struct dag *d)
 		/* Skip any file that should not exist yet. */
 		if(!dag_file_should_exist(f)) continue;
 
-		/* Check for the presence of the file. */
-		int result = batch_fs_stat(remote_queue, f->filename, &buf );
+		set.checks[set.count++].file = f;
+	}
+
+	/* Check for the presence of the files. */
+	makeflow_check_files_stat(&set);
+
+	for(i = 0; i < set.count; i++) {
+		struct stat *buf = &set.checks[i].info;
+		int result = set.checks[i].result;
+		f = set.checks[i].file;
+
+		/* Resetting an earlier node may have changed what this file should be. */
+		if(!dag_file_should_exist(f)) continue;
 
 		if(dag_file_is_source(f)) {
 			/* Source files must exist before running */
@@ -958,7 +1095,7 @@ static int makeflow_check_files(struct dag *d)
 				makeflow_log_file_state_change(d, f, DAG_FILE_STATE_UNKNOWN);
 				makeflow_node_reset(d,f->created_by);
 				warnings++;
-			} else if(!S_ISDIR(buf.st_mode) && difftime(buf.st_mtime, f->creation_logged) > 0) {
+			} else if(!S_ISDIR(buf->st_mode) && difftime(buf->st_mtime, f->creation_logged) > 0) {
 				/* Recreate descendants by resetting all nodes that consume this file. */
 				printf("warning: %s was previously created by makeflow, but someone else modified it!\n",f->filename);
 				makeflow_node_reset_by_file(d,f);
@@ -967,6 +1104,9 @@ static int makeflow_check_files(struct dag *d)
 		}
 	}
 
+	pthread_mutex_destroy(&set.mutex);
+	free(set.checks);
+
 	if(errors>0 || warnings>0) {
 		printf("found %d errors and %d warnings during consistency check.\n", errors,warnings);
 	}
@@ -1019,9 +1159,6 @@ Main loop for running a makeflow: submit jobs, wait for completion, keep going u
 
 static void makeflow_run( struct dag *d )
 {
-	struct dag_node *n;
-	batch_job_id_t jobid;
-	struct batch_job_info info;
 	// Start Catalog at current time
 	timestamp_t start = timestamp_get();
 	// Last Report is created stall for first reporting.
@@ -1032,6 +1169,9 @@ static void makeflow_run( struct dag *d )
 		makeflow_catalog_summary(d, project, batch_queue_type, start);
 	}
 
+	// From now on, the ready list follows the changes of state of nodes and files.
+	dag_ready_nodes_init(d);
+
 	while(!makeflow_abort_flag) {
 		makeflow_dispatch_ready_jobs(d);
 		/*
@@ -1050,17 +1190,7 @@ static void makeflow_run( struct dag *d )
 
 		if(dag_remote_jobs_running(d)) {
 			int tmp_timeout = 5;
-			jobid = batch_job_wait_timeout(remote_queue, &info, time(0) + tmp_timeout);
-			if(jobid > 0) {
-				printf("job %"PRIbjid" completed\n",jobid);
-				debug(D_MAKEFLOW_RUN, "Job %" PRIbjid " has returned.\n", jobid);
-				n = itable_remove(d->remote_job_table, jobid);
-				if(n){
-					// Stop gap until batch_job_wait returns task struct
-					batch_task_set_info(n->task, &info);
-					makeflow_node_complete(d, n, remote_queue, n->task);
-				}
-			}
+			makeflow_wait_jobs(d, remote_queue, d->remote_job_table, time(0) + tmp_timeout);
 		}
 
 		if(dag_local_jobs_running(d)) {
@@ -1073,16 +1203,7 @@ static void makeflow_run( struct dag *d )
 				stoptime = time(0) + tmp_timeout;
 			}
 
-			jobid = batch_job_wait_timeout(local_queue, &info, stoptime);
-			if(jobid > 0) {
-				debug(D_MAKEFLOW_RUN, "Job %" PRIbjid " has returned.\n", jobid);
-				n = itable_remove(d->local_job_table, jobid);
-				if(n){
-					// Stop gap until batch_job_wait returns task struct
-					batch_task_set_info(n->task, &info);
-					makeflow_node_complete(d, n, local_queue, n->task);
-				}
-			}
+			makeflow_wait_jobs(d, local_queue, d->local_job_table, stoptime);
 		}
 
 		/* Report to catalog */
@@ -1162,6 +1283,7 @@ static void show_help_run(const char *cmd)
 	printf("    --jx-args=<file>            File defining JX variables for JX workflow.\n");
 	printf("    --jx-define=<VAR>=<EXPR>	Set the JX variable VAR to JX expression EXPR.\n");
 	printf("    --log-verbose               Add node id symbol tags in the makeflow log.\n");
+	printf("    --log-checkpoint=<secs>     Checkpoint the makeflow log this often. (default is 300, 0 disables)\n");
 	printf(" -j,--max-local=<#>             Max number of local jobs to run at once.\n");
 	printf(" -J,--max-remote=<#>            Max number of remote jobs to run at once.\n");
 	printf(" -R,--retry                     Retry failed batch jobs up to 5 times.\n");
@@ -1411,6 +1533,7 @@ int main(int argc, char *argv[])
 		LONG_OPT_VC3_OPT,
 		LONG_OPT_VERBOSE_PARSING,
 		LONG_OPT_LOG_VERBOSE_MODE,
+		LONG_OPT_LOG_CHECKPOINT,
 		LONG_OPT_WORKING_DIR,
 		LONG_OPT_PREFERRED_CONNECTION,
 		LONG_OPT_WQ_WAIT_FOR_WORKERS,
@@ -1524,6 +1647,7 @@ int main(int argc, char *argv[])
 		{"vc3-options", required_argument, 0, LONG_OPT_VC3_OPT},
 		{"version", no_argument, 0, 'v'},
 		{"log-verbose", no_argument, 0, LONG_OPT_LOG_VERBOSE_MODE},
+		{"log-checkpoint", required_argument, 0, LONG_OPT_LOG_CHECKPOINT},
 		{"working-dir", required_argument, 0, LONG_OPT_WORKING_DIR},
 		{"skip-file-check", no_argument, 0, LONG_OPT_SKIP_FILE_CHECK},
 		{"umbrella-binary", required_argument, 0, LONG_OPT_UMBRELLA_BINARY},
@@ -1835,6 +1959,9 @@ int main(int argc, char *argv[])
 			case LONG_OPT_LOG_VERBOSE_MODE:
 				log_verbose_mode = 1;
 				break;
+			case LONG_OPT_LOG_CHECKPOINT:
+				makeflow_log_checkpoint_interval(atoi(optarg));
+				break;
 			case LONG_OPT_WRAPPER:
 				if (makeflow_hook_register(&makeflow_hook_basic_wrapper, &hook_args) == MAKEFLOW_HOOK_FAILURE)
 					goto EXIT_WITH_FAILURE;
@@ -2541,6 +2668,7 @@ EXIT_WITH_FAILURE:
 		batch_queue_delete(local_queue);
 
 	makeflow_log_close(d);
+	dag_ready_nodes_delete(d);
         
 	exit(exit_value);
         
@@ -14,8 +14,13 @@ See the file COPYING for details.
 #include "timestamp.h"
 #include "list.h"
 #include "debug.h"
+#include "hash_table.h"
+#include "itable.h"
+#include "stringtools.h"
 #include "xxmalloc.h"
 
+#include <sys/stat.h>
+
 #include <limits.h>
 #include <stdio.h>
 #include <unistd.h>
@@ -107,6 +112,8 @@ These event types indicate that the workflow as a whole has started or completed
 
 void makeflow_node_decide_reset( struct dag *d, struct dag_node *n, int silent );
 
+static int makeflow_log_checkpoint_due();
+
 /*
 To balance between performance and consistency, we sync the log every 60 seconds
 on ordinary events, but sync immediately on important events like a makeflow restart.
@@ -124,6 +131,10 @@ static void makeflow_log_sync( struct dag *d, int force )
 		fsync(fileno(d->logfile));
 		last_fsync = time(NULL);
 	}
+
+	if(makeflow_log_checkpoint_due()) {
+		makeflow_log_checkpoint(d);
+	}
 }
 
 void makeflow_log_close( struct dag *d )
@@ -132,6 +143,7 @@ void makeflow_log_close( struct dag *d )
 	if(!d || !d->logfile) return;
 
 	makeflow_log_sync(d,1);
+	makeflow_log_checkpoint(d);
 	fclose(d->logfile);
 	d->logfile = 0;
 }
@@ -169,8 +181,20 @@ void makeflow_log_completed_event( struct dag *d )
 	makeflow_log_sync(d,1);
 }
 
+/* Mount events are kept so that checkpoints can carry them forward. */
+static struct list *mount_events = 0;
+
+static void makeflow_log_remember_mount( const char *line )
+{
+	if(!mount_events) mount_events = list_create();
+	list_push_tail(mount_events, xxstrdup(line));
+}
+
 void makeflow_log_mount_event( struct dag *d, const char *target, const char *source, const char *cache_name, dag_file_source_t type ) {
-	fprintf(d->logfile, "# MOUNT %" PRIu64 " %s %s %s %d\n", timestamp_get(), target, source, cache_name, type);
+	char *line = string_format("# MOUNT %" PRIu64 " %s %s %s %d", timestamp_get(), target, source, cache_name, type);
+	fprintf(d->logfile, "%s\n", line);
+	makeflow_log_remember_mount(line);
+	free(line);
 	makeflow_log_sync(d,1);
 }
 
@@ -195,6 +219,8 @@ void makeflow_log_state_change( struct dag *d, struct dag_node *n, int newstate
 	n->state = newstate;
 	d->node_states[n->state]++;
 
+	dag_ready_nodes_update(d, n);
+
 	fprintf(d->logfile, "%" PRIu64 " %d %d %" PRIbjid " %d %d %d %d %d %d\n", timestamp_get(), n->nodeid, newstate, n->jobid, d->node_states[0], d->node_states[1], d->node_states[2], d->node_states[3], d->node_states[4], d->nodeid_counter);
 
 	makeflow_log_sync(d,0);
@@ -204,7 +230,9 @@ void makeflow_log_file_state_change( struct dag *d, struct dag_file *f, int news
 {
 	debug(D_MAKEFLOW_RUN, "file %s %s -> %s\n", f->filename, dag_file_state_name(f->state), dag_file_state_name(newstate));
 
+	int existed = dag_file_should_exist(f);
 	f->state = newstate;
+	dag_ready_nodes_file_update(d, f, existed);
 
 	/* If a file is a wrapper global file do not log to avoid cleaning floating global files. */
 	if(f->type == DAG_FILE_TYPE_GLOBAL) return;
@@ -312,6 +340,348 @@ void makeflow_log_dag_structure( struct dag *d )
 	}
 }
 
+/*
+Apply the events read back from the log or a checkpoint.
+Those returning int return non-zero if the event conflicts
+with the current configuration.
+*/
+
+static struct dag_file *makeflow_log_recover_file( struct dag *d, const char *filename, int file_state, timestamp_t time )
+{
+	struct dag_file *f = dag_file_lookup_or_create(d, filename);
+	f->state = file_state;
+	if(file_state == DAG_FILE_STATE_EXISTS){
+		d->completed_files += 1;
+		f->creation_logged = (time_t) (time / 1000000);
+	} else if(file_state == DAG_FILE_STATE_DELETE){
+		d->deleted_files += 1;
+	}
+	return f;
+}
+
+static int makeflow_log_recover_cache( struct dag *d, const char *cache_dir )
+{
+	/* if the user specifies a cache dir using --cache dir, ignore the info from the log file */
+	if(!d->cache_dir) {
+		d->cache_dir = xxstrdup(cache_dir);
+	} else {
+		/* There are two possible reasons for the inconsistency:
+		 * 1) the cache dir specified via the --cache opt and in the log file mismatch;
+		 * 2) the log file includes multiple different CACHE entries.
+		 */
+		if(strcmp(cache_dir, d->cache_dir)) {
+			fprintf(stderr, "The --cache option (%s) does not match the cache dir (%s) in the log file!\n", d->cache_dir, cache_dir);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int makeflow_log_recover_mount( struct dag *d, const char *file, const char *source, const char *cache_name, int type )
+{
+	struct dag_file *f = dag_file_lookup_or_create(d, file);
+
+	if(!f->source) {
+		f->source = xxstrdup(source);
+		f->cache_name = xxstrdup(cache_name);
+		f->type = type;
+	} else {
+		/* If a mount entry is specified in the mountfile and logged in a log file at the same time, they must not conflict with each other. */
+		/* If a mount entry is logged in a log file multiple times deliberately or not, they must not conflict with each other. */
+		if(makeflow_mount_check_consistency(file, f->source, source, d->cache_dir, cache_name)) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/* Return zero on success, negative on conflict, positive if the line is not a MOUNT event. */
+
+static int makeflow_log_recover_mount_line( struct dag *d, const char *line )
+{
+	char file[MAX_BUFFER_SIZE], source[PATH_MAX], cache_name[NAME_MAX];
+	timestamp_t time;
+	int type;
+
+	if(sscanf(line, "# MOUNT %" SCNu64 " %s %s %s %d", &time, file, source, cache_name, &type) != 5) return 1;
+
+	makeflow_log_remember_mount(line);
+	return makeflow_log_recover_mount(d, file, source, cache_name, type) ? -1 : 0;
+}
+
+static void makeflow_log_recover_node( struct dag *d, int nodeid, int state, batch_job_id_t jobid, timestamp_t time )
+{
+	struct dag_node *n = itable_lookup(d->node_table, nodeid);
+	if(n) {
+		n->state = state;
+		n->jobid = jobid;
+		/* Log timestamp is in microseconds, we need seconds for diff. */
+		n->previous_completion = (time_t) (time / 1000000);
+	}
+}
+
+/*
+A checkpoint is a binary snapshot of the state of every node and file,
+along with the offset of the log at the moment it was taken.  Recovery
+loads the latest checkpoint and then replays only the lines written to
+the log after that offset, so restarting a large workflow does not
+require parsing its entire history.  The checkpoint is written to a
+temporary file and renamed into place, so it is either complete or absent.
+
+The format is private to makeflow: a header, the cache dir, then
+fixed-size records for nodes and files, with any strings following
+their record, and finally the MOUNT lines of the log verbatim.
+*/
+
+#define CHECKPOINT_MAGIC "mfckpt01"
+
+struct checkpoint_header {
+	char magic[8];
+	uint64_t log_offset;
+	uint64_t log_inode;
+	int32_t nodeid_counter;
+	int32_t node_count;
+	int32_t file_count;
+	int32_t mount_count;
+	int32_t cache_dir_length;
+	int32_t completed_files;
+	int32_t deleted_files;
+	int32_t padding;
+};
+
+struct checkpoint_node {
+	int32_t nodeid;
+	int32_t state;
+	int64_t jobid;
+	int64_t previous_completion;
+};
+
+struct checkpoint_file {
+	int32_t state;
+	int32_t name_length;
+	int64_t creation_logged;
+};
+
+struct checkpoint_mount {
+	int32_t length;
+	int32_t padding;
+};
+
+static char *checkpoint_filename = 0;
+static int checkpoint_interval = 300;
+static time_t last_checkpoint = 0;
+
+void makeflow_log_checkpoint_interval( int interval )
+{
+	checkpoint_interval = interval;
+}
+
+static int makeflow_log_checkpoint_due()
+{
+	return checkpoint_filename && checkpoint_interval > 0 && (time(NULL)-last_checkpoint) > checkpoint_interval;
+}
+
+static int makeflow_log_checkpoint_wanted( struct dag_file *f )
+{
+	/* Global wrapper files are never logged, so they are not recovered either. */
+	return f->type != DAG_FILE_TYPE_GLOBAL && f->state != DAG_FILE_STATE_UNKNOWN;
+}
+
+void makeflow_log_checkpoint( struct dag *d )
+{
+	struct checkpoint_header h;
+	struct stat info;
+	struct dag_node *n;
+	struct dag_file *f;
+	char *name;
+
+	if(!d || !d->logfile || !checkpoint_filename || checkpoint_interval <= 0) return;
+
+	last_checkpoint = time(NULL);
+
+	/* The log must be on disk before the checkpoint that refers to it. */
+	fflush(d->logfile);
+	fsync(fileno(d->logfile));
+
+	if(fstat(fileno(d->logfile), &info) < 0) return;
+
+	/* If the log has been removed (e.g. by --clean) remove its checkpoint too. */
+	if(info.st_nlink == 0) {
+		unlink(checkpoint_filename);
+		return;
+	}
+
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, CHECKPOINT_MAGIC, sizeof(h.magic));
+	h.log_offset = info.st_size;
+	h.log_inode = info.st_ino;
+	h.nodeid_counter = d->nodeid_counter;
+	h.completed_files = d->completed_files;
+	h.deleted_files = d->deleted_files;
+	h.mount_count = mount_events ? list_size(mount_events) : 0;
+	h.cache_dir_length = d->cache_dir ? strlen(d->cache_dir) : 0;
+
+	for(n = d->nodes; n; n = n->next) {
+		h.node_count++;
+	}
+
+	hash_table_firstkey(d->files);
+	while(hash_table_nextkey(d->files, &name, (void **) &f)) {
+		if(makeflow_log_checkpoint_wanted(f)) h.file_count++;
+	}
+
+	char *tmpname = string_format("%s.tmp", checkpoint_filename);
+	FILE *file = fopen(tmpname, "w");
+	if(!file) {
+		debug(D_MAKEFLOW_RUN, "couldn't write checkpoint %s: %s", tmpname, strerror(errno));
+		free(tmpname);
+		return;
+	}
+
+	fwrite(&h, sizeof(h), 1, file);
+	if(h.cache_dir_length) fwrite(d->cache_dir, h.cache_dir_length, 1, file);
+
+	for(n = d->nodes; n; n = n->next) {
+		struct checkpoint_node r;
+		r.nodeid = n->nodeid;
+		r.state = n->state;
+		r.jobid = n->jobid;
+		r.previous_completion = n->previous_completion;
+		fwrite(&r, sizeof(r), 1, file);
+	}
+
+	hash_table_firstkey(d->files);
+	while(hash_table_nextkey(d->files, &name, (void **) &f)) {
+		if(!makeflow_log_checkpoint_wanted(f)) continue;
+		struct checkpoint_file r;
+		r.state = f->state;
+		r.name_length = strlen(f->filename);
+		r.creation_logged = f->creation_logged;
+		fwrite(&r, sizeof(r), 1, file);
+		fwrite(f->filename, r.name_length, 1, file);
+	}
+
+	if(mount_events) {
+		char *line;
+		list_first_item(mount_events);
+		while((line = list_next_item(mount_events))) {
+			struct checkpoint_mount r;
+			r.length = strlen(line);
+			r.padding = 0;
+			fwrite(&r, sizeof(r), 1, file);
+			fwrite(line, r.length, 1, file);
+		}
+	}
+
+	if(fflush(file) != 0 || fsync(fileno(file)) != 0 || fclose(file) != 0 || rename(tmpname, checkpoint_filename) != 0) {
+		debug(D_MAKEFLOW_RUN, "couldn't write checkpoint %s: %s", checkpoint_filename, strerror(errno));
+		unlink(tmpname);
+	} else {
+		debug(D_MAKEFLOW_RUN, "checkpoint of %d nodes and %d files written at log offset %" PRIu64, h.node_count, h.file_count, h.log_offset);
+	}
+
+	free(tmpname);
+}
+
+static char *checkpoint_read_string( FILE *file, int32_t length )
+{
+	if(length < 0 || length >= 4*PATH_MAX) return 0;
+
+	char *s = xxmalloc(length + 1);
+	if(length > 0 && fread(s, length, 1, file) != 1) {
+		free(s);
+		return 0;
+	}
+	s[length] = 0;
+	return s;
+}
+
+/*
+Load the checkpoint matching the log described by info.
+Return the log offset at which replay should resume,
+zero if there is no usable checkpoint, or -1 if the checkpoint
+conflicts with the current configuration.
+*/
+
+static int64_t makeflow_log_checkpoint_load( struct dag *d, const char *filename, struct stat *info )
+{
+	struct checkpoint_header h;
+	int32_t i;
+
+	FILE *file = fopen(filename, "r");
+	if(!file) return 0;
+
+	if(fread(&h, sizeof(h), 1, file) != 1 || memcmp(h.magic, CHECKPOINT_MAGIC, sizeof(h.magic))) {
+		fprintf(stderr, "makeflow: ignoring checkpoint %s: unknown format\n", filename);
+		fclose(file);
+		return 0;
+	}
+
+	if(h.log_inode != (uint64_t) info->st_ino || h.log_offset > (uint64_t) info->st_size || h.nodeid_counter != d->nodeid_counter) {
+		fprintf(stderr, "makeflow: ignoring checkpoint %s: it does not match the log\n", filename);
+		fclose(file);
+		return 0;
+	}
+
+	if(h.cache_dir_length) {
+		char *cache_dir = checkpoint_read_string(file, h.cache_dir_length);
+		if(!cache_dir) goto corrupted;
+		int result = makeflow_log_recover_cache(d, cache_dir);
+		free(cache_dir);
+		if(result) goto conflict;
+	}
+
+	for(i = 0; i < h.node_count; i++) {
+		struct checkpoint_node r;
+		if(fread(&r, sizeof(r), 1, file) != 1) goto corrupted;
+		makeflow_log_recover_node(d, r.nodeid, r.state, r.jobid, (timestamp_t) r.previous_completion * 1000000);
+	}
+
+	for(i = 0; i < h.file_count; i++) {
+		struct checkpoint_file r;
+		if(fread(&r, sizeof(r), 1, file) != 1) goto corrupted;
+		char *name = checkpoint_read_string(file, r.name_length);
+		if(!name) goto corrupted;
+		struct dag_file *f = makeflow_log_recover_file(d, name, r.state, 0);
+		/* The creation time outlives the EXISTS state that recorded it. */
+		f->creation_logged = r.creation_logged;
+		free(name);
+	}
+
+	for(i = 0; i < h.mount_count; i++) {
+		struct checkpoint_mount r;
+		if(fread(&r, sizeof(r), 1, file) != 1) goto corrupted;
+		char *line = checkpoint_read_string(file, r.length);
+		if(!line) goto corrupted;
+		int result = makeflow_log_recover_mount_line(d, line);
+		free(line);
+		if(result < 0) goto conflict;
+		if(result > 0) goto corrupted;
+	}
+
+	d->completed_files = h.completed_files;
+	d->deleted_files = h.deleted_files;
+
+	fclose(file);
+	printf("recovered %d nodes and %d files from checkpoint %s...\n", h.node_count, h.file_count, filename);
+	return h.log_offset;
+
+corrupted:
+	/*
+	Everything applied so far is also recorded in the log,
+	so replaying the whole log gives the same result.
+	*/
+	fprintf(stderr, "makeflow: ignoring checkpoint %s: it is truncated or corrupted\n", filename);
+	d->completed_files = 0;
+	d->deleted_files = 0;
+	fclose(file);
+	return 0;
+
+conflict:
+	fclose(file);
+	return -1;
+}
+
 /*
 Recover the state of the workflow so far by reading back the state
 from the log file, if it exists.  (If not, create a new log.)
@@ -323,73 +693,62 @@ int makeflow_log_recover(struct dag *d, const char *filename, int verbose_mode,
 	int nodeid, state, jobid, file_state;
 	int first_run = 1;
 	struct dag_node *n;
-	struct dag_file *f;
 	timestamp_t previous_completion_time;
 	uint64_t size;
 
+	free(checkpoint_filename);
+	checkpoint_filename = string_format("%s.checkpoint", filename);
+
 	d->logfile = fopen(filename, "r");
 	if(d->logfile) {
+		struct stat info;
+		int64_t offset = 0;
 		int linenum = 0;
 		first_run = 0;
 
-		printf("recovering from log file %s...\n",filename);
+		if(checkpoint_interval > 0 && fstat(fileno(d->logfile), &info) == 0) {
+			offset = makeflow_log_checkpoint_load(d, checkpoint_filename, &info);
+			if(offset < 0) {
+				fclose(d->logfile);
+				d->logfile = 0;
+				return -1;
+			}
+			fseeko(d->logfile, offset, SEEK_SET);
+		}
+
+		if(offset > 0) {
+			printf("recovering from log file %s after the checkpoint...\n",filename);
+		} else {
+			printf("recovering from log file %s...\n",filename);
+		}
 
 		while((line = get_line(d->logfile))) {
-			char source[PATH_MAX], cache_dir[NAME_MAX], cache_name[NAME_MAX];
-			int type;
+			char cache_dir[NAME_MAX];
 			linenum++;
 
 			if(sscanf(line, "# FILE %" SCNu64 " %s %d %" SCNu64 "", &previous_completion_time, file, &file_state, &size) == 4) {
-				f = dag_file_lookup_or_create(d, file);
-				f->state = file_state;
-				if(file_state == DAG_FILE_STATE_EXISTS){
-					d->completed_files += 1;
-					f->creation_logged = (time_t) (previous_completion_time / 1000000);
-				} else if(file_state == DAG_FILE_STATE_DELETE){
-					d->deleted_files += 1;
-				}
+				makeflow_log_recover_file(d, file, file_state, previous_completion_time);
 			} else if(sscanf(line, "# CACHE %" SCNu64 " %s", &previous_completion_time, cache_dir) == 2) {
-				/* if the user specifies a cache dir using --cache dir, ignore the info from the log file */
-				if(!d->cache_dir) {
-					d->cache_dir = xxstrdup(cache_dir);
-				} else {
-					/* There are two possible reasons for the inconsistency:
-					 * 1) the cache dir specified via the --cache opt and in the log file mismatch;
-					 * 2) the log file includes multiple different CACHE entries.
-					 */
-					if(strcmp(cache_dir, d->cache_dir)) {
-						fprintf(stderr, "The --cache option (%s) does not match the cache dir (%s) in the log file!\n", d->cache_dir, cache_dir);
-						free(line);
-						return -1;
-					}
+				if(makeflow_log_recover_cache(d, cache_dir)) {
+					free(line);
+					return -1;
 				}
-			} else if(sscanf(line, "# MOUNT %" SCNu64 " %s %s %s %d", &previous_completion_time, file, source, cache_name, &type) == 5) {
-				f = dag_file_lookup_or_create(d, file);
-
-				if(!f->source) {
-					f->source = xxstrdup(source);
-					f->cache_name = xxstrdup(cache_name);
-					f->type = type;
-				} else {
-					/* If a mount entry is specified in the mountfile and logged in a log file at the same time, they must not conflict with each other. */
-					/* If a mount entry is logged in a log file multiple times deliberately or not, they must not conflict with each other. */
-					if(makeflow_mount_check_consistency(file, f->source, source, d->cache_dir, cache_name)) {
-						free(line);
-						return -1;
-					}
+			} else if(!strncmp(line, "# MOUNT ", 8)) {
+				int result = makeflow_log_recover_mount_line(d, line);
+				if(result < 0) {
+					free(line);
+					return -1;
 				}
 			} else if(line[0] == '#') {
 				/* Ignore any other comment lines */
 			} else if(sscanf(line, "%" SCNu64 " %d %d %d", &previous_completion_time, &nodeid, &state, &jobid) == 4) {
-				n = itable_lookup(d->node_table, nodeid);
-				if(n) {
-					n->state = state;
-					n->jobid = jobid;
-					/* Log timestamp is in microseconds, we need seconds for diff. */
-					n->previous_completion = (time_t) (previous_completion_time / 1000000);
-				}
+				makeflow_log_recover_node(d, nodeid, state, jobid, previous_completion_time);
 			} else {
-				fprintf(stderr, "makeflow: %s appears to be corrupted on line %d\n", filename, linenum);
+				if(offset > 0) {
+					fprintf(stderr, "makeflow: %s appears to be corrupted on line %d after byte %" PRId64 "\n", filename, linenum, offset);
+				} else {
+					fprintf(stderr, "makeflow: %s appears to be corrupted on line %d\n", filename, linenum);
+				}
 				exit(1);
 			}
 			free(line);
@@ -434,6 +793,9 @@ int makeflow_log_recover(struct dag *d, const char *filename, int verbose_mode,
 		}
 	}
 
+	/* The checkpoint just loaded is fresh enough until the next interval. */
+	last_checkpoint = time(NULL);
+
 	/*
 	To bring garbage collection up to date, decrement
 	file reference counts for every node that is complete.
@@ -35,6 +35,14 @@ void makeflow_log_alloc_event( struct dag *d, struct makeflow_alloc *alloc );
 void makeflow_log_gc_event( struct dag *d, int collected, timestamp_t elapsed, int total_collected );
 void makeflow_log_close(struct dag *d );
 
+/*
+Every interval seconds (zero disables it) the state of the dag is
+saved to a checkpoint next to the log, so that recovery only needs
+to replay the log written since then.
+*/
+void makeflow_log_checkpoint_interval( int interval );
+void makeflow_log_checkpoint( struct dag *d );
+
 /* return 0 on success, return non-zero on failure. */
 int makeflow_log_recover( struct dag *d, const char *filename, int verbose_mode, struct batch_queue *queue, makeflow_clean_depth clean_mode );
 
@@ -0,0 +1,147 @@
+/*
+Copyright (C) 2019- The University of Notre Dame
+This software is distributed under the GNU General Public License.
+See the file COPYING for details.
+*/
+
+/*
+makeflow_parse_benchmark measures how long it takes to turn a workflow
+in Make syntax into a DAG, and the peak memory used to hold it.  If no
+workflow is given, a synthetic one is generated with the requested
+number of rules, using variables, substitutions, categories, and chains
+of dependencies, as large workflows produced by scripts usually do.
+*/
+
+#include "dag.h"
+#include "parser.h"
+
+#include "debug.h"
+#include "hash_table.h"
+#include "timestamp.h"
+
+#include <sys/resource.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define RULES_PER_CATEGORY 1000
+#define CHAIN_LENGTH 10
+
+static int generate( const char *filename, int rules )
+{
+	FILE *file = fopen(filename, "w");
+	int i;
+
+	if(!file)
+		return 0;
+
+	fprintf(file, "DIR=data\n");
+	fprintf(file, "PROGRAM=/bin/cp\n");
+	fprintf(file, "CORES=1\n\n");
+
+	for(i=0;i<rules;i++) {
+		if(i%RULES_PER_CATEGORY==0) {
+			fprintf(file, ".MAKEFLOW CATEGORY stage%d\n", i/RULES_PER_CATEGORY);
+			fprintf(file, ".MAKEFLOW MEMORY %d\n\n", 100+i/RULES_PER_CATEGORY);
+		}
+
+		/* Every rule but the first of a chain reads the output of the one before it. */
+		if(i%CHAIN_LENGTH==0) {
+			fprintf(file, "$(DIR)/out.%d: $(DIR)/in.%d $(PROGRAM)\n", i, i%100);
+			fprintf(file, "\tLOCAL $(PROGRAM) $(DIR)/in.%d $(DIR)/out.%d\n\n", i%100, i);
+		} else {
+			fprintf(file, "$(DIR)/out.%d: $(DIR)/out.%d $(PROGRAM)\n", i, i-1);
+			fprintf(file, "\t$(PROGRAM) $(DIR)/out.%d $(DIR)/out.%d # copy\n\n", i-1, i);
+		}
+	}
+
+	fclose(file);
+
+	return 1;
+}
+
+static void show_help( const char *cmd )
+{
+	fprintf(stdout, "Use: %s [options] [workflow]\n", cmd);
+	fprintf(stdout, "Where options are:\n");
+	fprintf(stdout, " %-20s Rules in the generated workflow. (default: 100000)\n", "-n <rules>");
+	fprintf(stdout, " %-20s Keep the generated workflow.\n", "-k");
+	fprintf(stdout, " %-20s Show this help screen.\n", "-h");
+}
+
+int main( int argc, char *argv[] )
+{
+	const char *filename = NULL;
+	char generated[] = "makeflow_parse_benchmark.XXXXXX";
+	int rules = 100000;
+	int keep = 0;
+	int c;
+
+	debug_config(argv[0]);
+
+	while((c = getopt(argc, argv, "n:kh")) != -1) {
+		switch(c) {
+		case 'n':
+			rules = atoi(optarg);
+			break;
+		case 'k':
+			keep = 1;
+			break;
+		case 'h':
+		default:
+			show_help(argv[0]);
+			return c=='h' ? 0 : 1;
+		}
+	}
+
+	if(optind < argc) {
+		filename = argv[optind];
+	} else {
+		int fd = mkstemp(generated);
+		if(fd<0) {
+			fprintf(stderr, "couldn't create %s: %s\n", generated, strerror(errno));
+			return 1;
+		}
+		close(fd);
+
+		if(!generate(generated, rules)) {
+			fprintf(stderr, "couldn't write %s: %s\n", generated, strerror(errno));
+			unlink(generated);
+			return 1;
+		}
+		filename = generated;
+	}
+
+	timestamp_t start = timestamp_get();
+	struct dag *d = dag_from_file(filename, DAG_SYNTAX_MAKE, NULL);
+	timestamp_t stop = timestamp_get();
+
+	if(filename==generated && !keep)
+		unlink(generated);
+
+	if(!d) {
+		fprintf(stderr, "couldn't parse %s\n", filename);
+		return 1;
+	}
+
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	struct dag_node *n;
+	int nodes = 0;
+	for(n=d->nodes;n;n=n->next)
+		nodes++;
+
+	printf("workflow:     %s\n", filename);
+	printf("rules:        %d\n", nodes);
+	printf("files:        %d\n", hash_table_size(d->files));
+	printf("parse time:   %.3lf s\n", (stop-start)/1000000.0);
+	printf("peak memory:  %ld MB\n", usage.ru_maxrss/1024);
+
+	return 0;
+}
+
+/* vim: set noexpandtab tabstop=4: */
@@ -200,6 +200,10 @@ void dag_close_over_nodes(struct dag *d)
 	for(n = d->nodes; n; n = n->next) {
 		struct rmsummary *rs = n->resources_requested;
 
+		/* Only variables set for the rule itself are looked up. */
+		if(hash_table_size(n->variables) < 1)
+			continue;
+
 		struct dag_variable_lookup_set s = {NULL, NULL, n, NULL };
 		
 		rmsummary_set_resources_from_env(rs, s);
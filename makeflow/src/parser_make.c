@@ -76,13 +76,13 @@ static int dag_parse_make_node_regular_command(struct lexer *bk, struct dag_node
 		switch(t->type)
 		{
 		case TOKEN_SPACE:
-			buffer_printf(&b, " ");
+			buffer_putliteral(&b, " ");
 			break;
 		case TOKEN_LITERAL:
-			buffer_printf(&b, "%s", t->lexeme);
+			buffer_putstring(&b, t->lexeme);
 			break;
 		case TOKEN_IO_REDIRECT:
-			buffer_printf(&b, "%s", t->lexeme);
+			buffer_putstring(&b, t->lexeme);
 			break;
 		default:
 			lexer_report_error(bk, "Unexpected command token: %s.\n", lexer_print_token(t));
@@ -0,0 +1,104 @@
+#!/bin/sh
+
+. ../../dttools/test/test_runner_common.sh
+
+test_dir=`basename $0 .sh`.dir
+test_output=`basename $0 .sh`.output
+
+prepare()
+{
+	mkdir $test_dir
+	cd $test_dir
+	ln -sf ../../src/makeflow .
+	echo "hello" > file.1
+
+cat > test.jx << EOF
+{
+	"rules" :
+	[
+		{
+			"command" : format("cp file.%d file.%d",i,i+1),
+			"inputs"  : [ "file."+i ],
+			"outputs" : [ "file."+(i+1) ]
+		} for i in range(1,10)
+	]
+}
+EOF
+	exit 0
+}
+
+run()
+{
+	cd $test_dir
+
+	echo "+++++ first run: should make 10 files and a checkpoint +++++"
+	./makeflow --jx test.jx | tee output.1
+
+	if [ ! -f test.jx.makeflowlog.checkpoint ]
+	then
+		echo "+++++ no checkpoint was written +++++"
+		exit 1
+	fi
+
+	echo "+++++ deleting file.5 manually +++++"
+	rm file.5
+
+	echo "+++++ second run: should recover from the checkpoint and rebuild 6 files +++++"
+	./makeflow --jx test.jx | tee output.2
+
+	grep -q "from checkpoint" output.2 || exit 1
+
+	count=`grep "deleted" output.2 | wc -l`
+	echo "+++++ $count files deleted +++++"
+
+	if [ $count -ne 6 ]
+	then
+		exit 1
+	fi
+
+	echo "+++++ truncating the checkpoint and deleting file.5 +++++"
+	head -c 100 test.jx.makeflowlog.checkpoint > checkpoint.tmp
+	mv checkpoint.tmp test.jx.makeflowlog.checkpoint
+	rm file.5
+
+	echo "+++++ third run: should ignore the checkpoint and rebuild 6 files +++++"
+	./makeflow --jx test.jx 2>&1 | tee output.3
+
+	grep -q "ignoring checkpoint" output.3 || exit 1
+
+	count=`grep "deleted" output.3 | wc -l`
+	echo "+++++ $count files deleted +++++"
+
+	if [ $count -ne 6 ]
+	then
+		exit 1
+	fi
+
+	echo "+++++ cleaning should remove the checkpoint with the log +++++"
+	./makeflow --jx --clean test.jx
+
+	if [ -f test.jx.makeflowlog.checkpoint ]
+	then
+		exit 1
+	fi
+
+	echo "+++++ fourth run: should not write a checkpoint when disabled +++++"
+	./makeflow --jx --log-checkpoint=0 test.jx | tee output.4
+
+	if [ -f test.jx.makeflowlog.checkpoint ]
+	then
+		exit 1
+	fi
+
+	exit 0
+}
+
+clean()
+{
+	rm -fr $test_dir $test_output
+	exit 0
+}
+
+dispatch "$@"
+
+# vim: set noexpandtab tabstop=4:
@@ -0,0 +1,71 @@
+#!/bin/sh
+
+# Measure how long makeflow takes to recover a large workflow after a
+# crash, replaying the whole log versus starting from a checkpoint.
+#
+# Usage: makeflow_restart_benchmark.sh [rules] [directory]
+#
+# A synthetic workflow of independent rules is generated along with a
+# log in which every rule has completed, so that each restart only
+# recovers, checks files, and finds nothing left to do.
+
+rules=${1:-100000}
+dir=${2:-makeflow_restart_benchmark.dir}
+makeflow=`cd \`dirname $0\`/../src && pwd`/makeflow
+
+mkdir -p $dir || exit 1
+cd $dir || exit 1
+
+echo "generating $rules rules..."
+
+awk -v n=$rules 'BEGIN {
+	for(i=0;i<n;i++) printf("out.%d: in.%d\n\tcp in.%d out.%d\n\n", i, i%100, i%100, i);
+}' > bench.mf
+
+awk 'BEGIN { for(i=0;i<100;i++) print "x" > ("in." i) }'
+awk -v n=$rules 'BEGIN { for(i=0;i<n;i++) { f = "out." i; printf("") > f; close(f) } }'
+
+# Log timestamps must be later than the files, or they look modified.
+sleep 1
+now=`date +%s`000000
+
+awk -v n=$rules -v t=$now 'BEGIN {
+	printf("# STARTED %s\n", t);
+	for(i=0;i<n;i++) {
+		printf("# FILE %s out.%d 1 0\n", t, i);
+		printf("%s %d 1 %d 0 1 0 0 0 %d\n", t, i, 1000+i, n);
+		printf("# FILE %s out.%d 2 1\n", t, i);
+		printf("%s %d 2 %d 0 0 1 0 0 %d\n", t, i, 1000+i, n);
+	}
+	printf("# COMPLETED %s\n", t);
+}' > bench.log
+
+# Time from the end of parsing to the start of the workflow,
+# which covers log recovery and the file consistency check.
+elapsed()
+{
+	stdbuf -oL "$@" 2>&1 | while read line
+	do
+		echo "`date +%s%N` $line"
+	done > bench.out
+	start=`grep "checking bench.mf for consistency" bench.out | cut -d " " -f 1`
+	stop=`grep "starting workflow" bench.out | cut -d " " -f 1`
+	echo $(( (stop-start)/1000000 ))
+}
+
+rm -f bench.mf.makeflowlog.checkpoint
+
+cp bench.log bench.mf.makeflowlog
+replay=`elapsed $makeflow --log-checkpoint=0 bench.mf`
+
+cp bench.log bench.mf.makeflowlog
+elapsed $makeflow bench.mf > /dev/null
+checkpoint=`elapsed $makeflow bench.mf`
+
+echo "rules:                        $rules"
+echo "recovery replaying the log:   $replay ms"
+echo "recovery from a checkpoint:   $checkpoint ms"
+echo "log size:                     `wc -c < bench.mf.makeflowlog` bytes"
+echo "checkpoint size:              `wc -c < bench.mf.makeflowlog.checkpoint` bytes"
+
+# vim: set noexpandtab tabstop=4:
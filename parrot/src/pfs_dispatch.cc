@@ -422,42 +422,48 @@ static int iovec_size( struct pfs_process *p, struct pfs_kernel_iovec *v, int co
 	return total;
 }
 
-static int iovec_copy_in( struct pfs_process *p, char *buf, struct pfs_kernel_iovec *v, int count )
+/*
+The tracee's iovecs are converted to native ones so that the
+whole list can be moved with a single scatter/gather copy.
+*/
+
+static struct iovec * iovec_native( struct pfs_kernel_iovec *v, int count )
 {
-	int i, pos=0;
-	for(i=0;i<count;i++) {
-		tracer_copy_in(p->tracer,&buf[pos],POINTER(v[i].iov_base),v[i].iov_len,0);
-		pos += v[i].iov_len;
+	struct iovec *nv = (struct iovec *) malloc(sizeof(struct iovec)*count);
+	if(nv) {
+		for(int i=0;i<count;i++) {
+			nv[i].iov_base = POINTER(v[i].iov_base);
+			nv[i].iov_len = v[i].iov_len;
+		}
 	}
-	return pos;
+	return nv;
+}
+
+static int iovec_copy_in( struct pfs_process *p, char *buf, struct pfs_kernel_iovec *v, int count )
+{
+	struct iovec *nv = iovec_native(v,count);
+	if(!nv) return -1;
+	ssize_t result = tracer_copy_inv(p->tracer,buf,nv,count,iovec_size(p,v,count),0);
+	free(nv);
+	return result;
 }
 
 static int iovec_copy_out( struct pfs_process *p, void *buf, struct pfs_kernel_iovec *v, int count, size_t total )
 {
-	int i = 0;
-	size_t current = 0;
-
-	while (current < total) {
-		if (v[i].iov_len <= (total-current)) {
-			tracer_copy_out(p->tracer,((char *)buf)+current,POINTER(v[i].iov_base),v[i].iov_len,0);
-			current += v[i].iov_len;
-			i += 1;
-		} else {
-			tracer_copy_out(p->tracer,((char *)buf)+current,POINTER(v[i].iov_base),total-current,0);
-			current += (total-current);
-			assert(current == total);
-		}
-	}
-	return current;
+	struct iovec *nv = iovec_native(v,count);
+	if(!nv) return -1;
+	ssize_t result = tracer_copy_outv(p->tracer,buf,nv,count,total,0);
+	free(nv);
+	return result;
 }
 
 /*
-Both readv and writev have a careful but inefficient implementation.
-For each uio block, we examine the data structures, do a manual
-read and write in our local buffer, and then copy the data over.
-I assume that these are not heavily used system calls, although
-they do seem to appear sporadically in X11, the dynamic linker,
-and sporadically in networking utilities.
+Both readv and writev do a single read or write through a local
+buffer as large as the whole uio list, and move the data between
+that buffer and the caller's blocks with one scatter/gather copy.
+These calls appear sporadically in X11, the dynamic linker, and
+networking utilities, but also in I/O libraries that issue large
+vectored requests.
 */
 
 static void decode_readv( struct pfs_process *p, int entering, INT64_T syscall, const INT64_T *args )
@@ -3612,7 +3618,7 @@ void pfs_dispatch32( struct pfs_process *p )
 	switch(p->state) {
 		case PFS_PROCESS_STATE_KERNEL:
 		case PFS_PROCESS_STATE_USER:
-			tracer_continue(p->tracer,0);
+			pfs_process_continue(p,0);
 			break;
 		default:
 			assert(0);
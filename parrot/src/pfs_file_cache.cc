@@ -16,12 +16,14 @@ extern "C" {
 #include "file_cache.h"
 #include "full_io.h"
 #include "hash_table.h"
+#include "macros.h"
 }
 
 #include <unistd.h>
 #include <fcntl.h>
 #include <string.h>
 #include <stdio.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/statfs.h>
 #include <errno.h>
@@ -32,6 +34,7 @@ extern "C" {
 extern struct file_cache *pfs_file_cache;
 extern int pfs_session_cache;
 extern int pfs_master_timeout;
+extern int pfs_block_cache;
 
 static struct hash_table * not_found_table = 0;
 
@@ -170,6 +173,292 @@ public:
 	}
 };
 
+/*
+Services that can read at any offset (pfs_service::has_ranges)
+are cached a block at a time instead of being copied whole before
+the first read.  Each remote file has two cache entries: a sparse
+data file of the full size, and a block map with one byte per block
+that is set once the block has been written into the data file.
+Both live in the shared cache directory and the map is mapped
+shared, so Parrot instances on the same node see each other's
+blocks.  A new map is always committed after its data file, and
+the map is always opened before the data file, so a map never
+describes blocks of a different data file.
+*/
+
+#define BLOCK_CACHE_BLOCK_SIZE (1024*1024)
+#define BLOCK_CACHE_WINDOW_MAX 16
+#define BLOCK_CACHE_MAGIC "pfsblk1"
+
+struct block_map_header {
+	char magic[8];
+	INT64_T size;
+	INT64_T block_size;
+};
+
+class pfs_file_blocks : public pfs_file
+{
+private:
+	int fd;
+	unsigned char *map;
+	size_t map_length;
+	unsigned char *present;
+	INT64_T size;
+	INT64_T nblocks;
+	INT64_T next_block;
+	int window;
+	time_t ctime;
+	ino_t inode;
+	pfs_file *rfile;
+	char data_path[PFS_PATH_MAX+8];
+
+	int fetch( INT64_T first, INT64_T last ) {
+		char *buffer;
+		INT64_T i;
+
+		if(!rfile) {
+			rfile = name.service->open(&name,O_RDONLY,0);
+			if(!rfile) return -1;
+		}
+
+		buffer = (char*) malloc(BLOCK_CACHE_BLOCK_SIZE);
+		if(!buffer) return -1;
+
+		debug(D_CACHE,"fetch %s blocks %lld-%lld",name.path,(long long)first,(long long)last-1);
+
+		for(i=first;i<last;i++) {
+			pfs_off_t offset = i*BLOCK_CACHE_BLOCK_SIZE;
+			pfs_size_t length = MIN(BLOCK_CACHE_BLOCK_SIZE,size-offset);
+			pfs_size_t actual = 0;
+
+			while(actual<length) {
+				pfs_ssize_t result = rfile->read(buffer+actual,length-actual,offset+actual);
+				if(result<=0) {
+					if(result==0) errno = EIO;
+					free(buffer);
+					return -1;
+				}
+				actual += result;
+			}
+
+			if(full_pwrite64(fd,buffer,length,offset)!=length) {
+				free(buffer);
+				return -1;
+			}
+			present[i] = 1;
+		}
+
+		free(buffer);
+		return 0;
+	}
+
+	int fetch_range( INT64_T first, INT64_T last, INT64_T readahead ) {
+		INT64_T i = first;
+
+		while(i<last) {
+			if(present[i]) {
+				i++;
+				continue;
+			}
+			INT64_T end = i;
+			while(end<last && !present[end]) end++;
+			if(end==last) {
+				while(end<nblocks && end<last+readahead && !present[end]) end++;
+			}
+			if(fetch(i,end)<0) return -1;
+			i = end;
+		}
+		return 0;
+	}
+
+public:
+	pfs_file_blocks( pfs_name *n, int f, unsigned char *m, INT64_T s, time_t c, ino_t in, const char *d ) : pfs_file(n) {
+		fd = f;
+		map = m;
+		size = s;
+		nblocks = (s+BLOCK_CACHE_BLOCK_SIZE-1)/BLOCK_CACHE_BLOCK_SIZE;
+		map_length = sizeof(struct block_map_header)+nblocks;
+		present = m+sizeof(struct block_map_header);
+		next_block = 0;
+		window = 1;
+		ctime = c;
+		inode = in;
+		rfile = 0;
+		strcpy(data_path,d);
+	}
+
+	virtual int close() {
+		if(rfile) {
+			rfile->close();
+			delete rfile;
+		}
+		munmap(map,map_length);
+		::close(fd);
+		return 0;
+	}
+
+	virtual pfs_ssize_t read( void *d, pfs_size_t length, pfs_off_t offset ) {
+		INT64_T first, last;
+
+		if(offset>=size) return 0;
+		length = MIN(length,size-offset);
+		if(length<=0) return 0;
+
+		first = offset/BLOCK_CACHE_BLOCK_SIZE;
+		last = (offset+length-1)/BLOCK_CACHE_BLOCK_SIZE+1;
+
+		/* Read ahead further the longer the program reads sequentially. */
+		if(first==next_block || first==next_block-1) {
+			window = MIN(window*2,BLOCK_CACHE_WINDOW_MAX);
+		} else {
+			window = 1;
+		}
+		next_block = last;
+
+		if(fetch_range(first,last,window-1)<0) return -1;
+
+		return ::full_pread64(fd,d,length,offset);
+	}
+
+	virtual int fstat( struct pfs_stat *buf ) {
+		int result;
+		struct stat64 lbuf;
+		result = ::fstat64(fd,&lbuf);
+		if(result>=0) {
+			COPY_STAT(lbuf,*buf);
+			buf->st_size = size;
+			buf->st_ctime = ctime;
+			buf->st_ino = inode;
+		}
+		return result;
+	}
+
+	virtual int fstatfs( struct pfs_statfs *buf ) {
+		struct statfs64 lbuf;
+		int result = ::fstatfs64(fd,&lbuf);
+		if(result>=0){
+				COPY_STATFS(lbuf,*buf);
+		}
+		return result;
+	}
+
+	virtual pfs_ssize_t get_size() {
+		return size;
+	}
+
+	/* A local name is only useful once every block is present. */
+	virtual int get_local_name( char *n ) {
+		if(fetch_range(0,nblocks,0)<0) return -1;
+		return file_cache_contains(pfs_file_cache,data_path,n);
+	}
+
+	virtual int is_seekable() {
+		return 1;
+	}
+};
+
+static int block_map_check( int fd, INT64_T size, INT64_T *actual_size )
+{
+	struct block_map_header header;
+
+	if(full_pread64(fd,&header,sizeof(header),0)!=sizeof(header)) return 0;
+	if(memcmp(header.magic,BLOCK_CACHE_MAGIC,sizeof(header.magic))) return 0;
+	if(header.block_size!=BLOCK_CACHE_BLOCK_SIZE) return 0;
+	if(size>=0 && header.size!=size) return 0;
+
+	*actual_size = header.size;
+	return 1;
+}
+
+/*
+Open the block map and data file for a remote file of the given size.
+If size is negative, any existing entry is accepted as it stands.
+*/
+
+static pfs_file * pfs_block_cache_open( pfs_name *name, INT64_T size, time_t ctime, ino_t inode )
+{
+	char data_path[PFS_PATH_MAX+8];
+	char map_path[PFS_PATH_MAX+8];
+	char lpath[PFS_PATH_MAX];
+	int mfd, dfd = -1;
+
+	snprintf(data_path,sizeof(data_path),"%s#data",name->path);
+	snprintf(map_path,sizeof(map_path),"%s#map",name->path);
+
+	mfd = file_cache_open(pfs_file_cache,map_path,O_RDWR,lpath,0,0);
+	if(mfd>=0) {
+		INT64_T actual_size;
+		if(block_map_check(mfd,size,&actual_size)) {
+			size = actual_size;
+			dfd = file_cache_open(pfs_file_cache,data_path,O_RDWR,lpath,size,0);
+		} else {
+			debug(D_CACHE,"stale block map for %s",name->path);
+		}
+		if(dfd<0) {
+			::close(mfd);
+			mfd = -1;
+		}
+	}
+
+	if(mfd<0) {
+		struct block_map_header header;
+		char dtxn[PFS_PATH_MAX];
+		char mtxn[PFS_PATH_MAX];
+
+		if(size<0) {
+			errno = ENOENT;
+			return 0;
+		}
+
+		debug(D_CACHE,"creating block map for %s",name->path);
+
+		dfd = file_cache_begin(pfs_file_cache,data_path,dtxn);
+		if(dfd<0) return 0;
+
+		mfd = file_cache_begin(pfs_file_cache,map_path,mtxn);
+		if(mfd<0) {
+			::close(dfd);
+			file_cache_abort(pfs_file_cache,data_path,dtxn);
+			return 0;
+		}
+
+		memset(&header,0,sizeof(header));
+		memcpy(header.magic,BLOCK_CACHE_MAGIC,sizeof(header.magic));
+		header.size = size;
+		header.block_size = BLOCK_CACHE_BLOCK_SIZE;
+
+		INT64_T nblocks = (size+BLOCK_CACHE_BLOCK_SIZE-1)/BLOCK_CACHE_BLOCK_SIZE;
+
+		if(::ftruncate64(dfd,size)<0
+			|| full_pwrite64(mfd,&header,sizeof(header),0)!=sizeof(header)
+			|| ::ftruncate64(mfd,sizeof(header)+nblocks)<0
+			|| file_cache_commit(pfs_file_cache,data_path,dtxn)<0) {
+			::close(dfd);
+			::close(mfd);
+			file_cache_abort(pfs_file_cache,data_path,dtxn);
+			file_cache_abort(pfs_file_cache,map_path,mtxn);
+			return 0;
+		}
+
+		if(file_cache_commit(pfs_file_cache,map_path,mtxn)<0) {
+			::close(dfd);
+			::close(mfd);
+			file_cache_abort(pfs_file_cache,map_path,mtxn);
+			return 0;
+		}
+	}
+
+	size_t map_length = sizeof(struct block_map_header)+(size+BLOCK_CACHE_BLOCK_SIZE-1)/BLOCK_CACHE_BLOCK_SIZE;
+	void *map = ::mmap(0,map_length,PROT_READ|PROT_WRITE,MAP_SHARED,mfd,0);
+	::close(mfd);
+	if(map==MAP_FAILED) {
+		::close(dfd);
+		return 0;
+	}
+
+	return new pfs_file_blocks(name,dfd,(unsigned char*)map,size,ctime,inode,data_path);
+}
+
 pfs_file * pfs_cache_open( pfs_name *name, int flags, mode_t mode )
 {
 	struct pfs_stat buf;
@@ -185,6 +474,25 @@ pfs_file * pfs_cache_open( pfs_name *name, int flags, mode_t mode )
 	buf.st_size = 0;
 	buf.st_ino = hash_string(name->rest);
 
+	if(pfs_block_cache && name->service->has_ranges() && (flags&O_ACCMODE)==O_RDONLY && !(flags&(O_CREAT|O_TRUNC))) {
+		if(pfs_session_cache) {
+			if(!not_found_table) not_found_table = hash_table_create(0,0);
+			if(hash_table_lookup(not_found_table,name->path)) {
+				errno = ENOENT;
+				return 0;
+			}
+			result = pfs_block_cache_open(name,-1,buf.st_ctime,buf.st_ino);
+			if(result) return result;
+		}
+		if(name->service->stat(name,&buf)!=0) {
+			if(pfs_session_cache && errno==ENOENT) {
+				hash_table_insert(not_found_table,name->path,(void*)1);
+			}
+			return 0;
+		}
+		return pfs_block_cache_open(name,buf.st_size,buf.st_ctime,buf.st_ino);
+	}
+
 	if(pfs_session_cache) {
 		if(!not_found_table) not_found_table = hash_table_create(0,0);
 
@@ -292,6 +600,11 @@ int pfs_cache_invalidate( pfs_name *name )
 			if(!not_found_table) not_found_table = hash_table_create(0,0);
 			hash_table_remove(not_found_table,name->path);
 		}
+		char block_path[PFS_PATH_MAX+8];
+		snprintf(block_path,sizeof(block_path),"%s#map",name->path);
+		file_cache_delete(pfs_file_cache,block_path);
+		snprintf(block_path,sizeof(block_path),"%s#data",name->path);
+		file_cache_delete(pfs_file_cache,block_path);
 		return file_cache_delete(pfs_file_cache,name->path);
 	} else {
 		return 0;
@@ -9,6 +9,7 @@ See the file COPYING for details.
 #include "pfs_channel.h"
 #include "pfs_critical.h"
 #include "pfs_dispatch.h"
+#include "pfs_metadata_cache.h"
 #include "pfs_paranoia.h"
 #include "pfs_process.h"
 #include "pfs_service.h"
@@ -98,7 +99,10 @@ int pfs_use_helper = 0;
 int pfs_checksum_files = 1;
 int pfs_write_rval = 0;
 int pfs_no_flock = 0;
+int pfs_block_cache = 1;
+int pfs_metadata_ttl = 0;
 int pfs_paranoid_mode = 0;
+int pfs_use_seccomp = 0;
 const char *pfs_write_rval_file = "parrot.rval";
 int pfs_enable_small_file_optimizations = 1;
 int set_foreground = 1;
@@ -140,6 +144,7 @@ struct jx *pfs_cvmfs_options = NULL;
 
 int pfs_irods_debug_level = 0;
 char *stats_file = NULL;
+char *metadata_cache_file = NULL;
 
 int parrot_fd_max = -1;
 int parrot_fd_start = -1;
@@ -179,6 +184,10 @@ enum {
 	LONG_OPT_STATS_FILE,
 	LONG_OPT_DISABLE_SERVICE,
 	LONG_OPT_NO_FLOCK,
+	LONG_OPT_NO_BLOCK_CACHE,
+	LONG_OPT_METADATA_TTL,
+	LONG_OPT_METADATA_CACHE_FILE,
+	LONG_OPT_SECCOMP,
 	LONG_OPT_EXT_IMAGE,
 };
 
@@ -289,6 +298,10 @@ static void show_help( const char *cmd )
 	printf( " %-30s Enable automatic decompression on .gz files.\n", "-Z,--auto-decompress");
 	printf( " %-30s Disable the given service.\n", "--disable-service");
 	printf( " %-30s Make flock a no-op.\n", "--no-flock");
+	printf( " %-30s Copy whole HTTP files into the cache instead of single blocks.\n", "--no-block-cache");
+	printf( " %-30s Cache remote metadata for this many seconds.(PARROT_METADATA_TTL)\n", "--metadata-ttl=<secs>");
+	printf( " %-30s Load and save the metadata cache in this file.\n", "--metadata-cache-file=<file>");
+	printf( " %-30s Let system calls that Parrot ignores run without stopping.\n", "--seccomp");
 	printf("\n");
 	printf("Filesystem Options:\n");
 	printf( " %-30s Mount a read-only ext[234] disk image.\n", "--ext <image>=<mountpoint>");
@@ -398,6 +411,9 @@ static void handle_event( pid_t pid, int status, struct rusage *usage )
 	if (WIFSTOPPED(status) && WSTOPSIG(status) == (SIGTRAP|0x80)) {
 		/* The common case, a syscall delivery stop. */
 		pfs_dispatch(p);
+	} else if (status>>8 == (SIGTRAP | (PTRACE_EVENT_SECCOMP<<8))) {
+		/* With --seccomp, the filter stops a syscall we must see on entry. */
+		pfs_dispatch(p);
 	} else if (status>>8 == (SIGTRAP | (PTRACE_EVENT_CLONE<<8)) || status>>8 == (SIGTRAP | (PTRACE_EVENT_FORK<<8)) || status>>8 == (SIGTRAP | (PTRACE_EVENT_VFORK<<8))) {
 		pid_t cpid;
 		struct pfs_process *child;
@@ -416,11 +432,11 @@ static void handle_event( pid_t pid, int status, struct rusage *usage )
 		}
 		child = pfs_process_create(cpid,p,p->syscall_args[0]&CLONE_THREAD,clone_files);
 		child->syscall_result = 0;
-		if (tracer_continue(p->tracer,0) == -1) /* child starts stopped. */
+		if (pfs_process_continue(p,0) == -1) /* child starts stopped. */
 			return;
 	} else if (status>>8 == (SIGTRAP | (PTRACE_EVENT_EXEC<<8))) {
 		pfs_process_exec(p);
-		if (tracer_continue(p->tracer,0) == -1)
+		if (pfs_process_continue(p,0) == -1)
 			return;
 	} else if (status>>8 == (SIGTRAP | (PTRACE_EVENT_EXIT<<8)) || WIFEXITED(status) || WIFSIGNALED(status)) {
 		/* In my own testing, if we use PTRACE_O_TRACEEXIT then we never get
@@ -462,7 +478,7 @@ static void handle_event( pid_t pid, int status, struct rusage *usage )
 			 *     PTRACE_SEIZE was used.
 			 */
 			debug(D_DEBUG, "%d received PTRACE_EVENT_STOP, continuing...", (int)pid);
-			if (tracer_continue(p->tracer, 0) == -1)
+			if (pfs_process_continue(p, 0) == -1)
 				return;
 		} else if((linux_available(3,4,0) && ((status>>16) == PTRACE_EVENT_STOP)) || (!linux_available(3,4,0) && SIG_ISSTOP(signum) && ptrace(PTRACE_GETSIGINFO, pid, 0, &info) == -1 && errno == EINVAL)) {
 			/* group-stop, `man ptrace` for more information */
@@ -516,7 +532,7 @@ static void handle_event( pid_t pid, int status, struct rusage *usage )
 					break;
 				}
 			}
-			if (tracer_continue(p->tracer,signum) == -1) /* deliver (or not) the signal */
+			if (pfs_process_continue(p,signum) == -1) /* deliver (or not) the signal */
 				return;
 		}
 	} else {
@@ -726,6 +742,9 @@ int main( int argc, char *argv[] )
 	s = getenv("PARROT_SESSION_CACHE");
 	if(s) pfs_session_cache = 1;
 
+	s = getenv("PARROT_METADATA_TTL");
+	if(s) pfs_metadata_ttl = atoi(s);
+
 	s = getenv("PARROT_HOST_NAME");
 	if(s) pfs_false_uname = xxstrdup(pfs_false_uname);
 
@@ -839,6 +858,8 @@ int main( int argc, char *argv[] )
 		{"helper", no_argument, 0, LONG_OPT_HELPER},
 		{"hostname", required_argument, 0, 'N'},
 		{"ld-path", required_argument, 0, 'l'},
+		{"metadata-cache-file", required_argument, 0, LONG_OPT_METADATA_CACHE_FILE},
+		{"metadata-ttl", required_argument, 0, LONG_OPT_METADATA_TTL},
 		{"mount", required_argument, 0, 'M'},
 		{"name-list", required_argument, 0, 'n'},
 		{"no-checksums", no_argument, 0, 'k'},
@@ -846,6 +867,7 @@ int main( int argc, char *argv[] )
 		{"no-follow-symlinks", no_argument, 0, 'f'},
 		{"no-helper", no_argument, 0, 'H'},
 		{"no-optimize", no_argument, 0, 'D'},
+		{"no-block-cache", no_argument, 0, LONG_OPT_NO_BLOCK_CACHE},
 		{"no-flock", no_argument, 0, LONG_OPT_NO_FLOCK},
 		{"no-set-foreground", no_argument, 0, LONG_OPT_NO_SET_FOREGROUND},
 		{"paranoid", no_argument, 0, 'P'},
@@ -854,6 +876,7 @@ int main( int argc, char *argv[] )
 		{"pid-warp", no_argument, 0, LONG_OPT_PID_WARP},
 		{"proxy", required_argument, 0, 'p'},
 		{"root-checksum", required_argument, 0, 'R'},
+		{"seccomp", no_argument, 0, LONG_OPT_SECCOMP},
 		{"session-caching", no_argument, 0, 'S'},
 		{"stats-file", required_argument, 0, LONG_OPT_STATS_FILE},
 		{"status-file", required_argument, 0, 'c'},
@@ -1130,6 +1153,19 @@ int main( int argc, char *argv[] )
 		case LONG_OPT_NO_FLOCK:
 			pfs_no_flock = 1;
 			break;
+		case LONG_OPT_NO_BLOCK_CACHE:
+			pfs_block_cache = 0;
+			break;
+		case LONG_OPT_METADATA_TTL:
+			pfs_metadata_ttl = atoi(optarg);
+			break;
+		case LONG_OPT_METADATA_CACHE_FILE:
+			free(metadata_cache_file);
+			metadata_cache_file = xxstrdup(optarg);
+			break;
+		case LONG_OPT_SECCOMP:
+			pfs_use_seccomp = 1;
+			break;
 		case LONG_OPT_EXT_IMAGE: {
 			char service[128];
 			char image[PATH_MAX] = {0};
@@ -1200,6 +1236,20 @@ int main( int argc, char *argv[] )
 
 	get_linux_version(argv[0]);
 
+	if(pfs_use_seccomp) {
+		/* Before 4.8, the kernel reports a syscall-enter-stop after the
+		 * seccomp stop, which the dispatcher does not expect. */
+		if(!linux_available(4,8,0)) {
+			debug(D_NOTICE,"--seccomp requires Linux 4.8 or later, ignoring it");
+			pfs_use_seccomp = 0;
+		} else if(valgrind) {
+			debug(D_NOTICE,"--seccomp cannot be used with --valgrind, ignoring it");
+			pfs_use_seccomp = 0;
+		} else {
+			tracer_filter_enable();
+		}
+	}
+
 	if (envlist[0]) {
 		extern char **environ;
 		if(access(envlist, F_OK) == 0)
@@ -1234,6 +1284,10 @@ int main( int argc, char *argv[] )
 	if(!pfs_file_cache) fatal("couldn't setup cache in %s: %s\n",pfs_temp_dir,strerror(errno));
 	file_cache_cleanup(pfs_file_cache);
 
+	if(metadata_cache_file && pfs_metadata_ttl>0) {
+		pfs_metadata_load(metadata_cache_file);
+	}
+
 	string_nformat(pfs_cvmfs_locks_dir, sizeof(pfs_cvmfs_locks_dir), "%s/cvmfs_locks_XXXXXX", pfs_temp_per_instance_dir);
 
 	if(mkdtemp(pfs_cvmfs_locks_dir) == NULL)
@@ -1338,6 +1392,10 @@ int main( int argc, char *argv[] )
 			signal(SIGUSR1, set_attached_and_ready);
 			raise(SIGSTOP); /* synchronize with parent, above */
 			while (!attached_and_ready) ; /* spin waiting to be traced (NO SLEEPING/STOPPING) */
+			if (pfs_use_seccomp && tracer_filter_install() == -1) {
+				fprintf(stderr, "unable to install seccomp filter: %s\n", strerror(errno));
+				_exit(1);
+			}
 			execvp(argv[optind],&argv[optind]);
 		}
 		fprintf(stderr, "unable to execute %s: %s\n", argv[optind], strerror(errno));
@@ -1465,6 +1523,10 @@ int main( int argc, char *argv[] )
 		fclose(namelist_file);
 	}
 
+	if(metadata_cache_file && pfs_metadata_ttl>0) {
+		pfs_metadata_save(metadata_cache_file);
+	}
+
 	if (stats_file) {
 		jx_pretty_print_stream(stats_get(), stats_out);
 		fprintf(stats_out, "\n");
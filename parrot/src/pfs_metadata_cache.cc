@@ -0,0 +1,514 @@
+/*
+Copyright (C) 2005- The University of Notre Dame
+This software is distributed under the GNU General Public License.
+See the file COPYING for details.
+*/
+
+/*
+Programs such as Python and ROOT probe many names that do not exist
+while starting up, and every probe of a remote name costs a readlink
+and a stat on the server.  This cache remembers the answers to stat,
+lstat, readlink and directory listings, including failures, for
+pfs_metadata_ttl seconds.  A cached listing also answers for its
+children: a name missing from the listing of its parent does not exist.
+
+There is one table per Parrot, so it is shared by every traced process.
+If a cache file is given, unexpired entries are loaded at startup and
+written back at exit, so that later runs on the same node start warm.
+Changes made through Parrot invalidate the affected entries, but changes
+made by others are only seen once the entries expire.
+*/
+
+#include "pfs_metadata_cache.h"
+#include "pfs_dir.h"
+#include "pfs_service.h"
+
+extern "C" {
+#include "debug.h"
+#include "hash_table.h"
+#include "list.h"
+#include "macros.h"
+#include "path.h"
+#include "stats.h"
+#include "stringtools.h"
+#include "xxmalloc.h"
+}
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+extern int pfs_metadata_ttl;
+
+#define KIND_STAT     'S'
+#define KIND_LSTAT    'L'
+#define KIND_READLINK 'R'
+#define KIND_LISTING  'D'
+
+#define METADATA_FILE_MAGIC "pfsmeta1"
+
+/* Largest entry accepted from a cache file: a listing of some 200,000 names. */
+#define METADATA_LENGTH_MAX (64*1024*1024)
+
+struct metadata_entry {
+	time_t expires;
+	int error;
+	struct pfs_stat buf;
+	size_t length;
+	char *data;                 /* link target, or an array of struct dirent */
+	struct hash_table *names;   /* names in a listing */
+};
+
+static struct hash_table *table = 0;
+
+static void entry_delete( struct metadata_entry *e )
+{
+	if(e->names) hash_table_delete(e->names);
+	free(e->data);
+	free(e);
+}
+
+static void make_key( char *key, char kind, const char *path )
+{
+	key[0] = kind;
+	strcpy(&key[1],path);
+}
+
+static struct metadata_entry * entry_lookup( char kind, const char *path )
+{
+	char key[PFS_PATH_MAX+1];
+	struct metadata_entry *e;
+
+	if(!table) return 0;
+
+	make_key(key,kind,path);
+	e = (struct metadata_entry *) hash_table_lookup(table,key);
+	if(e && e->expires<time(0)) {
+		hash_table_remove(table,key);
+		entry_delete(e);
+		e = 0;
+	}
+	return e;
+}
+
+static void entry_index( struct metadata_entry *e )
+{
+	size_t i;
+	struct dirent *d = (struct dirent *) e->data;
+
+	e->names = hash_table_create(0,0);
+	for(i=0;i<e->length/sizeof(struct dirent);i++) {
+		hash_table_insert(e->names,d[i].d_name,(void*)1);
+	}
+}
+
+static void entry_insert( char kind, const char *path, struct metadata_entry *e )
+{
+	char key[PFS_PATH_MAX+1];
+	struct metadata_entry *old;
+
+	if(!table) table = hash_table_create(0,0);
+
+	make_key(key,kind,path);
+	old = (struct metadata_entry *) hash_table_remove(table,key);
+	if(old) entry_delete(old);
+	hash_table_insert(table,key,e);
+}
+
+static struct metadata_entry * entry_create( int error, const struct pfs_stat *buf, const void *data, size_t length )
+{
+	struct metadata_entry *e = (struct metadata_entry *) xxcalloc(1,sizeof(*e));
+	e->expires = time(0)+pfs_metadata_ttl;
+	e->error = error;
+	if(buf) e->buf = *buf;
+	if(data) {
+		e->data = (char *) xxmalloc(length+1);
+		memcpy(e->data,data,length);
+		e->data[length] = 0;
+		e->length = length;
+	}
+	return e;
+}
+
+static int is_cacheable( pfs_name *name )
+{
+	return pfs_metadata_ttl>0 && name->service->metadata_is_cacheable();
+}
+
+/* Only definite answers are kept; a timeout says nothing about the name. */
+static int is_definite( int error )
+{
+	return error==ENOENT || error==ENOTDIR || error==EINVAL;
+}
+
+static int known_missing( const char *path )
+{
+	char parent[PFS_PATH_MAX];
+	struct metadata_entry *e;
+
+	path_dirname(path,parent);
+	e = entry_lookup(KIND_LISTING,parent);
+	if(!e || e->error) return 0;
+
+	return !hash_table_lookup(e->names,path_basename(path));
+}
+
+static int cached_stat( pfs_name *name, struct pfs_stat *buf, char kind )
+{
+	struct metadata_entry *e;
+	int result;
+
+	if(!is_cacheable(name)) {
+		return kind==KIND_STAT ? name->service->stat(name,buf) : name->service->lstat(name,buf);
+	}
+
+	e = entry_lookup(kind,name->path);
+	if(e) {
+		stats_inc("parrot.metadata.hit",1);
+		if(e->error) {
+			errno = e->error;
+			return -1;
+		}
+		*buf = e->buf;
+		return 0;
+	}
+
+	if(known_missing(name->path)) {
+		stats_inc("parrot.metadata.hit",1);
+		errno = ENOENT;
+		return -1;
+	}
+
+	stats_inc("parrot.metadata.miss",1);
+	result = kind==KIND_STAT ? name->service->stat(name,buf) : name->service->lstat(name,buf);
+	if(result==0) {
+		entry_insert(kind,name->path,entry_create(0,buf,0,0));
+	} else if(is_definite(errno)) {
+		int save_errno = errno;
+		entry_insert(kind,name->path,entry_create(errno,0,0,0));
+		errno = save_errno;
+	}
+	return result;
+}
+
+int pfs_metadata_stat( pfs_name *name, struct pfs_stat *buf )
+{
+	return cached_stat(name,buf,KIND_STAT);
+}
+
+int pfs_metadata_lstat( pfs_name *name, struct pfs_stat *buf )
+{
+	return cached_stat(name,buf,KIND_LSTAT);
+}
+
+int pfs_metadata_readlink( pfs_name *name, char *buf, pfs_size_t size )
+{
+	struct metadata_entry *e;
+	int result;
+
+	if(!is_cacheable(name)) return name->service->readlink(name,buf,size);
+
+	e = entry_lookup(KIND_READLINK,name->path);
+	if(e) {
+		stats_inc("parrot.metadata.hit",1);
+		if(e->error) {
+			errno = e->error;
+			return -1;
+		}
+		result = MIN((pfs_size_t)e->length,size);
+		memcpy(buf,e->data,result);
+		return result;
+	}
+
+	if(known_missing(name->path)) {
+		stats_inc("parrot.metadata.hit",1);
+		errno = ENOENT;
+		return -1;
+	}
+
+	/* Ask for the whole target so that any later caller can be answered. */
+	char target[PFS_PATH_MAX];
+	stats_inc("parrot.metadata.miss",1);
+	result = name->service->readlink(name,target,sizeof(target));
+	if(result>=0) {
+		entry_insert(KIND_READLINK,name->path,entry_create(0,0,target,result));
+		result = MIN(result,size);
+		memcpy(buf,target,result);
+	} else if(is_definite(errno)) {
+		int save_errno = errno;
+		entry_insert(KIND_READLINK,name->path,entry_create(errno,0,0,0));
+		errno = save_errno;
+	}
+	return result;
+}
+
+static pfs_dir * listing_to_dir( pfs_name *name, struct metadata_entry *e )
+{
+	pfs_dir *dir = new pfs_dir(name);
+	struct dirent *d = (struct dirent *) e->data;
+	size_t i;
+
+	for(i=0;i<e->length/sizeof(struct dirent);i++) {
+		dir->append(&d[i]);
+	}
+	return dir;
+}
+
+pfs_dir * pfs_metadata_getdir( pfs_name *name )
+{
+	struct metadata_entry *e;
+	pfs_dir *dir;
+
+	if(!is_cacheable(name)) return name->service->getdir(name);
+
+	e = entry_lookup(KIND_LISTING,name->path);
+	if(e) {
+		stats_inc("parrot.metadata.hit",1);
+		if(e->error) {
+			errno = e->error;
+			return 0;
+		}
+		return listing_to_dir(name,e);
+	}
+
+	if(known_missing(name->path)) {
+		stats_inc("parrot.metadata.hit",1);
+		errno = ENOENT;
+		return 0;
+	}
+
+	stats_inc("parrot.metadata.miss",1);
+	dir = name->service->getdir(name);
+	if(!dir) {
+		if(is_definite(errno)) {
+			int save_errno = errno;
+			entry_insert(KIND_LISTING,name->path,entry_create(errno,0,0,0));
+			errno = save_errno;
+		}
+		return 0;
+	}
+
+	/*
+	Copy the listing out, then hand back a fresh directory built from
+	the copy, since reading a pfs_dir to its end changes its state.
+	*/
+
+	struct dirent *entries = 0;
+	size_t count = 0, allocated = 0;
+	pfs_off_t offset = 0, next_offset;
+	struct dirent *d;
+
+	while((d = dir->fdreaddir(offset,&next_offset))) {
+		if(count==allocated) {
+			allocated = allocated ? allocated*2 : 64;
+			entries = (struct dirent *) xxrealloc(entries,allocated*sizeof(struct dirent));
+		}
+		entries[count++] = *d;
+		offset = next_offset;
+	}
+	dir->close();
+	delete dir;
+
+	e = entry_create(0,0,entries,count*sizeof(struct dirent));
+	entry_index(e);
+	entry_insert(KIND_LISTING,name->path,e);
+	free(entries);
+
+	return listing_to_dir(name,e);
+}
+
+int pfs_metadata_may_exist( pfs_name *name )
+{
+	struct metadata_entry *e;
+
+	if(!is_cacheable(name)) return 1;
+
+	e = entry_lookup(KIND_STAT,name->path);
+	if(!e) e = entry_lookup(KIND_LSTAT,name->path);
+
+	if((e && e->error==ENOENT) || (!e && known_missing(name->path))) {
+		stats_inc("parrot.metadata.hit",1);
+		errno = ENOENT;
+		return 0;
+	}
+
+	return 1;
+}
+
+static void remove_key( char kind, const char *path )
+{
+	char key[PFS_PATH_MAX+1];
+	struct metadata_entry *e;
+
+	make_key(key,kind,path);
+	e = (struct metadata_entry *) hash_table_remove(table,key);
+	if(e) entry_delete(e);
+}
+
+void pfs_metadata_invalidate( pfs_name *name )
+{
+	char parent[PFS_PATH_MAX];
+
+	if(!table) return;
+
+	remove_key(KIND_STAT,name->path);
+	remove_key(KIND_LSTAT,name->path);
+	remove_key(KIND_READLINK,name->path);
+	remove_key(KIND_LISTING,name->path);
+
+	path_dirname(name->path,parent);
+	remove_key(KIND_STAT,parent);
+	remove_key(KIND_LSTAT,parent);
+	remove_key(KIND_LISTING,parent);
+}
+
+void pfs_metadata_invalidate_tree( pfs_name *name )
+{
+	struct list *keys;
+	struct metadata_entry *e;
+	char *key;
+	size_t length;
+
+	pfs_metadata_invalidate(name);
+
+	if(!table) return;
+
+	/* Entries cannot be removed while walking the table, so collect the keys first. */
+	length = strlen(name->path);
+	while(length>0 && name->path[length-1]=='/') length--;
+
+	keys = list_create();
+	hash_table_firstkey(table);
+	while(hash_table_nextkey(table,&key,(void**)&e)) {
+		if(!strncmp(&key[1],name->path,length) && key[1+length]=='/') {
+			list_push_tail(keys,xxstrdup(key));
+		}
+	}
+
+	while((key = (char *) list_pop_head(keys))) {
+		e = (struct metadata_entry *) hash_table_remove(table,key);
+		if(e) entry_delete(e);
+		free(key);
+	}
+	list_delete(keys);
+}
+
+/*
+The cache file is a private binary format: a magic string, then for
+each entry its fixed-size part, its key and its data.  It is only
+meant to be read back by the same build of Parrot on the same node.
+*/
+
+struct metadata_record {
+	INT64_T expires;
+	INT32_T error;
+	INT32_T keylength;
+	INT64_T length;
+	struct pfs_stat buf;
+};
+
+int pfs_metadata_load( const char *filename )
+{
+	char magic[sizeof(METADATA_FILE_MAGIC)];
+	struct metadata_record r;
+	char key[PFS_PATH_MAX+1];
+	time_t now = time(0);
+	int count = 0;
+
+	FILE *file = fopen(filename,"r");
+	if(!file) return -1;
+
+	if(fread(magic,sizeof(magic),1,file)!=1 || memcmp(magic,METADATA_FILE_MAGIC,sizeof(magic))) {
+		debug(D_NOTICE,"ignoring metadata cache %s: unknown format",filename);
+		fclose(file);
+		return -1;
+	}
+
+	while(fread(&r,sizeof(r),1,file)==1) {
+		if(r.keylength<2 || r.keylength>PFS_PATH_MAX || r.length<0) break;
+		if(fread(key,r.keylength,1,file)!=1) break;
+		key[r.keylength] = 0;
+
+		if(r.length>METADATA_LENGTH_MAX) {
+			debug(D_NOTICE,"ignoring metadata cache entry for %s: %lld bytes is too large",&key[1],(long long)r.length);
+			if(fseek(file,r.length,SEEK_CUR)!=0) break;
+			continue;
+		}
+
+		char *data = (char *) xxmalloc(r.length+1);
+		if(r.length>0 && fread(data,r.length,1,file)!=1) {
+			free(data);
+			break;
+		}
+
+		if(r.expires>=now) {
+			struct metadata_entry *e = entry_create(r.error,&r.buf,r.length ? data : 0,r.length);
+			e->expires = r.expires;
+			if(key[0]==KIND_LISTING && !e->error) entry_index(e);
+			entry_insert(key[0],&key[1],e);
+			count++;
+		}
+		free(data);
+	}
+
+	fclose(file);
+	debug(D_CACHE,"loaded %d metadata entries from %s",count,filename);
+	return count;
+}
+
+int pfs_metadata_save( const char *filename )
+{
+	char tmpname[PFS_PATH_MAX];
+	struct metadata_entry *e;
+	time_t now = time(0);
+	char *key;
+	FILE *file;
+	int fd;
+
+	if(!table) return 0;
+
+	string_nformat(tmpname,sizeof(tmpname),"%s.XXXXXX",filename);
+	fd = mkstemp(tmpname);
+	if(fd<0) {
+		debug(D_NOTICE,"couldn't save metadata cache %s: %s",filename,strerror(errno));
+		return -1;
+	}
+
+	file = fdopen(fd,"w");
+	if(!file) {
+		debug(D_NOTICE,"couldn't save metadata cache %s: %s",filename,strerror(errno));
+		close(fd);
+		unlink(tmpname);
+		return -1;
+	}
+
+	fwrite(METADATA_FILE_MAGIC,sizeof(METADATA_FILE_MAGIC),1,file);
+
+	hash_table_firstkey(table);
+	while(hash_table_nextkey(table,&key,(void**)&e)) {
+		struct metadata_record r;
+		if(e->expires<now || e->length>METADATA_LENGTH_MAX) continue;
+		memset(&r,0,sizeof(r));
+		r.expires = e->expires;
+		r.error = e->error;
+		r.keylength = strlen(key);
+		r.length = e->length;
+		r.buf = e->buf;
+		fwrite(&r,sizeof(r),1,file);
+		fwrite(key,r.keylength,1,file);
+		if(e->length) fwrite(e->data,e->length,1,file);
+	}
+
+	if(fclose(file)!=0 || rename(tmpname,filename)!=0) {
+		debug(D_NOTICE,"couldn't save metadata cache %s: %s",filename,strerror(errno));
+		unlink(tmpname);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* vim: set noexpandtab tabstop=4: */
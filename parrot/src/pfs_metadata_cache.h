@@ -0,0 +1,39 @@
+/*
+Copyright (C) 2005- The University of Notre Dame
+This software is distributed under the GNU General Public License.
+See the file COPYING for details.
+*/
+
+#ifndef PFS_METADATA_CACHE_H
+#define PFS_METADATA_CACHE_H
+
+#include "pfs_name.h"
+#include "pfs_types.h"
+
+class pfs_dir;
+
+/*
+These wrap the metadata calls of a pfs_service.  For services that
+return true from metadata_is_cacheable(), and while pfs_metadata_ttl
+is non-zero, results (including "not found") are remembered for that
+many seconds and shared by every process under this Parrot.
+*/
+
+int       pfs_metadata_stat( pfs_name *name, struct pfs_stat *buf );
+int       pfs_metadata_lstat( pfs_name *name, struct pfs_stat *buf );
+int       pfs_metadata_readlink( pfs_name *name, char *buf, pfs_size_t size );
+pfs_dir * pfs_metadata_getdir( pfs_name *name );
+
+/* Returns false and sets errno if the name is already known not to exist. */
+int       pfs_metadata_may_exist( pfs_name *name );
+
+/* Forget everything about a name and the listing of its parent. */
+void      pfs_metadata_invalidate( pfs_name *name );
+
+/* The same, and also everything below the name, for a directory that moves or goes away. */
+void      pfs_metadata_invalidate_tree( pfs_name *name );
+
+int       pfs_metadata_load( const char *filename );
+int       pfs_metadata_save( const char *filename );
+
+#endif
@@ -45,7 +45,7 @@ extern uid_t pfs_uid;
 extern gid_t pfs_gid;
 extern int pfs_fake_setuid;
 extern int pfs_fake_setgid;
-
+extern int pfs_use_seccomp;
 
 struct pfs_process * pfs_process_lookup( pid_t pid )
 {
@@ -313,6 +313,19 @@ void pfs_process_exec( struct pfs_process *p )
 	p->table->close_on_exec();
 }
 
+/* Restart a stopped process.  A process inside a system call must stop again
+ * when the call returns.  With --seccomp, a process in userspace runs until
+ * its filter traps the next system call; otherwise it stops at every one.
+ */
+int pfs_process_continue( struct pfs_process *p, int signum )
+{
+	if(pfs_use_seccomp && p->state == PFS_PROCESS_STATE_USER) {
+		return tracer_resume(p->tracer, signum);
+	} else {
+		return tracer_continue(p->tracer, signum);
+	}
+}
+
 static void pfs_process_delete( struct pfs_process *p )
 {
 	if(p->table) {
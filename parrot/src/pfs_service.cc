@@ -51,6 +51,16 @@ int pfs_service::is_local()
 	return 0;
 }
 
+int pfs_service::has_ranges()
+{
+	return 0;
+}
+
+int pfs_service::metadata_is_cacheable()
+{
+	return 0;
+}
+
 pfs_file * pfs_service::open( pfs_name *name, int flags, mode_t mode )
 {
 	errno = ENOENT;
@@ -25,6 +25,8 @@ public:
 	virtual int tilde_is_special();
 	virtual int is_seekable() = 0;
 	virtual int is_local();
+	virtual int has_ranges();
+	virtual int metadata_is_cacheable();
 
 	virtual pfs_file * open( pfs_name *name, int flags, mode_t mode );
 	virtual pfs_dir * getdir( pfs_name *name );
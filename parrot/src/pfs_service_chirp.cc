@@ -626,6 +626,10 @@ public:
 		return 1;
 	}
 
+	virtual int metadata_is_cacheable() {
+		return 1;
+	}
+
 };
 
 static pfs_service_chirp pfs_service_chirp_instance;
@@ -32,7 +32,7 @@ extern "C" {
 
 extern int pfs_master_timeout;
 
-static struct link * http_fetch( pfs_name *name, const char *action, INT64_T *size )
+static struct link * http_fetch( pfs_name *name, const char *action, INT64_T offset, INT64_T *size )
 {
 	char url[HTTP_LINE_MAX];
 
@@ -42,28 +42,52 @@ static struct link * http_fetch( pfs_name *name, const char *action, INT64_T *si
 	}
 
 	sprintf(url,"http://%s:%d%s",name->host,name->port,name->rest);
-	return http_query_size(url,action,size,time(0)+pfs_master_timeout,0);
+	return http_query_range(url,action,offset,size,time(0)+pfs_master_timeout,0);
 }
 
+/*
+The body of the response is read as a stream.  A read at any
+other offset drops the connection and asks the server for the
+rest of the object starting at that offset, so that the block
+cache can fetch just the ranges that a program touches.
+*/
+
 class pfs_file_http : public pfs_file
 {
 private:
 	struct link *link;
 	INT64_T size;
+	INT64_T position;
 
 public:
 	pfs_file_http( pfs_name *n, struct link *l, INT64_T s ) : pfs_file(n) {
 		link = l;
 		size = s;
+		position = 0;
 	}
 
 	virtual int close() {
-		link_close(link);
+		if(link) link_close(link);
 		return 0;
 	}
 
 	virtual pfs_ssize_t read( void *d, pfs_size_t length, pfs_off_t offset ) {
-		return link_read(link,(char*)d,length,LINK_FOREVER);
+		INT64_T remaining;
+		pfs_ssize_t result;
+
+		if(offset>=size) return 0;
+
+		if(!link || offset!=position) {
+			if(link) link_close(link);
+			debug(D_HTTP,"seek %s to %lld",name.path,(long long)offset);
+			link = http_fetch(&name,"GET",offset,&remaining);
+			if(!link) return -1;
+			position = offset;
+		}
+
+		result = link_read(link,(char*)d,length,LINK_FOREVER);
+		if(result>0) position += result;
+		return result;
 	}
 
 	virtual int fstat( struct pfs_stat *buf ) {
@@ -94,7 +118,7 @@ public:
 			return 0;
 		}
 
-		link = http_fetch(name,"GET",&size);
+		link = http_fetch(name,"GET",0,&size);
 		if(link) {
 			return new pfs_file_http(name,link,size);
 		} else {
@@ -106,7 +130,7 @@ public:
 		struct link *link;
 		INT64_T size;
 
-		link = http_fetch(name,"HEAD",&size);
+		link = http_fetch(name,"HEAD",0,&size);
 		if(link) {
 			link_close(link);
 			pfs_service_emulate_stat(name,buf);
@@ -125,6 +149,14 @@ public:
 	virtual int is_seekable (void) {
 		return 0;
 	}
+
+	virtual int has_ranges (void) {
+		return 1;
+	}
+
+	virtual int metadata_is_cacheable (void) {
+		return 1;
+	}
 };
 
 static pfs_service_http pfs_service_http_instance;
@@ -253,6 +253,10 @@ public:
 		return 1;
 	}
 
+	virtual int metadata_is_cacheable() {
+		return 1;
+	}
+
 
 };
 
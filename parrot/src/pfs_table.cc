@@ -17,6 +17,7 @@ See the file COPYING for details.
 #include "pfs_mmap.h"
 #include "pfs_process.h"
 #include "pfs_file_cache.h"
+#include "pfs_metadata_cache.h"
 #include "pfs_resolve.h"
 
 extern "C" {
@@ -406,7 +407,7 @@ void pfs_table::follow_symlink( struct pfs_name *pname, mode_t mode, int depth )
 
 	if (string_prefix_is(pname->path, "/proc/")) in_proc = true;
 
-	int rlres = new_pname.service->readlink(pname,link_target,PFS_PATH_MAX-1);
+	int rlres = pfs_metadata_readlink(pname,link_target,PFS_PATH_MAX-1);
 	if (rlres > 0) {
 		/* readlink does not NULL-terminate */
 		link_target[rlres] = '\000';
@@ -610,7 +611,7 @@ pfs_dir * pfs_table::open_directory(pfs_name *pname, int flags)
 		errno = EISDIR;
 		file = 0;
 	} else {
-		file = pname->service->getdir(pname);
+		file = pfs_metadata_getdir(pname);
 	}
 	return file;
 }
@@ -678,6 +679,12 @@ pfs_file * pfs_table::open_object( const char *lname, int flags, mode_t mode, in
 			// Linux ignores O_DIRECTORY in this combination
 			flags &= ~O_DIRECTORY;
 		}
+		if(!(flags&O_CREAT) && !pfs_metadata_may_exist(&pname)) {
+			return 0;
+		}
+		if(flags&(O_WRONLY|O_RDWR|O_CREAT|O_TRUNC)) {
+			pfs_metadata_invalidate(&pname);
+		}
 		char *pid = NULL;
 		if(flags&O_DIRECTORY) {
 			if (pattern_match(pname.rest, "^/proc/(%d+)/fd/?$", &pid) >= 0) {
@@ -866,6 +873,10 @@ int pfs_table::close( int fd )
 
 		int result = 0;
 
+		if(p->flags&(O_WRONLY|O_RDWR)) {
+			pfs_metadata_invalidate(f->get_name());
+		}
+
 		if(f->refs()==1) {
 			result = f->close();
 			delete f;
@@ -1073,6 +1084,7 @@ int pfs_table::ftruncate( int fd, pfs_off_t size )
 		result = 0;
 	} else {
 		result = pointers[fd]->file->ftruncate(size);
+		pfs_metadata_invalidate(pointers[fd]->file->get_name());
 	}
 
 	return result;
@@ -1204,6 +1216,7 @@ int pfs_table::fchmod( int fd, mode_t mode )
 {
 	CHECK_FD(fd);
 
+	pfs_metadata_invalidate(pointers[fd]->file->get_name());
 	return pointers[fd]->file->fchmod(mode);
 }
 
@@ -1211,6 +1224,7 @@ int pfs_table::fchown( int fd, struct pfs_process *p, uid_t uid, gid_t gid )
 {
 	CHECK_FD(fd);
 
+	pfs_metadata_invalidate(pointers[fd]->file->get_name());
 	int result = pointers[fd]->file->fchown(uid,gid);
 
 	/*
@@ -1287,7 +1301,9 @@ int pfs_table::access( const char *n, mode_t mode )
 	int result = -1;
 
 	if(resolve_name(0,n,&pname,X_OK | mode)) {
-		result = pname.service->access(&pname,mode);
+		if(pfs_metadata_may_exist(&pname)) {
+			result = pname.service->access(&pname,mode);
+		}
 	}
 
 	return result;
@@ -1300,6 +1316,7 @@ int pfs_table::chmod( const char *n, mode_t mode )
 
 	if(resolve_name(0,n,&pname,W_OK)) {
 		result = pname.service->chmod(&pname,mode);
+		pfs_metadata_invalidate(&pname);
 	}
 
 	return result;
@@ -1312,6 +1329,7 @@ int pfs_table::chown( const char *n, struct pfs_process *p, uid_t uid, gid_t gid
 
 	if(resolve_name(0,n,&pname,W_OK)) {
 		result = pname.service->chown(&pname,uid,gid);
+		pfs_metadata_invalidate(&pname);
 	}
 
 	/*
@@ -1333,6 +1351,7 @@ int pfs_table::lchown( const char *n, uid_t uid, gid_t gid )
 
 	if(resolve_name(0,n,&pname,W_OK,false)) {
 		result = pname.service->lchown(&pname,uid,gid);
+		pfs_metadata_invalidate(&pname);
 	}
 
 	return result;
@@ -1345,6 +1364,7 @@ int pfs_table::truncate( const char *n, pfs_off_t offset )
 
 	if(resolve_name(1,n,&pname,W_OK)) {
 		result = pname.service->truncate(&pname,offset);
+		pfs_metadata_invalidate(&pname);
 	}
 
 	return result;
@@ -1419,6 +1439,7 @@ int pfs_table::setxattr (const char *path, const char *name, const void *value,
 
 	if(resolve_name(0,path,&pname,W_OK)) {
 		result = pname.service->setxattr(&pname,name,value,size,flags);
+		pfs_metadata_invalidate(&pname);
 	}
 
 	return result;
@@ -1431,6 +1452,7 @@ int pfs_table::lsetxattr (const char *path, const char *name, const void *value,
 
 	if(resolve_name(0,path,&pname,W_OK,false)) {
 		result = pname.service->lsetxattr(&pname,name,value,size,flags);
+		pfs_metadata_invalidate(&pname);
 	}
 
 	return result;
@@ -1440,6 +1462,7 @@ int pfs_table::fsetxattr (int fd, const char *name, const void *value, size_t si
 {
 	CHECK_FD(fd);
 
+	pfs_metadata_invalidate(pointers[fd]->file->get_name());
 	return pointers[fd]->file->fsetxattr(name,value,size,flags);
 }
 
@@ -1450,6 +1473,7 @@ int pfs_table::removexattr (const char *path, const char *name)
 
 	if(resolve_name(0,path,&pname,W_OK)) {
 		result = pname.service->removexattr(&pname,name);
+		pfs_metadata_invalidate(&pname);
 	}
 
 	return result;
@@ -1462,6 +1486,7 @@ int pfs_table::lremovexattr (const char *path, const char *name)
 
 	if(resolve_name(0,path,&pname,W_OK,false)) {
 		result = pname.service->lremovexattr(&pname,name);
+		pfs_metadata_invalidate(&pname);
 	}
 
 	return result;
@@ -1471,6 +1496,7 @@ int pfs_table::fremovexattr (int fd, const char *name)
 {
 	CHECK_FD(fd);
 
+	pfs_metadata_invalidate(pointers[fd]->file->get_name());
 	return pointers[fd]->file->fremovexattr(name);
 }
 
@@ -1481,6 +1507,7 @@ int pfs_table::utime( const char *n, struct utimbuf *buf )
 
 	if(resolve_name(0,n,&pname,W_OK)) {
 		result = pname.service->utime(&pname,buf);
+		pfs_metadata_invalidate(&pname);
 	}
 
 	return result;
@@ -1493,6 +1520,7 @@ int pfs_table::utimens( const char *n, const struct timespec times[2] )
 
 	if(resolve_name(0,n,&pname,W_OK)) {
 		result = pname.service->utimens(&pname,times);
+		pfs_metadata_invalidate(&pname);
 	}
 
 	return result;
@@ -1505,6 +1533,7 @@ int pfs_table::lutimens( const char *n, const struct timespec times[2] )
 
 	if(resolve_name(0,n,&pname,W_OK,false)) {
 		result = pname.service->lutimens(&pname,times);
+		pfs_metadata_invalidate(&pname);
 	}
 
 	return result;
@@ -1518,6 +1547,7 @@ int pfs_table::unlink( const char *n )
 
 	if(resolve_name(0,n,&pname,E_OK,false)) {
 		result = pname.service->unlink(&pname);
+		pfs_metadata_invalidate(&pname);
 		if(result==0) {
 			pfs_cache_invalidate(&pname);
 			pfs_channel_update_name(pname.path,0);
@@ -1534,7 +1564,7 @@ int pfs_table::stat( const char *n, struct pfs_stat *b )
 
 	/* You don't need to have read permission on a file to stat it. */
 	if(resolve_name(0,n,&pname,F_OK)) {
-		result = pname.service->stat(&pname,b);
+		result = pfs_metadata_stat(&pname,b);
 		if(result>=0) {
 			b->st_blksize = pname.service->get_block_size();
 		} else if(errno==ENOENT && !pname.hostport[0]) {
@@ -1567,7 +1597,7 @@ int pfs_table::lstat( const char *n, struct pfs_stat *b )
 
 	/* You don't need to have read permission on a file to stat it. */
 	if(resolve_name(0,n,&pname,F_OK,false)) {
-		result = pname.service->lstat(&pname,b);
+		result = pfs_metadata_lstat(&pname,b);
 		if(result>=0) {
 			b->st_blksize = pname.service->get_block_size();
 		} else if(errno==ENOENT && !pname.hostport[0]) {
@@ -1588,6 +1618,8 @@ int pfs_table::rename( const char *n1, const char *n2 )
 	if(resolve_name(0,n1,&p1,E_OK,false) && resolve_name(0,n2,&p2,E_OK,false)) {
 		if(p1.service==p2.service) {
 			result = p1.service->rename(&p1,&p2);
+			pfs_metadata_invalidate_tree(&p1);
+			pfs_metadata_invalidate_tree(&p2);
 			if(result==0) {
 				pfs_cache_invalidate(&p1);
 				pfs_cache_invalidate(&p2);
@@ -1611,6 +1643,8 @@ int pfs_table::link( const char *n1, const char *n2 )
 	if(resolve_name(0,n1,&p1,W_OK,false) && resolve_name(0,n2,&p2,E_OK,false)) {
 		if(p1.service==p2.service) {
 			result = p1.service->link(&p1,&p2);
+			pfs_metadata_invalidate(&p1);
+			pfs_metadata_invalidate(&p2);
 		} else {
 			errno = EXDEV;
 		}
@@ -1635,6 +1669,7 @@ int pfs_table::symlink( const char *target, const char *path )
 
 	if(resolve_name(0,path,&pname,E_OK,false)) {
 		result = pname.service->symlink(target,&pname);
+		pfs_metadata_invalidate(&pname);
 	}
 
 	return result;
@@ -1680,10 +1715,10 @@ int pfs_table::readlink( const char *n, char *buf, pfs_size_t size )
 				memcpy(buf,path,count);
 				result = (int)count;
 			} else {
-				result = pname.service->readlink(&pname,buf,size);
+				result = pfs_metadata_readlink(&pname,buf,size);
 			}
 		} else {
-			result = pname.service->readlink(&pname,buf,size);
+			result = pfs_metadata_readlink(&pname,buf,size);
 		}
 		free(pid);
 		free(fd);
@@ -1702,6 +1737,7 @@ int pfs_table::mknod( const char *n, mode_t mode, dev_t dev )
 
 	if(resolve_name(0,n,&pname,E_OK)) {
 		result = pname.service->mknod(&pname,mode,dev);
+		pfs_metadata_invalidate(&pname);
 	}
 
 	return result;
@@ -1714,6 +1750,7 @@ int pfs_table::mkdir( const char *n, mode_t mode )
 
 	if(resolve_name(0,n,&pname,E_OK)) {
 		result = pname.service->mkdir(&pname,mode);
+		pfs_metadata_invalidate(&pname);
 	}
 
 	return result;
@@ -1726,6 +1763,7 @@ int pfs_table::rmdir( const char *n )
 
 	if(resolve_name(0,n,&pname,E_OK,false)) {
 		result = pname.service->rmdir(&pname);
+		pfs_metadata_invalidate_tree(&pname);
 	}
 
 	return result;
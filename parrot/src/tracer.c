@@ -21,12 +21,18 @@ See the file COPYING for details.
 #include <syscall.h>
 #include <unistd.h>
 
+#include <linux/audit.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+
+#include <sys/prctl.h>
 #include <sys/wait.h>
 
 #include <assert.h>
 #include <errno.h>
 #include <limits.h>
 #include <signal.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -46,8 +52,15 @@ See the file COPYING for details.
 #	define PTRACE_OLDSETOPTIONS 21
 #endif
 
+#ifndef PR_SET_NO_NEW_PRIVS
+#	define PR_SET_NO_NEW_PRIVS 38
+#endif
+
 #include "tracer.table.c"
 #include "tracer.table64.c"
+#if !defined(CCTOOLS_CPU_I386)
+#include "tracer.native64.c"
+#endif
 
 /*
 Note that we would normally get such register definitions
@@ -86,14 +99,76 @@ struct tracer {
 		struct x86_64_registers regs64;
 	} regs;
 	int has_args5_bug;
+	int memfd;
 };
 
+static int use_filter = 0;
+static int copy_methods = TRACER_COPY_VM|TRACER_COPY_MEM|TRACER_COPY_WORD;
+
+void tracer_copy_methods_set( int methods )
+{
+	copy_methods = methods;
+}
+
+void tracer_filter_enable (void)
+{
+	use_filter = 1;
+}
+
+/*
+Called by the tracee, after it has been attached, to install a seccomp
+filter which lets the system calls in syscall_native.tbl run without
+stopping.  Every other system call, including all 32-bit and x32 calls,
+stops with PTRACE_EVENT_SECCOMP just before it would enter the kernel.
+*/
+
+int tracer_filter_install (void)
+{
+#if !defined(CCTOOLS_CPU_I386)
+	size_t n = sizeof(syscall64_native)/sizeof(syscall64_native[0]);
+	struct sock_filter *filter = malloc((2*n+4)*sizeof(*filter));
+	struct sock_fprog prog;
+	size_t i, k = 0;
+
+	if (!filter)
+		return -1;
+
+	filter[k++] = (struct sock_filter) BPF_STMT(BPF_LD|BPF_W|BPF_ABS, offsetof(struct seccomp_data, arch));
+	filter[k++] = (struct sock_filter) BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, AUDIT_ARCH_X86_64, 1, 0);
+	filter[k++] = (struct sock_filter) BPF_STMT(BPF_RET|BPF_K, SECCOMP_RET_TRACE);
+	filter[k++] = (struct sock_filter) BPF_STMT(BPF_LD|BPF_W|BPF_ABS, offsetof(struct seccomp_data, nr));
+	for (i = 0; i < n; i++) {
+		filter[k++] = (struct sock_filter) BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, syscall64_native[i], 0, 1);
+		filter[k++] = (struct sock_filter) BPF_STMT(BPF_RET|BPF_K, SECCOMP_RET_ALLOW);
+	}
+	filter[k++] = (struct sock_filter) BPF_STMT(BPF_RET|BPF_K, SECCOMP_RET_TRACE);
+
+	prog.len = k;
+	prog.filter = filter;
+
+	if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) == -1 || prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &prog) == -1) {
+		int saved_errno = errno;
+		free(filter);
+		errno = saved_errno;
+		return -1;
+	}
+
+	free(filter);
+	return 0;
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
 int tracer_attach (pid_t pid)
 {
 	intptr_t options = PTRACE_O_TRACESYSGOOD|PTRACE_O_TRACEEXEC|PTRACE_O_TRACEEXIT|PTRACE_O_TRACECLONE|PTRACE_O_TRACEFORK|PTRACE_O_TRACEVFORK;
 
 	if (linux_available(3,8,0))
 		options |= PTRACE_O_EXITKILL;
+	if (use_filter)
+		options |= PTRACE_O_TRACESECCOMP;
 	assert(linux_available(2,5,60));
 
 	if (linux_available(3,4,0)) {
@@ -154,6 +229,7 @@ struct tracer *tracer_init (pid_t pid)
 	t->gotregs = 0;
 	t->setregs = 0;
 	t->has_args5_bug = 0;
+	t->memfd = -1;
 
 	memset(&t->regs,0,sizeof(t->regs));
 
@@ -189,6 +265,7 @@ void tracer_detach( struct tracer *t )
 		t->setregs = 0;
 	}
 	ptrace(PTRACE_DETACH,t->pid,0,0); /* ignore failure */
+	if(t->memfd>=0) close(t->memfd);
 	free(t);
 }
 
@@ -205,6 +282,19 @@ int tracer_continue( struct tracer *t, int signum )
 	return 0;
 }
 
+int tracer_resume( struct tracer *t, int signum )
+{
+	t->gotregs = 0;
+	if(t->setregs) {
+		if(ptrace(PTRACE_SETREGS,t->pid,0,&t->regs) == -1)
+			return -1;
+		t->setregs = 0;
+	}
+	if (ptrace(PTRACE_CONT,t->pid,0,signum) == -1)
+		ERROR;
+	return 0;
+}
+
 int tracer_args_get( struct tracer *t, INT64_T *syscall, INT64_T args[TRACER_ARGS_MAX] )
 {
 	if(!t->gotregs) {
@@ -443,7 +533,7 @@ static ssize_t copy_out_fast( struct tracer *t, const void *data, const void *ua
 	size_t count;
 	size_t written = 0;
 
-	if (!linux_available(3,2,0))
+	if (!(copy_methods & TRACER_COPY_VM) || !linux_available(3,2,0))
 		return errno = ENOSYS, -1;
 
 more:
@@ -509,6 +599,64 @@ more:
 	return written;
 }
 
+/*
+Where process_vm_readv/writev are missing or forbidden (for example by
+a container's seccomp policy) the tracee's memory can still be moved
+in bulk through /proc/pid/mem, which a tracer may read and write.
+The descriptor is opened on first use.  After an exec it refers to the
+old address space and transfers nothing, so it is reopened once.
+*/
+
+static ssize_t copy_mem( struct tracer *t, void *data, const void *uaddr, size_t length, int flags, int out )
+{
+	size_t total = 0;
+	int reopened = 0;
+
+	if (!(copy_methods & TRACER_COPY_MEM))
+		return errno = ENOSYS, -1;
+
+again:
+	if (t->memfd == -1) {
+		char path[PATH_MAX];
+		snprintf(path, sizeof(path), "/proc/%d/mem", (int)t->pid);
+		t->memfd = open(path, O_RDWR|O_CLOEXEC);
+		if (t->memfd == -1) {
+			debug(D_DEBUG, "could not open %s: %s", path, strerror(errno));
+			return errno = ENOSYS, -1;
+		}
+	}
+
+	while (total < length) {
+		ssize_t n;
+		off64_t offset = (off64_t)((uintptr_t)uaddr+total);
+		if (out) {
+			n = pwrite64(t->memfd, (char *)data+total, length-total, offset);
+		} else {
+			n = pread64(t->memfd, (char *)data+total, length-total, offset);
+		}
+		if (n > 0) {
+			total += n;
+		} else if (n == 0 && total == 0 && !reopened) {
+			close(t->memfd);
+			t->memfd = -1;
+			reopened = 1;
+			goto again;
+		} else if (n == -1 && errno == EINTR) {
+			continue;
+		} else {
+			if (n == 0 || errno == EIO)
+				errno = EFAULT;
+			break;
+		}
+	}
+
+	if (total == length || (total > 0 && !(flags & TRACER_O_ATOMIC))) {
+		return total;
+	} else {
+		return errno = EFAULT, -1;
+	}
+}
+
 ssize_t tracer_copy_out( struct tracer *t, const void *data, const void *uaddr, size_t length, int flags )
 {
 	if(length==0) return 0;
@@ -520,7 +668,9 @@ ssize_t tracer_copy_out( struct tracer *t, const void *data, const void *uaddr,
 #endif
 
 	ssize_t rc = copy_out_fast(t,data,uaddr,length,flags);
-	if (rc == -1 && errno == ENOSYS && !(flags & TRACER_O_FAST))
+	if (rc == -1 && (errno == ENOSYS || errno == EPERM))
+		rc = copy_mem(t,(void *)data,uaddr,length,flags,1);
+	if (rc == -1 && errno == ENOSYS && !(flags & TRACER_O_FAST) && (copy_methods & TRACER_COPY_WORD))
 		rc = tracer_copy_out_slow(t,data,uaddr,length,flags);
 	assert(!(flags & TRACER_O_ATOMIC) || (rc == -1 || (size_t)rc == length));
 	return rc;
@@ -575,7 +725,7 @@ ssize_t copy_in_fast( struct tracer *t, void *data, const void *uaddr, size_t le
 	size_t count;
 	size_t read = 0;
 
-	if (!linux_available(3,2,0))
+	if (!(copy_methods & TRACER_COPY_VM) || !linux_available(3,2,0))
 		return errno = ENOSYS, -1;
 
 more:
@@ -652,7 +802,9 @@ ssize_t tracer_copy_in( struct tracer *t, void *data, const void *uaddr, size_t
 #endif
 
 	ssize_t rc = copy_in_fast(t,data,uaddr,length,flags);
-	if (rc == -1 && errno == ENOSYS && !(flags & TRACER_O_FAST))
+	if (rc == -1 && (errno == ENOSYS || errno == EPERM))
+		rc = copy_mem(t,data,uaddr,length,flags,0);
+	if (rc == -1 && errno == ENOSYS && !(flags & TRACER_O_FAST) && (copy_methods & TRACER_COPY_WORD))
 		rc = tracer_copy_in_slow(t,data,uaddr,length,flags);
 	assert(!(flags & TRACER_O_ATOMIC) || (rc == -1 || (size_t)rc == length));
 	return rc;
@@ -699,7 +851,9 @@ ssize_t tracer_copy_in_string( struct tracer *t, char *str, const void *uaddr, s
 #endif
 
 	ssize_t rc = copy_in_fast(t,str,uaddr,length,flags);
-	if (rc == -1 && errno == ENOSYS && !(flags & TRACER_O_FAST))
+	if (rc == -1 && (errno == ENOSYS || errno == EPERM))
+		rc = copy_mem(t,str,uaddr,length,flags,0);
+	if (rc == -1 && errno == ENOSYS && !(flags & TRACER_O_FAST) && (copy_methods & TRACER_COPY_WORD))
 		rc = copy_in_string_slow(t,str,uaddr,length,flags);
 	/* check for NUL */
 	if (rc > 0) {
@@ -715,6 +869,78 @@ ssize_t tracer_copy_in_string( struct tracer *t, char *str, const void *uaddr, s
 	return rc;
 }
 
+/*
+Scatter or gather between one local buffer and a list of regions in
+the tracee, as for readv and writev.  Where possible the whole list
+is handed to a single process_vm_readv/writev.  If that is not
+available, or stops short on a fault, the remaining regions are
+copied one at a time with tracer_copy_in/out, which also handle
+partial copies.  Copying a region twice is harmless, so a short
+bulk transfer simply restarts from the first region it covered.
+*/
+
+static ssize_t copy_vector( struct tracer *t, void *data, const struct iovec *uv, int count, size_t length, int flags, int out )
+{
+	size_t total = 0;
+	int i = 0;
+
+	if ((copy_methods & TRACER_COPY_VM) && linux_available(3,2,0)) {
+		while (i < count && total < length) {
+			struct iovec local;
+			int rn = MIN(count-i, IOV_MAX);
+			size_t expected = 0;
+			int j;
+
+			for (j = 0; j < rn; j++)
+				expected += uv[i+j].iov_len;
+			local.iov_base = (char *)data+total;
+			local.iov_len = length-total;
+			expected = MIN(expected, local.iov_len);
+
+#ifdef CCTOOLS_CPU_I386
+			ssize_t n = syscall(out ? SYSCALL32_process_vm_writev : SYSCALL32_process_vm_readv, (int32_t)t->pid, &local, (int32_t)1, &uv[i], (int32_t)rn, (int32_t)0);
+#else
+			ssize_t n = syscall(out ? SYSCALL64_process_vm_writev : SYSCALL64_process_vm_readv, (int64_t)t->pid, &local, (int64_t)1, &uv[i], (int64_t)rn, (int64_t)0);
+#endif
+			if (n < 0 || (size_t)n != expected)
+				break;
+			total += n;
+			i += rn;
+		}
+	}
+
+	for (; i < count && total < length; i++) {
+		size_t chunk = MIN(uv[i].iov_len, length-total);
+		ssize_t n;
+
+		if (out) {
+			n = tracer_copy_out(t, (char *)data+total, uv[i].iov_base, chunk, flags);
+		} else {
+			n = tracer_copy_in(t, (char *)data+total, uv[i].iov_base, chunk, flags);
+		}
+		if (n == -1) {
+			if (total == 0 || (flags & TRACER_O_ATOMIC))
+				return -1;
+			break;
+		}
+		total += n;
+		if ((size_t)n != chunk)
+			break;
+	}
+
+	return total;
+}
+
+ssize_t tracer_copy_outv( struct tracer *t, const void *data, const struct iovec *uv, int count, size_t length, int flags )
+{
+	return copy_vector(t,(void *)data,uv,count,length,flags,1);
+}
+
+ssize_t tracer_copy_inv( struct tracer *t, void *data, const struct iovec *uv, int count, size_t length, int flags )
+{
+	return copy_vector(t,data,uv,count,length,flags,0);
+}
+
 const char * tracer_syscall32_name( int syscall )
 {
 	if( syscall<0 || syscall>SYSCALL32_MAX ) {
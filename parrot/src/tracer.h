@@ -9,16 +9,20 @@ See the file COPYING for details.
 #define TRACER_H
 
 #include <sys/types.h>
+#include <sys/uio.h>
 #include "int_sizes.h"
 
 #define TRACER_ARGS_MAX 8
 
 struct tracer;
 
+void tracer_filter_enable( void );
+int tracer_filter_install( void );
 int tracer_attach( pid_t pid );
 void tracer_detach( struct tracer *t );
 struct tracer *tracer_init( pid_t pid );
 int tracer_continue( struct tracer *t, int signum );
+int tracer_resume( struct tracer *t, int signum );
 int tracer_listen( struct tracer *t );
 int tracer_getevent( struct tracer *t, unsigned long *message );
 
@@ -40,6 +44,17 @@ ssize_t tracer_copy_out( struct tracer *t, const void *data, const void *uaddr,
 ssize_t tracer_copy_in( struct tracer *t, void *data, const void *uaddr, size_t length, int flags );
 ssize_t tracer_copy_in_string( struct tracer *t, char *data, const void *uaddr, size_t maxlength, int flags );
 
+/* Copy length bytes between data and the tracee regions listed in uv. */
+ssize_t tracer_copy_outv( struct tracer *t, const void *data, const struct iovec *uv, int count, size_t length, int flags );
+ssize_t tracer_copy_inv( struct tracer *t, void *data, const struct iovec *uv, int count, size_t length, int flags );
+
+/* Ways of moving tracee memory, tried in this order. */
+#define TRACER_COPY_VM   (1<<0) /* process_vm_readv/writev */
+#define TRACER_COPY_MEM  (1<<1) /* pread/pwrite on /proc/pid/mem */
+#define TRACER_COPY_WORD (1<<2) /* PTRACE_PEEKDATA/POKEDATA */
+/* Restrict the methods used, for testing and benchmarking. */
+void tracer_copy_methods_set( int methods );
+
 int tracer_is_64bit( struct tracer *t );
 
 const char *tracer_syscall32_name( int syscall );
@@ -4,12 +4,26 @@ if($ARGV[0] eq "table") {
 	$dotable = 1;
 } elsif($ARGV[0] eq "header") {
 	$doheader = 1;
+} elsif($ARGV[0] eq "native") {
+	$donative = 1;
 } else {
-	die "Use: $0 <table|header>\n";
+	die "Use: $0 <table|header|native> <bits> [native-list]\n";
 }
 
 $bits = $ARGV[1];
 
+if($donative) {
+	open(LIST, "<", $ARGV[2]) or die "$0: couldn't open $ARGV[2]: $!\n";
+	while(<LIST>) {
+		next if /^\s*#/; # skip comments
+		next if /^\s*$/; # skip empty
+		($name) = split;
+		$native{$name} = 1;
+	}
+	close(LIST);
+	print "static const int syscall${bits}_native[] = {\n";
+}
+
 if($dotable) {
 	print "static const char * syscall${bits}_names[] = {\n";
 }
@@ -36,9 +50,22 @@ while(<STDIN>) {
 		if ($n < $number) {
 			$n = $number;
 		}
+	} elsif ($donative) {
+		# As above, only the first instance of a name counts.
+		if ($native{$name} == 1) {
+			print "\t${number}, /* ${name} */\n";
+			$native{$name} = 2;
+		}
 	}
 }
 
+if($donative) {
+	foreach $name (sort keys %native) {
+		die "$0: unknown system call $name\n" if $native{$name} != 2;
+	}
+	print "};\n";
+}
+
 if($doheader) {
 	print "#define SYSCALL${bits}_MAX ${n}\n";
 }
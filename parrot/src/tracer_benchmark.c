@@ -0,0 +1,188 @@
+/*
+Copyright (C) 2005- The University of Notre Dame
+This software is distributed under the GNU General Public License.
+See the file COPYING for details.
+*/
+
+/*
+tracer_benchmark measures how fast Parrot can move system call
+payloads in and out of a traced process with each of the methods
+in tracer.c, and how a scatter/gather copy compares with copying
+the blocks of an iovec one at a time.
+*/
+
+#include "linux-version.h"
+#include "tracer.h"
+
+#include "debug.h"
+#include "timestamp.h"
+
+#include <sys/ptrace.h>
+#include <sys/utsname.h>
+#include <sys/wait.h>
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_SIZE (16*1024*1024)
+#define RUN_TIME 500000
+#define IOV_BLOCK 4096
+
+int linux_major;
+int linux_minor;
+int linux_micro;
+
+static char *remote;
+static char *local;
+
+static double run( struct tracer *t, int out, size_t length )
+{
+	timestamp_t start = timestamp_get();
+	timestamp_t stop;
+	INT64_T total = 0;
+
+	do {
+		ssize_t result;
+		if(out) {
+			result = tracer_copy_out(t,local,remote,length,TRACER_O_ATOMIC);
+		} else {
+			result = tracer_copy_in(t,local,remote,length,TRACER_O_ATOMIC);
+		}
+		if(result!=(ssize_t)length) {
+			fprintf(stderr,"copy of %zu bytes failed: %s\n",length,strerror(errno));
+			exit(1);
+		}
+		total += length;
+		stop = timestamp_get();
+	} while(stop-start<RUN_TIME);
+
+	return total/(double)(stop-start);
+}
+
+static double run_vector( struct tracer *t, int out, int count, int gather )
+{
+	struct iovec *v = malloc(sizeof(*v)*count);
+	timestamp_t start = timestamp_get();
+	timestamp_t stop;
+	INT64_T total = 0;
+	int i;
+
+	/* Every other block, so that the regions are not contiguous. */
+	for(i=0;i<count;i++) {
+		v[i].iov_base = remote+2*i*IOV_BLOCK;
+		v[i].iov_len = IOV_BLOCK;
+	}
+
+	do {
+		if(gather) {
+			ssize_t result;
+			if(out) {
+				result = tracer_copy_outv(t,local,v,count,count*IOV_BLOCK,TRACER_O_ATOMIC);
+			} else {
+				result = tracer_copy_inv(t,local,v,count,count*IOV_BLOCK,TRACER_O_ATOMIC);
+			}
+			if(result!=count*IOV_BLOCK) {
+				fprintf(stderr,"vector copy failed: %s\n",strerror(errno));
+				exit(1);
+			}
+		} else {
+			for(i=0;i<count;i++) {
+				if(out) {
+					tracer_copy_out(t,local+i*IOV_BLOCK,v[i].iov_base,IOV_BLOCK,TRACER_O_ATOMIC);
+				} else {
+					tracer_copy_in(t,local+i*IOV_BLOCK,v[i].iov_base,IOV_BLOCK,TRACER_O_ATOMIC);
+				}
+			}
+		}
+		total += count*IOV_BLOCK;
+		stop = timestamp_get();
+	} while(stop-start<RUN_TIME);
+
+	free(v);
+	return total/(double)(stop-start);
+}
+
+int main( int argc, char *argv[] )
+{
+	static const struct {
+		const char *name;
+		int methods;
+	} methods[] = {
+		{"process_vm", TRACER_COPY_VM},
+		{"proc_mem", TRACER_COPY_MEM},
+		{"peekpoke", TRACER_COPY_WORD},
+	};
+	static const size_t sizes[] = { 64, 4096, 65536, 1024*1024, MAX_SIZE };
+	struct utsname name;
+	struct tracer *t;
+	pid_t pid;
+	int status;
+	unsigned i, j;
+
+	debug_config(argv[0]);
+
+	uname(&name);
+	sscanf(name.release,"%d.%d.%d",&linux_major,&linux_minor,&linux_micro);
+
+	remote = malloc(MAX_SIZE);
+	local = malloc(MAX_SIZE);
+	memset(remote,'x',MAX_SIZE);
+	memset(local,'y',MAX_SIZE);
+
+	pid = fork();
+	if(pid==0) {
+		ptrace(PTRACE_TRACEME,0,0,0);
+		raise(SIGSTOP);
+		_exit(0);
+	} else if(pid<0) {
+		fprintf(stderr,"couldn't fork: %s\n",strerror(errno));
+		return 1;
+	}
+
+	if(waitpid(pid,&status,0)<0 || !WIFSTOPPED(status)) {
+		fprintf(stderr,"child did not stop\n");
+		return 1;
+	}
+
+	t = tracer_init(pid);
+
+	printf("%-12s %-4s", "method", "dir");
+	for(j=0;j<sizeof(sizes)/sizeof(sizes[0]);j++) {
+		printf(" %9zuB", sizes[j]);
+	}
+	printf("   (MB/s)\n");
+
+	for(i=0;i<sizeof(methods)/sizeof(methods[0]);i++) {
+		int out;
+		tracer_copy_methods_set(methods[i].methods);
+		for(out=0;out<=1;out++) {
+			printf("%-12s %-4s",methods[i].name,out ? "out" : "in");
+			for(j=0;j<sizeof(sizes)/sizeof(sizes[0]);j++) {
+				printf(" %10.1lf",run(t,out,sizes[j]));
+				fflush(stdout);
+			}
+			printf("\n");
+		}
+	}
+
+	printf("\n%-12s %-4s %10s %10s   (MB/s, 256 x 4KB blocks)\n","method","dir","gather","blockwise");
+	for(i=0;i<sizeof(methods)/sizeof(methods[0]);i++) {
+		int out;
+		tracer_copy_methods_set(methods[i].methods);
+		for(out=0;out<=1;out++) {
+			printf("%-12s %-4s %10.1lf %10.1lf\n",methods[i].name,out ? "out" : "in",run_vector(t,out,256,1),run_vector(t,out,256,0));
+		}
+	}
+
+	kill(pid,SIGKILL);
+	tracer_detach(t);
+	waitpid(pid,&status,0);
+
+	return 0;
+}
+
+/* vim: set noexpandtab tabstop=4: */
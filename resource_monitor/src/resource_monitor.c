@@ -182,6 +182,8 @@ struct jx *verbatim_summary_fields; /* fields added to the summary without chang
 
 int    rmonitor_queue_fd = -1;  /* File descriptor of a datagram socket to which (great)
                                   grandchildren processes report to the monitor. */
+struct rmonitor_counters *rmonitor_counters = NULL; /* Shared memory where (great) grandchildren
+                                                       processes count the bytes they transfer. */
 static int rmonitor_inotify_fd = -1;
 
 pid_t  first_process_pid;                 /* pid of the process given at the command line. */
@@ -224,6 +226,8 @@ struct rmsummary *resources_flags;
 struct list *tx_rx_sizes; /* list of network byte counts with a timestamp, to compute bandwidth. */
 int64_t total_bytes_rx;   /* total bytes received */
 int64_t total_bytes_tx;   /* total bytes sent */
+uint64_t counted_bytes_rx; /* bytes received, as last read from the shared counters */
+uint64_t counted_bytes_tx; /* bytes sent, as last read from the shared counters */
 
 const char *sh_cmd_line = NULL;    /* command line passed with the --sh option. */
 
@@ -791,17 +795,17 @@ int rmonitor_handle_inotify(void)
 	return urgent;
 }
 
-void append_network_bw(struct rmonitor_msg *msg) {
+void append_network_bw(int64_t bytes, timestamp_t start, timestamp_t end) {
 
 	/* Avoid division by zero, negative bws */
-	if(msg->end <= msg->start || msg->data.n < 1)
+	if(end <= start || bytes < 1)
 		return;
 
 	struct rmonitor_bw_info *new_tail = malloc(sizeof(struct rmonitor_bw_info));
 
-	new_tail->bit_count = 8*msg->data.n;
-	new_tail->start     = msg->start;
-	new_tail->end       = msg->end;
+	new_tail->bit_count = 8*bytes;
+	new_tail->start     = start;
+	new_tail->end       = end;
 
 	/* we drop entries older than 60s, unless there are less than 4, so
 	 * we can smooth some noise. */
@@ -820,6 +824,39 @@ void append_network_bw(struct rmonitor_msg *msg) {
 	list_push_tail(tx_rx_sizes, new_tail);
 }
 
+/* Add the bytes that the helper counted since the last poll to the totals. */
+void rmonitor_read_counters(void) {
+	uint64_t rx = 0, tx = 0;
+	timestamp_t start = 0, end = 0;
+	int i;
+
+	if(!rmonitor_counters)
+		return;
+
+	for(i = 0; i < RMONITOR_COUNTERS_SLOTS; i++) {
+		struct rmonitor_counters_slot *slot = &rmonitor_counters->slots[i];
+
+		rx += slot->bytes_received;
+		tx += slot->bytes_sent;
+
+		timestamp_t slot_start = __sync_lock_test_and_set(&slot->net_start, 0);
+		if(slot_start > 0 && (start == 0 || slot_start < start))
+			start = slot_start;
+		if(slot->net_end > end)
+			end = slot->net_end;
+	}
+
+	int64_t bytes = (rx - counted_bytes_rx) + (tx - counted_bytes_tx);
+
+	total_bytes_rx += rx - counted_bytes_rx;
+	total_bytes_tx += tx - counted_bytes_tx;
+	counted_bytes_rx = rx;
+	counted_bytes_tx = tx;
+
+	if(start > 0)
+		append_network_bw(bytes, start, end);
+}
+
 int64_t average_bandwidth(int use_min_len) {
 	if(list_size(tx_rx_sizes) == 0)
 		return 0;
@@ -1522,6 +1559,8 @@ struct rmsummary *rmonitor_final_usage_tree(void)
 		tr_usg->cores_avg = tmp_output;
 	}
 
+	rmonitor_read_counters();
+
 	tr_usg->bandwidth      = average_bandwidth(0);
 	tr_usg->bytes_received = total_bytes_rx;
 	tr_usg->bytes_sent     = total_bytes_tx;
@@ -1648,6 +1687,9 @@ void rmonitor_final_cleanup(int signum)
 
     status = rmonitor_final_summary();
 
+	rmonitor_counters_delete(rmonitor_counters);
+	rmonitor_counters = NULL;
+
 	send_catalog_update(summary, 1);
 
 	fclose(log_summary);
@@ -1783,14 +1825,14 @@ int rmonitor_dispatch_msg(void)
 			msg.error = 0;
 			if(msg.data.n > 0) {
 				total_bytes_rx += msg.data.n;
-				append_network_bw(&msg);
+				append_network_bw(msg.data.n, msg.start, msg.end);
 			}
 			break;
 		case TX:
 			msg.error = 0;
 			if(msg.data.n > 0) {
 				total_bytes_tx += msg.data.n;
-				append_network_bw(&msg);
+				append_network_bw(msg.data.n, msg.start, msg.end);
 			}
 			break;
         case READ:
@@ -2096,6 +2138,8 @@ int rmonitor_resources(long int interval /*in seconds */)
 
 		// rmonitor_fss_once(f); disabled until statfs fs id makes sense.
 
+		rmonitor_read_counters();
+
 		rmonitor_collate_tree(resources_now, p_acc, m_acc, d_acc, f_acc);
 		rmonitor_find_max_tree(summary,  resources_now);
 		rmonitor_find_max_tree(snapshot, resources_now);
@@ -2176,6 +2220,8 @@ int main(int argc, char **argv) {
 
 	total_bytes_rx = 0;
 	total_bytes_tx = 0;
+	counted_bytes_rx = 0;
+	counted_bytes_tx = 0;
 	tx_rx_sizes    = list_create();
 
 	snapshot_labels = list_create();
@@ -2480,7 +2526,7 @@ int main(int argc, char **argv) {
     }
 
     write_helper_lib();
-    rmonitor_helper_init(lib_helper_name, &rmonitor_queue_fd, stop_short_running);
+    rmonitor_helper_init(lib_helper_name, &rmonitor_queue_fd, &rmonitor_counters, stop_short_running);
 
 	summary_path = default_summary_name(template_path);
 
@@ -55,6 +55,8 @@
 #define END(msg)   POP_ERRNO(msg) if(msg.type == RX || msg.type == TX) msg.end = timestamp_get(); }
 
 static struct itable *family_of_fd = NULL;
+static struct rmonitor_counters *counters = NULL;
+static struct rmonitor_counters_slot *counters_slot = NULL; /* Slot of this process, or NULL to send messages instead. */
 static uint64_t start_time = 0;
 static uint64_t end_time   = 0;
 
@@ -119,6 +121,13 @@ void rmonitor_helper_initialize() {
 		family_of_fd = itable_create(8);
 	}
 
+	if(!counters) {
+		counters = rmonitor_counters_attach();
+		if(counters) {
+			counters_slot = &counters->slots[getpid() % RMONITOR_COUNTERS_SLOTS];
+		}
+	}
+
 	if(getenv(RESOURCE_MONITOR_ROOT_PROCESS)) {
 		root_process = 1;
 		unsetenv(RESOURCE_MONITOR_ROOT_PROCESS);
@@ -154,6 +163,10 @@ pid_t fork()
 		snprintf(start_tmp, 256, "%" PRId64, timestamp_get());
 		setenv(RESOURCE_MONITOR_PROCESS_START, start_tmp, 1);
 
+		if(counters) {
+			counters_slot = &counters->slots[getpid() % RMONITOR_COUNTERS_SLOTS];
+		}
+
 		struct rmonitor_msg msg;
 		msg.type   = BRANCH;
 
@@ -377,6 +390,19 @@ int socket(int domain, int type, int protocol)
 	return fd;
 }
 
+/* Add the bytes of a transfer to the shared counters, or if they are not
+ * available, report them to the monitor in a message. */
+static void report_transfer(struct rmonitor_msg *msg, ssize_t real_count)
+{
+	if(counters_slot) {
+		rmonitor_counters_add(counters_slot, msg->type, real_count, msg->start, msg->end);
+	} else {
+		msg->origin = getpid();
+		msg->data.n = real_count;
+		send_monitor_msg(msg);
+	}
+}
+
 ssize_t write(int fd, const void *buf, size_t count)
 {
 	struct rmonitor_msg msg;
@@ -385,8 +411,6 @@ ssize_t write(int fd, const void *buf, size_t count)
 		return syscall(SYS_write, fd, buf, count);
 	}
 
-	msg.origin = getpid();
-
 	if(family_of_fd && itable_lookup(family_of_fd, fd)) {
 		msg.type   = TX;
 	} else {
@@ -398,8 +422,14 @@ ssize_t write(int fd, const void *buf, size_t count)
 		real_count = original_write(fd, buf, count);
 	END(msg)
 
-	msg.data.n = real_count;
-	send_monitor_msg(&msg);
+	if(msg.type == TX) {
+		report_transfer(&msg, real_count);
+	} else if(msg.error == ENOSPC) {
+		/* Bytes written to files are read from /proc, so only running out of space is reported. */
+		msg.origin = getpid();
+		msg.data.n = real_count;
+		send_monitor_msg(&msg);
+	}
 
 	return real_count;
 }
@@ -412,21 +442,19 @@ ssize_t read(int fd, void *buf, size_t count)
 		return syscall(SYS_read, fd, buf, count);
 	}
 
-	msg.origin = getpid();
-
-	if(family_of_fd && itable_lookup(family_of_fd, fd)) {
-		msg.type   = RX;
-	} else {
-		msg.type   = READ;
+	/* Bytes read from files are read from /proc, so only network reads are counted. */
+	if(!family_of_fd || !itable_lookup(family_of_fd, fd)) {
+		return original_read(fd, buf, count);
 	}
 
+	msg.type   = RX;
+
 	ssize_t real_count;
 	START(msg)
 		real_count = original_read(fd, buf, count);
 	END(msg)
 
-	msg.data.n = real_count;
-	send_monitor_msg(&msg);
+	report_transfer(&msg, real_count);
 
 	return real_count;
 }
@@ -441,15 +469,13 @@ ssize_t recv(int fd, void *buf, size_t count, int flags)
 	}
 
 	msg.type   = RX;
-	msg.origin = getpid();
 
 	ssize_t real_count;
 	START(msg)
 		real_count = original_recv(fd, buf, count, flags);
 	END(msg)
 
-	msg.data.n = real_count;
-	send_monitor_msg(&msg);
+	report_transfer(&msg, real_count);
 
 	return real_count;
 }
@@ -464,15 +490,13 @@ ssize_t recvfrom(int fd, void *buf, size_t count, int flags, struct sockaddr *sr
 	}
 
 	msg.type   = RX;
-	msg.origin = getpid();
 
 	ssize_t real_count;
 	START(msg)
 		real_count = original_recvfrom(fd, buf, count, flags, src, addrlen);
 	END(msg)
 
-	msg.data.n = real_count;
-	send_monitor_msg(&msg);
+	report_transfer(&msg, real_count);
 
 	return real_count;
 }
@@ -487,15 +511,13 @@ ssize_t send(int fd, const void *buf, size_t count, int flags)
 	}
 
 	msg.type   = TX;
-	msg.origin = getpid();
 
 	ssize_t real_count;
 	START(msg)
 		real_count = original_send(fd, buf, count, flags);
 	END(msg)
 
-	msg.data.n = real_count;
-	send_monitor_msg(&msg);
+	report_transfer(&msg, real_count);
 
 	return real_count;
 }
@@ -510,15 +532,13 @@ ssize_t sendmsg(int fd, const struct msghdr *mg, int flags)
 	}
 
 	msg.type   = TX;
-	msg.origin = getpid();
 
 	ssize_t real_count;
 	START(msg)
 		real_count = original_sendmsg(fd, mg, flags);
 	END(msg)
 
-	msg.data.n = real_count;
-	send_monitor_msg(&msg);
+	report_transfer(&msg, real_count);
 
 	return real_count;
 }
@@ -534,15 +554,13 @@ ssize_t recvmsg(int fd, struct msghdr *mg, int flags)
 	}
 
 	msg.type   = RX;
-	msg.origin = getpid();
 
 	ssize_t real_count;
 	START(msg)
 		real_count = original_recvmsg(fd, mg, flags);
 	END(msg)
 
-	msg.data.n = real_count;
-	send_monitor_msg(&msg);
+	report_transfer(&msg, real_count);
 
 	return real_count;
 }
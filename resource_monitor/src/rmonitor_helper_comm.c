@@ -18,6 +18,7 @@ See the file COPYING for details.
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <limits.h>
 
 #include "stringtools.h"
@@ -221,9 +222,102 @@ int rmonitor_client_open_socket(int *fd, struct addrinfo **addr) {
 	return 0;
 }
 
+/* Name of the shared memory object with the counters, kept to remove it at the end. */
+static char *counters_name = NULL;
+
+static struct rmonitor_counters *rmonitor_counters_create(void)
+{
+	struct rmonitor_counters *counters;
+
+	counters_name = string_format("/cctools-rmonitor-%d-%" PRId64, getpid(), timestamp_get());
+
+	int fd = shm_open(counters_name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if(fd < 0) {
+		debug(D_RMON, "couldn't create shared counters %s: %s", counters_name, strerror(errno));
+		free(counters_name);
+		counters_name = NULL;
+		return NULL;
+	}
+
+	counters = MAP_FAILED;
+	if(ftruncate(fd, sizeof(*counters)) == 0) {
+		counters = mmap(NULL, sizeof(*counters), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+
+	if(counters == MAP_FAILED) {
+		debug(D_RMON, "couldn't map shared counters %s: %s", counters_name, strerror(errno));
+		shm_unlink(counters_name);
+		free(counters_name);
+		counters_name = NULL;
+		return NULL;
+	}
+
+	setenv(RESOURCE_MONITOR_COUNTERS_ENV_VAR, counters_name, 1);
+
+	return counters;
+}
+
+struct rmonitor_counters *rmonitor_counters_attach(void)
+{
+	struct rmonitor_counters *counters;
+
+	const char *name = getenv(RESOURCE_MONITOR_COUNTERS_ENV_VAR);
+	if(!name)
+		return NULL;
+
+	int fd = shm_open(name, O_RDWR, 0);
+	if(fd < 0)
+		return NULL;
+
+	counters = mmap(NULL, sizeof(*counters), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if(counters == MAP_FAILED)
+		return NULL;
+
+	return counters;
+}
+
+void rmonitor_counters_delete(struct rmonitor_counters *counters)
+{
+	if(counters)
+		munmap(counters, sizeof(*counters));
+
+	if(counters_name) {
+		shm_unlink(counters_name);
+		free(counters_name);
+		counters_name = NULL;
+	}
+}
+
+void rmonitor_counters_add(struct rmonitor_counters_slot *slot, enum rmonitor_msg_type type, int64_t count, timestamp_t start, timestamp_t end)
+{
+	if(count < 1)
+		return;
+
+	__sync_bool_compare_and_swap(&slot->net_start, 0, start);
+
+	if(type == RX) {
+		__sync_fetch_and_add(&slot->bytes_received, count);
+	} else {
+		__sync_fetch_and_add(&slot->bytes_sent, count);
+	}
+
+	/* several processes may share the slot, so only move the end forward if no one else did. */
+	timestamp_t current = slot->net_end;
+	while(end > current) {
+		timestamp_t seen = __sync_val_compare_and_swap(&slot->net_end, current, end);
+		if(seen == current)
+			break;
+		current = seen;
+	}
+}
+
  /* We use datagrams to send information to the monitor from the
-  * great grandchildren processes */
-int rmonitor_helper_init(char *lib_default_path, int *fd, int stop_short_running)
+  * great grandchildren processes, and shared counters for the
+  * bytes they transfer. */
+int rmonitor_helper_init(char *lib_default_path, int *fd, struct rmonitor_counters **counters, int stop_short_running)
 {
 	int  port;
 	char *helper_path = rmonitor_helper_locate(lib_default_path);
@@ -271,12 +365,16 @@ int rmonitor_helper_init(char *lib_default_path, int *fd, int stop_short_running
 		debug(D_RMON,"setting %s to %s\n", RESOURCE_MONITOR_INFO_ENV_VAR, rmonitor_port);
 		setenv(RESOURCE_MONITOR_INFO_ENV_VAR, rmonitor_port, 1);
 
+		/* Without counters, the helper reports transfers with messages. */
+		*counters = rmonitor_counters_create();
+
 		free(ld_preload);
 		free(rmonitor_port);
 	}
 	else
 	{
 		*fd = -1;
+		*counters = NULL;
 	}
 
 	free(helper_path);
@@ -15,6 +15,7 @@ See the file COPYING for details.
 #define RESOURCE_MONITOR_ROOT_PROCESS      "CCTOOLS_RESOURCE_ROOT_PROCESS"
 #define RESOURCE_MONITOR_PROCESS_START     "CCTOOLS_RESOURCE_PROCESS_START"
 #define RESOURCE_MONITOR_INFO_ENV_VAR      "CCTOOLS_RESOURCE_MONITOR_INFO"
+#define RESOURCE_MONITOR_COUNTERS_ENV_VAR  "CCTOOLS_RESOURCE_MONITOR_COUNTERS"
 
 // in useconds
 #define RESOURCE_MONITOR_SHORT_TIME      250000
@@ -26,10 +27,10 @@ enum rmonitor_msg_type { BRANCH, WAIT, END_WAIT, END, CHDIR, OPEN_INPUT, OPEN_OU
  * CHDIR:  new working directory
  * OPEN_INPUT:  path of the file opened, or "" if not a regular file.
  * OPEN_OUTPUT: path of the file opened, or "" if not a regular file.
- * READ:   Number of bytes read.
- * WRITE:  Number of bytes written.
- * RX:     Number of bytes received.
- * TX:     Number of bytes sent.
+ * READ:   Number of bytes read. (no longer sent by the helper)
+ * WRITE:  Number of bytes written. (only sent when the disk is full)
+ * RX:     Number of bytes received. (only sent without counters)
+ * TX:     Number of bytes sent.     (only sent without counters)
  * SNAPSHOT: snapshot name
  */
 
@@ -47,7 +48,37 @@ struct rmonitor_msg
 	}                     data;
 };
 
-int rmonitor_helper_init(char *path_from_cmdline, int *fd, int stop_short_running);
+/* Number of slots in the block of counters. Each process adds to the slot
+ * of its pid, so that processes running at the same time seldom contend
+ * for the same cache line. */
+#define RMONITOR_COUNTERS_SLOTS 64
+
+/* Rather than sending a message for every transfer, the helper adds the
+ * bytes received and sent to counters in shared memory, which the monitor
+ * reads every time it polls.
+ * net_start: start of the first transfer since the monitor last read the slot, or 0.
+ * net_end:   end of the latest transfer.
+ */
+
+struct rmonitor_counters_slot
+{
+	uint64_t bytes_received;
+	uint64_t bytes_sent;
+	uint64_t net_start;
+	uint64_t net_end;
+	uint64_t padding[4];
+};
+
+struct rmonitor_counters
+{
+	struct rmonitor_counters_slot slots[RMONITOR_COUNTERS_SLOTS];
+};
+
+int rmonitor_helper_init(char *path_from_cmdline, int *fd, struct rmonitor_counters **counters, int stop_short_running);
+
+struct rmonitor_counters *rmonitor_counters_attach(void);
+void rmonitor_counters_delete(struct rmonitor_counters *counters);
+void rmonitor_counters_add(struct rmonitor_counters_slot *slot, enum rmonitor_msg_type type, int64_t count, timestamp_t start, timestamp_t end);
 
 const char *str_msgtype(enum rmonitor_msg_type n);
 
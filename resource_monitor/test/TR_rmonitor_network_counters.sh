@@ -0,0 +1,133 @@
+#!/bin/sh
+
+# More processes than there are counter slots move data over sockets at the
+# same time. The monitor must report every byte sent and received.
+
+. ../../dttools/test/test_runner_common.sh
+
+exe="network_counters.test"
+output="network_counters"
+
+PAIRS=80
+LENGTH=100000
+
+check_needed()
+{
+	# do not run the test if not on linux.
+	[ -d /proc ] || exit 1
+}
+
+prepare()
+{
+	${CC} -g $CCTOOLS_TEST_CCFLAGS -o "$exe" -x c - <<EOF
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define PAIRS $PAIRS
+#define LENGTH $LENGTH
+#define CHUNK 1000
+
+static void sender(int fd)
+{
+	char buf[CHUNK];
+	int sent = 0;
+
+	memset(buf, 'x', sizeof(buf));
+	while(sent < LENGTH) {
+		ssize_t n = send(fd, buf, sizeof(buf), 0);
+		if(n <= 0)
+			_exit(1);
+		sent += n;
+	}
+	_exit(0);
+}
+
+static void receiver(int fd)
+{
+	char buf[CHUNK];
+	int received = 0;
+
+	while(received < LENGTH) {
+		ssize_t n = recv(fd, buf, sizeof(buf), 0);
+		if(n <= 0)
+			_exit(1);
+		received += n;
+	}
+	_exit(0);
+}
+
+int main(int argc, char *argv[])
+{
+	int i, status, failed = 0;
+
+	/* All pairs are started before any is waited for, so they share the counter slots. */
+	for(i = 0; i < PAIRS; i++) {
+		int fds[2];
+		if(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+			return 1;
+		if(fork() == 0) {
+			close(fds[1]);
+			sender(fds[0]);
+		}
+		if(fork() == 0) {
+			close(fds[0]);
+			receiver(fds[1]);
+		}
+		close(fds[0]);
+		close(fds[1]);
+	}
+
+	while(wait(&status) > 0) {
+		if(!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			failed = 1;
+	}
+
+	return failed;
+}
+EOF
+	return $?
+}
+
+# the value of a resource in the summary, which is written as "name": [ value, "units" ]
+summary_value()
+{
+	awk -v name="\"$1\":" '$1 == name { getline; getline; sub(",", "", $1); print $1; exit }' $output.summary
+}
+
+run()
+{
+	if ! ../src/resource_monitor -O $output -- ./"$exe"
+	then
+		echo "the monitored program failed"
+		return 1
+	fi
+
+	expected=$((PAIRS*LENGTH))
+
+	for resource in bytes_sent bytes_received
+	do
+		# the summary reports bytes in MB.
+		value=`summary_value $resource | awk '{ printf "%.0f", $1 * 1048576 }'`
+		echo "$resource: $value bytes, expected $expected bytes"
+		if [ "$value" != "$expected" ]
+		then
+			cat $output.summary
+			return 1
+		fi
+	done
+
+	return 0
+}
+
+clean()
+{
+	rm -f "$exe" $output.summary
+	return 0
+}
+
+dispatch "$@"
+
+# vim: set noexpandtab tabstop=4:
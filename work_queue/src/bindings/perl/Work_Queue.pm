@@ -214,6 +214,11 @@ sub specify_algorithm {
 	return work_queue_specify_algorithm($self->{_work_queue}, $algorithm);
 }
 
+sub specify_content_cache {
+	my ($self, $flag) = @_;
+	return work_queue_specify_content_cache($self->{_work_queue}, $flag);
+}
+
 sub specify_task_order {
 	my ($self, $order) = @_;
 	return work_queue_specify_task_order($self->{_work_queue}, $order);
@@ -707,6 +712,20 @@ One of the following algorithms to use in assigning a task to a worker:
 
 =back
 
+=head3 C<specify_content_cache>
+
+Name cached input files by their contents rather than by their paths. The
+same data is then sent to a worker only once, whatever its path, and workers
+keep it for other masters that also enable this mode.
+
+=over 12
+
+=item flag
+
+1 to enable, 0 to disable (the default).
+
+=back
+
 =head3 C<specify_task_order>
 
 Set the order for dispatching submitted tasks in the queue to workers:
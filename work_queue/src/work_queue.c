@@ -28,6 +28,7 @@ The following major problems must be fixed:
 #include "interfaces_address.h"
 #include "itable.h"
 #include "list.h"
+#include "priority_queue.h"
 #include "macros.h"
 #include "username.h"
 #include "create_dir.h"
@@ -43,6 +44,7 @@ The following major problems must be fixed:
 #include "process.h"
 #include "path.h"
 #include "md5.h"
+#include "sha1.h"
 #include "url_encode.h"
 #include "jx_print.h"
 #include "shell.h"
@@ -57,6 +59,7 @@ The following major problems must be fixed:
 #include <sys/wait.h>
 #include <assert.h>
 #include <errno.h>
+#include <float.h>
 #include <limits.h>
 #include <math.h>
 #include <stdarg.h>
@@ -145,14 +148,25 @@ struct work_queue {
 	char workingdir[PATH_MAX];
 
 	struct link      *master_link;   // incoming tcp connection for workers.
-	struct link_info *poll_table;
+	struct link_poller *poller;      // master link and worker links, to wait for activity.
+	struct link_info *poll_table;    // links found ready by the poller.
 	int poll_table_size;
+	int master_link_active;          // new workers are waiting to connect.
 
 	struct itable *tasks;           // taskid -> task
 	struct itable *task_state_map;  // taskid -> state
-	struct list   *ready_list;      // ready to be sent to a worker
+	struct priority_queue *ready_list;   // ready to be sent to a worker, by priority
+	struct priority_queue *ready_expiry; // ready tasks with an end time, earliest end first
+	double resubmit_priority;            // priority of the task last resubmitted after resource exhaustion
+	struct list   *waiting_retrieval_list; // results available at a worker
+	struct list   *retrieved_list;  // results available at the master
+	struct itable *task_state_cursors; // taskid -> cursor on the task in the list of its state
+
+	struct work_queue_task_counts *task_counts;    // tasks per state and allocation label
+	struct hash_table *category_task_counts;       // category name -> work_queue_task_counts
 
 	struct hash_table *worker_table;
+	struct priority_queue *workers_by_free_cores;  // workers, most free cores first
 	struct hash_table *worker_blacklist;
 	struct itable  *worker_task_map;
 
@@ -167,6 +181,9 @@ struct work_queue {
 
 	int worker_selection_algorithm;
 	int task_ordering;
+
+	int content_cache;                  /* name cacheable input files by their contents. */
+	struct hash_table *content_hashes;  /* "device:inode" -> struct content_hash */
 	int process_pending_check;
 
 	int short_timeout;		// timeout to send/recv a brief message from worker
@@ -244,6 +261,20 @@ struct work_queue_worker {
 	timestamp_t last_update_msg_time;
 };
 
+/* Number of tasks in q->tasks by state and by resource allocation label.
+ * Kept current by change_task_state, so that the queries in the main loop
+ * do not need to walk the whole task table. */
+struct work_queue_task_counts {
+	int state[WORK_QUEUE_TASK_CANCELED + 1];
+	int request[CATEGORY_ALLOCATION_ERROR + 1];
+};
+
+struct content_hash {
+	time_t mtime;
+	off_t size;
+	char digest[SHA1_DIGEST_LENGTH * 2 + 1];
+};
+
 struct work_queue_task_report {
 	timestamp_t transfer_time;
 	timestamp_t exec_time;
@@ -270,6 +301,8 @@ static void commit_task_to_worker(struct work_queue *q, struct work_queue_worker
 static void reap_task_from_worker(struct work_queue *q, struct work_queue_worker *w, struct work_queue_task *t, work_queue_task_state_t new_state);
 static int cancel_task_on_worker(struct work_queue *q, struct work_queue_task *t, work_queue_task_state_t new_state);
 static void count_worker_resources(struct work_queue *q, struct work_queue_worker *w);
+static void index_worker_free_cores(struct work_queue *q, struct work_queue_worker *w);
+static void index_all_workers_free_cores(struct work_queue *q);
 
 static void find_max_worker(struct work_queue *q);
 static void update_max_worker(struct work_queue *q, struct work_queue_worker *w);
@@ -279,6 +312,8 @@ static void push_task_to_ready_list( struct work_queue *q, struct work_queue_tas
 /* returns old state */
 static work_queue_task_state_t change_task_state( struct work_queue *q, struct work_queue_task *t, work_queue_task_state_t new_state);
 
+static void change_task_resource_request(struct work_queue *q, struct work_queue_task *t, category_allocation_t request);
+
 const char *task_state_str(work_queue_task_state_t state);
 const char *task_result_str(work_queue_result_t result);
 
@@ -300,6 +335,8 @@ static work_queue_msg_code_t process_workqueue(struct work_queue *q, struct work
 static work_queue_msg_code_t process_queue_status(struct work_queue *q, struct work_queue_worker *w, const char *line, time_t stoptime);
 static work_queue_msg_code_t process_resource(struct work_queue *q, struct work_queue_worker *w, const char *line);
 static work_queue_msg_code_t process_feature(struct work_queue *q, struct work_queue_worker *w, const char *line);
+static work_queue_msg_code_t process_cache_update(struct work_queue *q, struct work_queue_worker *w, const char *line);
+static work_queue_msg_code_t process_cache_invalid(struct work_queue *q, struct work_queue_worker *w, const char *line);
 
 static struct jx * queue_to_jx( struct work_queue *q, struct link *foreman_uplink );
 static struct jx * queue_lean_to_jx( struct work_queue *q, struct link *foreman_uplink );
@@ -411,16 +448,17 @@ static void log_queue_stats(struct work_queue *q)
 {
 	struct work_queue_stats s;
 
-	work_queue_get_stats(q, &s);
-
 	debug(D_WQ, "workers connections -- known: %d, connecting: %d, available: %d.",
-			s.workers_connected,
-			s.workers_init,
+			count_workers(q, WORKER_TYPE_WORKER | WORKER_TYPE_FOREMAN),
+			count_workers(q, WORKER_TYPE_UNKNOWN),
 			available_workers(q));
 
 	if(!q->logfile)
 		return;
 
+	/* computing the stats visits every waiting task, thus only done when they are written. */
+	work_queue_get_stats(q, &s);
+
 	buffer_t B;
 	buffer_init(&B);
 
@@ -650,6 +688,10 @@ static work_queue_msg_code_t recv_worker_msg(struct work_queue *q, struct work_q
 		result = process_resource(q, w, line);
 	} else if (string_prefix_is(line, "feature")) {
 		result = process_feature(q, w, line);
+	} else if (string_prefix_is(line, "cache-update")) {
+		result = process_cache_update(q, w, line);
+	} else if (string_prefix_is(line, "cache-invalid")) {
+		result = process_cache_invalid(q, w, line);
 	} else if (string_prefix_is(line, "auth")) {
 		debug(D_WQ|D_NOTICE,"worker (%s) is attempting to use a password, but I do not have one.",w->addrport);
 		result = MSG_FAILURE;
@@ -907,6 +949,7 @@ static void remove_worker(struct work_queue *q, struct work_queue_worker *w, wor
 
 	hash_table_remove(q->worker_table, w->hashkey);
 	hash_table_remove(q->workers_with_available_results, w->hashkey);
+	priority_queue_remove(q->workers_by_free_cores, w);
 
 	record_removed_worker_stats(q, w);
 
@@ -970,6 +1013,12 @@ static void add_worker(struct work_queue *q)
 
 	debug(D_WQ,"worker %s:%d connected",addr,port);
 
+	if(!link_poller_add(q->poller, link, LINK_READ)) {
+		debug(D_NOTICE, "Cannot wait for messages from worker %s:%d: %s", addr, port, strerror(errno));
+		link_close(link);
+		return;
+	}
+
 	if(q->password) {
 		debug(D_WQ,"worker %s:%d authenticating",addr,port);
 		if(!link_auth_password(link,q->password,time(0)+q->short_timeout)) {
@@ -1010,6 +1059,7 @@ static void add_worker(struct work_queue *q)
 	link_to_hash_key(link, w->hashkey);
 	sprintf(w->addrport, "%s:%d", addr, port);
 	hash_table_insert(q->worker_table, w->hashkey, w);
+	index_worker_free_cores(q, w);
 
 	return;
 }
@@ -1182,6 +1232,73 @@ including a hash and a name where one is known, or another
 unique identifier where no name is available.
 */
 
+static int cached_name_is_content(const char *cached_name)
+{
+	return string_prefix_is(cached_name, "content-");
+}
+
+/*
+When the content cache is enabled, cacheable input files are named by a
+hash of their contents rather than of their paths. The hash of a file is
+remembered by device and inode, and only computed again when the size or
+modification time of the file change.
+*/
+static char *make_content_cached_name(struct work_queue *q, const char *path)
+{
+	struct stat info;
+
+	if(stat(path, &info) != 0 || !S_ISREG(info.st_mode)) {
+		return NULL;
+	}
+
+	char *key = string_format("%llu:%llu", (unsigned long long) info.st_dev, (unsigned long long) info.st_ino);
+	struct content_hash *h = hash_table_lookup(q->content_hashes, key);
+
+	if(!h || h->mtime != info.st_mtime || h->size != info.st_size) {
+		unsigned char digest[SHA1_DIGEST_LENGTH];
+
+		if(!sha1_file(path, digest)) {
+			debug(D_NOTICE, "Cannot hash contents of %s: %s", path, strerror(errno));
+			free(key);
+			return NULL;
+		}
+
+		if(!h) {
+			h = malloc(sizeof(*h));
+			hash_table_insert(q->content_hashes, key, h);
+		}
+
+		h->mtime = info.st_mtime;
+		h->size  = info.st_size;
+		strcpy(h->digest, sha1_string(digest));
+
+		debug(D_WQ, "contents of %s hashed to %s", path, h->digest);
+	}
+
+	free(key);
+
+	return string_format("content-%s", h->digest);
+}
+
+/* Payloads with $OS or $ARCH name different files for each worker, thus they keep their path-based names. */
+static void name_input_files_by_content(struct work_queue *q, struct work_queue_task *t)
+{
+	struct work_queue_file *f;
+
+	list_first_item(t->input_files);
+	while((f = list_next_item(t->input_files))) {
+		if(f->type != WORK_QUEUE_FILE || !(f->flags & WORK_QUEUE_CACHE) || strchr(f->payload, '$')) {
+			continue;
+		}
+
+		char *cached_name = make_content_cached_name(q, f->payload);
+		if(cached_name) {
+			free(f->cached_name);
+			f->cached_name = cached_name;
+		}
+	}
+}
+
 char *make_cached_name( const struct work_queue_task *t, const struct work_queue_file *f )
 {
 	static unsigned int file_count = 0;
@@ -1574,7 +1691,7 @@ static void fetch_output_from_worker(struct work_queue *q, struct work_queue_wor
 		}
 		else {
 			debug(D_WQ, "Task %d resubmitted using new resource allocation.\n", t->taskid);
-			t->resource_request = next;
+			change_task_resource_request(q, t, next);
 			change_task_state(q, t, WORK_QUEUE_TASK_READY);
 			return;
 		}
@@ -1633,26 +1750,17 @@ static int expire_waiting_tasks(struct work_queue *q)
 {
 	struct work_queue_task *t;
 	int expired = 0;
-	int count;
+
+	double priority;
 
 	timestamp_t current_time = timestamp_get();
-	count = task_state_count(q, NULL, WORK_QUEUE_TASK_READY);
 
-	while(count > 0)
+	/* tasks are ordered by -end, so only the expired ones are visited. */
+	while(priority_queue_top_priority(q->ready_expiry, &priority) && (uint64_t) -priority <= current_time)
 	{
-		count--;
-
-		t = list_pop_head(q->ready_list);
-
-		if(t->resources_requested->end > 0 && (uint64_t) t->resources_requested->end <= current_time)
-		{
-			expire_waiting_task(q, t);
-			expired++;
-		}
-		else
-		{
-			list_push_tail(q->ready_list, t);
-		}
+		t = priority_queue_peek_top(q->ready_expiry);
+		expire_waiting_task(q, t);
+		expired++;
 	}
 
 	return expired;
@@ -2043,8 +2151,9 @@ static struct rmsummary *largest_waiting_declared_resources(struct work_queue *q
 	struct rmsummary *max_resources_waiting = rmsummary_create(-1);
 	struct work_queue_task *t;
 
-	list_first_item(q->ready_list);
-	while((t = list_next_item(q->ready_list))) {
+	int i;
+	for(i = 0; i < priority_queue_size(q->ready_list); i++) {
+		t = priority_queue_peek_at(q->ready_list, i);
 
 		if(!category || (t->category && !strcmp(t->category, category))) {
 			rmsummary_merge_max(max_resources_waiting, t->resources_requested);
@@ -2066,8 +2175,9 @@ static struct rmsummary  *total_resources_needed(struct work_queue *q) {
 	struct rmsummary *total = rmsummary_create(0);
 
 	/* for waiting tasks, we use what they would request if dispatched right now. */
-	list_first_item(q->ready_list);
-	while((t = list_next_item(q->ready_list))) {
+	int i;
+	for(i = 0; i < priority_queue_size(q->ready_list); i++) {
+		t = priority_queue_peek_at(q->ready_list, i);
 		const struct rmsummary *s = task_min_resources(q, t);
 		rmsummary_add(total, s);
 	}
@@ -2095,8 +2205,9 @@ static struct rmsummary *largest_waiting_measured_resources(struct work_queue *q
 	struct rmsummary *max_resources_waiting = rmsummary_create(-1);
 	struct work_queue_task *t;
 
-	list_first_item(q->ready_list);
-	while((t = list_next_item(q->ready_list))) {
+	int i;
+	for(i = 0; i < priority_queue_size(q->ready_list); i++) {
+		t = priority_queue_peek_at(q->ready_list, i);
 
 		if(!category || (t->category && !strcmp(t->category, category))) {
 			const struct rmsummary *r = task_min_resources(q, t);
@@ -2701,6 +2812,63 @@ static work_queue_msg_code_t process_feature( struct work_queue *q, struct work_
 	return MSG_PROCESSED;
 }
 
+/*
+A worker reports the files it kept in its cache from previous masters.
+Only files named by their contents are kept, thus they can be used by
+any task that names an input file the same way.
+*/
+static work_queue_msg_code_t process_cache_update( struct work_queue *q, struct work_queue_worker *w, const char *line )
+{
+	char cached_name[WORK_QUEUE_LINE_MAX];
+	int64_t size;
+
+	int n = sscanf(line, "cache-update %s %" SCNd64, cached_name, &size);
+
+	if(n != 2 || !cached_name_is_content(cached_name)) {
+		return MSG_FAILURE;
+	}
+
+	struct stat *remote_info = hash_table_lookup(w->current_files, cached_name);
+	if(!remote_info) {
+		remote_info = calloc(1, sizeof(*remote_info));
+		if(!remote_info) {
+			debug(D_NOTICE, "Cannot allocate memory for cache entry %s at %s (%s)", cached_name, w->hostname, w->addrport);
+			return MSG_FAILURE;
+		}
+		hash_table_insert(w->current_files, cached_name, remote_info);
+	}
+	remote_info->st_size = size;
+
+	debug(D_WQ, "%s (%s) has %s in its cache", w->hostname, w->addrport, cached_name);
+
+	return MSG_PROCESSED;
+}
+
+/*
+A worker evicted a file from its cache to make room for others. A task
+already sent that needs the file is forsaken by the worker, and the file
+is sent again when the task is dispatched anew.
+*/
+static work_queue_msg_code_t process_cache_invalid( struct work_queue *q, struct work_queue_worker *w, const char *line )
+{
+	char cached_name[WORK_QUEUE_LINE_MAX];
+
+	int n = sscanf(line, "cache-invalid %s", cached_name);
+
+	if(n != 1) {
+		return MSG_FAILURE;
+	}
+
+	struct stat *remote_info = hash_table_remove(w->current_files, cached_name);
+	if(remote_info) {
+		free(remote_info);
+	}
+
+	debug(D_WQ, "%s (%s) evicted %s from its cache", w->hostname, w->addrport, cached_name);
+
+	return MSG_PROCESSED;
+}
+
 static work_queue_result_code_t handle_worker(struct work_queue *q, struct link *l)
 {
 	char line[WORK_QUEUE_LINE_MAX];
@@ -2731,12 +2899,8 @@ static work_queue_result_code_t handle_worker(struct work_queue *q, struct link
 	return SUCCESS;
 }
 
-static int build_poll_table(struct work_queue *q, struct link *master)
+static void resize_poll_table(struct work_queue *q)
 {
-	int n = 0;
-	char *key;
-	struct work_queue_worker *w;
-
 	// Allocate a small table, if it hasn't been done yet.
 	if(!q->poll_table) {
 		q->poll_table = malloc(sizeof(*q->poll_table) * q->poll_table_size);
@@ -2746,40 +2910,18 @@ static int build_poll_table(struct work_queue *q, struct link *master)
 		}
 	}
 
-	// The first item in the poll table is the master link, which accepts new connections.
-	q->poll_table[0].link = q->master_link;
-	q->poll_table[0].events = LINK_READ;
-	q->poll_table[0].revents = 0;
-	n = 1;
-
-	if(master) {
-		/* foreman uplink */
-		q->poll_table[1].link = master;
-		q->poll_table[1].events = LINK_READ;
-		q->poll_table[1].revents = 0;
-		n++;
-	}
-
-	// For every worker in the hash table, add an item to the poll table
-	hash_table_firstkey(q->worker_table);
-	while(hash_table_nextkey(q->worker_table, &key, (void **) &w)) {
-		// If poll table is not large enough, reallocate it
-		if(n >= q->poll_table_size) {
+	// The table should fit the master link, the foreman uplink, and every worker.
+	int n = hash_table_size(q->worker_table) + 2;
+	if(n > q->poll_table_size) {
+		while(n > q->poll_table_size) {
 			q->poll_table_size *= 2;
-			q->poll_table = realloc(q->poll_table, sizeof(*q->poll_table) * q->poll_table_size);
-			if(q->poll_table == NULL) {
-				//if we can't allocate a poll table, we can't do anything else.
-				fatal("reallocating memory for poll table failed.");
-			}
 		}
-
-		q->poll_table[n].link = w->link;
-		q->poll_table[n].events = LINK_READ;
-		q->poll_table[n].revents = 0;
-		n++;
+		q->poll_table = realloc(q->poll_table, sizeof(*q->poll_table) * q->poll_table_size);
+		if(q->poll_table == NULL) {
+			//if we can't allocate a poll table, we can't do anything else.
+			fatal("reallocating memory for poll table failed.");
+		}
 	}
-
-	return n;
 }
 
 static int send_file( struct work_queue *q, struct work_queue_worker *w, struct work_queue_task *t, const char *localname, const char *remotename, off_t offset, int64_t length, int64_t *total_bytes, int flags)
@@ -2921,8 +3063,8 @@ static work_queue_result_code_t send_file_or_directory( struct work_queue *q, st
 
 	/* If it is in the worker, but a new version is available, warn and return.
 	   We do not want to rewrite the file while some other task may be using
-	   it. */
-	if(remote_info && (remote_info->st_mtime != local_info.st_mtime || remote_info->st_size != local_info.st_size)) {
+	   it. Files named by their contents cannot be out of date. */
+	if(remote_info && !cached_name_is_content(tf->cached_name) && (remote_info->st_mtime != local_info.st_mtime || remote_info->st_size != local_info.st_size)) {
 		debug(D_NOTICE|D_WQ, "File %s changed locally. Task %d will be executed with an older version.", expanded_local_name, t->taskid);
 	}
 	else if(!remote_info) {
@@ -3413,7 +3555,86 @@ void compute_master_load(struct work_queue *q, int task_activity) {
 	q->stats->master_load = load;
 }
 
-static int check_hand_against_task(struct work_queue *q, struct work_queue_worker *w, struct work_queue_task *t) {
+/* Free cores of a worker, counting overcommit. Workers that do not report
+ * cores (e.g., not yet initialized) get the top value, so they are always
+ * considered when looking for a worker. */
+static double worker_free_cores(struct work_queue *q, struct work_queue_worker *w)
+{
+	if(w->resources->cores.total < 1) {
+		return DBL_MAX;
+	}
+
+	return overcommitted_resource_total(q, w->resources->cores.total, 1) - w->resources->cores.inuse;
+}
+
+/* Workers are indexed by free cores, and then by free memory (in MB), which
+ * is kept below WORKER_INDEX_MEMORY_SCALE so that it only breaks ties. */
+#define WORKER_INDEX_MEMORY_SCALE 4294967296.0
+
+static double worker_index_priority(struct work_queue *q, struct work_queue_worker *w)
+{
+	double cores = worker_free_cores(q, w);
+	if(cores == DBL_MAX) {
+		return DBL_MAX;
+	}
+
+	double memory = overcommitted_resource_total(q, w->resources->memory.total, 0) - w->resources->memory.inuse;
+	memory = MAX(0, MIN(memory, WORKER_INDEX_MEMORY_SCALE - 1));
+
+	return cores * WORKER_INDEX_MEMORY_SCALE + memory;
+}
+
+static void index_worker_free_cores(struct work_queue *q, struct work_queue_worker *w)
+{
+	priority_queue_remove(q->workers_by_free_cores, w);
+	priority_queue_push(q->workers_by_free_cores, w, worker_index_priority(q, w));
+}
+
+static void index_all_workers_free_cores(struct work_queue *q)
+{
+	char *key;
+	struct work_queue_worker *w;
+
+	hash_table_firstkey(q->worker_table);
+	while(hash_table_nextkey(q->worker_table, &key, (void **) &w)) {
+		index_worker_free_cores(q, w);
+	}
+}
+
+/* The minimum and maximum resources of a task do not depend on the worker,
+ * so they are computed once per task, rather than once per worker considered. */
+struct task_fit {
+	struct task_fit_resources {
+		int64_t cores;
+		int64_t memory;
+		int64_t disk;
+		int64_t gpus;
+	} min, max;
+
+	/* no worker with less free cores than this can run the task. */
+	int64_t cores_needed;
+};
+
+static void task_fit_compute(struct work_queue *q, struct work_queue_task *t, struct task_fit *fit)
+{
+	/* task_min_resources and task_max_resources return static buffers. */
+	const struct rmsummary *max = task_max_resources(q, t);
+	fit->max.cores  = max->cores;
+	fit->max.memory = max->memory;
+	fit->max.disk   = max->disk;
+	fit->max.gpus   = max->gpus;
+
+	const struct rmsummary *min = task_min_resources(q, t);
+	fit->min.cores  = min->cores;
+	fit->min.memory = min->memory;
+	fit->min.disk   = min->disk;
+	fit->min.gpus   = min->gpus;
+
+	/* without explicit cores, the task takes at least one whole core of the worker. */
+	fit->cores_needed = fit->max.cores > -1 ? fit->max.cores : 1;
+}
+
+static int check_hand_against_task(struct work_queue *q, struct work_queue_worker *w, struct work_queue_task *t, struct task_fit *fit) {
 
 	/* worker has no reported any resources yet */
 	if(w->resources->tag < 0)
@@ -3434,28 +3655,25 @@ static int check_hand_against_task(struct work_queue *q, struct work_queue_worke
 		}
 	}
 
-	struct rmsummary *limits = task_worker_box_size(q, w, t);
-
-	int ok = 1;
+	struct task_fit_resources *min = &fit->min;
+	struct task_fit_resources *max = &fit->max;
 
-	if(w->resources->cores.inuse + limits->cores > overcommitted_resource_total(q, w->resources->cores.total, 1)) {
-		ok = 0;
+	if(w->resources->cores.inuse + task_worker_box_size_resource(w, min, max, cores) > overcommitted_resource_total(q, w->resources->cores.total, 1)) {
+		return 0;
 	}
 
-	if(w->resources->memory.inuse + limits->memory > overcommitted_resource_total(q, w->resources->memory.total, 0)) {
-		ok = 0;
+	if(w->resources->memory.inuse + task_worker_box_size_resource(w, min, max, memory) > overcommitted_resource_total(q, w->resources->memory.total, 0)) {
+		return 0;
 	}
 
-	if(w->resources->disk.inuse + limits->disk > w->resources->disk.total) { /* No overcommit disk */
-		ok = 0;
+	if(w->resources->disk.inuse + task_worker_box_size_resource(w, min, max, disk) > w->resources->disk.total) { /* No overcommit disk */
+		return 0;
 	}
 
-	if(w->resources->gpus.inuse + limits->gpus > overcommitted_resource_total(q, w->resources->gpus.total, 0)) {
-		ok = 0;
+	if(w->resources->gpus.inuse + task_worker_box_size_resource(w, min, max, gpus) > overcommitted_resource_total(q, w->resources->gpus.total, 0)) {
+		return 0;
 	}
 
-	rmsummary_delete(limits);
-
 	if(t->features) {
 		if(!w->features)
 			return 0;
@@ -3468,12 +3686,36 @@ static int check_hand_against_task(struct work_queue *q, struct work_queue_worke
 		}
 	}
 
-	return ok;
+	return 1;
 }
 
-static struct work_queue_worker *find_worker_by_files(struct work_queue *q, struct work_queue_task *t)
+/* Begin and continue iteration over the workers that may fit the task, from
+ * the most to the least free cores. Workers with fewer free cores than the
+ * task needs are never visited. */
+static void first_candidate_worker(struct work_queue *q)
+{
+	priority_queue_first_item(q->workers_by_free_cores);
+}
+
+static struct work_queue_worker *next_candidate_worker(struct work_queue *q, struct work_queue_task *t, struct task_fit *fit)
+{
+	struct work_queue_worker *w;
+
+	while((w = priority_queue_next_item(q->workers_by_free_cores))) {
+		if(worker_free_cores(q, w) < fit->cores_needed) {
+			return NULL;
+		}
+
+		if(check_hand_against_task(q, w, t, fit)) {
+			return w;
+		}
+	}
+
+	return NULL;
+}
+
+static struct work_queue_worker *find_worker_by_files(struct work_queue *q, struct work_queue_task *t, struct task_fit *fit)
 {
-	char *key;
 	struct work_queue_worker *w;
 	struct work_queue_worker *best_worker = 0;
 	int64_t most_task_cached_bytes = 0;
@@ -3481,54 +3723,42 @@ static struct work_queue_worker *find_worker_by_files(struct work_queue *q, stru
 	struct stat *remote_info;
 	struct work_queue_file *tf;
 
-	hash_table_firstkey(q->worker_table);
-	while(hash_table_nextkey(q->worker_table, &key, (void **) &w)) {
-		if( check_hand_against_task(q, w, t) ) {
-			task_cached_bytes = 0;
-			list_first_item(t->input_files);
-			while((tf = list_next_item(t->input_files))) {
-				if((tf->type == WORK_QUEUE_FILE || tf->type == WORK_QUEUE_FILE_PIECE) && (tf->flags & WORK_QUEUE_CACHE)) {
-					remote_info = hash_table_lookup(w->current_files, tf->cached_name);
-					if(remote_info)
-						task_cached_bytes += remote_info->st_size;
-				}
+	first_candidate_worker(q);
+	while((w = next_candidate_worker(q, t, fit))) {
+		task_cached_bytes = 0;
+		list_first_item(t->input_files);
+		while((tf = list_next_item(t->input_files))) {
+			if((tf->type == WORK_QUEUE_FILE || tf->type == WORK_QUEUE_FILE_PIECE) && (tf->flags & WORK_QUEUE_CACHE)) {
+				remote_info = hash_table_lookup(w->current_files, tf->cached_name);
+				if(remote_info)
+					task_cached_bytes += remote_info->st_size;
 			}
+		}
 
-			if(!best_worker || task_cached_bytes > most_task_cached_bytes) {
-				best_worker = w;
-				most_task_cached_bytes = task_cached_bytes;
-			}
+		if(!best_worker || task_cached_bytes > most_task_cached_bytes) {
+			best_worker = w;
+			most_task_cached_bytes = task_cached_bytes;
 		}
 	}
 
 	return best_worker;
 }
 
-static struct work_queue_worker *find_worker_by_fcfs(struct work_queue *q, struct work_queue_task *t)
+static struct work_queue_worker *find_worker_by_fcfs(struct work_queue *q, struct work_queue_task *t, struct task_fit *fit)
 {
-	char *key;
-	struct work_queue_worker *w;
-	hash_table_firstkey(q->worker_table);
-	while(hash_table_nextkey(q->worker_table, &key, (void**)&w)) {
-		if( check_hand_against_task(q, w, t) ) {
-			return w;
-		}
-	}
-	return NULL;
+	first_candidate_worker(q);
+	return next_candidate_worker(q, t, fit);
 }
 
-static struct work_queue_worker *find_worker_by_random(struct work_queue *q, struct work_queue_task *t)
+static struct work_queue_worker *find_worker_by_random(struct work_queue *q, struct work_queue_task *t, struct task_fit *fit)
 {
-	char *key;
 	struct work_queue_worker *w = NULL;
 	int random_worker;
 	struct list *valid_workers = list_create();
 
-	hash_table_firstkey(q->worker_table);
-	while(hash_table_nextkey(q->worker_table, &key, (void**)&w)) {
-		if(check_hand_against_task(q, w, t)) {
-			list_push_tail(valid_workers, w);
-		}
+	first_candidate_worker(q);
+	while((w = next_candidate_worker(q, t, fit))) {
+		list_push_tail(valid_workers, w);
 	}
 
 	w = NULL;
@@ -3545,90 +3775,28 @@ static struct work_queue_worker *find_worker_by_random(struct work_queue *q, str
 	return w;
 }
 
-// 1 if a < b, 0 if a >= b
-static int compare_worst_fit(struct work_queue_resources *a, struct work_queue_resources *b)
+/* Candidates come by decreasing free cores, and then free memory, thus the
+ * first one that fits is the worst fit. Workers equal in cores and memory are
+ * taken in index order rather than by free disk and gpus. */
+static struct work_queue_worker *find_worker_by_worst_fit(struct work_queue *q, struct work_queue_task *t, struct task_fit *fit)
 {
-	//Total worker order: free cores > free memory > free disk > free gpus
-	if((a->cores.total < b->cores.total))
-		return 1;
-
-	if((a->cores.total > b->cores.total))
-		return 0;
-
-	//Same number of free cores...
-	if((a->memory.total < b->memory.total))
-		return 1;
-
-	if((a->memory.total > b->memory.total))
-		return 0;
-
-	//Same number of free memory...
-	if((a->disk.total < b->disk.total))
-		return 1;
-
-	if((a->disk.total > b->disk.total))
-		return 0;
-
-	//Same number of free disk...
-	if((a->gpus.total < b->gpus.total))
-		return 1;
-
-	if((a->gpus.total > b->gpus.total))
-		return 0;
-
-	//Number of free resources are the same.
-	return 0;
-}
-
-static struct work_queue_worker *find_worker_by_worst_fit(struct work_queue *q, struct work_queue_task *t)
-{
-	char *key;
-	struct work_queue_worker *w;
-	struct work_queue_worker *best_worker = NULL;
-
-	struct work_queue_resources bres;
-	struct work_queue_resources wres;
-
-	memset(&bres, 0, sizeof(struct work_queue_resources));
-	memset(&wres, 0, sizeof(struct work_queue_resources));
-
-	hash_table_firstkey(q->worker_table);
-	while(hash_table_nextkey(q->worker_table, &key, (void **) &w)) {
-		if( check_hand_against_task(q, w, t) ) {
-
-			//Use total field on bres, wres to indicate free resources.
-			wres.cores.total   = w->resources->cores.total   - w->resources->cores.inuse;
-			wres.memory.total  = w->resources->memory.total  - w->resources->memory.inuse;
-			wres.disk.total    = w->resources->disk.total    - w->resources->disk.inuse;
-			wres.gpus.total    = w->resources->gpus.total    - w->resources->gpus.inuse;
-
-			if(!best_worker || compare_worst_fit(&bres, &wres))
-			{
-				best_worker = w;
-				memcpy(&bres, &wres, sizeof(struct work_queue_resources));
-			}
-		}
-	}
-
-	return best_worker;
+	first_candidate_worker(q);
+	return next_candidate_worker(q, t, fit);
 }
 
-static struct work_queue_worker *find_worker_by_time(struct work_queue *q, struct work_queue_task *t)
+static struct work_queue_worker *find_worker_by_time(struct work_queue *q, struct work_queue_task *t, struct task_fit *fit)
 {
-	char *key;
 	struct work_queue_worker *w;
 	struct work_queue_worker *best_worker = 0;
 	double best_time = HUGE_VAL;
 
-	hash_table_firstkey(q->worker_table);
-	while(hash_table_nextkey(q->worker_table, &key, (void **) &w)) {
-		if(check_hand_against_task(q, w, t)) {
-			if(w->total_tasks_complete > 0) {
-				double t = (w->total_task_time + w->total_transfer_time) / w->total_tasks_complete;
-				if(!best_worker || t < best_time) {
-					best_worker = w;
-					best_time = t;
-				}
+	first_candidate_worker(q);
+	while((w = next_candidate_worker(q, t, fit))) {
+		if(w->total_tasks_complete > 0) {
+			double t = (w->total_task_time + w->total_transfer_time) / w->total_tasks_complete;
+			if(!best_worker || t < best_time) {
+				best_worker = w;
+				best_time = t;
 			}
 		}
 	}
@@ -3636,7 +3804,7 @@ static struct work_queue_worker *find_worker_by_time(struct work_queue *q, struc
 	if(best_worker) {
 		return best_worker;
 	} else {
-		return find_worker_by_fcfs(q, t);
+		return find_worker_by_fcfs(q, t, fit);
 	}
 }
 
@@ -3649,18 +3817,21 @@ static struct work_queue_worker *find_best_worker(struct work_queue *q, struct w
 		a = q->worker_selection_algorithm;
 	}
 
+	struct task_fit fit;
+	task_fit_compute(q, t, &fit);
+
 	switch (a) {
 	case WORK_QUEUE_SCHEDULE_FILES:
-		return find_worker_by_files(q, t);
+		return find_worker_by_files(q, t, &fit);
 	case WORK_QUEUE_SCHEDULE_TIME:
-		return find_worker_by_time(q, t);
+		return find_worker_by_time(q, t, &fit);
 	case WORK_QUEUE_SCHEDULE_WORST:
-		return find_worker_by_worst_fit(q, t);
+		return find_worker_by_worst_fit(q, t, &fit);
 	case WORK_QUEUE_SCHEDULE_FCFS:
-		return find_worker_by_fcfs(q, t);
+		return find_worker_by_fcfs(q, t, &fit);
 	case WORK_QUEUE_SCHEDULE_RAND:
 	default:
-		return find_worker_by_random(q, t);
+		return find_worker_by_random(q, t, &fit);
 	}
 }
 
@@ -3676,18 +3847,18 @@ static void count_worker_resources(struct work_queue *q, struct work_queue_worke
 
 	update_max_worker(q, w);
 
-	if(w->resources->workers.total < 1)
+	if(w->resources->workers.total > 0)
 	{
-		return;
+		itable_firstkey(w->current_tasks_boxes);
+		while(itable_nextkey(w->current_tasks_boxes, &taskid, (void **)& box)) {
+			w->resources->cores.inuse     += box->cores;
+			w->resources->memory.inuse    += box->memory;
+			w->resources->disk.inuse      += box->disk;
+			w->resources->gpus.inuse      += box->gpus;
+		}
 	}
 
-	itable_firstkey(w->current_tasks_boxes);
-	while(itable_nextkey(w->current_tasks_boxes, &taskid, (void **)& box)) {
-		w->resources->cores.inuse     += box->cores;
-		w->resources->memory.inuse    += box->memory;
-		w->resources->disk.inuse      += box->disk;
-		w->resources->gpus.inuse      += box->gpus;
-	}
+	index_worker_free_cores(q, w);
 }
 
 static void update_max_worker(struct work_queue *q, struct work_queue_worker *w) {
@@ -3789,8 +3960,8 @@ static int send_one_task( struct work_queue *q )
 	struct work_queue_worker *w;
 
 	// Consider each task in the order of priority:
-	list_first_item(q->ready_list);
-	while( (t = list_next_item(q->ready_list))) {
+	priority_queue_first_item(q->ready_list);
+	while( (t = priority_queue_next_item(q->ready_list))) {
 
 		// Find the best worker for the task at the head of the list
 		w = find_best_worker(q,t);
@@ -3810,17 +3981,13 @@ static int send_one_task( struct work_queue *q )
 static int receive_one_task( struct work_queue *q )
 {
 	struct work_queue_task *t;
-
 	struct work_queue_worker *w;
-	uint64_t taskid;
 
-	itable_firstkey(q->tasks);
-	while( itable_nextkey(q->tasks, &taskid, (void **) &t) ) {
-		if( task_state_is(q, taskid, WORK_QUEUE_TASK_WAITING_RETRIEVAL) ) {
-			w = itable_lookup(q->worker_task_map, taskid);
-			fetch_output_from_worker(q, w, taskid);
-			return 1;
-		}
+	t = task_state_any(q, WORK_QUEUE_TASK_WAITING_RETRIEVAL);
+	if(t) {
+		w = itable_lookup(q->worker_task_map, t->taskid);
+		fetch_output_from_worker(q, w, t->taskid);
+		return 1;
 	}
 
 	return 0;
@@ -4917,17 +5084,35 @@ struct work_queue *work_queue_create(int port)
 		link_address_local(q->master_link, address, &q->port);
 	}
 
+	q->poller = link_poller_create();
+	if(!q->poller || !link_poller_add(q->poller, q->master_link, LINK_READ)) {
+		debug(D_NOTICE, "Could not wait for workers on port %i: %s", q->port, strerror(errno));
+		link_poller_delete(q->poller);
+		link_close(q->master_link);
+		free(q);
+		return 0;
+	}
+
 	getcwd(q->workingdir,PATH_MAX);
 
 	q->next_taskid = 1;
 
-	q->ready_list = list_create();
+	q->ready_list = priority_queue_create(0);
+	q->ready_expiry = priority_queue_create(0);
+	q->resubmit_priority = DBL_MAX / 2;
+	q->waiting_retrieval_list = list_create();
+	q->retrieved_list = list_create();
 
 	q->tasks          = itable_create(0);
 
 	q->task_state_map = itable_create(0);
+	q->task_state_cursors = itable_create(0);
+
+	q->task_counts = calloc(1, sizeof(struct work_queue_task_counts));
+	q->category_task_counts = hash_table_create(0, 0);
 
 	q->worker_table = hash_table_create(0, 0);
+	q->workers_by_free_cores = priority_queue_create(0);
 	q->worker_blacklist = hash_table_create(0, 0);
 	q->worker_task_map = itable_create(0);
 
@@ -4941,10 +5126,13 @@ struct work_queue *work_queue_create(int port)
 	q->workers_with_available_results = hash_table_create(0, 0);
 
 	// The poll table is initially null, and will be created
-	// (and resized) as needed by build_poll_table.
+	// (and resized) as needed by resize_poll_table.
 	q->poll_table_size = 8;
 
 	q->worker_selection_algorithm = wq_option_scheduler;
+
+	q->content_cache = 0;
+	q->content_hashes = hash_table_create(0, 0);
 	q->process_pending_check = 0;
 
 	q->short_timeout = 5;
@@ -5117,6 +5305,11 @@ void work_queue_specify_algorithm(struct work_queue *q, work_queue_schedule_t al
 	q->worker_selection_algorithm = algorithm;
 }
 
+void work_queue_specify_content_cache(struct work_queue *q, int flag)
+{
+	q->content_cache = flag;
+}
+
 void work_queue_specify_task_order(struct work_queue *q, int order)
 {
 	q->task_ordering = order;
@@ -5215,6 +5408,7 @@ void work_queue_delete(struct work_queue *q)
 		if(q->catalog_hosts) free(q->catalog_hosts);
 
 		hash_table_delete(q->worker_table);
+		priority_queue_delete(q->workers_by_free_cores);
 		hash_table_delete(q->worker_blacklist);
 		itable_delete(q->worker_task_map);
 
@@ -5225,14 +5419,40 @@ void work_queue_delete(struct work_queue *q)
 		}
 		hash_table_delete(q->categories);
 
-		list_delete(q->ready_list);
+		uint64_t taskid;
+		struct list_cursor *cur;
+		itable_firstkey(q->task_state_cursors);
+		while(itable_nextkey(q->task_state_cursors, &taskid, (void **) &cur)) {
+			list_cursor_destroy(cur);
+		}
+		itable_delete(q->task_state_cursors);
+
+		priority_queue_delete(q->ready_list);
+		priority_queue_delete(q->ready_expiry);
+		list_delete(q->waiting_retrieval_list);
+		list_delete(q->retrieved_list);
 
 		itable_delete(q->tasks);
 
 		itable_delete(q->task_state_map);
 
+		struct work_queue_task_counts *counts;
+		hash_table_firstkey(q->category_task_counts);
+		while(hash_table_nextkey(q->category_task_counts, &key, (void **) &counts)) {
+			free(counts);
+		}
+		hash_table_delete(q->category_task_counts);
+		free(q->task_counts);
+
 		hash_table_delete(q->workers_with_available_results);
 
+		struct content_hash *h;
+		hash_table_firstkey(q->content_hashes);
+		while(hash_table_nextkey(q->content_hashes, &key, (void **) &h)) {
+			free(h);
+		}
+		hash_table_delete(q->content_hashes);
+
 		struct work_queue_task_report *tr;
 		list_first_item(q->task_reports);
 		while((tr = list_next_item(q->task_reports))) {
@@ -5252,6 +5472,7 @@ void work_queue_delete(struct work_queue *q)
 
 		free(q->poll_table);
 		link_close(q->master_link);
+		link_poller_delete(q->poller);
 		if(q->logfile) {
 			fclose(q->logfile);
 		}
@@ -5393,36 +5614,121 @@ char *work_queue_monitor_wrap(struct work_queue *q, struct work_queue_worker *w,
 	return wrap_cmd;
 }
 
-static double work_queue_task_priority(void *item) {
-	assert(item);
-	struct work_queue_task *t = item;
-	return t->priority;
+/* Returns the list that holds the tasks in the given state, or NULL if tasks in that state are only counted. */
+static struct list *task_state_list(struct work_queue *q, work_queue_task_state_t state)
+{
+	switch(state) {
+		case WORK_QUEUE_TASK_WAITING_RETRIEVAL:
+			return q->waiting_retrieval_list;
+		case WORK_QUEUE_TASK_RETRIEVED:
+			return q->retrieved_list;
+		default:
+			return NULL;
+	}
+}
+
+/* Insert the task to the left of cur, and keep cur on the task so that it can be removed later without a search. */
+static void task_state_list_insert(struct work_queue *q, struct work_queue_task *t, struct list_cursor *cur)
+{
+	void *item;
+
+	list_insert(cur, t);
+	if(list_get(cur, &item)) {
+		list_prev(cur);
+	} else {
+		list_seek(cur, -1);
+	}
+
+	itable_insert(q->task_state_cursors, t->taskid, cur);
+}
+
+static void task_state_list_remove(struct work_queue *q, struct work_queue_task *t)
+{
+	struct list_cursor *cur = itable_remove(q->task_state_cursors, t->taskid);
+	if(cur) {
+		list_drop(cur);
+		list_cursor_destroy(cur);
+	}
+}
+
+static struct work_queue_task_counts *category_task_counts(struct work_queue *q, const char *category)
+{
+	struct work_queue_task_counts *counts = hash_table_lookup(q->category_task_counts, category);
+
+	if(!counts) {
+		counts = calloc(1, sizeof(*counts));
+		hash_table_insert(q->category_task_counts, category, counts);
+	}
+
+	return counts;
+}
+
+/* Only the tasks in q->tasks are counted, that is, neither new, done, nor canceled tasks. */
+static int task_state_is_counted(work_queue_task_state_t state)
+{
+	switch(state) {
+		case WORK_QUEUE_TASK_READY:
+		case WORK_QUEUE_TASK_RUNNING:
+		case WORK_QUEUE_TASK_WAITING_RETRIEVAL:
+		case WORK_QUEUE_TASK_RETRIEVED:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+/* Add delta to the counts of state and request of the task, both globally and for its category. */
+static void update_task_counts(struct work_queue *q, struct work_queue_task *t, work_queue_task_state_t state, int delta)
+{
+	struct work_queue_task_counts *c = category_task_counts(q, t->category);
+
+	q->task_counts->state[state] += delta;
+	c->state[state]              += delta;
+
+	q->task_counts->request[t->resource_request] += delta;
+	c->request[t->resource_request]              += delta;
 }
 
 /* Put a given task on the ready list, taking into account the task priority and the queue schedule. */
 
 void push_task_to_ready_list( struct work_queue *q, struct work_queue_task *t )
 {
-	int by_priority = 1;
+	double priority = t->priority;
 
 	if(t->result == WORK_QUEUE_RESULT_RESOURCE_EXHAUSTION) {
 		/* when a task is resubmitted given resource exhaustion, we
 		 * push it at the head of the list, so it gets to run as soon
 		 * as possible. This avoids the issue in which all 'big' tasks
-		 * fail because the first allocation is too small. */
-		by_priority = 0;
+		 * fail because the first allocation is too small. Each such
+		 * task gets the next larger priority, above any given by the
+		 * user, so that the last one resubmitted runs first. */
+		q->resubmit_priority = nextafter(q->resubmit_priority, DBL_MAX);
+		priority = q->resubmit_priority;
 	}
 
-	if(by_priority) {
-		list_push_priority(q->ready_list, work_queue_task_priority, t);
-	} else {
-		list_push_head(q->ready_list,t);
+	priority_queue_push(q->ready_list, t, priority);
+
+	if(t->resources_requested->end > 0) {
+		priority_queue_push(q->ready_expiry, t, -((double) t->resources_requested->end));
 	}
 
 	/* If the task has been used before, clear out accumulated state. */
 	clean_task_state(t);
 }
 
+/* Change the allocation label of a task already in the queue. */
+static void change_task_resource_request(struct work_queue *q, struct work_queue_task *t, category_allocation_t request)
+{
+	work_queue_task_state_t state = (uintptr_t) itable_lookup(q->task_state_map, t->taskid);
+
+	if(task_state_is_counted(state)) {
+		update_task_counts(q, t, state, -1);
+		t->resource_request = request;
+		update_task_counts(q, t, state, 1);
+	} else {
+		t->resource_request = request;
+	}
+}
 
 work_queue_task_state_t work_queue_task_state(struct work_queue *q, int taskid) {
 	return (int)(uintptr_t)itable_lookup(q->task_state_map, taskid);
@@ -5462,11 +5768,17 @@ static work_queue_task_state_t change_task_state( struct work_queue *q, struct w
 
 	work_queue_task_state_t old_state = (uintptr_t) itable_lookup(q->task_state_map, t->taskid);
 	itable_insert(q->task_state_map, t->taskid, (void *) new_state);
+
 	// remove from current tables:
+	if(old_state == WORK_QUEUE_TASK_READY) {
+		priority_queue_remove(q->ready_list, t);
+		priority_queue_remove(q->ready_expiry, t);
+	} else if(task_state_list(q, old_state)) {
+		task_state_list_remove(q, t);
+	}
 
-	if( old_state == WORK_QUEUE_TASK_READY ) {
-		// Treat WORK_QUEUE_TASK_READY specially, as it has the order of the tasks
-		list_remove(q->ready_list, t);
+	if(task_state_is_counted(old_state)) {
+		update_task_counts(q, t, old_state, -1);
 	}
 
 	// insert to corresponding table
@@ -5477,6 +5789,10 @@ static work_queue_task_state_t change_task_state( struct work_queue *q, struct w
 			update_task_result(t, WORK_QUEUE_RESULT_UNKNOWN);
 			push_task_to_ready_list(q, t);
 			break;
+		case WORK_QUEUE_TASK_WAITING_RETRIEVAL:
+		case WORK_QUEUE_TASK_RETRIEVED:
+			task_state_list_insert(q, t, list_cursor_create(task_state_list(q, new_state)));
+			break;
 		case WORK_QUEUE_TASK_DONE:
 		case WORK_QUEUE_TASK_CANCELED:
 			/* tasks are freed when returned to user, thus we remove them from our local record */
@@ -5487,7 +5803,11 @@ static work_queue_task_state_t change_task_state( struct work_queue *q, struct w
 			/* do nothing */
 			break;
 	}
-	
+
+	if(task_state_is_counted(new_state)) {
+		update_task_counts(q, t, new_state, 1);
+	}
+
 	log_queue_stats(q);
 	write_transaction_task(q, t);
 
@@ -5594,6 +5914,12 @@ static int task_state_is( struct work_queue *q, uint64_t taskid, work_queue_task
 }
 
 static struct work_queue_task *task_state_any(struct work_queue *q, work_queue_task_state_t state) {
+	struct list *l = task_state_list(q, state);
+
+	if(l) {
+		return list_peek_head(l);
+	}
+
 	struct work_queue_task *t;
 	uint64_t taskid;
 
@@ -5608,39 +5934,23 @@ static struct work_queue_task *task_state_any(struct work_queue *q, work_queue_t
 }
 
 static int task_state_count(struct work_queue *q, const char *category, work_queue_task_state_t state) {
-	struct work_queue_task *t;
-	uint64_t taskid;
-
-	int count = 0;
+	if(!task_state_is_counted(state)) {
+		return 0;
+	}
 
-	itable_firstkey(q->tasks);
-	while( itable_nextkey(q->tasks, &taskid, (void **) &t) ) {
-		if( task_state_is(q, taskid, state) ) {
-			if(!category || strcmp(category, t->category) == 0) {
-				count++;
-			}
-		}
+	if(category) {
+		return category_task_counts(q, category)->state[state];
 	}
 
-	return count;
+	return q->task_counts->state[state];
 }
 
 static int task_request_count( struct work_queue *q, const char *category, category_allocation_t request) {
-	struct work_queue_task *t;
-	uint64_t taskid;
-
-	int count = 0;
-
-	itable_firstkey(q->tasks);
-	while( itable_nextkey(q->tasks, &taskid, (void **) &t) ) {
-		if(t->resource_request == request) {
-			if(!category || strcmp(category, t->category) == 0) {
-				count++;
-			}
-		}
+	if(category) {
+		return category_task_counts(q, category)->request[request];
 	}
 
-	return count;
+	return q->task_counts->request[request];
 }
 
 int work_queue_submit_internal(struct work_queue *q, struct work_queue_task *t)
@@ -5673,6 +5983,10 @@ int work_queue_submit(struct work_queue *q, struct work_queue_task *t)
 	//Increment taskid. So we get a unique taskid for every submit.
 	q->next_taskid++;
 
+	if(q->content_cache) {
+		name_input_files_by_content(q, t);
+	}
+
 	return work_queue_submit_internal(q, t);
 }
 
@@ -5798,7 +6112,13 @@ static int poll_active_workers(struct work_queue *q, int stoptime, struct link *
 {
 	BEGIN_ACCUM_TIME(q, time_polling);
 
-	int n = build_poll_table(q, foreman_uplink);
+	resize_poll_table(q);
+
+	// The foreman uplink is only waited on while the foreman is in this call.
+	if(foreman_uplink) {
+		link_poller_add(q->poller, foreman_uplink, LINK_READ);
+		*foreman_uplink_active = 0;
+	}
 
 	// We poll in at most small time segments (of a second). This lets
 	// promptly dispatch tasks, while avoiding busy waiting.
@@ -5809,38 +6129,41 @@ static int poll_active_workers(struct work_queue *q, int stoptime, struct link *
 
 	END_ACCUM_TIME(q, time_polling);
 
+	q->master_link_active = 0;
+
 	if(msec < 0) {
+		if(foreman_uplink) {
+			link_poller_remove(q->poller, foreman_uplink);
+		}
 		return 0;
 	}
 
 	BEGIN_ACCUM_TIME(q, time_polling);
 
-	// Poll all links for activity.
-	link_poll(q->poll_table, n, msec);
+	// Wait for activity on any link, and consider only the links that are ready.
+	int n = link_poller_wait(q->poller, q->poll_table, q->poll_table_size, msec);
 	q->link_poll_end = timestamp_get();
 
-	int i, j = 1;
-	// Consider the foreman_uplink passed into the function and disregard if inactive.
 	if(foreman_uplink) {
-		if(q->poll_table[1].revents) {
-			*foreman_uplink_active = 1; //signal that the master link saw activity
-		} else {
-			*foreman_uplink_active = 0;
-		}
-		j++;
+		link_poller_remove(q->poller, foreman_uplink);
 	}
 
 	END_ACCUM_TIME(q, time_polling);
 
 	BEGIN_ACCUM_TIME(q, time_status_msgs);
 
+	int i;
 	int workers_failed = 0;
-	// Then consider all existing active workers
-	for(i = j; i < n; i++) {
-		if(q->poll_table[i].revents) {
-			if(handle_worker(q, q->poll_table[i].link) == WORKER_FAILURE) {
-				workers_failed++;
-			}
+	for(i = 0; i < n; i++) {
+		struct link *l = q->poll_table[i].link;
+		if(!q->poll_table[i].revents) {
+			continue;
+		} else if(l == q->master_link) {
+			q->master_link_active = 1;
+		} else if(foreman_uplink && l == foreman_uplink) {
+			*foreman_uplink_active = 1; //signal that the master link saw activity
+		} else if(handle_worker(q, l) == WORKER_FAILURE) {
+			workers_failed++;
 		}
 	}
 
@@ -5868,7 +6191,7 @@ static int connect_new_workers(struct work_queue *q, int stoptime, int max_new_w
 	// If the master link was awake, then accept at most max_new_workers.
 	// Note we are using the information gathered in poll_active_workers, which
 	// is a little ugly.
-	if(q->poll_table[0].revents) {
+	if(q->master_link_active) {
 		do {
 			add_worker(q);
 			new_workers++;
@@ -6037,7 +6360,7 @@ struct work_queue_task *work_queue_wait_internal(struct work_queue *q, int timeo
 
 		// return if queue is empty.
 		BEGIN_ACCUM_TIME(q, time_internal);
-		int done = !task_state_any(q, WORK_QUEUE_TASK_RUNNING) && !task_state_any(q, WORK_QUEUE_TASK_READY) && !task_state_any(q, WORK_QUEUE_TASK_WAITING_RETRIEVAL) && !(foreman_uplink);
+		int done = !task_state_count(q, NULL, WORK_QUEUE_TASK_RUNNING) && !task_state_count(q, NULL, WORK_QUEUE_TASK_READY) && !task_state_count(q, NULL, WORK_QUEUE_TASK_WAITING_RETRIEVAL) && !(foreman_uplink);
 		END_ACCUM_TIME(q, time_internal);
 
 		if(done)
@@ -6224,22 +6547,19 @@ void release_all_workers(struct work_queue *q) {
 
 int work_queue_empty(struct work_queue *q)
 {
-	struct work_queue_task *t;
-	uint64_t taskid;
-
-	itable_firstkey(q->tasks);
-	while( itable_nextkey(q->tasks, &taskid, (void **) &t) ) {
-		int state = work_queue_task_state(q, taskid);
-
-		if( state == WORK_QUEUE_TASK_READY   )           return 0;
-		if( state == WORK_QUEUE_TASK_RUNNING )           return 0;
-		if( state == WORK_QUEUE_TASK_WAITING_RETRIEVAL ) return 0;
-		if( state == WORK_QUEUE_TASK_RETRIEVED )         return 0;
-	}
+	if( task_state_count(q, NULL, WORK_QUEUE_TASK_READY) )             return 0;
+	if( task_state_count(q, NULL, WORK_QUEUE_TASK_RUNNING) )           return 0;
+	if( task_state_count(q, NULL, WORK_QUEUE_TASK_WAITING_RETRIEVAL) ) return 0;
+	if( task_state_count(q, NULL, WORK_QUEUE_TASK_RETRIEVED) )         return 0;
 
 	return 1;
 }
 
+int work_queue_results_ready(struct work_queue *q)
+{
+	return task_state_count(q, NULL, WORK_QUEUE_TASK_WAITING_RETRIEVAL) + task_state_count(q, NULL, WORK_QUEUE_TASK_RETRIEVED);
+}
+
 void work_queue_specify_keepalive_interval(struct work_queue *q, int interval)
 {
 	q->keepalive_interval = interval;
@@ -6261,9 +6581,11 @@ int work_queue_tune(struct work_queue *q, const char *name, double value)
 
 	if(!strcmp(name, "asynchrony-multiplier")) {
 		q->asynchrony_multiplier = MAX(value, 1.0);
+		index_all_workers_free_cores(q);
 
 	} else if(!strcmp(name, "asynchrony-modifier")) {
 		q->asynchrony_modifier = MAX(value, 0);
+		index_all_workers_free_cores(q);
 
 	} else if(!strcmp(name, "min-transfer-timeout")) {
 		q->minimum_transfer_timeout = (int)value;
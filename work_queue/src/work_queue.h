@@ -726,6 +726,14 @@ this function returns true.
 */
 int work_queue_empty(struct work_queue *q);
 
+/** Count the tasks that have completed, but have not been returned yet by @ref work_queue_wait.
+Subsequent calls to @ref work_queue_wait return these tasks before waiting for other activity,
+so a user may collect several completions at once by calling it while this count is not zero.
+@param q A work queue object.
+@returns The number of tasks complete and waiting to be returned.
+*/
+int work_queue_results_ready(struct work_queue *q);
+
 /** Get the listening port of the queue.
 As noted in @ref work_queue_create, there are many controls that affect what TCP port the queue will listen on.
 Rather than assuming a specific port, the user should simply call this function to determine what port was selected.
@@ -838,6 +846,17 @@ This function controls which <b>worker</b> will be selected for a given task.
 */
 void work_queue_specify_algorithm(struct work_queue *q, work_queue_schedule_t algorithm);
 
+/** Name cached input files by their contents rather than by their paths.
+When enabled, each input file specified with @ref WORK_QUEUE_CACHE is hashed when its task
+is submitted, so that the same data is sent to a worker only once, whatever its path.
+Workers keep such files in their cache when they move to another master, and
+report them to it, so they are reused by any master that also enables this mode.
+A hash is computed again only when the size or modification time of the file change.
+@param q A work queue object.
+@param flag Non-zero to enable, zero to disable (the default).
+*/
+void work_queue_specify_content_cache(struct work_queue *q, int flag);
+
 /** Get the project name of the queue.
 @param q A work queue object.
 @return The project name of the queue.
@@ -57,13 +57,18 @@ struct list * work_queue_catalog_query( const char *catalog_host, int catalog_po
 	time_t stoptime = time(0) + 60;
 	struct catalog_query *q;
 
+	// Let the catalog server pick out the masters, rather than sending everything.
+	struct jx *filter = jx_operator(JX_OP_EQ, jx_symbol("type"), jx_string("wq_master"));
+
 	if(catalog_port > 0) {
 		sprintf(hostport, "%s:%d", catalog_host, catalog_port);
-		q = catalog_query_create(hostport, 0, stoptime);
+		q = catalog_query_create(hostport, filter, stoptime);
 	} else {
-		q = catalog_query_create(catalog_host, 0, stoptime);
+		q = catalog_query_create(catalog_host, filter, stoptime);
 	}
 	if(!q) {
+		// the query only takes the filter if it is created.
+		jx_delete(filter);
 		debug(D_NOTICE,"unable to contact catalog server at %s:%d\n", catalog_host, catalog_port);
 		return 0;
 	}
@@ -0,0 +1,190 @@
+/*
+Copyright (C) 2019- The University of Notre Dame
+This software is distributed under the GNU General Public License.
+See the file COPYING for details.
+*/
+
+/*
+work_queue_dispatch_benchmark measures how long a master takes to send
+tasks to a large pool of workers.  The workers are simulated: each is a
+connection made by this program, which announces itself and one core,
+and then never reads.  Twice as many tasks as workers are submitted, so
+that only half of them fit, and the time the master reports spending
+in sending tasks is divided among the tasks placed.
+*/
+
+#include "work_queue.h"
+#include "work_queue_protocol.h"
+
+#include "cctools.h"
+#include "debug.h"
+#include "link.h"
+#include "list.h"
+#include "timestamp.h"
+#include "xxmalloc.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Workers connected between turns of the master, which listens with a backlog of five. */
+#define CONNECT_BATCH 5
+
+/* Sizes of the simulated pools, up to the largest given with -w. */
+static const int pool_sizes[] = { 1000, 5000, 20000 };
+
+static struct link *fake_worker_create(int port, int id)
+{
+	time_t stoptime = time(0) + 10;
+
+	struct link *l = link_connect("127.0.0.1", port, stoptime);
+	if(!l)
+		return 0;
+
+	link_putfstring(l, "workqueue %d sim-%d unknown unknown %d.%d.%d\n", stoptime, WORK_QUEUE_PROTOCOL_VERSION, id, CCTOOLS_VERSION_MAJOR, CCTOOLS_VERSION_MINOR, CCTOOLS_VERSION_MICRO);
+	link_putliteral(l, "resource workers 1 1 1\n", stoptime);
+	link_putliteral(l, "resource disk 8192 8192 8192\n", stoptime);
+	link_putliteral(l, "resource memory 4096 4096 4096\n", stoptime);
+	link_putliteral(l, "resource gpus 0 0 0\n", stoptime);
+	link_putliteral(l, "resource cores 1 1 1\n", stoptime);
+	link_putliteral(l, "resource tag 1\n", stoptime);
+
+	return l;
+}
+
+/*
+Return the time per placed task to dispatch twice as many tasks as
+workers with the given algorithm, or a negative number on failure.
+*/
+
+static double benchmark_dispatch(int nworkers, int algorithm, int *placed)
+{
+	struct work_queue_stats s;
+	struct work_queue_task *t;
+	struct link **workers;
+	timestamp_t before = 0;
+	int i;
+
+	struct work_queue *q = work_queue_create(0);
+	if(!q) {
+		fprintf(stderr, "couldn't create queue: %s\n", strerror(errno));
+		return -1;
+	}
+
+	work_queue_specify_algorithm(q, algorithm);
+
+	workers = xxcalloc(nworkers, sizeof(*workers));
+
+	for(i = 0; i < nworkers; i++) {
+		workers[i] = fake_worker_create(work_queue_port(q), i);
+		if(!workers[i]) {
+			fprintf(stderr, "couldn't connect worker %d: %s\n", i, strerror(errno));
+			break;
+		}
+		if(i % CONNECT_BATCH == CONNECT_BATCH - 1)
+			work_queue_wait(q, 1);
+	}
+
+	/* Let the master take in every worker and its resources. */
+	do {
+		work_queue_wait(q, 1);
+		work_queue_get_stats(q, &s);
+	} while(i == nworkers && s.total_cores < nworkers);
+
+	if(i == nworkers) {
+		for(i = 0; i < 2 * nworkers; i++) {
+			t = work_queue_task_create("true");
+			work_queue_task_specify_cores(t, 1);
+			work_queue_task_specify_memory(t, 1024);
+			work_queue_task_specify_disk(t, 1024);
+			work_queue_submit(q, t);
+		}
+
+		before = s.time_send;
+
+		do {
+			work_queue_wait(q, 1);
+			work_queue_get_stats(q, &s);
+		} while(s.tasks_on_workers < nworkers);
+
+		*placed = s.tasks_on_workers;
+	} else {
+		*placed = 0;
+	}
+
+	struct list *l = work_queue_cancel_all_tasks(q);
+	while((t = list_pop_head(l)))
+		work_queue_task_delete(t);
+	list_delete(l);
+
+	work_queue_delete(q);
+
+	for(i = 0; i < nworkers; i++) {
+		if(workers[i])
+			link_close(workers[i]);
+	}
+	free(workers);
+
+	if(*placed == 0)
+		return -1;
+
+	return ((double) (s.time_send - before)) / *placed;
+}
+
+static void show_help(const char *cmd)
+{
+	fprintf(stdout, "Use: %s [options]\n", cmd);
+	fprintf(stdout, "Where options are:\n");
+	fprintf(stdout, " %-20s Largest number of workers to simulate. (default: 20000)\n", "-w <workers>");
+	fprintf(stdout, " %-20s Show this help screen.\n", "-h");
+}
+
+int main(int argc, char *argv[])
+{
+	struct {
+		const char *name;
+		int algorithm;
+	} algorithms[] = {
+		{ "fcfs",  WORK_QUEUE_SCHEDULE_FCFS },
+		{ "worst", WORK_QUEUE_SCHEDULE_WORST },
+		{ "time",  WORK_QUEUE_SCHEDULE_TIME },
+	};
+
+	int max_workers = 20000;
+	int workers, placed;
+	int c, i, j;
+
+	debug_config(argv[0]);
+
+	while((c = getopt(argc, argv, "w:h")) != -1) {
+		switch(c) {
+		case 'w':
+			max_workers = atoi(optarg);
+			break;
+		case 'h':
+		default:
+			show_help(argv[0]);
+			return c=='h' ? 0 : 1;
+		}
+	}
+
+	printf("%12s %12s %12s %16s\n", "algorithm", "workers", "placed", "usec/task");
+
+	for(j = 0; j < (int) (sizeof(pool_sizes) / sizeof(pool_sizes[0])); j++) {
+		workers = pool_sizes[j];
+		if(workers > max_workers)
+			break;
+		for(i = 0; i < (int) (sizeof(algorithms) / sizeof(algorithms[0])); i++) {
+			double usec = benchmark_dispatch(workers, algorithms[i].algorithm, &placed);
+			if(usec < 0)
+				return 1;
+			printf("%12s %12d %12d %16.2lf\n", algorithms[i].name, workers, placed, usec);
+		}
+	}
+
+	return 0;
+}
+
+/* vim: set noexpandtab tabstop=4: */
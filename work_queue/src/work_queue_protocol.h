@@ -19,7 +19,9 @@ This file should not be installed and should only be included by .c files.
 /* 6: worker only report total, max, and min resources. */
 /* 7: added category message */
 /* 8: worker send feature message. */
-#define WORK_QUEUE_PROTOCOL_VERSION 8
+/* 9: worker reports files kept in its cache with cache-update messages. */
+/* 10: worker reports files evicted from its cache with cache-invalid messages. */
+#define WORK_QUEUE_PROTOCOL_VERSION 10
 
 #define WORK_QUEUE_LINE_MAX 4096       /**< Maximum length of a work queue message line. */
 #define WORK_QUEUE_POOL_NAME_MAX 128   /**< Maximum length of a work queue pool name. */
@@ -281,7 +281,25 @@ void resize_catalog(size_t new_size)
 	catalog_size = new_size;
 }
 
-int get_masters( time_t stoptime )
+/*
+Fields needed to display a table with these headers, including those
+used to find the masters of foremen.  Null means every field is needed.
+*/
+struct jx *get_masters_fields( struct jx_table *headers )
+{
+	if(!headers)
+		return NULL;
+
+	struct jx *fields = jx_arrayv(jx_string("name"), jx_string("port"), jx_string("project"), jx_string("my_master"), NULL);
+
+	for(; headers->name; headers++) {
+		jx_array_append(fields, jx_string(headers->name));
+	}
+
+	return fields;
+}
+
+int get_masters( time_t stoptime, struct jx_table *headers )
 {
 	struct catalog_query *cq;
 	struct jx *j;
@@ -301,7 +319,7 @@ int get_masters( time_t stoptime )
 		)
 	);
 
-	cq = catalog_query_create(catalog_host, jexpr, stoptime );
+	cq = catalog_query_create_projection(catalog_host, jexpr, get_masters_fields(headers), 0, stoptime );
 	if(!cq)
 		fatal("failed to query catalog server %s: %s \n",catalog_host,strerror(errno));
 
@@ -537,7 +555,6 @@ int main(int argc, char *argv[])
 		return do_direct_query(master_host,master_port,stoptime);
 	} else {
 		global_catalog = malloc(sizeof(*global_catalog)*CATALOG_SIZE); //only malloc if catalog queries are being done
-		get_masters(stoptime);
 		struct jx_table *h;
 		if(query_mode==QUERY_MASTER_RESOURCES) {
 			h = master_resource_headers;
@@ -547,6 +564,7 @@ int main(int argc, char *argv[])
 		else {
 			h = queue_headers;
 		}
+		get_masters(stoptime, format_mode==FORMAT_TABLE ? h : NULL);
 		return do_catalog_query(project_name,h,stoptime);
 	}
 }
@@ -13,6 +13,7 @@ See the file COPYING for details.
 #include "itable.h"
 #include "list.h"
 #include "get_line.h"
+#include "timestamp.h"
 
 #include <errno.h>
 #include <limits.h>
@@ -72,6 +73,51 @@ void wait_for_all_tasks( struct work_queue *q )
 	}
 }
 
+/*
+Measure the cost of submitting tasks with random priorities, and the per-call
+cost of the task state queries done on every iteration of work_queue_wait, as
+the number of waiting tasks grows. With no workers connected, all the tasks
+stay in the ready list.
+*/
+void benchmark_state_queries( struct work_queue *q, int max_tasks )
+{
+	int submitted = 0;
+	int target;
+	int i;
+
+	printf("%12s %16s %16s\n", "tasks", "usec/submit", "usec/iteration");
+
+	for(target=1000; target<=max_tasks; target*=10) {
+		int batch = target - submitted;
+
+		timestamp_t start = timestamp_get();
+		for(; submitted<target; submitted++) {
+			struct work_queue_task *t = work_queue_task_create("true");
+			work_queue_task_specify_priority(t, rand() % 1000);
+			work_queue_submit(q, t);
+		}
+		timestamp_t submit_elapsed = timestamp_get() - start;
+
+		int iterations = 100000;
+
+		start = timestamp_get();
+		for(i=0;i<iterations;i++) {
+			work_queue_hungry(q);
+			work_queue_empty(q);
+		}
+		timestamp_t elapsed = timestamp_get() - start;
+
+		printf("%12d %16.2lf %16.2lf\n", submitted, ((double) submit_elapsed)/batch, ((double) elapsed)/iterations);
+	}
+
+	struct list *l = work_queue_cancel_all_tasks(q);
+	struct work_queue_task *t;
+	while((t = list_pop_head(l))) {
+		work_queue_task_delete(t);
+	}
+	list_delete(l);
+}
+
 void work_queue_mainloop( struct work_queue *q )
 {
 	char line[1024];
@@ -100,6 +146,9 @@ void work_queue_mainloop( struct work_queue *q )
 		} else if(sscanf(line, "submit %d %d %d %d %s",&input_size, &run_time, &output_size, &count, category) >= 4) {
 			printf("submitting %d tasks...\n",count);
 			submit_tasks(q,input_size,run_time,output_size,count,category);
+		} else if(sscanf(line, "bench %d", &count) == 1) {
+			printf("benchmarking state queries up to %d tasks...\n", count);
+			benchmark_state_queries(q, count);
 		} else if(!strcmp(line,"quit") || !strcmp(line,"exit")) {
 			break;
 		} else if(!strcmp(line,"help")) {
@@ -108,6 +157,7 @@ void work_queue_mainloop( struct work_queue *q )
 			printf("wait                    Wait for all submitted tasks to finish.\n");
 			printf("submit <I> <T> <O> <N>  Submit N tasks that read I MB input,\n");
 			printf("                        run for T seconds, and produce O MB of output.\n");
+			printf("bench <N>               Time task submission and state queries with up to N waiting tasks.\n");
 			printf("quit, exit              Wait for all tasks to complete, then exit.\n");
 			printf("\n");
 		} else {
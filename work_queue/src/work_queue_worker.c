@@ -38,6 +38,7 @@ See the file COPYING for details.
 #include "random.h"
 #include "url_encode.h"
 #include "md5.h"
+#include "sha1.h"
 #include "disk_alloc.h"
 #include "hash_table.h"
 #include "pattern.h"
@@ -131,6 +132,9 @@ char *password = 0;
 // Allow worker to use symlinks when link() fails.  Enabled by default.
 static int symlinks_enabled = 1;
 
+// Maximum size of the cache directory (in bytes), beyond which objects not used by any task are evicted. 0 for no limit.
+static int64_t cache_size_limit = 0;
+
 // Worker id. A unique id for this worker instance.
 static char *worker_id;
 
@@ -190,6 +194,32 @@ static char *tar_fn         = NULL;
 // Processes should be created/deleted when added/removed from this table.
 static struct itable *procs_table = NULL;
 
+// Top-level names in the cache directory, with their sizes and last use, for eviction.
+struct cache_object {
+	int64_t size;
+	timestamp_t last_access;
+	int used;    // 1 once a task referred to the object, as only then the master counts on it.
+};
+
+static struct hash_table *cache_objects = NULL;
+static int64_t cache_objects_size = 0;
+
+// Objects that may not be evicted although no task in procs_table refers to them:
+// those put since the last task message, which are meant for the next task, and
+// the inputs of tasks forsaken for a missing input, until the master sends them again.
+static struct hash_table *cache_pending = NULL;
+static struct itable *cache_forsaken = NULL;
+
+// Files named by their contents that were checked against their names, with the
+// modification time and size they had then. Kept across masters, so that a file
+// is hashed again only if it changed since.
+struct cache_content {
+	time_t mtime;
+	int64_t size;
+};
+
+static struct hash_table *cache_contents = NULL;
+
 // Table of all processes currently running, indexed by pid.
 // These are additional pointers into procs_table.
 static struct itable *procs_running = NULL;
@@ -213,6 +243,8 @@ static int total_tasks_executed = 0;
 static const char *project_regex = 0;
 static int released_by_master = 0;
 
+static void forsake_waiting_process(struct link *master, struct work_queue_process *p);
+
 __attribute__ (( format(printf,2,3) ))
 static void send_master_message( struct link *master, const char *fmt, ... )
 {
@@ -349,6 +381,67 @@ static void send_features(struct link *master) {
 }
 
 
+/*
+A file named by its contents is trusted by every later master, so check
+that the data on disk hashes to the name, and remove it if not. The data
+is hashed when it arrives, and again only if its modification time or
+size changed since, so that connecting to a master stays cheap.
+*/
+static int cache_content_is_valid(const char *cached_path, const char *name, const struct stat *info) {
+	unsigned char digest[SHA1_DIGEST_LENGTH];
+
+	struct cache_content *c = hash_table_lookup(cache_contents, name);
+	if(c && c->mtime == info->st_mtime && c->size == (int64_t) info->st_size) {
+		return 1;
+	}
+
+	debug(D_WQ, "checking the contents of cached file %s", name);
+
+	if(sha1_file(cached_path, digest) && !strcmp(sha1_string(digest), name + strlen("content-"))) {
+		if(!c) {
+			c = malloc(sizeof(*c));
+			hash_table_insert(cache_contents, name, c);
+		}
+		c->mtime = info->st_mtime;
+		c->size = info->st_size;
+		return 1;
+	}
+
+	debug(D_WQ|D_NOTICE, "contents of cached file %s do not match its name, removing it", name);
+	unlink(cached_path);
+	free(hash_table_remove(cache_contents, name));
+
+	return 0;
+}
+
+/*
+Send a message to the master for each file kept in the cache from a
+previous master. Only files named by their contents are kept, and each
+is checked again before it is offered if a task may have changed it.
+*/
+static void send_cache_contents(struct link *master) {
+	DIR *dir = opendir("cache");
+	if(!dir) {
+		return;
+	}
+
+	struct dirent *d;
+	while((d = readdir(dir))) {
+		if(!string_prefix_is(d->d_name, "content-")) {
+			continue;
+		}
+
+		struct stat info;
+		char *cached_path = string_format("cache/%s", d->d_name);
+		if(stat(cached_path, &info) == 0 && S_ISREG(info.st_mode) && cache_content_is_valid(cached_path, d->d_name, &info)) {
+			send_master_message(master, "cache-update %s %lld\n", d->d_name, (long long) info.st_size);
+		}
+		free(cached_path);
+	}
+
+	closedir(dir);
+}
+
 /*
 Send a message to the master with my current resources.
 */
@@ -442,6 +535,7 @@ static void report_worker_ready( struct link *master )
 	send_master_message(master,"workqueue %d %s %s %s %d.%d.%d\n",WORK_QUEUE_PROTOCOL_VERSION,hostname,os_name,arch_name,CCTOOLS_VERSION_MAJOR,CCTOOLS_VERSION_MINOR,CCTOOLS_VERSION_MICRO);
 	send_master_message(master, "info worker-id %s\n", worker_id);
 	send_features(master);
+	send_cache_contents(master);
 	send_keepalive(master, 1);
 }
 
@@ -650,6 +744,297 @@ and if they have exited, move them into the procs_complete table
 for later processing.
 */
 
+/*
+Return the top-level name in the cache of a path given relative to the
+cache directory, or to the workspace as cache/...
+*/
+
+static char *cache_object_name(const char *path)
+{
+	while(!strncmp(path, "./", 2)) path += 2;
+
+	if(!strncmp(path, "cache/", 6)) path += 6;
+
+	char *name = xxstrdup(path);
+	char *slash = strchr(name, '/');
+	if(slash) *slash = 0;
+
+	return name;
+}
+
+static struct cache_object *cache_object_lookup_or_create(const char *name)
+{
+	struct cache_object *o = hash_table_lookup(cache_objects, name);
+
+	if(!o) {
+		o = calloc(1, sizeof(*o));
+		hash_table_insert(cache_objects, name, o);
+	}
+
+	return o;
+}
+
+static void cache_object_set_size(const char *name, int64_t size)
+{
+	struct cache_object *o = cache_object_lookup_or_create(name);
+
+	cache_objects_size += size - o->size;
+	o->size = size;
+}
+
+static void cache_object_access(const char *name)
+{
+	struct cache_object *o = cache_object_lookup_or_create(name);
+
+	o->used = 1;
+	o->last_access = timestamp_get();
+}
+
+static void cache_object_remove(const char *name)
+{
+	struct cache_object *o = hash_table_remove(cache_objects, name);
+
+	if(o) {
+		cache_objects_size -= o->size;
+		free(o);
+	}
+}
+
+/* Record the size of an object as found on disk, or forget it if it is not there. */
+static void cache_object_update(const char *name)
+{
+	char *path = string_format("cache/%s", name);
+	struct stat info;
+	int64_t size = 0;
+
+	if(lstat(path, &info) == 0) {
+		if(S_ISDIR(info.st_mode)) {
+			int64_t count;
+			path_disk_size_info_get(path, &size, &count);
+		} else {
+			size = info.st_size;
+		}
+		cache_object_set_size(name, size);
+	} else {
+		cache_object_remove(name);
+	}
+
+	free(path);
+}
+
+/* Keep an object put for the next task until the task arrives. */
+static void cache_pin_pending(const char *name)
+{
+	if(!hash_table_lookup(cache_pending, name)) {
+		hash_table_insert(cache_pending, name, (void *) 1);
+	}
+}
+
+static void cache_unpin_forsaken(int taskid)
+{
+	struct list *names = itable_remove(cache_forsaken, taskid);
+
+	if(names) {
+		list_free(names);
+		list_delete(names);
+	}
+}
+
+/* Keep the inputs of a task forsaken for a missing input until the master sends it again. */
+static void cache_pin_forsaken(struct work_queue_process *p)
+{
+	struct work_queue_file *f;
+	struct list *names = list_create();
+
+	list_first_item(p->task->input_files);
+	while((f = list_next_item(p->task->input_files))) {
+		list_push_tail(names, cache_object_name(f->payload));
+	}
+
+	cache_unpin_forsaken(p->task->taskid);
+	itable_insert(cache_forsaken, p->task->taskid, names);
+}
+
+static void cache_unpin_all()
+{
+	struct list *names;
+	uint64_t taskid;
+
+	hash_table_clear(cache_pending);
+
+	itable_firstkey(cache_forsaken);
+	while(itable_nextkey(cache_forsaken, &taskid, (void **) &names)) {
+		list_free(names);
+		list_delete(names);
+	}
+	itable_clear(cache_forsaken);
+}
+
+/* Forget all objects, and track again those that are in the cache directory (e.g., kept from a previous master). */
+static void cache_objects_reset()
+{
+	char *name;
+	struct cache_object *o;
+
+	hash_table_firstkey(cache_objects);
+	while(hash_table_nextkey(cache_objects, &name, (void **) &o)) {
+		free(o);
+	}
+	hash_table_clear(cache_objects);
+	cache_objects_size = 0;
+
+	cache_unpin_all();
+
+	DIR *dir = opendir("cache");
+	if(!dir) {
+		return;
+	}
+
+	struct dirent *d;
+	while((d = readdir(dir))) {
+		if(!strcmp(d->d_name, ".") || !strcmp(d->d_name, "..") || !strcmp(d->d_name, "tmp")) {
+			continue;
+		}
+
+		cache_object_update(d->d_name);
+
+		/* objects kept from a previous master are the first to go. */
+		cache_object_lookup_or_create(d->d_name)->used = 1;
+	}
+
+	closedir(dir);
+}
+
+static int compare_cache_objects_by_access(const void *a, const void *b)
+{
+	struct cache_object *oa = hash_table_lookup(cache_objects, *(char **) a);
+	struct cache_object *ob = hash_table_lookup(cache_objects, *(char **) b);
+
+	if(oa->last_access < ob->last_access) return -1;
+	if(oa->last_access > ob->last_access) return  1;
+
+	return 0;
+}
+
+static int cache_has_room(int64_t length)
+{
+	if(cache_size_limit > 0 && cache_objects_size + length > cache_size_limit) {
+		return 0;
+	}
+
+	return check_disk_space_for_filesize(".", length, disk_avail_threshold);
+}
+
+/*
+Evict the least recently used objects of the cache until length more bytes
+fit in it. Only objects that some task referred to, and that no task in the
+worker refers to now, are evicted, and the master is told about each one.
+Objects pinned for a task that has not arrived yet are kept as well, or a
+task could lose one input while receiving another, and be forsaken again
+each time the master sends it.
+Return true if there is room for length bytes.
+*/
+
+static int cache_make_room(struct link *master, int64_t length)
+{
+	if(worker_mode != WORKER_MODE_WORKER || cache_has_room(length)) {
+		return 1;
+	}
+
+	struct hash_table *in_use = hash_table_create(0, 0);
+	struct work_queue_process *p;
+	struct work_queue_file *f;
+	uint64_t taskid;
+
+	itable_firstkey(procs_table);
+	while(itable_nextkey(procs_table, &taskid, (void **) &p)) {
+		struct list *files[] = { p->task->input_files, p->task->output_files };
+		int i;
+		for(i = 0; i < 2; i++) {
+			list_first_item(files[i]);
+			while((f = list_next_item(files[i]))) {
+				char *name = cache_object_name(f->payload);
+				hash_table_insert(in_use, name, (void *) 1);
+				free(name);
+			}
+		}
+	}
+
+	char *pinned;
+	void *dummy;
+	hash_table_firstkey(cache_pending);
+	while(hash_table_nextkey(cache_pending, &pinned, &dummy)) {
+		hash_table_insert(in_use, pinned, (void *) 1);
+	}
+
+	struct list *names;
+	itable_firstkey(cache_forsaken);
+	while(itable_nextkey(cache_forsaken, &taskid, (void **) &names)) {
+		list_first_item(names);
+		while((pinned = list_next_item(names))) {
+			hash_table_insert(in_use, pinned, (void *) 1);
+		}
+	}
+
+	int count = 0;
+	char **candidates = malloc(hash_table_size(cache_objects) * sizeof(char *));
+
+	char *name;
+	struct cache_object *o;
+	hash_table_firstkey(cache_objects);
+	while(hash_table_nextkey(cache_objects, &name, (void **) &o)) {
+		if(o->used && !hash_table_lookup(in_use, name)) {
+			candidates[count++] = xxstrdup(name);
+		}
+	}
+
+	qsort(candidates, count, sizeof(char *), compare_cache_objects_by_access);
+
+	int i;
+	for(i = 0; i < count; i++) {
+		if(!cache_has_room(length)) {
+			char *path = string_format("cache/%s", candidates[i]);
+
+			debug(D_WQ, "evicting %s from the cache (%" PRId64 " bytes)", candidates[i], ((struct cache_object *) hash_table_lookup(cache_objects, candidates[i]))->size);
+
+			if(delete_dir(path) == 0) {
+				cache_object_remove(candidates[i]);
+				send_master_message(master, "cache-invalid %s\n", candidates[i]);
+			}
+
+			free(path);
+		}
+
+		free(candidates[i]);
+	}
+
+	free(candidates);
+	hash_table_delete(in_use);
+
+	return cache_has_room(length);
+}
+
+/*
+An object a task needs may have been evicted after the master decided not
+to send it again. Such a task is forsaken, and the master sends the object
+again when it dispatches the task anew.
+*/
+
+static int cache_has_task_inputs(struct work_queue_process *p)
+{
+	struct work_queue_file *f;
+	struct stat info;
+
+	list_first_item(p->task->input_files);
+	while((f = list_next_item(p->task->input_files))) {
+		if(f->type != WORK_QUEUE_DIRECTORY && lstat(f->payload, &info) != 0 && errno == ENOENT) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
 static int handle_tasks(struct link *master)
 {
 	struct work_queue_process *p;
@@ -714,6 +1099,11 @@ static int handle_tasks(struct link *master)
 					}
 				}
 
+				char *name = cache_object_name(f->payload);
+				cache_object_access(name);
+				cache_object_update(name);
+				free(name);
+
 				free(sandbox_name);
 			}
 
@@ -922,6 +1312,10 @@ static int do_task( struct link *master, int taskid, time_t stoptime )
 			string_nformat(localname, sizeof(localname), "cache/%s", filename);
 			url_decode(taskname_encoded, taskname, WORK_QUEUE_LINE_MAX);
 			work_queue_task_specify_file(task, localname, taskname, WORK_QUEUE_INPUT, flags);
+
+			char *name = cache_object_name(filename);
+			cache_object_access(name);
+			free(name);
 		} else if(sscanf(line,"outfile %s %s %d", filename, taskname_encoded, &flags)) {
 			string_nformat(localname, sizeof(localname), "cache/%s", filename);
 			url_decode(taskname_encoded, taskname, WORK_QUEUE_LINE_MAX);
@@ -968,8 +1362,16 @@ static int do_task( struct link *master, int taskid, time_t stoptime )
 	// Every received task goes into procs_table.
 	itable_insert(procs_table,taskid,p);
 
+	// From here on the task itself keeps its files in the cache.
+	hash_table_clear(cache_pending);
+	cache_unpin_forsaken(taskid);
+
 	if(worker_mode==WORKER_MODE_FOREMAN) {
 		work_queue_submit_internal(foreman_q,task);
+	} else if(!cache_has_task_inputs(p)) {
+		debug(D_WQ, "task %d needs files evicted from the cache", taskid);
+		cache_pin_forsaken(p);
+		forsake_waiting_process(master, p);
 	} else {
 		// XXX sandbox setup should be done in task execution,
 		// so that it can be returned cleanly as a failure to execute.
@@ -998,7 +1400,7 @@ static int do_put( struct link *master, char *filename, int64_t length, int mode
 	char *cur_pos;
 
 	debug(D_WQ, "Putting file %s into workspace\n", filename);
-	if(!check_disk_space_for_filesize(".", length, disk_avail_threshold)) {
+	if(!cache_make_room(master, length)) {
 		debug(D_WQ, "Could not put file %s, not enough disk space (%"PRId64" bytes needed)\n", filename, length);
 		return 0;
 	}
@@ -1037,6 +1439,26 @@ static int do_put( struct link *master, char *filename, int64_t length, int mode
 		return 0;
 	}
 
+	const char *put_name = skip_dotslash(filename);
+	if(string_prefix_is(put_name, "content-") && !strchr(put_name, '/')) {
+		struct stat info;
+		free(hash_table_remove(cache_contents, put_name));
+		if(stat(cached_filename, &info) != 0 || !cache_content_is_valid(cached_filename, put_name, &info)) {
+			return 0;
+		}
+	}
+
+	char *name = cache_object_name(filename);
+	if(strchr(skip_dotslash(filename), '/')) {
+		/* a file within a directory adds to the size of the directory. */
+		struct cache_object *o = cache_object_lookup_or_create(name);
+		cache_object_set_size(name, o->size + length);
+	} else {
+		cache_object_set_size(name, length);
+	}
+	cache_pin_pending(name);
+	free(name);
+
 	return 1;
 }
 
@@ -1064,7 +1486,14 @@ static int do_url(struct link* master, const char *filename, int length, int mod
 		char cache_name[WORK_QUEUE_LINE_MAX];
 		string_nformat(cache_name, sizeof(cache_name), "cache/%s", filename);
 
-		return file_from_url(url, cache_name);
+		int result = file_from_url(url, cache_name);
+
+		char *name = cache_object_name(filename);
+		cache_object_update(name);
+		cache_pin_pending(name);
+		free(name);
+
+		return result;
 }
 
 static int do_unlink(const char *path) {
@@ -1450,6 +1879,9 @@ static int handle_master(struct link *master) {
 		} else if(sscanf(line, "unlink %s", filename) == 1) {
 			if(path_within_dir(filename, workspace)) {
 				r = do_unlink(filename);
+				char *name = cache_object_name(filename);
+				cache_object_update(name);
+				free(name);
 			} else {
 				debug(D_WQ, "Path - %s is not within workspace %s.", filename, workspace);
 				r= 0;
@@ -1458,6 +1890,10 @@ static int handle_master(struct link *master) {
 			r = do_get(master, filename, mode);
 		} else if(sscanf(line, "thirdget %o %s %[^\n]", &mode, filename, path) == 3) {
 			r = do_thirdget(mode, filename, path);
+			char *name = cache_object_name(filename);
+			cache_object_update(name);
+			cache_pin_pending(name);
+			free(name);
 		} else if(sscanf(line, "thirdput %o %s %[^\n]", &mode, filename, path) == 3) {
 			r = do_thirdput(master, mode, filename, path);
 			reset_idle_timer();
@@ -1534,7 +1970,7 @@ static int task_resources_fit_eventually(struct work_queue_task *t)
 		(t->resources_requested->gpus   <= r->gpus.largest);
 }
 
-void forsake_waiting_process(struct link *master, struct work_queue_process *p) {
+static void forsake_waiting_process(struct link *master, struct work_queue_process *p) {
 
 	/* the task cannot run in this worker */
 	p->task_status = WORK_QUEUE_RESULT_FORSAKEN;
@@ -1883,18 +2319,51 @@ static int workspace_prepare()
 	setenv("WORKER_TMPDIR", tmp_name, 1);
 	free(tmp_name);
 
+	cache_objects_reset();
+
 	return result;
 }
 
+/*
+Remove the entries of a directory, except those whose names begin with keep_prefix.
+*/
+
+static void delete_dir_contents_except(const char *dirname, const char *keep_prefix)
+{
+	DIR *dir = opendir(dirname);
+	if(!dir) {
+		return;
+	}
+
+	struct dirent *d;
+	while((d = readdir(dir))) {
+		if(!strcmp(d->d_name, ".") || !strcmp(d->d_name, "..") || string_prefix_is(d->d_name, keep_prefix)) {
+			continue;
+		}
+
+		char *path = string_format("%s/%s", dirname, d->d_name);
+		delete_dir(path);
+		free(path);
+	}
+
+	closedir(dir);
+}
+
 /*
 workspace_cleanup is called every time we disconnect from a master,
-to remove any state left over from a previous run.
+to remove any state left over from a previous run. Files in the cache
+named by their contents are kept, as they are valid for any master.
 */
 
 static void workspace_cleanup()
 {
 	debug(D_WQ,"cleaning workspace %s",workspace);
-	delete_dir_contents(workspace);
+
+	char *cachedir = string_format("%s/cache", workspace);
+	delete_dir_contents_except(cachedir, "content-");
+	free(cachedir);
+
+	delete_dir_contents_except(workspace, "cache");
 }
 
 /*
@@ -1915,6 +2384,32 @@ static void workspace_delete()
 	if(procs_complete)     itable_delete(procs_complete);
 	if(procs_waiting)      list_delete(procs_waiting);
 
+	if(cache_objects) {
+		char *name;
+		struct cache_object *o;
+		hash_table_firstkey(cache_objects);
+		while(hash_table_nextkey(cache_objects, &name, (void **) &o)) {
+			free(o);
+		}
+		hash_table_delete(cache_objects);
+	}
+
+	if(cache_forsaken) {
+		cache_unpin_all();
+		itable_delete(cache_forsaken);
+	}
+	if(cache_pending)      hash_table_delete(cache_pending);
+
+	if(cache_contents) {
+		char *name;
+		struct cache_content *c;
+		hash_table_firstkey(cache_contents);
+		while(hash_table_nextkey(cache_contents, &name, (void **) &c)) {
+			free(c);
+		}
+		hash_table_delete(cache_contents);
+	}
+
 	if(watcher)            work_queue_watcher_delete(watcher);
 
 	printf( "work_queue_worker: deleting workspace %s\n", workspace);
@@ -2251,6 +2746,8 @@ static void show_help(const char *cmd)
 	printf( " %-30s worker will clean up and try to reconnect. (default=%" PRIu64 "MB)\n", "", disk_avail_threshold);
 	printf( " %-30s Set available memory size threshold (in MB). When exceeded worker will\n", "--memory-threshold=<size>");
 	printf( " %-30s clean up and reconnect. (default=%" PRIu64 "MB)\n", "", memory_avail_threshold);
+	printf( " %-30s Maximum size of the file cache in MB. Least recently used files not needed\n", "--cache-size=<size>");
+	printf( " %-30s by any task are evicted beyond this size, or when the disk is full. (default=no limit)\n", "");
 	printf( " %-30s Set architecture string for the worker to report to master instead\n", "-A,--arch=<arch>");
 	printf( " %-30s of the value in uname (%s).\n", "", arch_name);
 	printf( " %-30s Set operating system string for the worker to report to master instead\n", "-O,--os=<os>");
@@ -2278,7 +2775,7 @@ enum {LONG_OPT_DEBUG_FILESIZE = 256, LONG_OPT_VOLATILITY, LONG_OPT_BANDWIDTH,
 	  LONG_OPT_DISK, LONG_OPT_GPUS, LONG_OPT_FOREMAN, LONG_OPT_FOREMAN_PORT, LONG_OPT_DISABLE_SYMLINKS,
 	  LONG_OPT_IDLE_TIMEOUT, LONG_OPT_CONNECT_TIMEOUT, LONG_OPT_RUN_DOCKER, LONG_OPT_RUN_DOCKER_PRESERVE,
 	  LONG_OPT_BUILD_FROM_TAR, LONG_OPT_SINGLE_SHOT, LONG_OPT_WALL_TIME, LONG_OPT_DISK_ALLOCATION,
-	  LONG_OPT_MEMORY_THRESHOLD, LONG_OPT_FEATURE};
+	  LONG_OPT_MEMORY_THRESHOLD, LONG_OPT_FEATURE, LONG_OPT_CACHE_SIZE};
 
 static const struct option long_options[] = {
 	{"advertise",           no_argument,        0,  'a'},
@@ -2306,6 +2803,7 @@ static const struct option long_options[] = {
 	{"disable-symlinks",    no_argument,        0,  LONG_OPT_DISABLE_SYMLINKS},
 	{"disk-threshold",      required_argument,  0,  'z'},
 	{"memory-threshold",    required_argument,  0,  LONG_OPT_MEMORY_THRESHOLD},
+	{"cache-size",          required_argument,  0,  LONG_OPT_CACHE_SIZE},
 	{"arch",                required_argument,  0,  'A'},
 	{"os",                  required_argument,  0,  'O'},
 	{"workdir",             required_argument,  0,  's'},
@@ -2442,6 +2940,9 @@ int main(int argc, char *argv[])
 		case LONG_OPT_MEMORY_THRESHOLD:
 			memory_avail_threshold = atoll(optarg);
 			break;
+		case LONG_OPT_CACHE_SIZE:
+			cache_size_limit = atoll(optarg) * MEGA;
+			break;
 		case 'A':
 			free(arch_name); //free the arch string obtained from uname
 			arch_name = xxstrdup(optarg);
@@ -2719,6 +3220,11 @@ int main(int argc, char *argv[])
 	procs_waiting  = list_create();
 	procs_complete = itable_create(0);
 
+	cache_objects = hash_table_create(0, 0);
+	cache_pending = hash_table_create(0, 0);
+	cache_forsaken = itable_create(0);
+	cache_contents = hash_table_create(0, 0);
+
 	watcher = work_queue_watcher_create();
 
 	if(!check_disk_space_for_filesize(".", 0, disk_avail_threshold)) {
@@ -0,0 +1,72 @@
+#!/bin/sh
+
+# Tasks whose cached inputs add up to more than the cache size of the
+# worker must all complete, with older inputs evicted to make room.
+
+. ../../dttools/test/test_runner_common.sh
+
+export PATH=../src:$PATH
+
+TASKS=6
+
+prepare()
+{
+	echo "nothing to do"
+}
+
+run()
+{
+	# Each submit makes a new input of 2 MB, cached, and used by one task.
+	rm -f master.script
+	i=0
+	while [ $i -lt $TASKS ]
+	do
+		echo "submit 2 0 0 1" >> master.script
+		i=$((i+1))
+	done
+	echo "wait" >> master.script
+	echo "quit" >> master.script
+
+	echo "starting master"
+	work_queue_test -d all -o master.log -Z master.port < master.script &
+
+	echo "waiting for master to get ready"
+	wait_for_file_creation master.port 5
+
+	port=`cat master.port`
+
+	echo "starting worker with a cache of 5 MB"
+	work_queue_worker -d all -o worker.log localhost $port -b 1 --timeout 20 --cores 1 --memory-threshold 10 --memory 50 --cache-size 5 --single-shot
+
+	i=0
+	while [ $i -lt $TASKS ]
+	do
+		if [ ! -f output.$i ]
+		then
+			echo "output.$i is missing!"
+			cat worker.log
+			return 1
+		fi
+		i=$((i+1))
+	done
+
+	evicted=`grep -c "evicting" worker.log`
+	echo "$evicted inputs were evicted"
+
+	if [ $evicted -lt 1 ]
+	then
+		echo "the cache was never full"
+		return 1
+	fi
+
+	return 0
+}
+
+clean()
+{
+	rm -f master.script master.log master.port worker.log output.* input.*
+}
+
+dispatch "$@"
+
+# vim: set noexpandtab tabstop=4: